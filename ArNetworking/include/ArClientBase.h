@@ -139,6 +139,11 @@ public:
   /// Sees if this data exists
   AREXPORT bool dataExists(const char *name);
 
+  /// Decodes a reply to getSensorCurrentCompact or getSensorCumulativeCompact
+  AREXPORT static bool decodeCompactSensorReadings(
+	  ArNetPacket *packet, std::vector<ArPose> *readings, 
+	  ArTypes::UByte4 *sequence, std::string *sensorName = NULL);
+
   /// Gets the name of the host we tried to connect to
   AREXPORT const char *getHost(void);
 
@@ -3,6 +3,7 @@
 
 #include "Aria.h"
 #include "ArClientBase.h"
+#include "md5.h"
 
 /// The item type that the ArCLientFileLister gets back
 class ArClientFileListerItem
@@ -136,10 +137,22 @@ protected:
    the int for the callback means everything is good, positive error
    messages are from the server (1 == tried to go outside allowed
    area, 2 == no such directory, 3 == empty file name, 4 == problem
-   reading file), negative are from this class (-1 == got directory
-   but it wasn't what we wanted (if you wait the right one might come
-   in, like if someone selects one dir then the other), -2 == can't
-   open file to put result into).
+   reading file, 5 == asked to resume past the end of the file),
+   negative are from this class (-1 == got directory but it wasn't
+   what we wanted (if you wait the right one might come in, like if
+   someone selects one dir then the other), -2 == can't open file to
+   put result into, -3 == streamed data didn't come in order, -4 ==
+   streamed file didn't match the server's MD5 (the file is removed),
+   -5 == couldn't write the streamed data to the file).  When a
+   streamed get fails any other way what was written is left in the
+   file so it can be resumed.
+
+   If the server supports it (isAvailableStreamed())
+   getFileStreamedFromDirectory() gets the file a window at a time,
+   acknowledging each packet once it is written, so a big file
+   doesn't hold up everything else the server is sending this client.
+   It can resume a file that was partially gotten before and checks
+   the whole file against the server's MD5 of it.
 **/
 class ArClientFileToClient
 {
@@ -158,6 +171,14 @@ public:
                                      const char *fileName, 
                                      const char *clientFileName,
                                      bool isSetTimestamp = false);
+  /// Sees if the server supports streaming files
+  AREXPORT bool isAvailableStreamed(void);
+  /// Streams the file from a directory (optionally resuming a partial one)
+  AREXPORT bool getFileStreamedFromDirectory(const char *directory, 
+					     const char *fileName, 
+					     const char *clientFileName,
+					     bool resume = false,
+					     ArTypes::UByte4 window = 0);
   /// Cancels getting a file
   AREXPORT void cancelGet(void);
   /// If we're getting a file now
@@ -187,6 +208,10 @@ protected:
   AREXPORT void doGetFile(ArNetPacket *packet,
                           bool isSetTimestamp);
   AREXPORT void callFileReceivedCallbacks(int val);
+  AREXPORT void netGetFileStreamed(ArNetPacket *packet);
+  AREXPORT void streamedFileDone(int val);
+  AREXPORT std::string buildWholeFileName(const char *directory, 
+					  const char *fileName);
 
 
 protected:
@@ -206,8 +231,14 @@ protected:
 
   std::list<ArFunctor1<int> *> myFileReceivedCallbacks;
 
+  // what we've written and its checksum when streaming a file
+  bool myIsStreaming;
+  ArTypes::UByte4 myStreamOffset;
+  md5_state_t myStreamMD5;
+
   ArFunctor1C<ArClientFileToClient, ArNetPacket *> myGetFileCB;
   ArFunctor1C<ArClientFileToClient, ArNetPacket *> myGetFileWithTimestampCB;
+  ArFunctor1C<ArClientFileToClient, ArNetPacket *> myGetFileStreamedCB;
 };
 
 /// Class for putting files to the server
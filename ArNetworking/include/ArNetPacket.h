@@ -41,6 +41,10 @@ public:
   AREXPORT virtual void doubleToBuf(double val);
   /// Gets a double from the packet buffer
   AREXPORT virtual double bufToDouble(void);
+  /// Puts a variable length (zigzag varint) integer into the packet buffer
+  AREXPORT void varIntToBuf(ArTypes::Byte4 val);
+  /// Gets a variable length (zigzag varint) integer from the packet buffer
+  AREXPORT ArTypes::Byte4 bufToVarInt(void);
   AREXPORT virtual void empty(void);
   AREXPORT virtual void finalizePacket(void);
   AREXPORT virtual void resetRead(void);
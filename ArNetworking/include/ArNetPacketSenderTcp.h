@@ -4,6 +4,39 @@
 #include "Aria.h"
 #include "ArNetPacket.h"
 
+/// An immutable, reference counted copy of a finalized packet
+/**
+   This lets a packet that is broadcast to many clients be copied once
+   and then queued on each client's ArNetPacketSenderTcp by reference.
+   The packet header has no per client fields, so the finalized bytes
+   are the same for every client.  The packet is deleted when the last
+   reference is released.
+**/
+class ArNetSharedPacket
+{
+public:
+  /// Constructor, copies the (finalized) packet and holds one reference
+  AREXPORT ArNetSharedPacket(ArNetPacket *packet);
+  /// Adds a reference
+  AREXPORT void addRef(void);
+  /// Releases a reference, deleting this if it was the last one
+  AREXPORT void release(void);
+  /// Gets the finalized packet data
+  const char *getBuf(void) const { return myBuf; }
+  /// Gets the length of the finalized packet data
+  int getLength(void) const { return myLength; }
+  /// Gets the command of the packet
+  ArTypes::UByte2 getCommand(void) const { return myCommand; }
+protected:
+  /// Destructor, use release instead
+  AREXPORT ~ArNetSharedPacket();
+  ArMutex myRefMutex;
+  int myRefCount;
+  char *myBuf;
+  int myLength;
+  ArTypes::UByte2 myCommand;
+};
+
 class ArNetPacketSenderTcp
 {
 public:
@@ -30,16 +63,29 @@ public:
   AREXPORT void sendPacket(ArNetPacket *packet, 
 			   const char *loggingString = "");
 
+  /// Sends a shared packet, without copying it
+  AREXPORT void sendSharedPacket(ArNetSharedPacket *packet);
+
   /// Tries to send the data there is to be sent
   AREXPORT bool sendData(void);
+
+  /// Returns true if there is data waiting to be sent
+  AREXPORT bool hasDataToSend(void);
+
+  /// Checks the backup timeout without sending, false if it has expired
+  AREXPORT bool checkBackupTimeout(void);
+
+  /// Sets a callback that is called whenever a packet is queued
+  AREXPORT void setDataQueuedCB(ArFunctor *functor);
 protected:
   ArMutex myDataMutex;
   bool myDebugLogging;
   std::string myLoggingPrefix;
   ArLog::LogLevel myVerboseLogLevel;
   ArSocket *mySocket;
-  std::list<ArNetPacket *> myPacketList;
-  ArNetPacket *myPacket;
+  std::list<ArNetSharedPacket *> myPacketList;
+  ArNetSharedPacket *myPacket;
+  ArFunctor *myDataQueuedCB;
   int myAlreadySent;
   const char *myBuf;
   int myLength;
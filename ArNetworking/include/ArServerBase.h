@@ -105,6 +105,10 @@ public:
   AREXPORT void close(void);
   /// Runs the server loop once
   AREXPORT void loopOnce(void);
+  /// Sets whether the server loop waits on its sockets with epoll (Linux only)
+  AREXPORT bool setUseEpoll(bool useEpoll, unsigned int cycleMSecs = 10);
+  /// Gets whether the server loop waits on its sockets with epoll
+  AREXPORT bool getUseEpoll(void);
 
   /// Adds a callback to be called when requests for some data are recieved.
   AREXPORT bool addData(const char *name, const char *description,
@@ -378,6 +382,18 @@ protected:
 
   /// accepts new sockets and moves them into the client list
   void acceptTcpSockets(void);
+  /// the part of the loop after the new data on the server sockets
+  void processClients(bool pollSockets);
+  /// runs the loop once, waiting on the sockets with epoll
+  void epollLoopOnce(void);
+  /// adds the server sockets to the epoll set
+  void epollAddServerSockets(void);
+  /// adds new clients to the epoll set and updates the events they wait on
+  void epollUpdateClients(void);
+  /// takes a client out of the epoll set
+  void epollRemoveClient(ArServerClient *client, bool forget);
+  /// wakes up the epoll loop (from a client queuing tcp data)
+  void epollWake(void);
   /// Internal function for server/client switching
   AREXPORT ArServerClient *finishAcceptingSocket(
 	  ArSocket *socket, bool skipPassword = false, 
@@ -449,6 +465,17 @@ protected:
 
   unsigned int myLoopMSecs;
 
+  // epoll set, its wake up eventfd, and the events each client is
+  // registered for (-1 if it was taken out because it failed)
+  int myEpollFD;
+  int myEpollWakeFD;
+  unsigned int myEpollCycleMSecs;
+  ArTime myEpollLastCycle;
+  std::map<ArServerClient *, int> myEpollClients;
+  ArMutex myEpollWakeMutex;
+  bool myEpollWakePending;
+  ArFunctorC<ArServerBase> myEpollWakeCB;
+
   ArMutex myAddListMutex;
   std::list<ArServerClient *> myAddList;
   ArMutex myRemoveSetMutex;
@@ -51,6 +51,9 @@ public:
   /// The callback for taking care of the TCP connection
   AREXPORT bool tcpCallback(void);
 
+  /// The callback for the TCP connection, reading and/or sending only if told to
+  AREXPORT bool tcpCallback(bool doRead, bool doSend);
+
   /// The callback for taking care of slow packets 
   AREXPORT bool slowPacketCallback(void);
 
@@ -86,6 +89,22 @@ public:
    */
   AREXPORT void broadcastPacketUdp(ArNetPacket *packet);
 
+  /** Broadcasts an already finalized packet over TCP if this client
+   * wants this data, queueing the shared copy instead of copying the
+   * packet -- For internal use only!
+   * @internal 
+   */
+  AREXPORT void broadcastPacketTcp(ArNetPacket *packet,
+				   ArNetSharedPacket *sharedPacket); 
+
+  /** Broadcasts an already finalized packet over UDP if this client
+   * wants this data (unless client only wants tcp then queues the
+   * shared copy over tcp) -- For internal ArNetworking use only!
+   * @internal 
+   */
+  AREXPORT void broadcastPacketUdp(ArNetPacket *packet,
+				   ArNetSharedPacket *sharedPacket);
+
   /// Logs the tracking information (packet and byte counts)
   AREXPORT void logTracking(bool terse);
   
@@ -121,6 +140,12 @@ public:
 
   /// Internal function to get the tcp socket
   AREXPORT ArSocket *getTcpSocket(void) { return &myTcpSocket; }
+  /// Internal function to see if there is tcp data waiting to be sent
+  AREXPORT bool hasTcpDataToSend(void) 
+    { return myTcpSender.hasDataToSend(); }
+  /// Internal function to set a callback for when tcp data is queued
+  AREXPORT void setTcpDataQueuedCB(ArFunctor *functor)
+    { myTcpSender.setDataQueuedCB(functor); }
   /// Forcibly disconnect a client (for client/server switching)
   AREXPORT void forceDisconnect(bool quiet);
   /// Gets how often a command is asked for
@@ -178,6 +203,11 @@ protected:
   std::list<bool> mySlowIdleForceTcpStack;  
 
   AREXPORT bool setupPacket(ArNetPacket *packet);
+  // Queues a broadcast packet that was already set up by the server
+  bool sendSharedPacketTcp(ArNetPacket *packet, 
+			   ArNetSharedPacket *sharedPacket);
+  // Whether this client requested the data for this command
+  bool hasRequested(unsigned int command);
   // Pushes a new number onto our little stack of numbers
   void pushCommand(unsigned int num);
   // Pops the command off the stack
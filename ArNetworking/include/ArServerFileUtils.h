@@ -3,6 +3,7 @@
 
 #include "Aria.h"
 #include "ArServerBase.h"
+#include "md5.h"
 
 
 /// Provides a list of files to clients
@@ -60,6 +61,15 @@ protected:
    directly, this is because the API is and will remain fairly
    volatile... if you need more functionality let us know and we'll
    add it if its reasonable.
+
+   Besides getFile and getFileWithTimestamp (which queue the whole
+   file to the client at once) this provides getFileStreamed, which
+   sends a window of the file at a time and sends more each time the
+   client acknowledges what it has written.  That keeps big files
+   from filling the client's send queue (and holding up everything
+   else being sent to it), lets a client resume a file it got part
+   of and ends with an MD5 of the whole file so the client can check
+   it got the file intact.
 **/
 class ArServerFileToClient
 {
@@ -76,6 +86,17 @@ public:
   AREXPORT void getFileWithTimestamp(ArServerClient *client,
                                      ArNetPacket *packet);
 
+  /// Starts, continues or cancels streaming a file to the client
+  AREXPORT void getFileStreamed(ArServerClient *client,
+				ArNetPacket *packet);
+
+  /// Sets the number of bytes sent to a client before it has to acknowledge them
+  void setStreamWindow(ArTypes::UByte4 window) { myStreamWindow = window; }
+  /// Gets the number of bytes sent to a client before it has to acknowledge them
+  ArTypes::UByte4 getStreamWindow(void) const { return myStreamWindow; }
+
+  /// Bytes of file data in each streamed packet
+  enum { STREAM_CHUNK_SIZE = 30000 };
 
 protected:
 
@@ -83,6 +104,15 @@ protected:
                           ArNetPacket *packet,
                           bool isSetTimestamp);
 
+  AREXPORT int findFile(const char *fileNameRaw, std::string *wholeName);
+
+  AREXPORT void clientRemoved(ArServerClient *client);
+
+  class StreamInfo;
+  AREXPORT void sendStreamWindow(ArServerClient *client, StreamInfo *info);
+  AREXPORT void sendStreamFailed(ArServerClient *client, 
+				 const char *fileNameRaw, int ret);
+
 protected:
   
   char myBaseDir[2048];
@@ -94,6 +124,34 @@ protected:
   ArFunctor2C<ArServerFileToClient, 
               ArServerClient *, 
               ArNetPacket *> myGetFileWithTimestampCB;
+
+  ArFunctor2C<ArServerFileToClient, 
+              ArServerClient *, 
+              ArNetPacket *> myGetFileStreamedCB;
+  ArFunctor1C<ArServerFileToClient, ArServerClient *> myClientRemovedCB;
+
+  ArTypes::UByte4 myStreamWindow;
+
+  class StreamInfo
+  {
+  public:
+    StreamInfo() { myFile = NULL; }
+    virtual ~StreamInfo() { if (myFile != NULL) fclose(myFile); }
+    std::string myRawFileName;
+    std::string myWholeFileName;
+    FILE *myFile;
+    ArTypes::UByte4 myFileSize;
+    time_t myFileTimestamp;
+    // how far into the file we've sent and the client has written
+    ArTypes::UByte4 mySent;
+    ArTypes::UByte4 myAcked;
+    ArTypes::UByte4 myWindow;
+    md5_state_t myMD5;
+  };
+
+  ArMutex myStreamMutex;
+  // the file each client is streaming, a client gets one at a time
+  std::map<ArServerClient *, StreamInfo *> myStreams;
 };
 
 // ----------------------------------------------------------------------------
@@ -25,6 +25,8 @@ class ArMapInterface;
  *  <li><code>getGoals</code>
  *  <li><code>getMapBinary</code>
  *  <li><code>getMapMultiScans</code>
+ *  <li><code>getMapWithMaxCategory</code>
+ *  <li><code>getMapIfChanged</code>
  * </ul>
  *
  * The following data types will also be broadcast to all clients to indicate
@@ -69,6 +71,22 @@ class ArMapInterface;
  * but it includes a list of the scan sources, along with the point and lines 
  * for each scan source in binary format.
  *
+ * The <code>getMapIfChanged</code> request takes the category (as for
+ * getMapWithMaxCategory) followed by the ArMapId of the map the client
+ * already has (see ArMapId::toPacket), so that a client that saved the
+ * map from an earlier connection doesn't need to download it again.  The
+ * first packet of the reply has a uByte that is 1 if the client's map is
+ * current and 0 if it is not, followed by the ArMapId of the server's map.
+ * If the client's map is current this is followed by an empty packet,
+ * otherwise it is followed by the map just as getMapWithMaxCategory sends
+ * it.
+ *
+ * The packets of the binary map requests are built the first time a
+ * client asks for the map in each category and then kept, so that each
+ * later client just gets copies of them instead of the map being walked
+ * and encoded again.  These are thrown away when the map changes (or its
+ * map ID does), see setUsePacketCache() and clearPacketCache().
+ *
  * The <code>mapUpdated</code> packet is sent to all connected clients whenever
  * a new map is loaded or the map is changed.  The packet contains no data; the 
  * new map can be downloaded using one of the above requests.
@@ -118,16 +136,26 @@ public:
   AREXPORT void serverGetMapWithMaxCategory(ArServerClient *client,
 				                                    ArNetPacket *packet);
 
+  /// Sends the map with the specified maximum features if the client's map ID doesn't match
+  AREXPORT void serverGetMapIfChanged(ArServerClient *client,
+                                      ArNetPacket *packet);
+
   /// The command that'll get the goals
   AREXPORT void serverGetGoals(ArServerClient *client,
 			                         ArNetPacket *packet);
 
   /// Sets which kind of data we send 
-  AREXPORT void setDataToSend(DataToSend dataToSend) 
-    { myDataToSend = dataToSend; }
+  AREXPORT void setDataToSend(DataToSend dataToSend);
   /// Gets which kind of data we send
   DataToSend getDataToSend(void) { return myDataToSend; }
 
+  /// Sets whether the packets of the map are cached for the next client
+  AREXPORT void setUsePacketCache(bool usePacketCache);
+  /// Gets whether the packets of the map are cached for the next client
+  bool getUsePacketCache(void) { return myUsePacketCache; }
+  /// Throws away the cached packets of the map
+  AREXPORT void clearPacketCache(void);
+
 protected:
   AREXPORT void handleCheckMap(ArServerClient *client, 
                                ArNetPacket *packet);
@@ -135,6 +163,15 @@ protected:
   AREXPORT void sendMapWithMaxCategory(ArServerClient *client,
 				                               const char *maxCategory);
 
+  AREXPORT void sendMapForCategory(ArServerClient *client,
+                                   const char *maxCategory);
+
+  // sends the map from the packet cache, building it if needed
+  AREXPORT bool sendCachedMap(ArServerClient *client, 
+                              const char *maxCategory);
+  // sends the packet to the client, or caches it if the client is NULL
+  AREXPORT void sendToClient(ArServerClient *client, ArNetPacket *packet);
+
   AREXPORT bool processFile(void);
   AREXPORT void mapChanged(void);
   // internal function that is used to toss the map to the client
@@ -161,6 +198,15 @@ protected:
   char myLastMapFile[1024];
   struct stat myLastMapFileStat;
 
+  bool myUsePacketCache;
+  // the packets of the map for each category, the binary map is ""
+  std::map<std::string, std::list<ArNetPacket *> > myPacketCache;
+  // the map ID of the map the cached packets are from
+  ArMapId myPacketCacheMapId;
+  ArMutex myPacketCacheMutex;
+  // the list the packets go into while the cache is being built
+  std::list<ArNetPacket *> *myCacheBuilding;
+
   ArFunctor2C<ArServerHandlerMap, 
       ArServerClient *, ArNetPacket *> myGetMapIdCB;
   ArFunctor2C<ArServerHandlerMap, 
@@ -173,6 +219,8 @@ protected:
       ArServerClient *, ArNetPacket *> myGetMapMultiScansCB;
   ArFunctor2C<ArServerHandlerMap, 
       ArServerClient *, ArNetPacket *> myGetMapMaxCategoryCB;
+  ArFunctor2C<ArServerHandlerMap, 
+      ArServerClient *, ArNetPacket *> myGetMapIfChangedCB;
   ArFunctor2C<ArServerHandlerMap, 
       ArServerClient *, ArNetPacket *> myGetGoalsCB;
   ArFunctor2C<ArServerHandlerMap, 
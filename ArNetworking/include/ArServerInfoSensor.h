@@ -41,6 +41,48 @@ class ArServerClient;
  *  </li>
  * </ol>
  *
+ * There are also <code>getSensorCurrentCompact</code> and
+ * <code>getSensorCumulativeCompact</code> requests, which send the same
+ * readings in much less space.  Clients should check that the server
+ * has them (ArClientBase::dataExists()) and use the requests above if
+ * it doesn't.  These requests must include the following data, which
+ * may be repeated for more sensors:
+ * <ol>
+ *  <li>Sensor name (Null-terminated string)</li>
+ *  <li>Sequence number of the last reply the client got for this
+ *  sensor, or 0 if it has none (4-byte unsigned integer)</li>
+ *  <li>Resolution to send the readings at in mm, 0 for 1 mm (2-byte
+ *  unsigned integer)</li>
+ * </ol>
+ *
+ * These requests reply with the following data packets:
+ * <ol>
+ *  <li>Number of readings in this packet, or -1 for invalid sensor
+ *  name error (2-byte integer)</li>
+ *  <li>Sensor name (null-terminated string)</li>
+ *  <li>Sequence number of these readings, to send with the next
+ *  request (4-byte unsigned integer)</li>
+ *  <li>Index of the first of the readings the client has for the
+ *  sequence number it sent that it should keep, or -1 if these are
+ *  all of the readings (4-byte integer)</li>
+ *  <li>Number of the readings the client has that it should keep
+ *  (4-byte integer)</li>
+ *  <li>Number of the readings in this packet that go before the kept
+ *  readings, the rest go after them (2-byte integer)</li>
+ *  <li>Resolution of the readings in mm (2-byte unsigned integer)</li>
+ *  <li>X and Y of the origin, which is the robot position (4-byte
+ *  integers)</li>
+ *  <li>For each reading:
+ *    <ol>
+ *      <li>X then Y of the reading, in resolution units from the
+ *      origin for the first reading and from the previous reading for
+ *      the rest (each a variable length integer, see
+ *      ArNetPacket::varIntToBuf())</li>
+ *    </ol>
+ *  </li>
+ * </ol>
+ * ArClientBase::decodeCompactSensorReadings() decodes these replies.
+ *
  * This service's requests are all in the <code>SensorInfo</code> group.
  */
 class ArServerInfoSensor
@@ -52,12 +94,33 @@ public:
   AREXPORT void getSensorCurrent(ArServerClient *client, ArNetPacket *packet);
   AREXPORT void getSensorCumulative(ArServerClient *client, 
 				    ArNetPacket *packet);
+  AREXPORT void getSensorCurrentCompact(ArServerClient *client, 
+					ArNetPacket *packet);
+  AREXPORT void getSensorCumulativeCompact(ArServerClient *client, 
+					   ArNetPacket *packet);
 protected:
+  AREXPORT void sendCompact(ArServerClient *client, ArNetPacket *packet,
+			    bool cumulative);
+
+  /// A set of readings we sent, x and y in mm one after the other
+  struct SentReadings
+  {
+    ArTypes::UByte4 mySequence;
+    std::vector<ArTypes::Byte4> myPoints;
+  };
+  // the last few sets of readings sent for each sensor (current and
+  // cumulative are kept separately), newest at the back
+  std::map<std::string, std::list<SentReadings> > mySentReadings;
+  ArTypes::UByte4 myNextSequence;
+  ArMutex mySentReadingsMutex;
+
   ArRobot *myRobot;
   ArServerBase *myServer;
   ArFunctor2C<ArServerInfoSensor, ArServerClient *, ArNetPacket *> myGetSensorListCB;
   ArFunctor2C<ArServerInfoSensor, ArServerClient *, ArNetPacket *> myGetSensorCurrentCB;
   ArFunctor2C<ArServerInfoSensor, ArServerClient *, ArNetPacket *> myGetSensorCumulativeCB;
+  ArFunctor2C<ArServerInfoSensor, ArServerClient *, ArNetPacket *> myGetSensorCurrentCompactCB;
+  ArFunctor2C<ArServerInfoSensor, ArServerClient *, ArNetPacket *> myGetSensorCumulativeCompactCB;
   
 };
 
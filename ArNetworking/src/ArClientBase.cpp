@@ -1859,6 +1859,96 @@ AREXPORT bool ArClientBase::dataExists(const char *name)
   return ret;
 }
 
+/**
+   The compact sensor replies (see ArServerInfoSensor) can be just the
+   changes from the readings the client already has, so this updates
+   @p readings and @p sequence in place.  Keep both for each sensor and
+   send the sequence with the next request; start with no readings and
+   a sequence of 0.
+
+   @param packet the reply packet
+   @param readings the readings for this sensor, which are updated
+   @param sequence the sequence number of @p readings, which is updated
+   @param sensorName if not NULL this is set to the name of the sensor
+   the reply is for
+
+   @return true if the readings were updated, false if there is no
+   sensor by that name, or if the reply couldn't be applied to the
+   readings (in which case they are cleared and the sequence set to 0
+   so that the next reply has all the readings)
+**/
+AREXPORT bool ArClientBase::decodeCompactSensorReadings(
+	ArNetPacket *packet, std::vector<ArPose> *readings, 
+	ArTypes::UByte4 *sequence, std::string *sensorName)
+{
+  char name[512];
+  ArTypes::Byte2 numReadings;
+  ArTypes::UByte4 newSequence;
+  ArTypes::Byte4 keepStart;
+  ArTypes::Byte4 keepCount;
+  int numBefore;
+  int resolution;
+  int x;
+  int y;
+  int i;
+
+  numReadings = packet->bufToByte2();
+  packet->bufToStr(name, sizeof(name));
+  if (sensorName != NULL)
+    *sensorName = name;
+  if (numReadings < 0)
+    return false;
+
+  newSequence = packet->bufToUByte4();
+  keepStart = packet->bufToByte4();
+  keepCount = packet->bufToByte4();
+  numBefore = packet->bufToByte2();
+  resolution = packet->bufToUByte2();
+  x = packet->bufToByte4();
+  y = packet->bufToByte4();
+
+  std::vector<ArPose> kept;
+  if (keepStart >= 0)
+  {
+    if (keepCount < 0 || (size_t)(keepStart + keepCount) > readings->size())
+    {
+      readings->clear();
+      *sequence = 0;
+      return false;
+    }
+    kept.assign(readings->begin() + keepStart, 
+		readings->begin() + keepStart + keepCount);
+  }
+  readings->clear();
+  readings->reserve(kept.size() + numReadings);
+
+  // the origin is in mm, the rest is in resolution units from it
+  double originX = x;
+  double originY = y;
+  x = 0;
+  y = 0;
+  for (i = 0; i < numReadings; i++)
+  {
+    if (i == numBefore)
+      readings->insert(readings->end(), kept.begin(), kept.end());
+    x += packet->bufToVarInt();
+    y += packet->bufToVarInt();
+    readings->push_back(ArPose(originX + x * resolution, 
+			       originY + y * resolution));
+  }
+  if (numBefore >= numReadings)
+    readings->insert(readings->end(), kept.begin(), kept.end());
+  
+  if (!packet->isValid())
+  {
+    readings->clear();
+    *sequence = 0;
+    return false;
+  }
+  *sequence = newSequence;
+  return true;
+}
+
 AREXPORT void ArClientBase::logDataList(void)
 {
   std::map<unsigned int, ArClientData *>::iterator it;
@@ -446,8 +446,11 @@ AREXPORT ArClientFileToClient::ArClientFileToClient(ArClientBase *client) :
   myLastRequested(),
   myLastReceived(),
   myFileReceivedCallbacks(),
+  myIsStreaming(false),
+  myStreamOffset(0),
   myGetFileCB(this, &ArClientFileToClient::netGetFile),
-  myGetFileWithTimestampCB(this, &ArClientFileToClient::netGetFileWithTimestamp)
+  myGetFileWithTimestampCB(this, &ArClientFileToClient::netGetFileWithTimestamp),
+  myGetFileStreamedCB(this, &ArClientFileToClient::netGetFileStreamed)
 {
   myDataMutex.setLogName("ArClientFileToClient::myDataMutex");
   myCallbackMutex.setLogName("ArClientFileToClient::myCallbackMutex");
@@ -455,6 +458,7 @@ AREXPORT ArClientFileToClient::ArClientFileToClient(ArClientBase *client) :
   if (myClient != NULL) {
     myClient->addHandler("getFile", &myGetFileCB);
     myClient->addHandler("getFileWithTimestamp", &myGetFileWithTimestampCB);
+    myClient->addHandler("getFileStreamed", &myGetFileStreamedCB);
   }
 }
 
@@ -510,6 +514,36 @@ AREXPORT bool ArClientFileToClient::getFileFromDirectory(const char *directory,
     myDirectory = "";
   myFileName = fileName;
   myClientFileName = clientFileName;
+  myWholeFileName = buildWholeFileName(directory, fileName);
+
+  ArNetPacket sendPacket;
+  sendPacket.strToBuf(myWholeFileName.c_str());
+  sendPacket.uByte2ToBuf(0);
+
+  if (isSetTimestamp && isAvailableSetTimestamp()) {
+    myClient->requestOnce("getFileWithTimestamp", &sendPacket);
+  } 
+  else {
+    myClient->requestOnce("getFile", &sendPacket);
+
+    if (isSetTimestamp) {
+      ArLog::log(ArLog::Normal,
+                 "File timestamps are not available, using getFile");
+      // TODO: Special return value?
+    }
+  }
+
+  myIsWaitingForFile = true;
+  myLastRequested.setToNow();
+  myDataMutex.unlock();
+  return true;
+}
+
+/// Puts the directory and file name together the way the server wants them
+AREXPORT std::string ArClientFileToClient::buildWholeFileName(
+	const char *directory, const char *fileName)
+{
+  std::string wholeFileName;
 
   char *dirStr = NULL;
   int dirLen;
@@ -530,40 +564,233 @@ AREXPORT bool ArClientFileToClient::getFileFromDirectory(const char *directory,
   // and that the slashes go a consistent direction
   ArUtil::fixSlashes(fileStr, fileLen);
 
-  if (directory == NULL)
-    myWholeFileName = "";
-  else
-    myWholeFileName = dirStr;
+  if (directory != NULL)
+    wholeFileName = dirStr;
 
-  myWholeFileName += fileStr;
+  wholeFileName += fileStr;
 
-  ArNetPacket sendPacket;
-  sendPacket.strToBuf(myWholeFileName.c_str());
-  sendPacket.uByte2ToBuf(0);
+  if (dirStr != NULL)
+    delete[] dirStr;
+  delete[] fileStr;    
+  return wholeFileName;
+}
 
-  if (isSetTimestamp && isAvailableSetTimestamp()) {
-    myClient->requestOnce("getFileWithTimestamp", &sendPacket);
-  } 
-  else {
-    myClient->requestOnce("getFile", &sendPacket);
+AREXPORT bool ArClientFileToClient::isAvailableStreamed(void)
+{
+  return ((myClient != NULL) &&
+          (myClient->dataExists("getFileStreamed")));
+}
+
+/**
+   This gets the file like getFileFromDirectory(), but the server
+   only sends a window of the file at a time, and sends more as this
+   acknowledges what it has written.  When the file is done it is
+   checked against the server's MD5 of it, and its timestamp is set
+   to the server's.
+
+   @param directory the directory on the server (NULL for the base)
+   @param fileName the file on the server
+   @param clientFileName where to put the file
+   @param resume if this is true and clientFileName already exists
+   only the rest of the file after what is in clientFileName is
+   gotten (for when a get was interrupted)
+   @param window how many bytes the server sends before it waits for
+   an acknowledgement, 0 for the server's default
+**/
+AREXPORT bool ArClientFileToClient::getFileStreamedFromDirectory(
+	const char *directory, const char *fileName, 
+	const char *clientFileName, bool resume, ArTypes::UByte4 window)
+{
+  myDataMutex.lock();
+  if (fileName == NULL || clientFileName == NULL)
+  {
+    ArLog::log(ArLog::Terse, 
+	       "ArClientFileToClient: NULL fileName ('%s') or clientFileName ('%s')", 
+	       fileName, clientFileName);
+    myDataMutex.unlock();
+    return false;
+  }
+  if (!isAvailableStreamed())
+  {
+    ArLog::log(ArLog::Normal, "ArClientFileToClient::getFileStreamedFromDirectory: Tried to stream file but the server doesn't support it.");
+    myDataMutex.unlock();
+    return false;
+  }
+  if (myIsWaitingForFile)
+  {
+    ArLog::log(ArLog::Terse, 
+	       "ArClientFileToClient: already busy downloading a file '%s' cannot download '%s'", 
+	       myFileName.c_str(), fileName);
+    myDataMutex.unlock();
+    return false;
+  }
 
-    if (isSetTimestamp) {
-      ArLog::log(ArLog::Normal,
-                 "File timestamps are not available, using getFile");
-      // TODO: Special return value?
+  md5_init(&myStreamMD5);
+  myStreamOffset = 0;
+  // if we're resuming pick up where the file we have leaves off (and
+  // get its checksum since the server's is of the whole file)
+  if (resume && (myFile = ArUtil::fopen(clientFileName, "r+b")) != NULL)
+  {
+    char buf[32000];
+    size_t ret;
+    while ((ret = fread(buf, 1, sizeof(buf), myFile)) > 0)
+    {
+      md5_append(&myStreamMD5, (md5_byte_t *)buf, ret);
+      myStreamOffset += ret;
     }
+    fseek(myFile, 0, SEEK_END);
+  }
+  else if ((myFile = ArUtil::fopen(clientFileName, "wb")) == NULL)
+  {
+    ArLog::log(ArLog::Normal, "Can't open '%s' to put file into", 
+	       clientFileName);
+    myDataMutex.unlock();
+    return false;
   }
 
+  if (directory != NULL)
+    myDirectory = directory;
+  else
+    myDirectory = "";
+  myFileName = fileName;
+  myClientFileName = clientFileName;
+  myWholeFileName = buildWholeFileName(directory, fileName);
+
+  ArNetPacket sendPacket;
+  sendPacket.uByte2ToBuf(0);
+  sendPacket.strToBuf(myWholeFileName.c_str());
+  sendPacket.uByte4ToBuf(myStreamOffset);
+  sendPacket.uByte4ToBuf(window);
+  myClient->requestOnce("getFileStreamed", &sendPacket);
+
+  if (myStreamOffset > 0)
+    ArLog::log(ArLog::Normal, "Resuming file %s at %u", 
+	       myFileName.c_str(), myStreamOffset);
+  myIsStreaming = true;
   myIsWaitingForFile = true;
   myLastRequested.setToNow();
-  if (dirStr != NULL)
-    delete[] dirStr;
-  if (fileStr != NULL)
-    delete[] fileStr;    
   myDataMutex.unlock();
   return true;
 }
 
+AREXPORT void ArClientFileToClient::netGetFileStreamed(ArNetPacket *packet)
+{
+  char fileName[2048];
+
+  myDataMutex.lock();
+  int ret = packet->bufToUByte2();
+  packet->bufToStr(fileName, sizeof(fileName));
+  ArUtil::fixSlashes(fileName, sizeof(fileName));
+  if (!myIsStreaming || 
+      ArUtil::strcasecmp(fileName, myWholeFileName) != 0)
+  {
+    ArLog::log(ArLog::Normal, 
+	       "Got streamed data for a file ('%s') we don't want (we want '%s') (ret %d)",
+	       fileName, myWholeFileName.c_str(), ret);
+    myDataMutex.unlock();
+    return;
+  } 
+
+  if (ret != 0)
+  {
+    ArLog::log(ArLog::Normal, "ArClientFileToClient: Bad return %d on file %s", ret, fileName);
+    streamedFileDone(ret);
+    return;
+  }
+
+  ArTypes::UByte4 fileSize = packet->bufToUByte4();
+  time_t modTime = packet->bufToByte4();
+  ArTypes::UByte4 offset = packet->bufToUByte4();
+  ArTypes::UByte4 numBytes = packet->bufToUByte4();
+  int left = packet->getDataLength() - packet->getDataReadLength();
+  
+  if (offset != myStreamOffset || left < 0 || numBytes > (ArTypes::UByte4)left)
+  {
+    ArLog::log(ArLog::Normal, 
+	       "ArClientFileToClient: Got %u bytes of file %s at %u but wanted data at %u", 
+	       numBytes, fileName, offset, myStreamOffset);
+    ArNetPacket sendPacket;
+    sendPacket.uByte2ToBuf(2);
+    sendPacket.strToBuf(myWholeFileName.c_str());
+    myClient->requestOnce("getFileStreamed", &sendPacket);
+    streamedFileDone(-3);
+    return;
+  }
+
+  if (numBytes == 0)
+  {
+    md5_byte_t serverDigest[16];
+    md5_byte_t digest[16];
+    packet->bufToData((char *)serverDigest, sizeof(serverDigest));
+    md5_finish(&myStreamMD5, digest);
+    if (offset != fileSize || 
+	memcmp(digest, serverDigest, sizeof(digest)) != 0)
+    {
+      ArLog::log(ArLog::Normal, 
+		 "ArClientFileToClient: Streamed file %s doesn't match the server's (%u of %u bytes)", 
+		 myFileName.c_str(), offset, fileSize);
+      streamedFileDone(-4);
+      return;
+    }
+    fclose(myFile);
+    myFile = NULL;
+    ArUtil::changeFileTimestamp(myClientFileName.c_str(), modTime);
+    ArLog::log(ArLog::Normal, "Received file %s", myFileName.c_str());
+    streamedFileDone(0);
+    return;
+  }
+
+  // write it straight from the packet's buffer, then let the server
+  // know it can send more
+  const char *data = packet->getBuf() + packet->getReadLength();
+  if (fwrite(data, 1, numBytes, myFile) != numBytes)
+  {
+    ArLog::log(ArLog::Normal, 
+	       "ArClientFileToClient: Could not write %u bytes of file %s to %s", 
+	       numBytes, myFileName.c_str(), myClientFileName.c_str());
+    ArNetPacket sendPacket;
+    sendPacket.uByte2ToBuf(2);
+    sendPacket.strToBuf(myWholeFileName.c_str());
+    myClient->requestOnce("getFileStreamed", &sendPacket);
+    streamedFileDone(-5);
+    return;
+  }
+  md5_append(&myStreamMD5, (const md5_byte_t *)data, numBytes);
+  myStreamOffset += numBytes;
+
+  ArNetPacket sendPacket;
+  sendPacket.uByte2ToBuf(1);
+  sendPacket.strToBuf(myWholeFileName.c_str());
+  sendPacket.uByte4ToBuf(myStreamOffset);
+  myClient->requestOnce("getFileStreamed", &sendPacket);
+  ArLog::log(ArLog::Verbose, "Got %u bytes of file '%s'", 
+	     numBytes, myFileName.c_str());
+  myDataMutex.unlock();
+}
+
+/**
+   Finishes streaming a file, then unlocks myDataMutex (which this has
+   to be called with locked) and calls the callbacks.  Only a file
+   that didn't match the server's MD5 (-4) is removed, since its data
+   is bad; on other failures what was written is kept so the get can
+   be resumed.
+**/
+AREXPORT void ArClientFileToClient::streamedFileDone(int val)
+{
+  if (myFile != NULL)
+  {
+    fclose(myFile);
+    myFile = NULL;
+  }
+  if (val == -4)
+    unlink(myClientFileName.c_str());
+  myIsStreaming = false;
+  myIsWaitingForFile = false;
+  myLastReceived.setToNow();
+  myDataMutex.unlock();
+  callFileReceivedCallbacks(val);
+}
+
 AREXPORT void ArClientFileToClient::netGetFile(ArNetPacket *packet)
 {
   doGetFile(packet, false);
@@ -735,7 +962,23 @@ AREXPORT void ArClientFileToClient::cancelGet(void)
   // to be dropped, and the file getter remains permanently in the 
   // waiting for file state.
   // myWholeFileName = "";
-  // TODO!
+  // TODO! (streamed files can be canceled though)
+  myDataMutex.lock();
+  if (!myIsStreaming)
+  {
+    myDataMutex.unlock();
+    return;
+  }
+  ArNetPacket sendPacket;
+  sendPacket.uByte2ToBuf(2);
+  sendPacket.strToBuf(myWholeFileName.c_str());
+  myClient->requestOnce("getFileStreamed", &sendPacket);
+  // keep what we have so the file can be resumed
+  fclose(myFile);
+  myFile = NULL;
+  myIsStreaming = false;
+  myIsWaitingForFile = false;
+  myDataMutex.unlock();
 }
 
 AREXPORT bool ArClientFileToClient::isWaitingForFile(void) 
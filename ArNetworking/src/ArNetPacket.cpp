@@ -79,6 +79,45 @@ AREXPORT double ArNetPacket::bufToDouble(void)
   }
 }
 
+/**
+   The value is zigzag encoded (so numbers near zero, negative or
+   positive, are small) and then put in 7 bits per byte with the high
+   bit set on every byte but the last.  So values from -64 to 63 take
+   one byte, -8192 to 8191 take two bytes, and so on up to five bytes.
+**/
+AREXPORT void ArNetPacket::varIntToBuf(ArTypes::Byte4 val)
+{
+  ArTypes::UByte4 zigzag;
+
+  zigzag = ((ArTypes::UByte4)val << 1) ^ (ArTypes::UByte4)(val >> 31);
+  while (zigzag >= 0x80)
+  {
+    uByteToBuf((ArTypes::UByte)((zigzag & 0x7f) | 0x80));
+    zigzag >>= 7;
+  }
+  uByteToBuf((ArTypes::UByte)zigzag);
+}
+
+/**
+   @see varIntToBuf
+**/
+AREXPORT ArTypes::Byte4 ArNetPacket::bufToVarInt(void)
+{
+  ArTypes::UByte4 zigzag = 0;
+  ArTypes::UByte byte;
+  int shift = 0;
+
+  do 
+  {
+    // if the packet runs out this returns 0 (and marks the packet
+    // invalid) which ends the loop
+    byte = bufToUByte();
+    zigzag |= (ArTypes::UByte4)(byte & 0x7f) << shift;
+    shift += 7;
+  } while ((byte & 0x80) && shift < 35);
+  return (ArTypes::Byte4)((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+}
+
 AREXPORT void ArNetPacket::empty(void)
 {
   myCommand = 0;
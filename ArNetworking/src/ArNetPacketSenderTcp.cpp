@@ -2,10 +2,43 @@
 #include "ArExport.h"
 #include "ArNetPacketSenderTcp.h"
 
+AREXPORT ArNetSharedPacket::ArNetSharedPacket(ArNetPacket *packet) :
+  myRefCount(1),
+  myLength(packet->getLength()),
+  myCommand(packet->getCommand())
+{
+  myRefMutex.setLogName("ArNetSharedPacket::myRefMutex");
+  myBuf = new char[myLength];
+  memcpy(myBuf, packet->getBuf(), myLength);
+}
+
+AREXPORT ArNetSharedPacket::~ArNetSharedPacket()
+{
+  delete [] myBuf;
+}
+
+AREXPORT void ArNetSharedPacket::addRef(void)
+{
+  myRefMutex.lock();
+  myRefCount++;
+  myRefMutex.unlock();
+}
+
+AREXPORT void ArNetSharedPacket::release(void)
+{
+  bool last;
+  myRefMutex.lock();
+  last = (--myRefCount == 0);
+  myRefMutex.unlock();
+  if (last)
+    delete this;
+}
+
 AREXPORT ArNetPacketSenderTcp::ArNetPacketSenderTcp() :
   mySocket(NULL),
   myPacketList(),
   myPacket(NULL),
+  myDataQueuedCB(NULL),
   myAlreadySent(false),
   myBuf(NULL),
   myLength(0)
@@ -18,7 +51,7 @@ AREXPORT ArNetPacketSenderTcp::ArNetPacketSenderTcp() :
 
 AREXPORT ArNetPacketSenderTcp::~ArNetPacketSenderTcp()
 {
-  ArNetPacket *packet;
+  ArNetSharedPacket *packet;
   int i = 0;
   long bytes = 0;
   while (myPacketList.begin() != myPacketList.end())
@@ -27,8 +60,10 @@ AREXPORT ArNetPacketSenderTcp::~ArNetPacketSenderTcp()
     packet = myPacketList.front();
     bytes += packet->getLength();
     myPacketList.pop_front();
-    delete packet;
+    packet->release();
   }
+  if (myPacket != NULL)
+    myPacket->release();
   if (i > 0)
     ArLog::log(ArLog::Normal, "Deleted %d packets of %d bytes", i, bytes);
 }
@@ -82,12 +117,8 @@ AREXPORT ArSocket *ArNetPacketSenderTcp::getSocket(void)
 AREXPORT void ArNetPacketSenderTcp::sendPacket(ArNetPacket *packet,
 					       const char *loggingString)
 {
-  ArNetPacket *sendPacket;
-  sendPacket = new ArNetPacket(packet->getLength() + 5);
-  sendPacket->duplicatePacket(packet);
-  if (myDebugLogging && sendPacket->getCommand() <= 255 && 
-      loggingString != NULL && loggingString[0] != '\0')
-    sendPacket->setArbitraryString(loggingString);
+  ArNetSharedPacket *sendPacket;
+  sendPacket = new ArNetSharedPacket(packet);
   myDataMutex.lock();
   myPacketList.push_back(sendPacket);
   /* this shouldn't really ever be in doubt
@@ -97,6 +128,74 @@ AREXPORT void ArNetPacketSenderTcp::sendPacket(ArNetPacket *packet,
 	       myLoggingPrefix.c_str(), 
 	       loggingString, sendPacket->getCommand());
   */
+  ArFunctor *dataQueuedCB = myDataQueuedCB;
+  myDataMutex.unlock();
+  if (dataQueuedCB != NULL)
+    dataQueuedCB->invoke();
+}
+
+/**
+   Queues the packet by reference, the sender holds its own reference
+   until the packet has been sent, so the caller can release its
+   reference as soon as this returns.
+**/
+AREXPORT void ArNetPacketSenderTcp::sendSharedPacket(
+	ArNetSharedPacket *packet)
+{
+  packet->addRef();
+  myDataMutex.lock();
+  myPacketList.push_back(packet);
+  ArFunctor *dataQueuedCB = myDataQueuedCB;
+  myDataMutex.unlock();
+  if (dataQueuedCB != NULL)
+    dataQueuedCB->invoke();
+}
+
+AREXPORT bool ArNetPacketSenderTcp::hasDataToSend(void)
+{
+  bool ret;
+  myDataMutex.lock();
+  ret = (myPacket != NULL || !myPacketList.empty());
+  myDataMutex.unlock();
+  return ret;
+}
+
+/**
+   sendData checks this when it can't send, this is for when sendData
+   is only called once the socket is writable (so it isn't called at
+   all while the connection is backed up).
+
+   @return false if there has been data waiting to be sent and none
+   could be sent for longer than the backup timeout, true otherwise
+**/
+AREXPORT bool ArNetPacketSenderTcp::checkBackupTimeout(void)
+{
+  myDataMutex.lock();
+  // if we have no data to send count it as a good send
+  if (myPacketList.begin() == myPacketList.end() && myPacket == NULL)
+    myLastGoodSend.setToNow();
+  else if (myBackupTimeout >= -.0000001 && myLastGoodSend.secSince() >= 5 &&
+	   myLastGoodSend.secSince() / 60.0 >= myBackupTimeout)
+  {
+    ArLog::log(ArLog::Normal, "%sConnection to %s backed up for %g minutes and is being closed",
+	       myLoggingPrefix.c_str(), mySocket->getIPString(), 
+	       myBackupTimeout);
+    myDataMutex.unlock();
+    return false;
+  }
+  myDataMutex.unlock();
+  return true;
+}
+
+/**
+   The callback is called from whichever thread queued the packet,
+   after the packet is on the list, so that something waiting for the
+   socket to be writable can know to start waiting for it.
+**/
+AREXPORT void ArNetPacketSenderTcp::setDataQueuedCB(ArFunctor *functor)
+{
+  myDataMutex.lock();
+  myDataQueuedCB = functor;
   myDataMutex.unlock();
 }
 
@@ -122,9 +221,8 @@ AREXPORT bool ArNetPacketSenderTcp::sendData(void)
       myBuf = myPacket->getBuf();
       myLength = myPacket->getLength();
       if (myDebugLogging && myPacket->getCommand() <= 255)
-	ArLog::log(ArLog::Normal, "%s %s Starting sending tcp command %d",
-		   myLoggingPrefix.c_str(), 
-		   myPacket->getArbitraryString(), myPacket->getCommand());
+	ArLog::log(ArLog::Normal, "%s Starting sending tcp command %d",
+		   myLoggingPrefix.c_str(), myPacket->getCommand());
       if (myPacket->getCommand() == 0)// || myPacket->getCommand() > 1000)
       {
 	ArLog::log(ArLog::Normal, "%sgetCommand is %d when it probably shouldn't be", myLoggingPrefix.c_str(), myPacket->getCommand());
@@ -134,7 +232,7 @@ AREXPORT bool ArNetPacketSenderTcp::sendData(void)
     {
       ArLog::log(ArLog::Terse, "%sArNetPacketSenderTcp: getLength for command %d packet is bad at %d", 
 		 myLoggingPrefix.c_str(), myPacket->getCommand(), myLength);
-      delete myPacket;
+      myPacket->release();
       myPacket = NULL;
       continue;
     }
@@ -161,9 +259,8 @@ AREXPORT bool ArNetPacketSenderTcp::sendData(void)
 	myDataMutex.unlock();
 	if (myDebugLogging && myPacket->getCommand() <= 255)
 	  ArLog::log(ArLog::Normal, 
-	     "%s%sContinue sending tcp command %d, no data could be sent",
-		     myLoggingPrefix.c_str(), myPacket->getArbitraryString(), 
-		     myPacket->getCommand());
+	     "%sContinue sending tcp command %d, no data could be sent",
+		     myLoggingPrefix.c_str(), myPacket->getCommand());
 	return true;
       }
       else 
@@ -180,9 +277,8 @@ AREXPORT bool ArNetPacketSenderTcp::sendData(void)
 	myDataMutex.unlock();
 	if (myDebugLogging && myPacket->getCommand() <= 255)
 	  ArLog::log(ArLog::Normal, 
-	     "%s%sContinue sending tcp command %d, no data could be sent",
-		     myLoggingPrefix.c_str(), 
-		     myPacket->getArbitraryString(), myPacket->getCommand());
+	     "%sContinue sending tcp command %d, no data could be sent",
+		     myLoggingPrefix.c_str(), myPacket->getCommand());
 	return true;
       }
       else 
@@ -225,19 +321,17 @@ AREXPORT bool ArNetPacketSenderTcp::sendData(void)
       if (myAlreadySent == myLength)
       {
 	if (myDebugLogging && myPacket->getCommand() <= 255)
-	  ArLog::log(ArLog::Normal, "%s%sFinished sending tcp command %d",
-		     myLoggingPrefix.c_str(), myPacket->getArbitraryString(), 
-		     myPacket->getCommand());
+	  ArLog::log(ArLog::Normal, "%sFinished sending tcp command %d",
+		     myLoggingPrefix.c_str(), myPacket->getCommand());
 	//printf("sent one %g\n", start.mSecSince() / 1000.0);
-	delete myPacket;
+	myPacket->release();
 	myPacket = NULL;
 	continue;
       }
       else if (myDebugLogging && myPacket->getCommand() <= 255)
 	ArLog::log(ArLog::Normal, 
-		   "%s%sContinue sending tcp command %d, sent %d",
-		   myLoggingPrefix.c_str(), myPacket->getArbitraryString(), 
-		   myPacket->getCommand(), ret);
+		   "%sContinue sending tcp command %d, sent %d",
+		   myLoggingPrefix.c_str(), myPacket->getCommand(), ret);
 
     }
     else
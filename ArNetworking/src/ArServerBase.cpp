@@ -5,6 +5,13 @@
 #include "ArClientCommands.h"
 #include "ArServerMode.h"
 
+#ifndef WIN32
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
 //#define ARDEBUG_SERVERBASE
 
 #if (defined(ARDEBUG_SERVERBASE))
@@ -50,6 +57,7 @@ AREXPORT ArServerBase::ArServerBase(bool addAriaExitCB,
 				    int maxClientsAllowed) :
   myProcessPacketCB(this, &ArServerBase::processPacket),
   mySendUdpCB(this, &ArServerBase::sendUdp),
+  myEpollWakeCB(this, &ArServerBase::epollWake),
   myAriaExitCB(this, &ArServerBase::close),
   myGetFrequencyCB(this, &ArServerBase::getFrequency, 0, true),
   myProcessFileCB(this, &ArServerBase::processFile),
@@ -68,6 +76,12 @@ AREXPORT ArServerBase::ArServerBase(bool addAriaExitCB,
   myCycleCallbacksMutex.setLogName("ArServerBase::myCycleCallbacksMutex");
   myAddListMutex.setLogName("ArServerBase::myAddListMutex");
   myRemoveSetMutex.setLogName("ArServerBase::myRemoveSetMutex");
+  myEpollWakeMutex.setLogName("ArServerBase::myEpollWakeMutex");
+
+  myEpollFD = -1;
+  myEpollWakeFD = -1;
+  myEpollCycleMSecs = 10;
+  myEpollWakePending = false;
   myProcessingSlowIdleMutex.setLogName(
 	  "ArServerBase::myProcessingSlowIdleMutex");
   myIdleCallbacksMutex.setLogName(
@@ -222,6 +236,7 @@ AREXPORT ArServerBase::ArServerBase(bool addAriaExitCB,
 AREXPORT ArServerBase::~ArServerBase()
 {
   close();
+  setUseEpoll(false);
 
   if (mySlowIdleThread != NULL)
   {
@@ -277,6 +292,7 @@ AREXPORT bool ArServerBase::open(unsigned int port, const char *openOnIP,
 		 myLogPrefix.c_str(), myTcpPort);
     myOpened = true;
     myUdpPort = 0;
+    epollAddServerSockets();
     myDataMutex.unlock();
     return true;
   }
@@ -305,6 +321,7 @@ AREXPORT bool ArServerBase::open(unsigned int port, const char *openOnIP,
     return false;
   }
   myOpened = true;
+  epollAddServerSockets();
   myDataMutex.unlock();
   return true;
 }
@@ -340,6 +357,8 @@ AREXPORT void ArServerBase::close(void)
     myClients.pop_front();
     delete client;
   }
+  // closing the sockets takes them out of the epoll set
+  myEpollClients.clear();
   myTcpSocket.close();
   if (!myTcpOnly)
     myUdpSocket.close();
@@ -505,6 +524,11 @@ AREXPORT void *ArServerBase::runThread(void *arg)
   threadStarted();
   while (myRunning)
   {
+    if (myEpollFD >= 0)
+    {
+      epollLoopOnce();
+      continue;
+    }
     loopOnce();
     ArUtil::sleep(myLoopMSecs);
   }
@@ -656,6 +680,15 @@ AREXPORT bool ArServerBase::broadcastPacketTcpByCommandWithExclusion(
     packet = &emptyPacket;
 
   packet->setCommand(command);
+  // serialize the packet once and queue that on each client, instead
+  // of each client copying it (packets that are too long are left to
+  // the clients to complain about)
+  ArNetSharedPacket *sharedPacket = NULL;
+  if (!myClients.empty() && packet->getLength() <= ArNetPacket::MAX_LENGTH)
+  {
+    packet->finalizePacket();
+    sharedPacket = new ArNetSharedPacket(packet);
+  }
   for (lit = myClients.begin(); lit != myClients.end(); ++lit)
   {
     serverClient = (*lit);
@@ -664,8 +697,10 @@ AREXPORT bool ArServerBase::broadcastPacketTcpByCommandWithExclusion(
     if (match && 
 	!serverClient->getIdentifier().matches(identifier, matchConnectionID))
       continue;
-    serverClient->broadcastPacketTcp(packet);
+    serverClient->broadcastPacketTcp(packet, sharedPacket);
   }
+  if (sharedPacket != NULL)
+    sharedPacket->release();
 
   myClientsMutex.unlock();  
   return true;
@@ -806,6 +841,15 @@ AREXPORT bool ArServerBase::broadcastPacketUdpByCommandWithExclusion(
     packet = &emptyPacket;
 
   packet->setCommand(command);
+  // serialize the packet once and queue that on each client, instead
+  // of each client copying it (packets that are too long are left to
+  // the clients to complain about)
+  ArNetSharedPacket *sharedPacket = NULL;
+  if (!myClients.empty() && packet->getLength() <= ArNetPacket::MAX_LENGTH)
+  {
+    packet->finalizePacket();
+    sharedPacket = new ArNetSharedPacket(packet);
+  }
   for (lit = myClients.begin(); lit != myClients.end(); ++lit)
   {
     serverClient = (*lit);
@@ -814,8 +858,10 @@ AREXPORT bool ArServerBase::broadcastPacketUdpByCommandWithExclusion(
     if (match && 
 	!serverClient->getIdentifier().matches(identifier, matchConnectionID))
       continue;
-    serverClient->broadcastPacketUdp(packet);
+    serverClient->broadcastPacketUdp(packet, sharedPacket);
   }
+  if (sharedPacket != NULL)
+    sharedPacket->release();
   myClientsMutex.unlock();  
   return true;
 }
@@ -859,13 +905,6 @@ AREXPORT unsigned int ArServerBase::findCommandFromName(const char *name)
  **/
 AREXPORT void ArServerBase::loopOnce(void)
 {
-  std::list<ArServerClient *>::iterator it;
-  std::set<ArServerClient *>::iterator setIt;
-  // for speed we'd use a list of iterators and erase, but for clarity
-  // this is easier and this won't happen that often
-  //std::list<ArServerClient *> removeList;
-  ArServerClient *client;
-
   myDataMutex.lock();  
   if (!myOpened)
   {
@@ -879,6 +918,23 @@ AREXPORT void ArServerBase::loopOnce(void)
   if (!myTcpOnly)
     myUdpReceiver.readData();
 
+  processClients(true);
+}
+
+/**
+   @param pollSockets if true every client reads and sends whatever it
+   can, if false the clients only do their state checks (the epoll loop
+   has them read and send when their sockets are ready)
+**/
+void ArServerBase::processClients(bool pollSockets)
+{
+  std::list<ArServerClient *>::iterator it;
+  std::set<ArServerClient *>::iterator setIt;
+  // for speed we'd use a list of iterators and erase, but for clarity
+  // this is easier and this won't happen that often
+  //std::list<ArServerClient *> removeList;
+  ArServerClient *client;
+
   if (myProcessingSlowIdleMutex.tryLock() == 0)
   {
     myClientsMutex.lock();
@@ -930,7 +986,7 @@ AREXPORT void ArServerBase::loopOnce(void)
     if (newBackupTimeout)
       client->setBackupTimeout(backupTimeout);      
 
-    if (!client->tcpCallback())
+    if (!client->tcpCallback(pollSockets, pollSockets))
     {
       client->forceDisconnect(true);
       myRemoveSetMutex.lock();
@@ -986,6 +1042,7 @@ AREXPORT void ArServerBase::loopOnce(void)
       }
       
       myRemoveSet.erase(client);
+      epollRemoveClient(client, true);
       delete client;
     }
     myRemoveSetMutex.unlock();
@@ -1013,6 +1070,330 @@ AREXPORT void ArServerBase::loopOnce(void)
   myCycleCallbacksMutex.unlock();
 }
 
+/**
+   Normally the server loop (run() or runAsync()) goes through every
+   client each time around, trying to read from and send to each
+   socket and then sleeping for a millisecond.  That means the time
+   spent grows with the number of clients even when most of them are
+   idle.  With epoll the loop instead waits until one of the sockets
+   (the listening socket, the udp socket, or a client socket) has data
+   to read, or until a client that has data waiting to be sent can
+   send it, and then only services those sockets.
+
+   The rest of the loop (handling requests that are sent at an
+   interval, adding and removing clients, the cycle callbacks and the
+   clients' timeout checks) is done every @p cycleMSecs, so that is
+   the granularity for data requested at an interval and for the cycle
+   callbacks.
+
+   This is only available on Linux, and only changes run() and
+   runAsync(); loopOnce() still goes through every client.  It should
+   be set before the server is run.
+
+   @param useEpoll whether to use epoll or not
+
+   @param cycleMSecs how often the rest of the loop is done when using
+   epoll, in milliseconds
+
+   @return true if the mode was set, false if epoll couldn't be used
+   (in which case the normal loop is used)
+**/
+AREXPORT bool ArServerBase::setUseEpoll(bool useEpoll, 
+					unsigned int cycleMSecs)
+{
+#ifndef WIN32
+  myDataMutex.lock();
+  if (!useEpoll)
+  {
+    if (myEpollFD >= 0)
+    {
+      ::close(myEpollFD);
+      myEpollFD = -1;
+      ::close(myEpollWakeFD);
+      myEpollWakeFD = -1;
+      myEpollClients.clear();
+      ArLog::log(myVerboseLogLevel, "%sNot using epoll", 
+		 myLogPrefix.c_str());
+    }
+    myDataMutex.unlock();
+    return true;
+  }
+
+  if (cycleMSecs < 1)
+    cycleMSecs = 1;
+  myEpollCycleMSecs = cycleMSecs;
+  if (myEpollFD >= 0)
+  {
+    myDataMutex.unlock();
+    return true;
+  }
+
+  struct epoll_event event;
+  if ((myEpollFD = epoll_create(64)) < 0)
+  {
+    ArLog::logErrorFromOS(ArLog::Normal, 
+			  "%sCould not create epoll set, not using epoll", 
+			  myLogPrefix.c_str());
+    myDataMutex.unlock();
+    return false;
+  }
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.ptr = &myEpollWakeFD;
+  if ((myEpollWakeFD = eventfd(0, EFD_NONBLOCK)) < 0 ||
+      epoll_ctl(myEpollFD, EPOLL_CTL_ADD, myEpollWakeFD, &event) < 0)
+  {
+    ArLog::logErrorFromOS(ArLog::Normal, 
+	  "%sCould not set up epoll wake up event, not using epoll", 
+			  myLogPrefix.c_str());
+    if (myEpollWakeFD >= 0)
+      ::close(myEpollWakeFD);
+    myEpollWakeFD = -1;
+    ::close(myEpollFD);
+    myEpollFD = -1;
+    myDataMutex.unlock();
+    return false;
+  }
+  myEpollLastCycle.setToNow();
+  if (myOpened)
+    epollAddServerSockets();
+  ArLog::log(ArLog::Normal, "%sUsing epoll with a %u ms cycle", 
+	     myLogPrefix.c_str(), myEpollCycleMSecs);
+  myDataMutex.unlock();
+  return true;
+#else // WIN32
+  if (useEpoll)
+  {
+    ArLog::log(ArLog::Normal, "%sepoll is not available on this platform",
+	       myLogPrefix.c_str());
+    return false;
+  }
+  return true;
+#endif // WIN32
+}
+
+AREXPORT bool ArServerBase::getUseEpoll(void)
+{
+  return myEpollFD >= 0;
+}
+
+/// Should be called with myDataMutex locked
+void ArServerBase::epollAddServerSockets(void)
+{
+#ifndef WIN32
+  struct epoll_event event;
+
+  if (myEpollFD < 0)
+    return;
+
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.ptr = &myTcpSocket;
+  if (epoll_ctl(myEpollFD, EPOLL_CTL_ADD, myTcpSocket.getFD(), &event) < 0)
+    ArLog::logErrorFromOS(ArLog::Terse, 
+			  "%sCould not add tcp socket to epoll set", 
+			  myLogPrefix.c_str());
+  if (!myTcpOnly)
+  {
+    event.data.ptr = &myUdpSocket;
+    if (epoll_ctl(myEpollFD, EPOLL_CTL_ADD, myUdpSocket.getFD(), 
+		  &event) < 0)
+      ArLog::logErrorFromOS(ArLog::Terse, 
+			    "%sCould not add udp socket to epoll set", 
+			    myLogPrefix.c_str());
+  }
+#endif // WIN32
+}
+
+/**
+   This adds clients that aren't in the epoll set yet, and has each
+   client wait to be able to send only while it has data waiting to
+   be sent.
+**/
+void ArServerBase::epollUpdateClients(void)
+{
+#ifndef WIN32
+  std::list<ArServerClient *>::iterator it;
+  std::map<ArServerClient *, int>::iterator mapIt;
+  ArServerClient *client;
+  struct epoll_event event;
+  int events;
+
+  memset(&event, 0, sizeof(event));
+  for (it = myClients.begin(); it != myClients.end(); ++it)
+  {
+    client = (*it);
+    events = EPOLLIN;
+    if (client->hasTcpDataToSend())
+      events |= EPOLLOUT;
+    event.events = events;
+    event.data.ptr = client;
+    if ((mapIt = myEpollClients.find(client)) == myEpollClients.end())
+    {
+      client->setTcpDataQueuedCB(&myEpollWakeCB);
+      if (epoll_ctl(myEpollFD, EPOLL_CTL_ADD, 
+		    client->getTcpSocket()->getFD(), &event) < 0)
+      {
+	ArLog::logErrorFromOS(ArLog::Terse, 
+			      "%sCould not add %s to epoll set", 
+			      myLogPrefix.c_str(), client->getIPString());
+	myEpollClients[client] = -1;
+	client->forceDisconnect(true);
+	myRemoveSetMutex.lock();
+	myRemoveSet.insert(client);
+	myRemoveSetMutex.unlock();
+      }
+      else
+	myEpollClients[client] = events;
+    }
+    else if ((*mapIt).second >= 0 && (*mapIt).second != events)
+    {
+      epoll_ctl(myEpollFD, EPOLL_CTL_MOD, client->getTcpSocket()->getFD(), 
+		&event);
+      (*mapIt).second = events;
+    }
+  }
+#endif // WIN32
+}
+
+/**
+   @param client the client to take out of the set
+
+   @param forget if true the client is forgotten about (since it is
+   being deleted), if false it is remembered so that it isn't added
+   back before it is deleted
+**/
+void ArServerBase::epollRemoveClient(ArServerClient *client, bool forget)
+{
+#ifndef WIN32
+  std::map<ArServerClient *, int>::iterator mapIt;
+  struct epoll_event event;
+
+  if ((mapIt = myEpollClients.find(client)) == myEpollClients.end())
+    return;
+  // the event is ignored, but older kernels want it to not be NULL
+  if ((*mapIt).second >= 0)
+    epoll_ctl(myEpollFD, EPOLL_CTL_DEL, client->getTcpSocket()->getFD(), 
+	      &event);
+  client->setTcpDataQueuedCB(NULL);
+  if (forget)
+    myEpollClients.erase(mapIt);
+  else
+    (*mapIt).second = -1;
+#endif // WIN32
+}
+
+/**
+   This is called when a client queues tcp data (which may be from
+   another thread), so that the loop starts waiting for that client's
+   socket to be writable without waiting for the next cycle.
+**/
+void ArServerBase::epollWake(void)
+{
+#ifndef WIN32
+  myEpollWakeMutex.lock();
+  if (!myEpollWakePending && myEpollWakeFD >= 0)
+  {
+    uint64_t one = 1;
+    myEpollWakePending = true;
+    if (write(myEpollWakeFD, &one, sizeof(one)) < 0)
+      myEpollWakePending = false;
+  }
+  myEpollWakeMutex.unlock();
+#endif // WIN32
+}
+
+void ArServerBase::epollLoopOnce(void)
+{
+#ifndef WIN32
+  struct epoll_event events[64];
+  int numEvents;
+  int i;
+  long timeout;
+  ArServerClient *client;
+  uint64_t wakes;
+
+  myDataMutex.lock();  
+  if (!myOpened)
+  {
+    myDataMutex.unlock();
+    ArUtil::sleep(myLoopMSecs);
+    return;
+  }
+  myDataMutex.unlock();
+
+  // the clients and the epoll set are only used with myClientsMutex
+  // locked (but not while waiting) so close() can't empty them out
+  // from under us
+  myClientsMutex.lock();
+  epollUpdateClients();
+  myClientsMutex.unlock();
+
+  timeout = myEpollCycleMSecs - myEpollLastCycle.mSecSince();
+  if (timeout < 0)
+    timeout = 0;
+  if ((numEvents = epoll_wait(myEpollFD, events, 64, timeout)) < 0)
+  {
+    if (errno != EINTR)
+    {
+      ArLog::logErrorFromOS(ArLog::Terse, "%sepoll_wait failed", 
+			    myLogPrefix.c_str());
+      ArUtil::sleep(myLoopMSecs);
+    }
+    numEvents = 0;
+  }
+
+  myClientsMutex.lock();
+  // if the server was closed while we waited the events are stale
+  if (!myOpened)
+    numEvents = 0;
+  for (i = 0; i < numEvents; i++)
+  {
+    if (events[i].data.ptr == &myEpollWakeFD)
+    {
+      // clear the flag before the clients are updated (next time
+      // through) so that data queued after that still wakes us
+      myEpollWakeMutex.lock();
+      myEpollWakePending = false;
+      if (read(myEpollWakeFD, &wakes, sizeof(wakes)) < 0)
+	wakes = 0;
+      myEpollWakeMutex.unlock();
+    }
+    else if (events[i].data.ptr == &myTcpSocket)
+      acceptTcpSockets();
+    else if (events[i].data.ptr == &myUdpSocket)
+      myUdpReceiver.readData();
+    else
+    {
+      client = (ArServerClient *)events[i].data.ptr;
+      // it may have been taken out by an earlier event this time
+      std::map<ArServerClient *, int>::iterator mapIt;
+      if ((mapIt = myEpollClients.find(client)) == myEpollClients.end() ||
+	  (*mapIt).second < 0)
+	continue;
+      if (!client->tcpCallback(
+		  (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0,
+		  (events[i].events & EPOLLOUT) != 0))
+      {
+	// take it out now so a closed socket doesn't keep waking us
+	epollRemoveClient(client, false);
+	client->forceDisconnect(true);
+	myRemoveSetMutex.lock();
+	myRemoveSet.insert(client);
+	myRemoveSetMutex.unlock();
+      }
+    }
+  }
+  myClientsMutex.unlock();
+
+  if (myEpollLastCycle.mSecSince() >= (long)myEpollCycleMSecs)
+  {
+    myEpollLastCycle.setToNow();
+    processClients(false);
+  }
+#endif // WIN32
+}
+
 AREXPORT void ArServerBase::processPacket(ArNetPacket *packet, struct sockaddr_in *sin)
 {
   std::list<ArServerClient *>::iterator it;
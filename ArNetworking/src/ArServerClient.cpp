@@ -204,6 +204,18 @@ AREXPORT void ArServerClient::setBackupTimeout(double timeoutInMins)
 }
 
 AREXPORT bool ArServerClient::tcpCallback(void)
+{
+  return tcpCallback(true, true);
+}
+
+/**
+   This is used by the server when it knows which sockets are ready
+   (see ArServerBase::setUseEpoll), the state checks are always done.
+
+   @param doRead whether to read the data waiting on the socket
+   @param doSend whether to send the data waiting to be sent
+**/
+AREXPORT bool ArServerClient::tcpCallback(bool doRead, bool doSend)
 {
   if (myState == STATE_REJECTED)
   {
@@ -234,22 +246,27 @@ AREXPORT bool ArServerClient::tcpCallback(void)
     sendPacketTcp(&sending);
   }
 
-  if (!myTcpReceiver.readData())
+  if (doRead && !myTcpReceiver.readData())
   {
     ArLog::log(myVerboseLogLevel, "%sTrouble receiving tcp data from %s",
 	       myLogPrefix.c_str(), getIPString());
     internalSwitchState(STATE_DISCONNECTED);
-    return tcpCallback();
+    return tcpCallback(doRead, doSend);
     //return false; 
   }
-  if (!myTcpSender.sendData())
+  if (doSend && !myTcpSender.sendData())
   {
     ArLog::log(myVerboseLogLevel, "%sTrouble sending tcp data to %s", 
 	       myLogPrefix.c_str(), getIPString());
     internalSwitchState(STATE_DISCONNECTED);
-    return tcpCallback();
+    return tcpCallback(doRead, doSend);
     //return false;
   }
+  if (!doSend && !myTcpSender.checkBackupTimeout())
+  {
+    internalSwitchState(STATE_DISCONNECTED);
+    return tcpCallback(doRead, doSend);
+  }
 
   return true;
 }
@@ -880,6 +897,76 @@ AREXPORT void ArServerClient::broadcastPacketUdp(ArNetPacket *packet)
   // we didn't have the data to send
 }
 
+/**
+   @param packet the packet to broadcast, which must already have its
+   command set and be finalized
+   @param sharedPacket the shared copy of packet to queue, if this is
+   NULL then packet is sent normally
+**/
+AREXPORT void ArServerClient::broadcastPacketTcp(
+	ArNetPacket *packet, ArNetSharedPacket *sharedPacket)
+{
+  if (!hasRequested(packet->getCommand()))
+    return;
+  if (sharedPacket != NULL)
+    sendSharedPacketTcp(packet, sharedPacket);
+  else
+    sendPacketTcp(packet);
+}
+
+/**
+   @param packet the packet to broadcast, which must already have its
+   command set and be finalized
+   @param sharedPacket the shared copy of packet to queue if this
+   client only gets tcp, if this is NULL then packet is sent normally
+**/
+AREXPORT void ArServerClient::broadcastPacketUdp(
+	ArNetPacket *packet, ArNetSharedPacket *sharedPacket)
+{
+  if (!hasRequested(packet->getCommand()))
+    return;
+  if (sharedPacket != NULL && (myTcpOnly || getForceTcpFlag()))
+    sendSharedPacketTcp(packet, sharedPacket);
+  else
+    sendPacketUdp(packet);
+}
+
+bool ArServerClient::hasRequested(unsigned int command)
+{
+  std::list<ArServerClientData *>::iterator it;
+
+  for (it = myRequested.begin(); it != myRequested.end(); ++it)
+  {
+    if ((*it)->getServerData()->getCommand() == command)
+      return true;
+  }
+  return false;
+}
+
+/**
+   This does the checks from setupPacket that can differ between
+   clients; the packet itself was already finalized by the server.
+**/
+bool ArServerClient::sendSharedPacketTcp(ArNetPacket *packet,
+					 ArNetSharedPacket *sharedPacket)
+{
+  if (myState == STATE_DISCONNECTED)
+  {
+    if (myDebugLogging && packet->getCommand() <= 255)
+      ArLog::log(myVerboseLogLevel, "%s sendPacket: command %s trying to be sent while disconnected", myLogPrefix.c_str(), findCommandName(packet->getCommand()));
+    return false;
+  }
+
+  trackPacketSent(packet, true);
+
+  if (myDebugLogging && packet->getCommand() <= 255)
+    ArLog::log(ArLog::Normal, "%sSending shared tcp command %d", 
+	       myLogPrefix.c_str(), packet->getCommand());
+
+  myTcpSender.sendSharedPacket(sharedPacket);
+  return true;
+}
+
 AREXPORT bool ArServerClient::sendPacketTcp(ArNetPacket *packet)
 {
   if (!setupPacket(packet))
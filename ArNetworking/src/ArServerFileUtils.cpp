@@ -433,8 +433,12 @@ AREXPORT void ArServerFileLister::getDefaultUploadDownloadDir(
 AREXPORT ArServerFileToClient::ArServerFileToClient(ArServerBase *server, 
 						                                        const char *topDir) :
   myGetFileCB(this, &ArServerFileToClient::getFile),
-  myGetFileWithTimestampCB(this, &ArServerFileToClient::getFileWithTimestamp)
+  myGetFileWithTimestampCB(this, &ArServerFileToClient::getFileWithTimestamp),
+  myGetFileStreamedCB(this, &ArServerFileToClient::getFileStreamed),
+  myClientRemovedCB(this, &ArServerFileToClient::clientRemoved),
+  myStreamWindow(8 * STREAM_CHUNK_SIZE)
 {
+  myStreamMutex.setLogName("ArServerFileToClient::myStreamMutex");
   myServer = server;
   myServer->addData("getFile", 
 		    "Gets a file (use ArClientFileToClient instead of calling this directly since this interface may change)",
@@ -449,6 +453,14 @@ AREXPORT ArServerFileToClient::ArServerFileToClient(ArServerBase *server,
 		    "ubyte2: return code, 0 = good (sending file), 1 = tried to go outside allowed area, 2 = no such file (or can't read), 3 = empty file name, 4 = error reading file (can happen after some good values) ; string: fileGotten; IF return was 0 then byte4: time_t that file was last modified; ubyte4: numBytes (number of bytes in the file buffer in this packet, 0 means end of file); data buffer that is numBytes in length", 
 		    "FileAccess", "RETURN_UNTIL_EMPTY|SLOW_PACKET");
 
+  myServer->addData("getFileStreamed", 
+		    "Streams a file a window at a time (use ArClientFileToClient instead of calling this directly since this interface may change)",
+		    &myGetFileStreamedCB, 
+		    "uByte2: command, 0 = start, 1 = acknowledge data, 2 = cancel; string: file to get; IF command is 0 then uByte4: offset to start at (to resume a file); uByte4: window (bytes to send before waiting for an acknowledgement, 0 for the server's default); IF command is 1 then uByte4: bytes of the file the client has written",
+		    "uByte2: return code, 0 = good (sending file), 1 = tried to go outside allowed area, 2 = no such file (or can't read), 3 = empty file name, 4 = error reading file (can happen after some good values), 5 = offset is past the end of the file; string: fileGotten; IF return was 0 then uByte4: size of the file; byte4: time_t the file was last modified; uByte4: offset of this data in the file; uByte4: numBytes (0 means the file is done); IF numBytes is 0 then 16 bytes of MD5 of the whole file ELSE numBytes of data",
+		    "FileAccess", "RETURN_COMPLEX|SLOW_PACKET");
+  myServer->addClientRemovedCallback(&myClientRemovedCB);
+
   // snag our base dir and make sure we have enough room for a /
   strncpy(myBaseDir, topDir, sizeof(myBaseDir) - 2);
   myBaseDir[sizeof(myBaseDir) - 2] = '\0';
@@ -460,7 +472,9 @@ AREXPORT ArServerFileToClient::ArServerFileToClient(ArServerBase *server,
 
 AREXPORT ArServerFileToClient::~ArServerFileToClient()
 {
-
+  myServer->remClientRemovedCallback(&myClientRemovedCB);
+  ArUtil::deleteSetPairs(myStreams.begin(), myStreams.end());
+  myStreams.clear();
 }
 
 
@@ -480,19 +494,24 @@ AREXPORT void ArServerFileToClient::getFileWithTimestamp
 
 
 
-AREXPORT void ArServerFileToClient::doGetFile(ArServerClient *client,
-                                              ArNetPacket *packet,
-                                              bool isSetTimestamp)
-{
-  ArNetPacket sendPacket;
+/**
+   Finds the file under our base dir, ignoring case, and makes sure
+   the client isn't trying to get outside of it.
 
-  char fileNameRaw[2048];
-  packet->bufToStr(fileNameRaw, sizeof(fileNameRaw));
+   @param fileNameRaw the file name the client asked for
 
-  // should check for operation here, but thats not implemented yet
+   @param wholeName this is set to the name of the file to open
 
+   @return 0 if the file was found, otherwise the return code to
+   send the client (1 = tried to go outside allowed area, 2 = no such
+   file, 3 = empty file name)
+**/
+AREXPORT int ArServerFileToClient::findFile(const char *fileNameRaw,
+					    std::string *wholeName)
+{
   char fileNameCooked[2048];
-  strcpy(fileNameCooked, fileNameRaw);
+  strncpy(fileNameCooked, fileNameRaw, sizeof(fileNameCooked) - 1);
+  fileNameCooked[sizeof(fileNameCooked) - 1] = '\0';
   ArUtil::fixSlashes(fileNameCooked, sizeof(fileNameCooked));
 
 
@@ -502,13 +521,7 @@ AREXPORT void ArServerFileToClient::doGetFile(ArServerClient *client,
   {
     ArLog::log(ArLog::Normal, 
 	             "ArServerFileToClient: can't open file '%s'", fileNameRaw);
-    sendPacket.uByte2ToBuf(2);
-    sendPacket.strToBuf(fileNameRaw);
-    client->sendPacketTcp(&sendPacket);
-    // send an empty packet so that forwarding knows we're done
-    sendPacket.empty();
-    client->sendPacketTcp(&sendPacket);
-    return;
+    return 2;
   }
 
   size_t len = strlen(fileName);
@@ -533,13 +546,7 @@ AREXPORT void ArServerFileToClient::doGetFile(ArServerClient *client,
 	       "ArServerFileToClient: '%s' tried to access outside allowed area",
 	       fileStr);
     delete[] fileStr;
-    sendPacket.uByte2ToBuf(1);    
-    sendPacket.strToBuf(fileNameRaw);
-    client->sendPacketTcp(&sendPacket);
-    // send an empty packet so that forwarding knows we're done
-    sendPacket.empty();
-    client->sendPacketTcp(&sendPacket);
-    return;
+    return 1;
   }
 
   if (strlen(fileStr) > 0)
@@ -551,29 +558,49 @@ AREXPORT void ArServerFileToClient::doGetFile(ArServerClient *client,
     ArLog::log(ArLog::Normal, 
 	       "ArServerFileToClient: can't get file, empty filename");
     delete[] fileStr;
-    sendPacket.uByte2ToBuf(3);
-    sendPacket.strToBuf(fileNameRaw);
-    client->sendPacketTcp(&sendPacket);
-    // send an empty packet so that forwarding knows we're done
-    sendPacket.empty();
-    client->sendPacketTcp(&sendPacket);
-    return;
+    return 3;
   }
 
   // walk from our base down and try to find the first by name
   // ignoring case
   
   // put our base and where we want to go together
-  std::string wholeName;
-  wholeName = myBaseDir;
-  wholeName += fileStr;
+  *wholeName = myBaseDir;
+  *wholeName += fileStr;
 
   delete[] fileStr;
 
   ArLog::log(ArLog::Verbose, 
 	     "ArServerFileToClient: Trying to open %s from base %s", 
-	     wholeName.c_str(), myBaseDir);
-  
+	     wholeName->c_str(), myBaseDir);
+  return 0;
+}
+
+AREXPORT void ArServerFileToClient::doGetFile(ArServerClient *client,
+                                              ArNetPacket *packet,
+                                              bool isSetTimestamp)
+{
+  ArNetPacket sendPacket;
+
+  char fileNameRaw[2048];
+  packet->bufToStr(fileNameRaw, sizeof(fileNameRaw));
+
+  // should check for operation here, but thats not implemented yet
+
+  std::string wholeName;
+  int findRet;
+  if ((findRet = findFile(fileNameRaw, &wholeName)) != 0)
+  {
+    sendPacket.uByte2ToBuf(findRet);
+    sendPacket.strToBuf(fileNameRaw);
+    client->sendPacketTcp(&sendPacket);
+    // send an empty packet so that forwarding knows we're done
+    sendPacket.empty();
+    client->sendPacketTcp(&sendPacket);
+    return;
+  }
+  const char *fileName = wholeName.c_str();
+
   struct stat fileStat;
   stat(wholeName.c_str(), &fileStat);
  
@@ -669,6 +696,245 @@ AREXPORT void ArServerFileToClient::doGetFile(ArServerClient *client,
 
 }
 
+/**
+   A client starts a file (optionally from an offset, to resume one it
+   got part of), then the server sends up to the window's worth of
+   data and waits for the client to acknowledge what it has written
+   before sending more.  So only a window of the file is ever queued
+   to the client, and whatever else is being sent to it goes out in
+   between.  Once all the data is sent the server sends a packet with
+   no data and the MD5 of the whole file (including any part the
+   client resumed from).
+**/
+AREXPORT void ArServerFileToClient::getFileStreamed(ArServerClient *client,
+						    ArNetPacket *packet)
+{
+  char fileNameRaw[2048];
+  std::map<ArServerClient *, StreamInfo *>::iterator it;
+  StreamInfo *info;
+
+  int command = packet->bufToUByte2();
+  packet->bufToStr(fileNameRaw, sizeof(fileNameRaw));
+
+  myStreamMutex.lock();
+  it = myStreams.find(client);
+  if (it != myStreams.end())
+    info = (*it).second;
+  else
+    info = NULL;
+
+  // acknowledging or canceling a file, anything for a file we're not
+  // sending (like acknowledgements that come in after we finished) is
+  // just ignored
+  if (command != 0)
+  {
+    if (info == NULL || 
+	ArUtil::strcasecmp(info->myRawFileName, fileNameRaw) != 0)
+    {
+      myStreamMutex.unlock();
+      return;
+    }
+    if (command == 1)
+    {
+      ArTypes::UByte4 acked = packet->bufToUByte4();
+      if (acked > info->myAcked && acked <= info->mySent)
+	info->myAcked = acked;
+      sendStreamWindow(client, info);
+    }
+    else
+    {
+      ArLog::log(ArLog::Normal, 
+		 "ArServerFileToClient: %s canceled streaming file %s",
+		 client->getIPString(), info->myWholeFileName.c_str());
+      delete info;
+      myStreams.erase(it);
+    }
+    myStreamMutex.unlock();
+    return;
+  }
+
+  // starting a file, which replaces whatever this client was getting
+  if (info != NULL)
+  {
+    delete info;
+    myStreams.erase(it);
+  }
+
+  ArTypes::UByte4 offset = packet->bufToUByte4();
+  ArTypes::UByte4 window = packet->bufToUByte4();
+
+  std::string wholeName;
+  int ret;
+  if ((ret = findFile(fileNameRaw, &wholeName)) != 0)
+  {
+    sendStreamFailed(client, fileNameRaw, ret);
+    myStreamMutex.unlock();
+    return;
+  }
+
+  struct stat fileStat;
+  FILE *file = NULL;
+  if (stat(wholeName.c_str(), &fileStat) != 0 ||
+      (file = ArUtil::fopen(wholeName.c_str(), "rb")) == NULL)
+  {
+    ArLog::log(ArLog::Normal, 
+	       "ArServerFileToClient: can't open file '%s'", wholeName.c_str());
+    sendStreamFailed(client, fileNameRaw, 2);
+    myStreamMutex.unlock();
+    return;
+  }
+
+  if (offset > (ArTypes::UByte4)fileStat.st_size)
+  {
+    ArLog::log(ArLog::Normal, 
+	       "ArServerFileToClient: %s asked to resume %s at %u but it is only %u bytes", 
+	       client->getIPString(), wholeName.c_str(), offset, 
+	       (ArTypes::UByte4)fileStat.st_size);
+    fclose(file);
+    sendStreamFailed(client, fileNameRaw, 5);
+    myStreamMutex.unlock();
+    return;
+  }
+
+  info = new StreamInfo;
+  info->myRawFileName = fileNameRaw;
+  info->myWholeFileName = wholeName;
+  info->myFile = file;
+  info->myFileSize = fileStat.st_size;
+  info->myFileTimestamp = fileStat.st_mtime;
+  info->mySent = offset;
+  info->myAcked = offset;
+  if (window == 0)
+    info->myWindow = myStreamWindow;
+  else
+    info->myWindow = window;
+  md5_init(&info->myMD5);
+
+  // the checksum is of the whole file, so get the part the client
+  // already has in it
+  char buf[STREAM_CHUNK_SIZE];
+  ArTypes::UByte4 done = 0;
+  size_t toRead;
+  while (done < offset)
+  {
+    toRead = offset - done;
+    if (toRead > sizeof(buf))
+      toRead = sizeof(buf);
+    if (fread(buf, 1, toRead, file) != toRead)
+    {
+      ArLog::log(ArLog::Normal, 
+		 "ArServerFileToClient: Error reading file %s", 
+		 wholeName.c_str());
+      delete info;
+      sendStreamFailed(client, fileNameRaw, 4);
+      myStreamMutex.unlock();
+      return;
+    }
+    md5_append(&info->myMD5, (md5_byte_t *)buf, toRead);
+    done += toRead;
+  }
+
+  ArLog::log(ArLog::Normal, 
+	     "ArServerFileToClient: Streaming file %s to %s from %u of %u bytes", 
+	     wholeName.c_str(), client->getIPString(), offset, 
+	     info->myFileSize);
+  myStreams[client] = info;
+  sendStreamWindow(client, info);
+  myStreamMutex.unlock();
+}
+
+/**
+   Sends data until the client has a window's worth it hasn't
+   acknowledged, and if that is the end of the file sends the end and
+   forgets the stream.  Call with myStreamMutex locked.
+**/
+AREXPORT void ArServerFileToClient::sendStreamWindow(ArServerClient *client,
+						     StreamInfo *info)
+{
+  ArNetPacket sendPacket;
+  char buf[STREAM_CHUNK_SIZE];
+  size_t toRead;
+  // leave room in the packet for the return code, name, and offsets
+  size_t maxRead = (ArNetPacket::MAX_DATA_LENGTH - 
+		    info->myRawFileName.size() - 1 - 18);
+  if (maxRead > sizeof(buf))
+    maxRead = sizeof(buf);
+
+  while (info->mySent < info->myFileSize && 
+	 info->mySent - info->myAcked < info->myWindow)
+  {
+    toRead = info->myFileSize - info->mySent;
+    if (toRead > maxRead)
+      toRead = maxRead;
+    if (fread(buf, 1, toRead, info->myFile) != toRead)
+    {
+      ArLog::log(ArLog::Normal, 
+		 "ArServerFileToClient: Error sending file %s", 
+		 info->myWholeFileName.c_str());
+      sendStreamFailed(client, info->myRawFileName.c_str(), 4);
+      myStreams.erase(client);
+      delete info;
+      return;
+    }
+    md5_append(&info->myMD5, (md5_byte_t *)buf, toRead);
+
+    sendPacket.empty();
+    sendPacket.uByte2ToBuf(0);
+    sendPacket.strToBuf(info->myRawFileName.c_str());
+    sendPacket.uByte4ToBuf(info->myFileSize);
+    sendPacket.byte4ToBuf(info->myFileTimestamp);
+    sendPacket.uByte4ToBuf(info->mySent);
+    sendPacket.uByte4ToBuf(toRead);
+    sendPacket.dataToBuf(buf, toRead);
+    client->sendPacketTcp(&sendPacket);
+    info->mySent += toRead;
+  }
+
+  if (info->mySent < info->myFileSize)
+    return;
+
+  md5_byte_t digest[16];
+  md5_finish(&info->myMD5, digest);
+
+  sendPacket.empty();
+  sendPacket.uByte2ToBuf(0);
+  sendPacket.strToBuf(info->myRawFileName.c_str());
+  sendPacket.uByte4ToBuf(info->myFileSize);
+  sendPacket.byte4ToBuf(info->myFileTimestamp);
+  sendPacket.uByte4ToBuf(info->mySent);
+  sendPacket.uByte4ToBuf(0);
+  sendPacket.dataToBuf((char *)digest, sizeof(digest));
+  client->sendPacketTcp(&sendPacket);
+
+  ArLog::log(ArLog::Normal, "ArServerFileToClient: Streamed file %s to %s", 
+	     info->myWholeFileName.c_str(), client->getIPString());
+  myStreams.erase(client);
+  delete info;
+}
+
+AREXPORT void ArServerFileToClient::sendStreamFailed(ArServerClient *client,
+						     const char *fileNameRaw,
+						     int ret)
+{
+  ArNetPacket sendPacket;
+  sendPacket.uByte2ToBuf(ret);
+  sendPacket.strToBuf(fileNameRaw);
+  client->sendPacketTcp(&sendPacket);
+}
+
+AREXPORT void ArServerFileToClient::clientRemoved(ArServerClient *client)
+{
+  std::map<ArServerClient *, StreamInfo *>::iterator it;
+
+  myStreamMutex.lock();
+  if ((it = myStreams.find(client)) != myStreams.end())
+  {
+    delete (*it).second;
+    myStreams.erase(it);
+  }
+  myStreamMutex.unlock();
+}
+
 // -----------------------------------------------------------------------------
 // ArServerFileFromClient
 // -----------------------------------------------------------------------------
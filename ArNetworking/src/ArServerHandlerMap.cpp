@@ -27,6 +27,7 @@ AREXPORT ArServerHandlerMap::ArServerHandlerMap(ArServerBase *server,
   myGetMapBinaryCB(this, &ArServerHandlerMap::serverGetMapBinary),
   myGetMapMultiScansCB(this, &ArServerHandlerMap::serverGetMapMultiScans),
   myGetMapMaxCategoryCB(this, &ArServerHandlerMap::serverGetMapWithMaxCategory),
+  myGetMapIfChangedCB(this, &ArServerHandlerMap::serverGetMapIfChanged),
   myGetGoalsCB(this, &ArServerHandlerMap::serverGetGoals),
   myCheckMapCB(this, &ArServerHandlerMap::handleCheckMap),
   myProcessFileCB(this, &ArServerHandlerMap::processFile),
@@ -35,6 +36,9 @@ AREXPORT ArServerHandlerMap::ArServerHandlerMap(ArServerBase *server,
   myServer = server;
   myOwnMap = false;
   myMap = arMap;
+  myUsePacketCache = true;
+  myCacheBuilding = NULL;
+  myPacketCacheMutex.setLogName("ArServerHandlerMap::myPacketCacheMutex");
   setDataToSend(dataToSend);
   myMapChangedCB.setName("ArServerHandlerMap");
   myProcessFileCB.setName("ArServerHandlerMap");
@@ -93,7 +97,12 @@ AREXPORT ArServerHandlerMap::ArServerHandlerMap(ArServerBase *server,
 		                  "packets of '<string>: line' for header, followed by packets of '<byte4>: numPtsInPacket, (<double>:x, <double>:y)*' until numPtsInPacket == 0",
 		                  "Map", "RETURN_UNTIL_EMPTY");
   
-    
+    myServer->addData("getMapIfChanged", 
+                      "Like getMapWithMaxCategory, but only sends the map if the client's map ID doesn't match the server's", 
+                      &myGetMapIfChangedCB,
+                      "string: category (one of the constants defined in ArMapInterface); map ID of the client's map (see ArMapId::toPacket)", 
+		                  "packet of 'uByte: 1 if the client's map is current, 0 if not; map ID of the server's map', followed by the same packets as getMapWithMaxCategory if the map is not current, then an empty packet",
+		                  "Map", "RETURN_UNTIL_EMPTY");
     
     myServer->addData("getMap", "gets the map as a set of ascii lines", 
 		            &myGetMapCB, "none", 
@@ -123,7 +132,7 @@ AREXPORT ArServerHandlerMap::ArServerHandlerMap(ArServerBase *server,
 
 AREXPORT ArServerHandlerMap::~ArServerHandlerMap()
 {
-  
+  clearPacketCache();
 }
 
 AREXPORT bool ArServerHandlerMap::loadMap(const char *mapFile)
@@ -144,6 +153,7 @@ AREXPORT bool ArServerHandlerMap::loadMap(const char *mapFile)
   myMapName = mapFile;
   myOwnMap = true;
   bool ret = myMap->readFile(mapFile);
+  clearPacketCache();
   
   myServer->broadcastPacketTcp(&emptyPacket, "mapUpdated");
   myServer->broadcastPacketTcp(&emptyPacket, "goalsUpdated");
@@ -168,6 +178,7 @@ AREXPORT void ArServerHandlerMap::useMap(ArMapInterface *mapObj,
   myMap = mapObj;
   myMapName = myMap->getFileName();
   myOwnMap = takeOwnershipOfMap;
+  clearPacketCache();
   myServer->broadcastPacketTcp(&emptyPacket, "mapUpdated");
   myServer->broadcastPacketTcp(&emptyPacket, "goalsUpdated");
 }
@@ -240,13 +251,156 @@ AREXPORT void ArServerHandlerMap::serverGetMapName(ArServerClient *client,
   }
 }
 
+/**
+   The map packets sent by getMapBinary, getMapMultiScans,
+   getMapWithMaxCategory and getMapIfChanged are cached by default,
+   since walking and encoding a big map for every client that asks for
+   it is a lot of work, especially when a bunch of clients reconnect
+   at once.  Turning this off clears the cache.
+**/
+AREXPORT void ArServerHandlerMap::setUsePacketCache(bool usePacketCache)
+{
+  myPacketCacheMutex.lock();
+  myUsePacketCache = usePacketCache;
+  myPacketCacheMutex.unlock();
+  if (!usePacketCache)
+    clearPacketCache();
+}
+
+/**
+   This is done whenever the map or what is sent changes, so it
+   normally doesn't need to be called, but if the map is modified
+   without its map changed callbacks being called (and without its map
+   ID changing) then this needs to be called for clients to get the
+   modified map.
+**/
+AREXPORT void ArServerHandlerMap::clearPacketCache(void)
+{
+  std::map<std::string, std::list<ArNetPacket *> >::iterator it;
+
+  myPacketCacheMutex.lock();
+  for (it = myPacketCache.begin(); it != myPacketCache.end(); ++it)
+    ArUtil::deleteSet((*it).second.begin(), (*it).second.end());
+  myPacketCache.clear();
+  myPacketCacheMapId.clear();
+  myPacketCacheMutex.unlock();
+}
+
+AREXPORT void ArServerHandlerMap::setDataToSend(DataToSend dataToSend)
+{
+  myDataToSend = dataToSend;
+  clearPacketCache();
+}
+
+/**
+   Sends the map to the client out of the packet cache, first filling
+   in the cache for this category (by sending the map to a NULL client)
+   if it is empty.  The map must be locked.
+
+   @param client the client to send the map to
+
+   @param maxCategory the category passed to sendMapWithMaxCategory, or
+   NULL for serverGetMapBinary
+
+   @return true if the map was sent, false if the cache is not being
+   used
+   @internal
+**/
+AREXPORT bool ArServerHandlerMap::sendCachedMap(ArServerClient *client,
+                                                const char *maxCategory)
+{
+  std::map<std::string, std::list<ArNetPacket *> >::iterator it;
+  std::list<ArNetPacket *>::iterator pit;
+  ArMapId mapId;
+  std::string key;
+
+  // the binary map can't collide with a category since an empty category
+  // gets the binary map
+  if (maxCategory != NULL)
+    key = maxCategory;
+
+  myMap->getMapId(&mapId);
+
+  myPacketCacheMutex.lock();
+  if (!myUsePacketCache)
+  {
+    myPacketCacheMutex.unlock();
+    return false;
+  }
+
+  // if the map was changed without its callbacks being called the
+  // map ID will still have changed (if it was reread)
+  if (!myPacketCache.empty() && mapId != myPacketCacheMapId)
+  {
+    ArLog::log(ArLog::Normal, 
+	       "ArServerHandlerMap: Map ID changed, clearing packet cache");
+    for (it = myPacketCache.begin(); it != myPacketCache.end(); ++it)
+      ArUtil::deleteSet((*it).second.begin(), (*it).second.end());
+    myPacketCache.clear();
+  }
+  myPacketCacheMapId = mapId;
+
+  if ((it = myPacketCache.find(key)) == myPacketCache.end())
+  {
+    ArTime started;
+    it = myPacketCache.insert(
+	    std::pair<std::string, std::list<ArNetPacket *> >(
+		    key, std::list<ArNetPacket *>())).first;
+    myCacheBuilding = &(*it).second;
+    if (maxCategory == NULL)
+      serverGetMapBinary(NULL, NULL);
+    else
+      sendMapWithMaxCategory(NULL, maxCategory);
+    myCacheBuilding = NULL;
+    ArLog::log(ArLog::Normal, 
+	       "ArServerHandlerMap: Cached %d packets of map %s (%s) in %lld ms",
+	       (int)(*it).second.size(), myMap->getFileName(), 
+	       (maxCategory != NULL) ? maxCategory : "binary", 
+	       started.mSecSinceLL());
+  }
+
+  ArNetPacket sendPacket;
+  for (pit = (*it).second.begin(); pit != (*it).second.end(); ++pit)
+  {
+    // the cached packets never get a command so they're good for any
+    // of the requests that send them
+    sendPacket.duplicatePacket(*pit);
+    client->sendPacketTcp(&sendPacket);
+  }
+  myPacketCacheMutex.unlock();
+  return true;
+}
+
+/**
+   Sends the packet to the client, or if the client is NULL puts a copy
+   of it into the packet cache being built.
+   @internal
+**/
+AREXPORT void ArServerHandlerMap::sendToClient(ArServerClient *client,
+                                               ArNetPacket *packet)
+{
+  if (client != NULL)
+  {
+    client->sendPacketTcp(packet);
+  }
+  else if (myCacheBuilding != NULL)
+  {
+    // only make the copy as big as it needs to be (with room for the
+    // footer), since a big map is a lot of packets
+    ArNetPacket *cached = new ArNetPacket(
+	    packet->getLength() + ArNetPacket::FOOTER_LENGTH);
+    cached->duplicatePacket(packet);
+    myCacheBuilding->push_back(cached);
+  }
+}
+
 /** @internal */
 AREXPORT void ArServerHandlerMap::writeMapToClient(const char *line,
 					 ArServerClient *client)
 {
   ArNetPacket sendPacket;
   sendPacket.strToBuf(line);
-  client->sendPacketTcp(&sendPacket);
+  sendToClient(client, &sendPacket);
 }
 
 /** @internal */
@@ -261,7 +415,7 @@ AREXPORT void ArServerHandlerMap::writePointsToClient(
   if (points == NULL) {
     // Send 0 points just so the client doesn't hang
     sendPacket.byte4ToBuf(0);
-    client->sendPacketTcp(&sendPacket);
+    sendToClient(client, &sendPacket);
     return;
   }
   
@@ -322,7 +476,7 @@ AREXPORT void ArServerHandlerMap::writePointsToClient(
       
       totalCount += currentCount;
       
-      client->sendPacketTcp(&sendPacket);
+      sendToClient(client, &sendPacket);
       //ArUtil::sleep(1);
       
       isStartPacket = true;
@@ -338,7 +492,7 @@ AREXPORT void ArServerHandlerMap::writePointsToClient(
   if (false) {
   sendPacket.empty();
   sendPacket.byte4ToBuf(0);
-  client->sendPacketTcp(&sendPacket);
+  sendToClient(client, &sendPacket);
   }
 
 } // end writePointsToClient
@@ -355,7 +509,7 @@ AREXPORT void ArServerHandlerMap::writeLinesToClient(
   if (lines == NULL) {
     // Send 0 points just so the client doesn't hang
     sendPacket.byte4ToBuf(0);
-    client->sendPacketTcp(&sendPacket);
+    sendToClient(client, &sendPacket);
     return;
   }
   
@@ -421,7 +575,7 @@ AREXPORT void ArServerHandlerMap::writeLinesToClient(
       
       totalCount += currentCount;
       
-      client->sendPacketTcp(&sendPacket);
+      sendToClient(client, &sendPacket);
       //ArUtil::sleep(1);
       
       isStartPacket = true;
@@ -437,7 +591,7 @@ AREXPORT void ArServerHandlerMap::writeLinesToClient(
   if (false) {
   sendPacket.empty();
   sendPacket.byte4ToBuf(0);
-  client->sendPacketTcp(&sendPacket);
+  sendToClient(client, &sendPacket);
   }
 
 } // end writePointsToClient
@@ -489,6 +643,15 @@ AREXPORT void ArServerHandlerMap::serverGetMapBinary(ArServerClient *client,
   }
 
   myMap->lock();
+  // replay the packets the last client got if the map hasn't changed
+  if (client != NULL && sendCachedMap(client, NULL))
+  {
+    myMap->unlock();
+    ArLog::log(ArLog::Verbose, 
+               "Finished sending map (binary) to client from cache");
+    return;
+  }
+
   // This functor is used to send the map header and objects in text format.
   ArFunctor1<const char *> *textFunctor = 
 		new ArFunctor2C<ArServerHandlerMap, const char *, ArServerClient *>
@@ -565,7 +728,7 @@ AREXPORT void ArServerHandlerMap::serverGetMapBinary(ArServerClient *client,
     ArNetPacket sendPacket;
     sendPacket.empty();
     sendPacket.byte4ToBuf(0);
-    client->sendPacketTcp(&sendPacket);
+    sendToClient(client, &sendPacket);
 
     /****/
   }
@@ -593,7 +756,7 @@ AREXPORT void ArServerHandlerMap::serverGetMapBinary(ArServerClient *client,
     ArNetPacket sendPacket;
     sendPacket.empty();
     sendPacket.byte4ToBuf(0);
-    client->sendPacketTcp(&sendPacket);
+    sendToClient(client, &sendPacket);
   }
   // if not just say we're done
   else
@@ -602,7 +765,7 @@ AREXPORT void ArServerHandlerMap::serverGetMapBinary(ArServerClient *client,
 
   // send an empty packet to say we're done
   ArNetPacket emptyPacket;
-  client->sendPacketTcp(&emptyPacket);
+  sendToClient(client, &emptyPacket);
 
   myMap->unlock();
   ArLog::log(ArLog::Verbose, "Finished sending map (binary) to client");
@@ -644,10 +807,71 @@ AREXPORT void ArServerHandlerMap::serverGetMapWithMaxCategory(ArServerClient *cl
                tempBuf);
   }
 
+  sendMapForCategory(client, category.c_str());
+
+} // end method serverGetMapWithMaxCategory
+
+
+/**
+   This lets a client that saved the map (and its ArMapId) from an
+   earlier connection skip downloading it again if it hasn't changed.
+   @internal
+**/
+AREXPORT void ArServerHandlerMap::serverGetMapIfChanged(ArServerClient *client,
+                                                        ArNetPacket *packet)
+{
+  char category[512];
+  ArMapId clientMapId;
+  ArMapId mapId;
+  ArNetPacket sendPacket;
+
+  packet->bufToStr(category, sizeof(category));
+  if (!ArMapId::fromPacket(packet, &clientMapId))
+    clientMapId.clear();
+
+  if (myMap != NULL)
+    myMap->getMapId(&mapId);
+
+  bool isCurrent = (myMap != NULL && !mapId.isNull() && 
+		    !clientMapId.isNull() && mapId == clientMapId);
+
+  ArLog::log(ArLog::Normal,
+             "ArServerHandlerMap::serverGetMapIfChanged() %s requested by %s, client's map is %s",
+             category, client->getIPString(), 
+	     isCurrent ? "current" : "not current");
+
+  sendPacket.uByteToBuf(isCurrent ? 1 : 0);
+  ArMapId::toPacket(mapId, &sendPacket);
+  client->sendPacketTcp(&sendPacket);
+
+  if (isCurrent)
+  {
+    ArNetPacket emptyPacket;
+    client->sendPacketTcp(&emptyPacket);
+  }
+  else
+  {
+    sendMapForCategory(client, category);
+  }
+
+} // end method serverGetMapIfChanged
+
+
+/**
+   Sends the map in the format for the category a client asked for,
+   which is what getMapWithMaxCategory and getMapIfChanged send after
+   reading their arguments.
+   @internal
+**/
+AREXPORT void ArServerHandlerMap::sendMapForCategory(ArServerClient *client,
+                                                     const char *maxCategory)
+{
+  std::string category = maxCategory;
+
   if ((category.empty()) ||
       (ArUtil::strcasecmp(category, ArMapInterface::MAP_CATEGORY_2D) == 0) ) {
     
-        serverGetMapBinary(client, packet);
+        serverGetMapBinary(client, NULL);
     
   } 
   else if ((ArUtil::strcasecmp(category, ArMapInterface::MAP_CATEGORY_2D_MULTI_SOURCES) == 0) ||
@@ -665,7 +889,7 @@ AREXPORT void ArServerHandlerMap::serverGetMapWithMaxCategory(ArServerClient *cl
     sendMapWithMaxCategory(client, ArMapInterface::MAP_CATEGORY_2D_EXTENDED);
   }
 
-} // end method serverGetMapWithMaxCategory
+} // end method sendMapForCategory
 
 
 AREXPORT void ArServerHandlerMap::sendMapWithMaxCategory(ArServerClient *client,
@@ -686,6 +910,14 @@ AREXPORT void ArServerHandlerMap::sendMapWithMaxCategory(ArServerClient *client,
   }
 
   myMap->lock();
+  if (client != NULL && sendCachedMap(client, maxCategory))
+  {
+    myMap->unlock();
+    ArLog::log(level, "Finished sending map (%s) to client from cache", 
+               maxCategory);
+    return;
+  }
+
   // This functor is used to send the map header and objects in text format.
   ArFunctor1<const char *> *textFunctor = 
 		new ArFunctor2C<ArServerHandlerMap, const char *, ArServerClient *>
@@ -740,7 +972,7 @@ AREXPORT void ArServerHandlerMap::sendMapWithMaxCategory(ArServerClient *client,
           ArNetPacket sendPacket;
           sendPacket.empty();
           sendPacket.byte4ToBuf(0);
-          client->sendPacketTcp(&sendPacket);
+          sendToClient(client, &sendPacket);
         }
       }
     }
@@ -762,7 +994,7 @@ AREXPORT void ArServerHandlerMap::sendMapWithMaxCategory(ArServerClient *client,
           ArNetPacket sendPacket;
           sendPacket.empty();
           sendPacket.byte4ToBuf(0);
-          client->sendPacketTcp(&sendPacket);
+          sendToClient(client, &sendPacket);
         }
       }
     }
@@ -770,7 +1002,7 @@ AREXPORT void ArServerHandlerMap::sendMapWithMaxCategory(ArServerClient *client,
   
   // send an empty packet to say we're done
   ArNetPacket emptyPacket;
-  client->sendPacketTcp(&emptyPacket);
+  sendToClient(client, &emptyPacket);
 
   myMap->unlock();
   ArLog::log(level, "Finished sending map (%s) to client", maxCategory);
@@ -826,6 +1058,8 @@ AREXPORT void ArServerHandlerMap::mapChanged(void)
 
   strncpy(myMapFileName, myMap->getFileName(), 512);
   myMapFileName[511] = 0;
+  // toss the old packets before telling the clients to ask again
+  clearPacketCache();
   myServer->broadcastPacketTcp(&emptyPacket, "mapUpdated");
   myServer->broadcastPacketTcp(&emptyPacket, "goalsUpdated");
 }
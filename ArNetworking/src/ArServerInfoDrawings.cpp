@@ -189,12 +189,12 @@ AREXPORT void ArServerInfoDrawings::netRangeDeviceCurrent(
   std::list<ArPoseWithTime *> *readings;
   std::list<ArPoseWithTime *>::iterator it;
 
-  device->lockDevice();
+  device->lockDeviceForRead();
   readings = device->getCurrentBuffer();
   if (readings == NULL)
   {
     ArLog::log(ArLog::Verbose, "ArServerInfoDrawing::netRangeDeviceCurrent: No current buffer for %s", device->getName());
-    device->unlockDevice();
+    device->unlockDeviceForRead();
     sendPacket.byte4ToBuf(0);
     client->sendPacketUdp(&sendPacket);
     return;
@@ -206,7 +206,7 @@ AREXPORT void ArServerInfoDrawings::netRangeDeviceCurrent(
     sendPacket.byte4ToBuf(ArMath::roundInt((*it)->getX()));
     sendPacket.byte4ToBuf(ArMath::roundInt((*it)->getY()));
   }
-  device->unlockDevice();
+  device->unlockDeviceForRead();
   client->sendPacketUdp(&sendPacket);
 
 }
@@ -219,12 +219,12 @@ AREXPORT void ArServerInfoDrawings::netRangeDeviceCumulative(
   std::list<ArPoseWithTime *> *readings;
   std::list<ArPoseWithTime *>::iterator it;
 
-  device->lockDevice();
+  device->lockDeviceForRead();
   readings = device->getCumulativeBuffer();
   if (readings == NULL)
   {
     ArLog::log(ArLog::Verbose, "ArServerInfoDrawing::netRangeDeviceCumulative: No cumulative buffer for %s", device->getName());
-    device->unlockDevice();
+    device->unlockDeviceForRead();
     sendPacket.byte4ToBuf(0);
     client->sendPacketUdp(&sendPacket);
     return;
@@ -236,7 +236,7 @@ AREXPORT void ArServerInfoDrawings::netRangeDeviceCumulative(
     sendPacket.byte4ToBuf(ArMath::roundInt((*it)->getX()));
     sendPacket.byte4ToBuf(ArMath::roundInt((*it)->getY()));
   }
-  device->unlockDevice();
+  device->unlockDeviceForRead();
   client->sendPacketUdp(&sendPacket);
 
 }
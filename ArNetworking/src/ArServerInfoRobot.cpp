@@ -67,8 +67,13 @@ AREXPORT void ArServerInfoRobot::update(ArServerClient *client,
 					ArNetPacket *packet)
 {
   ArNetPacket sending;
+  ArRobotState state;
 
-  myRobot->lock();
+  // the numbers come from the snapshot the robot publishes each
+  // cycle (and when it connects), so the robot only has to be locked
+  // for the mode, they can be up to a cycle old
+  myRobot->getStateSnapshot(&state);
+  myRobot->lockForRead();
 
   ArServerMode *netMode;
   if ((netMode = ArServerMode::getActiveMode()) != NULL)
@@ -81,6 +86,7 @@ AREXPORT void ArServerInfoRobot::update(ArServerClient *client,
     sending.strToBuf("Unknown status");
     sending.strToBuf("Unknown mode");
   }
+  myRobot->unlock();
 
 
 	//ArLog::log(ArLog::Normal,
@@ -90,24 +96,23 @@ AREXPORT void ArServerInfoRobot::update(ArServerClient *client,
 	//											myRobot->getRealBatteryVoltage(),
 	//											myRobot->getBatteryVoltage());
 
-  if (myRobot->haveStateOfCharge())
-    sending.byte2ToBuf(ArMath::roundInt(myRobot->getStateOfCharge() * 10));
-  else if (myRobot->getRealBatteryVoltage() > 0)
+  if (state.haveStateOfCharge())
+    sending.byte2ToBuf(ArMath::roundInt(state.getStateOfCharge() * 10));
+  else if (state.getRealBatteryVoltage() > 0)
     sending.byte2ToBuf(ArMath::roundInt(
-	    myRobot->getRealBatteryVoltage() * 10));
+	    state.getRealBatteryVoltage() * 10));
   else
     sending.byte2ToBuf(ArMath::roundInt(
-	    myRobot->getBatteryVoltage() * 10));
-
-  sending.byte4ToBuf((int)myRobot->getX());
-  sending.byte4ToBuf((int)myRobot->getY());
-  sending.byte2ToBuf((int)myRobot->getTh());
-  sending.byte2ToBuf((int)myRobot->getVel());
-  sending.byte2ToBuf((int)myRobot->getRotVel());
-  sending.byte2ToBuf((int)myRobot->getLatVel());
-  sending.byteToBuf((char)myRobot->getTemperature());
+	    state.getBatteryVoltage() * 10));
+
+  sending.byte4ToBuf((int)state.getPose().getX());
+  sending.byte4ToBuf((int)state.getPose().getY());
+  sending.byte2ToBuf((int)state.getPose().getTh());
+  sending.byte2ToBuf((int)state.getVel());
+  sending.byte2ToBuf((int)state.getRotVel());
+  sending.byte2ToBuf((int)state.getLatVel());
+  sending.byteToBuf((char)state.getTemperature());
 	//sending.byte2ToBuf((int)myRobot->getPayloadNumSlots());
-  myRobot->unlock();
 
   client->sendPacketUdp(&sending);
 }
@@ -116,26 +121,26 @@ AREXPORT void ArServerInfoRobot::updateNumbers(ArServerClient *client,
 					       ArNetPacket *packet)
 {
   ArNetPacket sending;
+  ArRobotState state;
 
-  myRobot->lock();
+  myRobot->getStateSnapshot(&state);
 
-  if (myRobot->haveStateOfCharge())
-    sending.byte2ToBuf(ArMath::roundInt(myRobot->getStateOfCharge() * 10));
-  else if (myRobot->getRealBatteryVoltage() > 0)
+  if (state.haveStateOfCharge())
+    sending.byte2ToBuf(ArMath::roundInt(state.getStateOfCharge() * 10));
+  else if (state.getRealBatteryVoltage() > 0)
     sending.byte2ToBuf(ArMath::roundInt(
-	    myRobot->getRealBatteryVoltage() * 10));
+	    state.getRealBatteryVoltage() * 10));
   else
     sending.byte2ToBuf(ArMath::roundInt(
-	    myRobot->getBatteryVoltage() * 10));
-  sending.byte4ToBuf((int)myRobot->getX());
-  sending.byte4ToBuf((int)myRobot->getY());
-  sending.byte2ToBuf((int)myRobot->getTh());
-  sending.byte2ToBuf((int)myRobot->getVel());
-  sending.byte2ToBuf((int)myRobot->getRotVel());
-  sending.byte2ToBuf((int)myRobot->getLatVel());
-  sending.byteToBuf((char)myRobot->getTemperature());
+	    state.getBatteryVoltage() * 10));
+  sending.byte4ToBuf((int)state.getPose().getX());
+  sending.byte4ToBuf((int)state.getPose().getY());
+  sending.byte2ToBuf((int)state.getPose().getTh());
+  sending.byte2ToBuf((int)state.getVel());
+  sending.byte2ToBuf((int)state.getRotVel());
+  sending.byte2ToBuf((int)state.getLatVel());
+  sending.byteToBuf((char)state.getTemperature());
 	//sending.byte2ToBuf((int)myRobot->getPayloadNumSlots());
-  myRobot->unlock();
 
   client->sendPacketUdp(&sending);
 }
@@ -145,7 +150,7 @@ AREXPORT void ArServerInfoRobot::updateStrings(ArServerClient *client,
 {
   ArNetPacket sending;
 
-  myRobot->lock();
+  myRobot->lockForRead();
   sending.strToBuf(myStatus.c_str());
   sending.strToBuf(myMode.c_str());
   sending.strToBuf(myExtendedStatus.c_str());
@@ -160,7 +165,7 @@ AREXPORT void ArServerInfoRobot::batteryInfo(ArServerClient *client,
 {
   ArNetPacket sending;
 
-  myRobot->lock();
+  myRobot->lockForRead();
   if (myRobot->haveStateOfCharge())
   {
     sending.doubleToBuf(myRobot->getStateOfChargeLow());
@@ -204,7 +209,7 @@ AREXPORT void ArServerInfoRobot::physicalInfo(ArServerClient *client,
 {
   ArNetPacket sending;
 
-  myRobot->lock();
+  myRobot->lockForRead();
   sending.strToBuf(myRobot->getRobotType());
   sending.strToBuf(myRobot->getRobotSubType());
   sending.byte2ToBuf((int)myRobot->getRobotWidth());
@@ -229,7 +234,7 @@ AREXPORT void ArServerInfoRobot::activityTimeInfo(
   // TODO Not entirely sure whether the robot needs to be locked here, but
   // it seems like it shouldn't hurt.
   //
-  myRobot->lock();
+  myRobot->lockForRead();
   sending.byte4ToBuf(ArServerMode::getActiveModeActivityTimeSecSince());
   myRobot->unlock();
   
@@ -5,11 +5,16 @@
 AREXPORT ArServerInfoSensor::ArServerInfoSensor(ArServerBase *server, ArRobot *robot) :
   myGetSensorListCB(this, &ArServerInfoSensor::getSensorList),
   myGetSensorCurrentCB(this, &ArServerInfoSensor::getSensorCurrent),
-  myGetSensorCumulativeCB(this, &ArServerInfoSensor::getSensorCumulative)
-  
+  myGetSensorCumulativeCB(this, &ArServerInfoSensor::getSensorCumulative),
+  myGetSensorCurrentCompactCB(this, 
+			      &ArServerInfoSensor::getSensorCurrentCompact),
+  myGetSensorCumulativeCompactCB(
+	  this, &ArServerInfoSensor::getSensorCumulativeCompact)
 {
   myRobot = robot;
   myServer = server;
+  myNextSequence = 1;
+  mySentReadingsMutex.setLogName("ArServerInfoSensor::mySentReadingsMutex");
   
   if (myServer != NULL)
   {
@@ -38,6 +43,20 @@ AREXPORT ArServerInfoSensor::ArServerInfoSensor(ArServerBase *server, ArRobot *r
 		      "string: sensorName",
 		      "byte2: numReadings string: sensorName, repeating for numReadings times: byte4: x byte4: y.... if numReadings is -1 it means no sensor by that name",
 		      "SensorInfo", "RETURN_COMPLEX");
+
+    myServer->addData("getSensorCurrentCompact", 
+		      "gets the current sensor readings for requested sensors, compactly encoded (see the ArServerInfoSensor docs)",
+		      &myGetSensorCurrentCompactCB,
+		      "repeating: string: sensorName ubyte4: lastSequence (0 for none) ubyte2: resolutionInMM",
+		      "byte2: numReadings string: sensorName ubyte4: sequence byte4: keepStart (-1 if these are all the readings) byte4: keepCount byte2: numBefore ubyte2: resolutionInMM byte4: originX byte4: originY, repeating for numReadings times: varint: dx varint: dy.... if numReadings is -1 it means no sensor by that name",
+		      "SensorInfo", "RETURN_COMPLEX");
+
+    myServer->addData("getSensorCumulativeCompact", 
+		      "gets the cumulative sensor readings for requested sensors, compactly encoded (see the ArServerInfoSensor docs)",
+		      &myGetSensorCumulativeCompactCB,
+		      "repeating: string: sensorName ubyte4: lastSequence (0 for none) ubyte2: resolutionInMM",
+		      "byte2: numReadings string: sensorName ubyte4: sequence byte4: keepStart (-1 if these are all the readings) byte4: keepCount byte2: numBefore ubyte2: resolutionInMM byte4: originX byte4: originY, repeating for numReadings times: varint: dx varint: dy.... if numReadings is -1 it means no sensor by that name",
+		      "SensorInfo", "RETURN_COMPLEX");
   }
 }
 
@@ -53,7 +72,7 @@ AREXPORT void ArServerInfoSensor::getSensorList(ArServerClient *client,
   std::list<ArRangeDevice *> *devList;
   std::list<ArRangeDevice *>::iterator it;
 
-  myRobot->lock();
+  myRobot->lockForRead();
   devList = myRobot->getRangeDeviceList();
   
   if (devList == NULL)
@@ -88,7 +107,7 @@ AREXPORT void ArServerInfoSensor::getSensorCurrent(ArServerClient *client,
 
     // find out the sensor they want
     packet->bufToStr(sensor, sizeof(sensor));
-    myRobot->lock();
+    myRobot->lockForRead();
     if ((dev = myRobot->findRangeDevice(sensor)) == NULL)
     {
       myRobot->unlock();
@@ -100,11 +119,11 @@ AREXPORT void ArServerInfoSensor::getSensorCurrent(ArServerClient *client,
     }
     
     myRobot->unlock();
-    dev->lockDevice();
+    dev->lockDeviceForRead();
     readings = dev->getCurrentBuffer();
     if (readings == NULL)
     {
-      dev->unlockDevice();
+      dev->unlockDeviceForRead();
       ArLog::log(ArLog::Verbose, "ArServerInfoSensor::getSensorCurrent: No current buffer for %s", sensor);
       sendPacket.byte2ToBuf(0);
       sendPacket.strToBuf(sensor);
@@ -119,7 +138,7 @@ AREXPORT void ArServerInfoSensor::getSensorCurrent(ArServerClient *client,
       sendPacket.byte4ToBuf(ArMath::roundInt((*it)->getX()));
       sendPacket.byte4ToBuf(ArMath::roundInt((*it)->getY()));
     }
-    dev->unlockDevice();
+    dev->unlockDeviceForRead();
     client->sendPacketUdp(&sendPacket);
   }
   
@@ -139,7 +158,7 @@ AREXPORT void ArServerInfoSensor::getSensorCumulative(ArServerClient *client,
     ArNetPacket sendPacket;  
     // find out the sensor they want
     packet->bufToStr(sensor, sizeof(sensor));
-    myRobot->lock();
+    myRobot->lockForRead();
     if ((dev = myRobot->findRangeDevice(sensor)) == NULL)
     {
       myRobot->unlock();
@@ -151,11 +170,11 @@ AREXPORT void ArServerInfoSensor::getSensorCumulative(ArServerClient *client,
     }
     
     myRobot->unlock();
-    dev->lockDevice();
+    dev->lockDeviceForRead();
     readings = dev->getCumulativeBuffer();
     if (readings == NULL)
     {
-      dev->unlockDevice();
+      dev->unlockDeviceForRead();
       ArLog::log(ArLog::Verbose, "ArServerInfoSensor::getSensorCumulative: No current buffer for %s", sensor);
       sendPacket.byte2ToBuf(0);
       sendPacket.strToBuf(sensor);
@@ -170,8 +189,192 @@ AREXPORT void ArServerInfoSensor::getSensorCumulative(ArServerClient *client,
       sendPacket.byte4ToBuf(ArMath::roundInt((*it)->getX()));
       sendPacket.byte4ToBuf(ArMath::roundInt((*it)->getY()));
     }
-    dev->unlockDevice();
+    dev->unlockDeviceForRead();
     client->sendPacketUdp(&sendPacket);
   }
 
 }
+
+AREXPORT void ArServerInfoSensor::getSensorCurrentCompact(
+	ArServerClient *client, ArNetPacket *packet)
+{
+  sendCompact(client, packet, false);
+}
+
+AREXPORT void ArServerInfoSensor::getSensorCumulativeCompact(
+	ArServerClient *client, ArNetPacket *packet)
+{
+  sendCompact(client, packet, true);
+}
+
+/**
+   The readings sent are remembered for the last few requests (for
+   each sensor), so that if the client says it has a set of readings
+   we still have, and the new readings are a run of those readings
+   with new readings before or after it (which is how the buffers
+   change as readings come in and the oldest are dropped), only the
+   new readings are sent.  Otherwise all of the readings are sent.
+**/
+AREXPORT void ArServerInfoSensor::sendCompact(ArServerClient *client, 
+					      ArNetPacket *packet,
+					      bool cumulative)
+{
+  ArRangeDevice *dev;
+  char sensor[512];
+  std::list<ArPoseWithTime *> *readings;
+  std::list<ArPoseWithTime *>::iterator it;
+  ArTypes::UByte4 lastSequence;
+  int resolution;
+  ArPose robotPose;
+  std::vector<ArTypes::Byte4> points;
+  const char *logName = (cumulative ? 
+	 "ArServerInfoSensor::getSensorCumulativeCompact" :
+	 "ArServerInfoSensor::getSensorCurrentCompact");
+
+  while (packet->getDataLength() > packet->getDataReadLength())
+  {
+    ArNetPacket sendPacket;
+
+    // find out the sensor they want and what they have
+    packet->bufToStr(sensor, sizeof(sensor));
+    lastSequence = packet->bufToUByte4();
+    resolution = packet->bufToUByte2();
+    if (resolution < 1)
+      resolution = 1;
+
+    myRobot->lockForRead();
+    if ((dev = myRobot->findRangeDevice(sensor)) == NULL)
+    {
+      myRobot->unlock();
+      ArLog::log(ArLog::Verbose, "%s: No sensor %s", logName, sensor);
+      sendPacket.byte2ToBuf(-1);
+      sendPacket.strToBuf(sensor);
+      client->sendPacketUdp(&sendPacket);
+      continue;
+    }
+    robotPose = myRobot->getPose();
+    myRobot->unlock();
+
+    points.clear();
+    dev->lockDeviceForRead();
+    if (cumulative)
+      readings = dev->getCumulativeBuffer();
+    else
+      readings = dev->getCurrentBuffer();
+    if (readings != NULL)
+    {
+      points.reserve(readings->size() * 2);
+      for (it = readings->begin(); it != readings->end(); it++)
+      {
+	points.push_back(ArMath::roundInt((*it)->getX()));
+	points.push_back(ArMath::roundInt((*it)->getY()));
+      }
+    }
+    dev->unlockDeviceForRead();
+
+    std::string key = sensor;
+    if (cumulative)
+      key += " cumulative";
+    else
+      key += " current";
+
+    mySentReadingsMutex.lock();
+    std::list<SentReadings> *sent = &mySentReadings[key];
+    std::list<SentReadings>::iterator sentIt;
+    // if the readings changed remember the new set
+    if (sent->empty() || sent->back().myPoints != points)
+    {
+      sent->push_back(SentReadings());
+      sent->back().mySequence = myNextSequence++;
+      sent->back().myPoints = points;
+      if (myNextSequence == 0)
+	myNextSequence = 1;
+      while (sent->size() > 8)
+	sent->pop_front();
+    }
+    ArTypes::UByte4 sequence = sent->back().mySequence;
+
+    // see if the client has readings we can send just the changes
+    // from, the range buffers add new readings at the front and drop
+    // the oldest from the back, but this also works for buffers that
+    // add at the back and drop from the front
+    ArTypes::Byte4 keepStart = -1;
+    ArTypes::Byte4 keepCount = 0;
+    size_t numBefore = 0;
+    size_t afterStart = points.size();
+    for (sentIt = sent->begin(); lastSequence != 0 && sentIt != sent->end();
+	 sentIt++)
+    {
+      if ((*sentIt).mySequence != lastSequence)
+	continue;
+      const std::vector<ArTypes::Byte4> &old = (*sentIt).myPoints;
+      size_t i;
+      // new readings then the start of the old ones
+      for (i = 0; i <= points.size() && keepStart < 0; i += 2)
+      {
+	if (points.size() - i <= old.size() &&
+	    std::equal(points.begin() + i, points.end(), old.begin()))
+	{
+	  keepStart = 0;
+	  keepCount = (points.size() - i) / 2;
+	  numBefore = i;
+	  afterStart = points.size();
+	}
+      }
+      // the end of the old readings then new ones
+      for (i = 0; i < old.size() && keepStart < 0; i += 2)
+      {
+	if (old.size() - i <= points.size() &&
+	    std::equal(old.begin() + i, old.end(), points.begin()))
+	{
+	  keepStart = i / 2;
+	  keepCount = (old.size() - i) / 2;
+	  numBefore = 0;
+	  afterStart = old.size() - i;
+	}
+      }
+      break;
+    }
+    if (keepStart < 0 || keepCount == 0)
+    {
+      keepStart = -1;
+      keepCount = 0;
+      numBefore = points.size();
+      afterStart = points.size();
+    }
+    mySentReadingsMutex.unlock();
+
+    int originX = ArMath::roundInt(robotPose.getX());
+    int originY = ArMath::roundInt(robotPose.getY());
+    int lastX = 0;
+    int lastY = 0;
+    int x;
+    int y;
+    size_t i;
+
+    sendPacket.byte2ToBuf((numBefore + points.size() - afterStart) / 2);
+    sendPacket.strToBuf(sensor);
+    sendPacket.uByte4ToBuf(sequence);
+    sendPacket.byte4ToBuf(keepStart);
+    sendPacket.byte4ToBuf(keepCount);
+    sendPacket.byte2ToBuf(numBefore / 2);
+    sendPacket.uByte2ToBuf(resolution);
+    sendPacket.byte4ToBuf(originX);
+    sendPacket.byte4ToBuf(originY);
+    for (i = 0; i + 1 < points.size(); i += 2)
+    {
+      // skip the readings the client is keeping
+      if (i == numBefore)
+	i = afterStart;
+      if (i + 1 >= points.size())
+	break;
+      x = ArMath::roundInt((points[i] - originX) / (double)resolution);
+      y = ArMath::roundInt((points[i + 1] - originY) / (double)resolution);
+      sendPacket.varIntToBuf(x - lastX);
+      sendPacket.varIntToBuf(y - lastY);
+      lastX = x;
+      lastY = y;
+    }
+    client->sendPacketUdp(&sendPacket);
+  }
+}
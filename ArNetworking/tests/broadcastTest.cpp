@@ -0,0 +1,125 @@
+#include "Aria.h"
+#include "ArNetworking.h"
+
+/*
+  Connects a number of clients to an in-process server, broadcasts a
+  stream of packets to them and checks that every client got every
+  packet with the right contents, then prints how long the broadcasts
+  took.
+*/
+
+int numClients = 8;
+int numPackets = 2000;
+
+class BroadcastCounter
+{
+public:
+  BroadcastCounter() : myCB(this, &BroadcastCounter::handler)
+    { myCount = 0; myErrors = 0; }
+  void handler(ArNetPacket *packet)
+    {
+      int num = packet->bufToByte4();
+      char buf[512];
+      packet->bufToStr(buf, sizeof(buf));
+      char expected[512];
+      sprintf(expected, "broadcast number %d", num);
+      myMutex.lock();
+      if (num != myCount || strcmp(buf, expected) != 0)
+	myErrors++;
+      myCount++;
+      myMutex.unlock();
+    }
+  int getCount(void) 
+    { myMutex.lock(); int ret = myCount; myMutex.unlock(); return ret; }
+  ArFunctor1C<BroadcastCounter, ArNetPacket *> myCB;
+  ArMutex myMutex;
+  int myCount;
+  int myErrors;
+};
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  ArArgumentParser parser(&argc, argv);
+  parser.checkParameterArgumentInteger("-clients", &numClients);
+  parser.checkParameterArgumentInteger("-packets", &numPackets);
+  bool useEpoll = parser.checkArgument("-epoll");
+
+  ArServerBase server(false);
+  server.addData("broadcastTest", "test broadcast", NULL, "none", 
+		 "byte4: number, string: text");
+  if (!server.open(7279))
+  {
+    printf("Could not open server port\n");
+    Aria::exit(1);
+  }
+  if (useEpoll)
+    server.setUseEpoll(true);
+  server.runAsync();
+
+  std::vector<ArClientBase *> clients;
+  std::vector<BroadcastCounter *> counters;
+  int i;
+  for (i = 0; i < numClients; i++)
+  {
+    ArClientBase *client = new ArClientBase;
+    BroadcastCounter *counter = new BroadcastCounter;
+    if (!client->blockingConnect("localhost", 7279, false))
+    {
+      printf("Could not connect client %d\n", i);
+      Aria::exit(1);
+    }
+    client->addHandler("broadcastTest", &counter->myCB);
+    client->request("broadcastTest", -1);
+    client->runAsync();
+    clients.push_back(client);
+    counters.push_back(counter);
+  }
+  // give the requests time to get to the server
+  ArUtil::sleep(500);
+
+  ArNetPacket packet;
+  char buf[512];
+  ArTime start;
+  for (i = 0; i < numPackets; i++)
+  {
+    packet.empty();
+    packet.byte4ToBuf(i);
+    sprintf(buf, "broadcast number %d", i);
+    packet.strToBuf(buf);
+    server.broadcastPacketTcp(&packet, "broadcastTest");
+  }
+  long long sendTime = start.mSecSinceLL();
+
+  ArTime waitStart;
+  bool done = false;
+  while (!done && waitStart.mSecSince() < 20000)
+  {
+    done = true;
+    for (i = 0; i < numClients; i++)
+      if (counters[i]->getCount() < numPackets)
+	done = false;
+    if (!done)
+      ArUtil::sleep(10);
+  }
+  long long recvTime = start.mSecSinceLL();
+
+  int errors = 0;
+  for (i = 0; i < numClients; i++)
+  {
+    if (counters[i]->getCount() != numPackets || counters[i]->myErrors != 0)
+    {
+      printf("Client %d got %d of %d packets with %d errors\n", i,
+	     counters[i]->getCount(), numPackets, counters[i]->myErrors);
+      errors++;
+    }
+  }
+  printf("%d packets to %d clients: broadcast %lld ms, all received %lld ms, %d bad clients\n",
+	 numPackets, numClients, sendTime, recvTime, errors);
+
+  for (i = 0; i < numClients; i++)
+    clients[i]->disconnect();
+  server.close();
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -0,0 +1,131 @@
+#include "Aria.h"
+#include "ArNetworking.h"
+
+/*
+  Opens a server with a number of idle connections (plain sockets
+  that never send anything) and one real client, then measures the
+  round trip time of requests from the real client and how much CPU
+  the process uses while everything is idle.  Run it with and without
+  -epoll to compare the two server loops.
+*/
+
+int numIdle = 200;
+int numRequests = 500;
+
+ArMutex replyMutex;
+int replies = 0;
+
+void ping(ArServerClient *client, ArNetPacket *packet)
+{
+  ArNetPacket sending;
+  sending.byte4ToBuf(packet->bufToByte4());
+  client->sendPacketTcp(&sending);
+}
+
+void pong(ArNetPacket *packet)
+{
+  replyMutex.lock();
+  replies++;
+  replyMutex.unlock();
+}
+
+int getReplies(void)
+{
+  replyMutex.lock();
+  int ret = replies;
+  replyMutex.unlock();
+  return ret;
+}
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  ArArgumentParser parser(&argc, argv);
+  bool useEpoll = parser.checkArgument("-epoll");
+  parser.checkParameterArgumentInteger("-idle", &numIdle);
+  parser.checkParameterArgumentInteger("-requests", &numRequests);
+  ArLog::init(ArLog::StdOut, ArLog::Terse);
+
+  ArServerBase server(false);
+  ArGlobalFunctor2<ArServerClient *, ArNetPacket *> pingCB(&ping);
+  server.addData("ping", "replies with the number it is given", &pingCB, 
+		 "byte4: number", "byte4: number");
+  if (!server.open(7280))
+  {
+    printf("Could not open server port\n");
+    Aria::exit(1);
+  }
+  if (useEpoll && !server.setUseEpoll(true))
+  {
+    printf("Could not use epoll\n");
+    Aria::exit(1);
+  }
+  server.runAsync();
+
+  int i;
+  std::vector<ArSocket *> idleSockets;
+  for (i = 0; i < numIdle; i++)
+  {
+    ArSocket *socket = new ArSocket;
+    if (!socket->connect("localhost", 7280))
+    {
+      printf("Could not connect idle socket %d\n", i);
+      Aria::exit(1);
+    }
+    idleSockets.push_back(socket);
+  }
+
+  ArClientBase client;
+  ArGlobalFunctor1<ArNetPacket *> pongCB(&pong);
+  if (!client.blockingConnect("localhost", 7280, false))
+  {
+    printf("Could not connect client\n");
+    Aria::exit(1);
+  }
+  client.addHandler("ping", &pongCB);
+  client.runAsync();
+  ArUtil::sleep(500);
+
+  int errors = 0;
+  ArNetPacket packet;
+  ArTime start;
+  long long totalUSec = 0;
+  long long maxUSec = 0;
+  for (i = 0; i < numRequests; i++)
+  {
+    long long sent = ArUtil::getTimeUSec();
+    packet.empty();
+    packet.byte4ToBuf(i);
+    client.requestOnce("ping", &packet);
+    while (getReplies() <= i && start.mSecSince() < 30000)
+      ArUtil::sleep(0);
+    if (getReplies() <= i)
+    {
+      printf("Timed out waiting for reply %d\n", i);
+      errors++;
+      break;
+    }
+    long long took = ArUtil::getTimeUSec() - sent;
+    totalUSec += took;
+    if (took > maxUSec)
+      maxUSec = took;
+  }
+
+  clock_t cpuStart = clock();
+  ArUtil::sleep(2000);
+  double cpuMSecs = (clock() - cpuStart) * 1000.0 / CLOCKS_PER_SEC;
+
+  printf("%s: %d idle connections, %d requests, mean %lld us, max %lld us, idle cpu %.0f ms in 2000 ms\n",
+	 useEpoll ? "epoll" : "poll", numIdle, i, 
+	 i > 0 ? totalUSec / i : 0, maxUSec, cpuMSecs);
+
+  client.disconnect();
+  for (i = 0; i < numIdle; i++)
+  {
+    idleSockets[i]->close();
+    delete idleSockets[i];
+  }
+  server.close();
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -0,0 +1,214 @@
+#include "Aria.h"
+#include "ArNetworking.h"
+
+/*
+  Serves a few MB file with ArServerFileToClient from an in-process
+  server and gets it with getFile and with getFileStreamed (whole,
+  and resumed from half of it), checking the copies match.  While
+  each get is going it times a small request to the same server to
+  see how much the file holds up other traffic.
+*/
+
+int fileSize = 4000000;
+int errors = 0;
+
+/// Answers pings and times how long they take to come back
+class Pinger
+{
+public:
+  Pinger(ArClientBase *client) : 
+    myClient(client), myCB(this, &Pinger::handler) 
+    { 
+      myClient->addHandler("ping", &myCB); 
+      myWaiting = false; myCount = 0; myTotal = 0; myMax = 0;
+    }
+  void ping(void)
+    {
+      if (myWaiting)
+	return;
+      myWaiting = true;
+      mySent.setToNow();
+      myClient->requestOnce("ping");
+    }
+  void handler(ArNetPacket *)
+    {
+      long long took = mySent.mSecSinceLL();
+      myCount++;
+      myTotal += took;
+      if (took > myMax)
+	myMax = took;
+      myWaiting = false;
+    }
+  void reset(void) { myCount = 0; myTotal = 0; myMax = 0; }
+  ArClientBase *myClient;
+  ArFunctor1C<Pinger, ArNetPacket *> myCB;
+  volatile bool myWaiting;
+  ArTime mySent;
+  int myCount;
+  long long myTotal;
+  long long myMax;
+};
+
+void pingHandler(ArServerClient *client, ArNetPacket *packet)
+{
+  client->sendPacketTcp(packet);
+}
+
+// what the file received callback got, NOT_YET until it is called
+const int NOT_YET = 1000;
+volatile int lastResult = NOT_YET;
+void fileReceived(int ret)
+{
+  lastResult = ret;
+}
+
+bool sameFiles(const char *name1, const char *name2)
+{
+  FILE *file1 = fopen(name1, "rb");
+  FILE *file2 = fopen(name2, "rb");
+  bool same = (file1 != NULL && file2 != NULL);
+  int c1, c2;
+  while (same)
+  {
+    c1 = getc(file1);
+    c2 = getc(file2);
+    if (c1 != c2)
+      same = false;
+    if (c1 == EOF)
+      break;
+  }
+  if (file1 != NULL)
+    fclose(file1);
+  if (file2 != NULL)
+    fclose(file2);
+  return same;
+}
+
+void waitForFile(const char *what, Pinger *pinger, ArTime started)
+{
+  pinger->reset();
+  while (lastResult == NOT_YET)
+  {
+    pinger->ping();
+    ArUtil::sleep(1);
+  }
+  printf("%-16s %5lld ms, %d pings took %lld ms avg %lld ms max\n", what, 
+	 started.mSecSinceLL(), pinger->myCount, 
+	 pinger->myCount > 0 ? pinger->myTotal / pinger->myCount : 0, 
+	 pinger->myMax);
+}
+
+void check(bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("FAILED: %s\n", what);
+    errors++;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  ArArgumentParser parser(&argc, argv);
+  parser.checkParameterArgumentInteger("-size", &fileSize);
+
+  mkdir("fileStreamTestDir", 0755);
+  FILE *file = fopen("fileStreamTestDir/served", "wb");
+  int i;
+  for (i = 0; i < fileSize; i++)
+    putc(ArMath::random() % 256, file);
+  fclose(file);
+
+  ArServerBase server(false);
+  ArGlobalFunctor2<ArServerClient *, ArNetPacket *> pingCB(&pingHandler);
+  server.addData("ping", "ping", &pingCB, "none", "none");
+  ArServerFileToClient fileToClientServer(&server, "fileStreamTestDir/");
+  if (!server.open(7280))
+  {
+    printf("Could not open server port\n");
+    Aria::exit(1);
+  }
+  server.runAsync();
+
+  ArClientBase client;
+  if (!client.blockingConnect("localhost", 7280, false))
+  {
+    printf("Could not connect client\n");
+    Aria::exit(1);
+  }
+  client.runAsync();
+  Pinger pinger(&client);
+  ArClientFileToClient fileToClient(&client);
+  ArGlobalFunctor1<int> fileReceivedCB(&fileReceived);
+  fileToClient.addFileReceivedCallback(&fileReceivedCB);
+  check(fileToClient.isAvailableStreamed(), "server streams files");
+
+  // the old way
+  ArTime started;
+  lastResult = NOT_YET;
+  fileToClient.getFileFromDirectory(NULL, "served", "fileStreamTestGot");
+  waitForFile("getFile", &pinger, started);
+  check(lastResult == 0 && 
+	sameFiles("fileStreamTestDir/served", "fileStreamTestGot"),
+	"getFile");
+
+  // streamed
+  unlink("fileStreamTestGot");
+  started.setToNow();
+  lastResult = NOT_YET;
+  fileToClient.getFileStreamedFromDirectory(NULL, "served", 
+					    "fileStreamTestGot");
+  waitForFile("getFileStreamed", &pinger, started);
+  check(lastResult == 0 && 
+	sameFiles("fileStreamTestDir/served", "fileStreamTestGot"),
+	"getFileStreamed");
+
+  // resumed from half way
+  truncate("fileStreamTestGot", fileSize / 2);
+  started.setToNow();
+  lastResult = NOT_YET;
+  fileToClient.getFileStreamedFromDirectory(NULL, "served", 
+					    "fileStreamTestGot", true);
+  waitForFile("resumed", &pinger, started);
+  check(lastResult == 0 && 
+	sameFiles("fileStreamTestDir/served", "fileStreamTestGot"),
+	"resumed getFileStreamed");
+
+  // a bad partial file fails the checksum
+  file = fopen("fileStreamTestGot", "r+b");
+  int c = getc(file);
+  fseek(file, 0, SEEK_SET);
+  putc(c ^ 0xff, file);
+  fclose(file);
+  truncate("fileStreamTestGot", fileSize / 2);
+  lastResult = NOT_YET;
+  fileToClient.getFileStreamedFromDirectory(NULL, "served", 
+					    "fileStreamTestGot", true);
+  while (lastResult == NOT_YET)
+    ArUtil::sleep(1);
+  check(lastResult == -4, "corrupt file fails checksum");
+  check(access("fileStreamTestGot", F_OK) != 0, "corrupt file is removed");
+
+  // and resuming past the end fails
+  file = fopen("fileStreamTestGot", "wb");
+  for (i = 0; i < fileSize + 10; i++)
+    putc(0, file);
+  fclose(file);
+  lastResult = NOT_YET;
+  fileToClient.getFileStreamedFromDirectory(NULL, "served", 
+					    "fileStreamTestGot", true);
+  while (lastResult == NOT_YET)
+    ArUtil::sleep(1);
+  check(lastResult == 5, "resuming past end fails");
+  check(access("fileStreamTestGot", F_OK) == 0, 
+	"file is kept when the get fails for other reasons");
+
+  unlink("fileStreamTestGot");
+  unlink("fileStreamTestDir/served");
+  rmdir("fileStreamTestDir");
+  printf("%d errors\n", errors);
+  client.disconnect();
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -0,0 +1,229 @@
+#include "Aria.h"
+#include "ArNetworking.h"
+
+/*
+  Serves a big generated map with ArServerHandlerMap from an in-process
+  server and has several clients get it at once, like after they all
+  reconnect, first with the packet cache turned off and then with it
+  on, checking the clients get the same packets either way.  Then
+  checks that getMapIfChanged skips the map for a client that already
+  has it and that changing the map throws the cache away.
+*/
+
+int numPoints = 300000;
+int numClients = 5;
+int errors = 0;
+
+/// Collects the packets of one map request
+class MapGetter
+{
+public:
+  MapGetter(ArClientBase *client) :
+    myClient(client),
+    myMapCB(this, &MapGetter::mapHandler),
+    myMapIdCB(this, &MapGetter::mapIdHandler)
+    {
+      myClient->addHandler("getMapBinary", &myMapCB);
+      myClient->addHandler("getMapWithMaxCategory", &myMapCB);
+      myClient->addHandler("getMapIfChanged", &myMapCB);
+      myClient->addHandler("getMapId", &myMapIdCB);
+      myDone = true;
+      myGotMapId = false;
+    }
+  void request(const char *name, ArNetPacket *packet = NULL)
+    {
+      myPackets.clear();
+      myDone = false;
+      myClient->requestOnce(name, packet);
+    }
+  void mapHandler(ArNetPacket *packet)
+    {
+      myPackets.push_back(std::string(
+			      packet->getBuf() + packet->getHeaderLength(),
+			      packet->getDataLength()));
+      if (packet->getDataLength() == 0)
+	myDone = true;
+    }
+  void mapIdHandler(ArNetPacket *packet)
+    {
+      ArMapId::fromPacket(packet, &myMapId);
+      myGotMapId = true;
+    }
+  ArClientBase *myClient;
+  ArFunctor1C<MapGetter, ArNetPacket *> myMapCB;
+  ArFunctor1C<MapGetter, ArNetPacket *> myMapIdCB;
+  std::vector<std::string> myPackets;
+  volatile bool myDone;
+  ArMapId myMapId;
+  volatile bool myGotMapId;
+};
+
+void check(bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("FAILED: %s\n", what);
+    errors++;
+  }
+}
+
+void waitForAll(std::vector<MapGetter *> *getters)
+{
+  bool done = false;
+  while (!done)
+  {
+    ArUtil::sleep(1);
+    done = true;
+    for (size_t i = 0; i < getters->size(); i++)
+      if (!(*getters)[i]->myDone)
+	done = false;
+  }
+}
+
+// has every client get the map and returns what the first one got
+std::vector<std::string> getFromAll(std::vector<MapGetter *> *getters,
+				    const char *what, const char *name,
+				    const char *category)
+{
+  ArTime started;
+  size_t i;
+  for (i = 0; i < getters->size(); i++)
+  {
+    ArNetPacket packet;
+    packet.strToBuf(category);
+    (*getters)[i]->request(name, category != NULL ? &packet : NULL);
+  }
+  waitForAll(getters);
+  printf("%-26s %d clients %5lld ms, %d packets each\n", what,
+	 (int)getters->size(), started.mSecSinceLL(),
+	 (int)(*getters)[0]->myPackets.size());
+  for (i = 1; i < getters->size(); i++)
+    check((*getters)[i]->myPackets == (*getters)[0]->myPackets,
+	  "every client got the same map");
+  return (*getters)[0]->myPackets;
+}
+
+void writeMap(const char *fileName, int seed)
+{
+  FILE *file = fopen(fileName, "w");
+  int i;
+  srand(seed);
+  fprintf(file, "2D-Map\nMinPos: -50000 -50000\nMaxPos: 50000 50000\n");
+  fprintf(file, "NumPoints: %d\nNumLines: 2000\n", numPoints);
+  fprintf(file, "Cairn: Goal 1000 1000 0.0 \"\" ICON \"goal1\"\n");
+  fprintf(file, "Cairn: Goal -1000 1000 0.0 \"\" ICON \"goal2\"\n");
+  fprintf(file, "LINES\n");
+  for (i = 0; i < 2000; i++)
+    fprintf(file, "%d %d %d %d\n", rand() % 100000 - 50000,
+	    rand() % 100000 - 50000, rand() % 100000 - 50000,
+	    rand() % 100000 - 50000);
+  fprintf(file, "DATA\n");
+  for (i = 0; i < numPoints; i++)
+    fprintf(file, "%d %d\n", rand() % 100000 - 50000,
+	    rand() % 100000 - 50000);
+  fclose(file);
+}
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  ArArgumentParser parser(&argc, argv);
+  parser.checkParameterArgumentInteger("-points", &numPoints);
+  parser.checkParameterArgumentInteger("-clients", &numClients);
+
+  writeMap("mapCacheTest.map", 1);
+  ArMap map;
+  map.setQuiet(true);
+  if (!map.readFile("mapCacheTest.map"))
+  {
+    printf("Could not read map\n");
+    Aria::exit(1);
+  }
+
+  ArServerBase server(false);
+  ArServerHandlerMap handlerMap(&server, &map);
+  if (!server.open(7281))
+  {
+    printf("Could not open server port\n");
+    Aria::exit(1);
+  }
+  server.runAsync();
+
+  std::vector<ArClientBase *> clients;
+  std::vector<MapGetter *> getters;
+  int i;
+  for (i = 0; i < numClients; i++)
+  {
+    ArClientBase *client = new ArClientBase;
+    if (!client->blockingConnect("localhost", 7281, false))
+    {
+      printf("Could not connect client\n");
+      Aria::exit(1);
+    }
+    client->runAsync();
+    clients.push_back(client);
+    getters.push_back(new MapGetter(client));
+  }
+
+  const char *extended = ArMapInterface::MAP_CATEGORY_2D_EXTENDED;
+  handlerMap.setUsePacketCache(false);
+  std::vector<std::string> binary =
+    getFromAll(&getters, "getMapBinary uncached", "getMapBinary", NULL);
+  std::vector<std::string> ext =
+    getFromAll(&getters, "extended uncached", "getMapWithMaxCategory",
+	       extended);
+
+  handlerMap.setUsePacketCache(true);
+  check(getFromAll(&getters, "getMapBinary first cached", "getMapBinary",
+		   NULL) == binary, "cached binary map matches");
+  check(getFromAll(&getters, "getMapBinary cached", "getMapBinary",
+		   NULL) == binary, "cached binary map matches");
+  check(getFromAll(&getters, "extended cached", "getMapWithMaxCategory",
+		   extended) == ext, "cached extended map matches");
+  check(getFromAll(&getters, "extended cached", "getMapWithMaxCategory",
+		   extended) == ext, "cached extended map matches");
+
+  // a client that has the map only gets told so
+  MapGetter *getter = getters[0];
+  getter->myClient->requestOnce("getMapId");
+  while (!getter->myGotMapId)
+    ArUtil::sleep(1);
+  ArNetPacket packet;
+  packet.strToBuf(extended);
+  ArMapId::toPacket(getter->myMapId, &packet);
+  getter->request("getMapIfChanged", &packet);
+  while (!getter->myDone)
+    ArUtil::sleep(1);
+  check(getter->myPackets.size() == 2 && getter->myPackets[0][0] == 1,
+	"getMapIfChanged with the current map ID");
+
+  // and one that doesn't gets the map
+  packet.empty();
+  packet.strToBuf(extended);
+  ArMapId::toPacket(ArMapId(), &packet);
+  getter->request("getMapIfChanged", &packet);
+  while (!getter->myDone)
+    ArUtil::sleep(1);
+  check(getter->myPackets.size() == ext.size() + 1 &&
+	getter->myPackets[0][0] == 0 &&
+	std::vector<std::string>(getter->myPackets.begin() + 1,
+				 getter->myPackets.end()) == ext,
+	"getMapIfChanged with no map ID");
+
+  // changing the map gets rid of the cached packets
+  writeMap("mapCacheTest.map", 2);
+  map.readFile("mapCacheTest.map");
+  std::vector<std::string> changed =
+    getFromAll(&getters, "changed map cached", "getMapBinary", NULL);
+  check(changed != binary, "changed map is different");
+  handlerMap.setUsePacketCache(false);
+  check(getFromAll(&getters, "changed map uncached", "getMapBinary",
+		   NULL) == changed, "changed cached map matches uncached");
+
+  for (i = 0; i < numClients; i++)
+    clients[i]->disconnect();
+  unlink("mapCacheTest.map");
+  printf("%d errors\n", errors);
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
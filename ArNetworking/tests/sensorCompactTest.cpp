@@ -0,0 +1,178 @@
+#include "Aria.h"
+#include "ArNetworking.h"
+
+/*
+  Serves a fake range device with ArServerInfoSensor, then requests
+  its cumulative readings both the old way and with the compact
+  encoding while readings are added, checking that what
+  ArClientBase::decodeCompactSensorReadings gives matches the old
+  replies and printing how many bytes each way took.
+*/
+
+int resolution = 10;
+
+ArMutex mutex;
+std::vector<ArPose> oldReadings;
+std::vector<ArPose> compactReadings;
+ArTypes::UByte4 sequence = 0;
+int oldBytes = 0;
+int compactBytes = 0;
+int oldReplies = 0;
+int compactReplies = 0;
+int incrementalReplies = 0;
+
+void handleOld(ArNetPacket *packet)
+{
+  char name[512];
+  mutex.lock();
+  oldBytes += packet->getLength();
+  oldReadings.clear();
+  int num = packet->bufToByte2();
+  packet->bufToStr(name, sizeof(name));
+  for (int i = 0; i < num; i++)
+  {
+    double x = packet->bufToByte4();
+    double y = packet->bufToByte4();
+    oldReadings.push_back(ArPose(x, y));
+  }
+  oldReplies++;
+  mutex.unlock();
+}
+
+void handleCompact(ArNetPacket *packet)
+{
+  mutex.lock();
+  compactBytes += packet->getLength();
+  // peek at where the kept readings start to see if this was just
+  // the changes
+  ArNetPacket peek;
+  peek.duplicatePacket(packet);
+  char name[512];
+  peek.bufToByte2();
+  peek.bufToStr(name, sizeof(name));
+  peek.bufToUByte4();
+  if (peek.bufToByte4() >= 0)
+    incrementalReplies++;
+  if (!ArClientBase::decodeCompactSensorReadings(packet, &compactReadings,
+						 &sequence))
+    printf("Decode failed\n");
+  compactReplies++;
+  mutex.unlock();
+}
+
+int waitFor(int *count, int num)
+{
+  ArTime start;
+  while (start.mSecSince() < 5000)
+  {
+    mutex.lock();
+    int now = *count;
+    mutex.unlock();
+    if (now >= num)
+      return true;
+    ArUtil::sleep(1);
+  }
+  printf("Timed out waiting for a reply\n");
+  return false;
+}
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  ArLog::init(ArLog::StdOut, ArLog::Terse);
+
+  ArRobot robot;
+  ArRangeDevice dev(100, 3000, "fake", 30000);
+  robot.addRangeDevice(&dev);
+  robot.moveTo(ArPose(1234, -567, 0));
+
+  ArServerBase server(false);
+  ArServerInfoSensor sensorInfo(&server, &robot);
+  if (!server.open(7281))
+  {
+    printf("Could not open server port\n");
+    Aria::exit(1);
+  }
+  server.runAsync();
+
+  ArClientBase client;
+  ArGlobalFunctor1<ArNetPacket *> oldCB(&handleOld);
+  ArGlobalFunctor1<ArNetPacket *> compactCB(&handleCompact);
+  if (!client.blockingConnect("localhost", 7281, false))
+  {
+    printf("Could not connect client\n");
+    Aria::exit(1);
+  }
+  if (!client.dataExists("getSensorCumulativeCompact"))
+  {
+    printf("Server doesn't have getSensorCumulativeCompact\n");
+    Aria::exit(1);
+  }
+  client.addHandler("getSensorCumulative", &oldCB);
+  client.addHandler("getSensorCumulativeCompact", &compactCB);
+  client.runAsync();
+
+  int errors = 0;
+  int round;
+  int i;
+  double angle = 0;
+  for (round = 0; round < 20; round++)
+  {
+    // a scan's worth of readings around the robot, the buffer drops
+    // the oldest once it is full
+    dev.lockDevice();
+    for (i = 0; i < 361; i++, angle += .5)
+      dev.getCumulativeRangeBuffer()->addReading(
+	      1234 + (3000 + round * 10) * ArMath::cos(angle), 
+	      -567 + (2000 + i) * ArMath::sin(angle));
+    dev.unlockDevice();
+
+    client.requestOnceWithString("getSensorCumulative", "fake");
+    ArNetPacket request;
+    request.strToBuf("fake");
+    mutex.lock();
+    request.uByte4ToBuf(sequence);
+    mutex.unlock();
+    request.uByte2ToBuf(resolution);
+    client.requestOnce("getSensorCumulativeCompact", &request);
+    if (!waitFor(&oldReplies, round + 1) || 
+	!waitFor(&compactReplies, round + 1))
+    {
+      errors++;
+      break;
+    }
+
+    mutex.lock();
+    if (oldReadings.size() != compactReadings.size())
+    {
+      printf("Round %d: %d old readings but %d compact readings\n", round,
+	     (int)oldReadings.size(), (int)compactReadings.size());
+      errors++;
+    }
+    for (i = 0; i < (int)oldReadings.size() && 
+	   i < (int)compactReadings.size(); i++)
+    {
+      if (fabs(oldReadings[i].getX() - compactReadings[i].getX()) > 
+	  resolution / 2.0 + .001 ||
+	  fabs(oldReadings[i].getY() - compactReadings[i].getY()) > 
+	  resolution / 2.0 + .001)
+      {
+	printf("Round %d: reading %d old %.0f %.0f compact %.0f %.0f\n",
+	       round, i, oldReadings[i].getX(), oldReadings[i].getY(),
+	       compactReadings[i].getX(), compactReadings[i].getY());
+	errors++;
+	break;
+      }
+    }
+    mutex.unlock();
+  }
+
+  printf("%d rounds: old %d bytes, compact %d bytes (%d of %d replies incremental), %d errors\n",
+	 round, oldBytes, compactBytes, incrementalReplies, compactReplies, 
+	 errors);
+
+  client.disconnect();
+  server.close();
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -115,6 +115,22 @@ public:
   /// Get the robot we are controlling, which was set by setRobot()
   AREXPORT ArRobot* getRobot() const { return myRobot; }
 
+  /// Sets whether this action's fire() is pure
+  /**
+     A pure action's fire() only looks at the robot and its range
+     devices (through the get and checkRangeDevices functions), doesn't
+     change anything but the action's own members, and doesn't use the
+     currentDesired it is passed.  If ArPriorityResolver is set to use
+     parallel threads (ArPriorityResolver::setParallelThreads()) then
+     pure actions are fired at the same time as each other on those
+     threads, with an empty currentDesired, before the rest of the
+     actions are fired in the normal order.  Actions are not pure
+     unless they (or whoever makes them) say so.
+  **/
+  void setPure(bool pure) { myIsPure = pure; }
+  /// Gets whether this action's fire() is pure (see setPure())
+  bool isPure(void) const { return myIsPure; }
+
   /// Sets the default activation state for all ArActions
   static void setDefaultActivationState(bool defaultActivationState)
     { ourDefaultActivationState = defaultActivationState; }
@@ -130,6 +146,7 @@ protected:
 
   // These are mostly for internal use by ArAction, not subclasses:
   bool myIsActive;
+  bool myIsPure;
   int myNumArgs;
   std::map<int, ArArg> myArgumentMap;
   std::string myName;
@@ -105,6 +105,12 @@ public:
   virtual int tryLockDevice() {return(myDeviceMutex.tryLock());}
   /// Unlock this device
   virtual int unlockDevice() {return(myDeviceMutex.unlock());}
+  /// Lock this device for reading (the same as lockDevice())
+  virtual int lockDeviceForRead() { return(myDeviceMutex.lock());}
+  /// Try to lock this device for reading (the same as tryLockDevice())
+  virtual int tryLockDeviceForRead() {return(myDeviceMutex.tryLock());}
+  /// Unlock this device after reading (the same as unlockDevice())
+  virtual int unlockDeviceForRead() {return(myDeviceMutex.unlock());}
 
   AREXPORT void logBatteryInfo(ArLog::LogLevel level = ArLog::Normal);
   AREXPORT void logCellInfo(ArLog::LogLevel level = ArLog::Normal);
@@ -305,6 +305,10 @@ public:
   AREXPORT std::list<std::string> getSectionNames() const;
 
   /// Get the sections themselves (use only if you know what to do)
+  /**
+     Sections should not be added to or removed from this list
+     directly, since findSection() would not know about them.
+  **/
   AREXPORT std::list<ArConfigSection *> *getSections(void);
 
 
@@ -452,6 +456,8 @@ protected:
 
   void addParserHandlers(void);
   void remParserHandlers(void);
+  /// Adds a section to the end of mySections and to mySectionIndex
+  void pushSection(ArConfigSection *section);
   void addListNamesToParser(const ArConfigArg &parent);
 
   /// Optional name of the robot with which the config is associated.
@@ -507,6 +513,11 @@ protected:
 
   // our list of sections which has in it the argument list for each
   std::list<ArConfigSection *> mySections;
+  // the first section in mySections with each name, for findSection
+  std::map<std::string, ArConfigSection *, ArStrCaseCmpOp> mySectionIndex;
+  // the section each parameter name was first added to, so addParam
+  // can tell when a name is in more than one section
+  std::map<std::string, std::string, ArStrCaseCmpOp> myParamSections;
 
   // callback for the file parser
   ArRetFunctor3C<bool, ArConfig, ArArgumentBuilder *, char *, size_t> myParserCB;
@@ -557,7 +568,11 @@ public:
   const char *getFlags(void) const { return myFlags->getFullString(); }
   AREXPORT bool hasFlag(const char *flag) const;
   
+  /// Gets the parameters (if you change the list call paramsChanged())
   std::list<ArConfigArg> *getParams(void) { return &myParams; }
+
+  /// Lets findParam() know that the list from getParams() was changed
+  void paramsChanged(void) { myParamIndexValid = false; }
   
   void setName(const char *name);
 
@@ -597,6 +612,11 @@ protected:
   /// Sets the name of the category to which this section belongs.
   void setCategoryName(const char *categoryName);
 
+  /// Adds a parameter just added to the end of myParams to the indexes
+  void indexParam(ArConfigArg *param);
+  /// Rebuilds the indexes of myParams
+  void buildParamIndex(void);
+
 protected:
 
   std::string myName;
@@ -607,6 +627,17 @@ protected:
   std::list<ArConfigArg> myParams;
   bool myIsQuiet;
 
+  // the last parameter in myParams with each name (so that findParam
+  // gets the same one it did when it searched the list), ignoring
+  // string and list holders
+  std::map<std::string, ArConfigArg *, ArStrCaseCmpOp> myParamIndex;
+  // the same, but including string and list holders
+  std::map<std::string, ArConfigArg *, ArStrCaseCmpOp> myParamWithHoldersIndex;
+  // the string and list holders in myParams, by name
+  std::map<std::string, int, ArStrCaseCmpOp> myHolderCounts;
+  // whether the indexes match myParams
+  bool myParamIndexValid;
+
 }; // end class ArConfigSection
 
 #endif // ARCONFIG
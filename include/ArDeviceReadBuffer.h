@@ -0,0 +1,103 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#ifndef ARDEVICEREADBUFFER_H
+#define ARDEVICEREADBUFFER_H
+
+#include <deque>
+#include "ariaTypedefs.h"
+#include "ariaUtil.h"
+
+class ArDeviceConnection;
+
+/// Buffers what is read from a device connection so packets can be framed out of it
+/**
+   Packet receivers that read one byte at a time while looking for
+   the start of a packet make a system call for every byte, which adds
+   up with fast devices (or ones over a network).  This instead reads
+   everything the connection has available at once into a ring
+   buffer, which the receiver looks through (find() uses memchr) and
+   takes whole packets out of (copy() then consume()).
+
+   When each read was made is kept, so getTimeRead() can say when the
+   data at any spot in the buffer came in (for when a packet was
+   received).
+
+   This isn't thread safe, it's meant to be used by the one thing
+   receiving packets from a connection.  Nothing else should read
+   from the connection while this is being used, since anything
+   already buffered would be out of order with what they read.
+**/
+class ArDeviceReadBuffer
+{
+public:
+  /// Constructor
+  AREXPORT ArDeviceReadBuffer(ArDeviceConnection *conn = NULL, 
+			      int size = 4096);
+  /// Destructor
+  AREXPORT virtual ~ArDeviceReadBuffer();
+  /// Sets the connection to read from (which empties the buffer)
+  AREXPORT void setDeviceConnection(ArDeviceConnection *conn);
+  /// Gets the connection being read from
+  ArDeviceConnection *getDeviceConnection(void) { return myConn; }
+  /// Reads whatever the connection has available into the buffer
+  AREXPORT int fill(unsigned int msWait = 0);
+  /// Gets how many bytes are in the buffer
+  int getNumBytes(void) const { return myNumBytes; }
+  /// Gets how many bytes the buffer can hold
+  int getSize(void) const { return mySize; }
+  /// Finds the first spot at or after start with the given byte
+  AREXPORT int find(unsigned char c, int start = 0) const;
+  /// Gets the byte at a spot in the buffer (which must be < getNumBytes())
+  unsigned char peek(int offset) const 
+    { return myBuf[(myStart + offset) & (mySize - 1)]; }
+  /// Copies bytes out of the buffer (without taking them out of it)
+  AREXPORT void copy(char *dest, int offset, int length) const;
+  /// Takes bytes off the front of the buffer
+  AREXPORT void consume(int length);
+  /// Empties the buffer
+  AREXPORT void clear(void);
+  /// Gets when the data at a spot in the buffer was read
+  AREXPORT ArTime getTimeRead(int offset) const;
+  /// Gets how many reads were made on the connection (for testing)
+  long getNumReads(void) const { return myNumReads; }
+protected:
+  // reads into the free space, returns how much was read or -1
+  int internalRead(int size, unsigned int msWait);
+
+  ArDeviceConnection *myConn;
+  unsigned char *myBuf;
+  int mySize;
+  int myStart;
+  int myNumBytes;
+  long myNumReads;
+  // how many bytes have ever been consumed, so that reads can be
+  // found after the buffer wraps
+  ArTypes::UByte4 myConsumed;
+  // where each read ended (in bytes ever read) and when it was read
+  std::deque<std::pair<ArTypes::UByte4, ArTime> > myReadTimes;
+};
+
+#endif // ARDEVICEREADBUFFER_H
@@ -28,17 +28,21 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 
 #include "ariaTypedefs.h"
 #include "ariaUtil.h"
+#include <vector>
 
 /** 
     This class takes care of storing in readings of position vs time, and then
     interpolating between them to find where the robot was at a particular 
-    point in time.  It has two lists, one containing the times, and one 
-    containing the positions at those same times (per position), they must be 
-    walked through jointly to maintain cohesion.  The new entries are at the
-    front of the list, while the old ones are at the back.  
-    numberOfReadings and the setNumberOfReadings control the number of entries
-    in the list.  If a size is set that is smaller than the current size, then
-    the old ones are chopped off.
+    point in time.  The readings (each position with its time) are kept in
+    a ring that holds numberOfReadings of them, adding a reading when it is
+    full replaces the oldest one.  If a size is set that is smaller than the
+    current size, then the old ones are chopped off.
+
+    The readings must be added in time order (which they are, since
+    they're added as they come in), since finding the readings around
+    a time is done with a binary search.  getPoses finds the positions
+    for many times at once (like all the readings of a laser scan),
+    which only locks once.
     
     This class now has a couple of variables for when it allows
     prediction, they're set with setAllowedMSForPrediction and
@@ -60,6 +64,9 @@ public:
   /// Finds a position
   AREXPORT int getPose(ArTime timeStamp, ArPose *position, 
 		       ArPoseWithTime *lastData = NULL);
+  /// Finds the positions for a number of times at once
+  AREXPORT int getPoses(const ArTime *timeStamps, ArPose *positions,
+			int *results, int numTimes);
   /// Sets the name
   AREXPORT void setName(const char *name);
   /// Gets the name
@@ -83,10 +90,21 @@ public:
   /// Empties the interpolated positions
   AREXPORT void reset(void);
 protected:
+  // finds a position (the data mutex must be locked)
+  int internalGetPose(ArTime timeStamp, ArPose *position, 
+		      ArPoseWithTime *mostRecent);
+  // gets a reading, 0 being the newest and getNum - 1 the oldest
+  const ArPoseWithTime &internalGetReading(size_t i) const
+    { return myReadings[(myNewest + myReadings.size() - i) % 
+			myReadings.size()]; }
+
   ArMutex myDataMutex;
   std::string myName;
-  std::list<ArTime> myTimes;
-  std::list<ArPose> myPoses;
+  // the readings, the newest is at myNewest and older ones go back
+  // from there (wrapping around)
+  std::vector<ArPoseWithTime> myReadings;
+  size_t myNewest;
+  size_t myNum;
   size_t mySize;
   bool myLogPrediction;
   int myAllowedMSForPrediction;
@@ -30,8 +30,17 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ArRobotPacket.h"
 #include "ArLaser.h"   
 #include "ArFunctor.h"
+#include "ArDeviceReadBuffer.h"
 
-/** @internal */
+/** 
+    This is the packet for the SICK CoLa protocol, it can be either
+    CoLa-A (ASCII, where each value is a hex or decimal word) or
+    CoLa-B (binary, where each value is big endian bytes).  The same
+    bufTo and ToBuf calls read and write either one, so the code
+    building and reading telegrams doesn't need to care which it is.
+
+    @internal
+**/
 class ArLMS1XXPacket : public ArBasePacket
 {
 public:
@@ -40,6 +49,11 @@ public:
   /// Destructor
   AREXPORT virtual ~ArLMS1XXPacket();
 
+  /// Sets whether this is a binary (CoLa-B) packet (which empties it)
+  AREXPORT void setBinary(bool binary);
+  /// Gets whether this is a binary (CoLa-B) packet 
+  bool isBinary(void) const { return myBinary; }
+
   /// Gets the command type 
   AREXPORT const char *getCommandType(void);
   /// Gets the command name
@@ -72,14 +86,34 @@ public:
   AREXPORT virtual ArTypes::UByte2 bufToUByte2(void);
   AREXPORT virtual ArTypes::UByte4 bufToUByte4(void);
   AREXPORT virtual void bufToStr(char *buf, int len);
+  /// Gets a string that's a fixed length in binary packets
+  AREXPORT void bufToFixedStr(char *buf, int len, int binaryLength);
+
+  /// Gets a whole block of 16 bit values at once
+  AREXPORT int bufToUByte2Array(ArTypes::UByte2 *values, int num);
+  /// Gets a whole block of 8 bit values at once
+  AREXPORT int bufToUByteArray(ArTypes::UByte *values, int num);
 
   // adds a raw char to the buf
   AREXPORT virtual void rawCharToBuf(unsigned char c);
 protected:
   int deascii(char c);
+  // gets the next hex word (for the ASCII protocol)
+  ArTypes::UByte4 hexWordFromBuf(void);
+  // gets the next size bytes as a big endian value (for the binary protocol)
+  ArTypes::UByte4 bigEndianFromBuf(int size);
+  // puts size bytes of val in big endian (for the binary protocol)
+  void bigEndianToBuf(ArTypes::UByte4 val, int size);
+
+  // the value of each hex digit (-1 for the chars that aren't)
+  static const signed char ourHexValues[256];
 
   ArTime myTimeReceived;
   bool myFirstAdd;
+  bool myBinary;
+  // if the last thing added to a binary packet was a string (which
+  // means the next thing needs a space first)
+  bool myLastAddedStr;
 
   char myCommandType[1024]; 
   char myCommandName[1024]; 
@@ -122,6 +156,11 @@ public:
 
 
 protected:
+  // takes a binary packet out of the read buffer if it's all there
+  ArLMS1XXPacket *internalBinaryPacket(bool ignoreRemainders);
+  // deals with what's in the read buffer after a packet
+  void internalRemainder(bool ignoreRemainders);
+
   ArDeviceConnection *myConn;
   ArLMS1XXPacket myPacket;
   
@@ -134,6 +173,8 @@ protected:
   State myState;
   char myName[1024];
   unsigned int myNameLength;
+  // what's been read but not yet split into packets (by receivePacket)
+  ArDeviceReadBuffer myReadBuffer;
   char myReadBuf[100000];
   int myReadCount;
 	int myReadTimeout;
@@ -192,6 +233,14 @@ public:
   /// Logs the information about the sensor
   AREXPORT void log(void);
 
+  /// Sets whether to try to get binary (CoLa-B) scans (call before connecting)
+  AREXPORT void setUseBinaryProtocol(bool useBinaryProtocol)
+    { myUseBinaryProtocol = useBinaryProtocol; }
+  /// Gets whether to try to get binary (CoLa-B) scans
+  AREXPORT bool getUseBinaryProtocol(void) { return myUseBinaryProtocol; }
+  /// Gets whether the scans are coming in binary (CoLa-B)
+  AREXPORT bool isUsingBinaryProtocol(void) { return myUsingBinaryProtocol; }
+
 
 protected:
   AREXPORT virtual void laserSetName(const char *name);
@@ -203,10 +252,14 @@ protected:
   void failedToConnect(void);
   void clear(void);
 	bool validateCheckSum(ArLMS1XXPacket *packet);
+  bool negotiateBinaryProtocol(ArTime timeDone);
 
   LaserModel myLaserModel;
   //bool myIsLMS5XX;
 
+  bool myUseBinaryProtocol;
+  bool myUsingBinaryProtocol;
+
   bool myIsConnected;
   bool myTryingToConnect;
   bool myStartConnect;
@@ -249,6 +302,13 @@ protected:
 
   std::list<ArLMS1XXPacket *> myPackets;
 
+  // the ranges and ignores of a scan, for laserConvertScan
+  std::vector<int> myScanRanges;
+  std::vector<char> myScanIgnores;
+  // the values of a channel of a scan, decoded all at once
+  std::vector<ArTypes::UByte2> myScanValues;
+  std::vector<ArTypes::UByte> myScanValues8Bit;
+
   ArFunctorC<ArLMS1XX> mySensorInterpTask;
   ArRetFunctorC<bool, ArLMS1XX> myAriaExitCB;
 };
@@ -29,8 +29,14 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ariaTypedefs.h"
 #include "ArDeviceConnection.h"
 #include "ArLMS2xxPacket.h"
+#include "ArDeviceReadBuffer.h"
 
 /// Given a device connection it receives packets from the sick through it
+/**
+   The data is read from the connection in bulk into an
+   ArDeviceReadBuffer that packets are then taken out of, rather than
+   a byte at a time.
+**/
 class ArLMS2xxPacketReceiver
 {
 public:
@@ -63,6 +69,7 @@ protected:
   ArLMS2xxPacket myPacket;
   unsigned char myReceivingAddress;
   bool myUseBase0Address;
+  ArDeviceReadBuffer myReadBuffer;
   enum { STATE_START, STATE_ADDR, STATE_START_COUNT, STATE_ACQUIRE_DATA };
 };
 
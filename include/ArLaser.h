@@ -561,6 +561,13 @@ protected:
   /// by subclasses)
   AREXPORT void laserProcessReadings(void);
 
+  /// Converts a whole scan of ranges into the raw readings
+  AREXPORT void laserConvertScan(const int *ranges, const char *ignore,
+				 int numReadings, double startAngle, 
+				 double increment, ArPose robotPose, 
+				 ArPose encoderPose, ArTransform transform,
+				 unsigned int counter, ArTime timeTaken);
+
   /// Returns if the laser has lost connection so that the subclass
   /// can do something appropriate
   AREXPORT bool laserCheckLostConnection(void);
@@ -661,6 +668,23 @@ protected:
   double mySensorZ;
   bool myHaveSensorPose;
 
+  // the cos and sin of each beam for laserConvertScan, and what they
+  // were made for
+  bool myScanTableValid;
+  int myScanTableNumReadings;
+  double myScanTableStart;
+  double myScanTableIncrement;
+  double myScanTableSensorX;
+  double myScanTableSensorY;
+  std::vector<double> myScanCos;
+  std::vector<double> myScanSin;
+  // working space for laserConvertScan
+  std::vector<double> myScanDoubleRanges;
+  std::vector<double> myScanLocalX;
+  std::vector<double> myScanLocalY;
+  std::vector<double> myScanX;
+  std::vector<double> myScanY;
+
   double myCumulativeCleanDist;
   double myCumulativeCleanDistSquared;
   int myCumulativeCleanInterval;
@@ -27,9 +27,14 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #define ARLASERLOGGER_H
 
 #include <stdio.h>
+#include <vector>
 
 #include "ariaUtil.h"
 #include "ArFunctor.h"
+#include "ArMutex.h"
+#include "ArCondition.h"
+#include "ArThread.h"
+#include "ArBasePacket.h"
 
 class ArLaser;
 class ArRobot;
@@ -50,6 +55,17 @@ class ArRobotPacket;
    information about that... you can also explicitly have it add a
    goal by calling addGoal.
 
+   The robot task only gathers up what is to be logged, the
+   formatting and writing of the file is done by a separate writer
+   thread (so that slow disks don't slow down the robot's cycle).  If
+   the writer falls far enough behind, whole sets of scans are
+   dropped (never part of one, and never text or tags) until it
+   catches up, and how many were dropped is logged (see
+   getNumDropped()).  The log can also be written in a compact
+   binary format instead of text (see the binaryFile constructor arg
+   and @ref LaserLogFileFormat), which can be converted to the text
+   format with convertBinaryToText().
+
    @see @ref LaserLogFileFormat for details on the laser scan log output file format.
 **/
 class ArLaserLogger
@@ -67,7 +83,8 @@ public:
 	  const std::map<std::string, 
 	  ArRetFunctor3<int, ArTime, ArPose *, ArPoseWithTime *> *, 
 	  ArStrCaseCmpOp> *extraLocationData = NULL,
-	  std::list<ArLaser *> *extraLasers = NULL);
+	  std::list<ArLaser *> *extraLasers = NULL,
+	  bool binaryFile = false);
   /// Destructor
   AREXPORT virtual ~ArLaserLogger();
 
@@ -113,6 +130,27 @@ public:
   bool takingNewReadings(void) { return myNewReadings; }
   /// Sets if we're taking old (scan1:) readings
   void takeNewReadings(bool takeNew) { myNewReadings = takeNew; }
+  /// Gets if the log is being written in the binary format
+  bool isBinaryFile(void) { return myBinaryFile; }
+  /// Gets how many sets of scans were dropped because the writer fell behind
+  AREXPORT long getNumDropped(void);
+
+  /// Converts a binary laser log into the text format
+  AREXPORT static bool convertBinaryToText(const char *binaryFileName,
+					   const char *textFileName);
+  /// Reads the index of a binary laser log, to find where scans are in the file
+  AREXPORT static bool readBinaryIndex(const char *binaryFileName,
+				       std::map<int, long> *scanOffsets);
+
+  /// The types of records in the binary format
+  enum BinaryRecordType {
+    BINARY_TEXT = 1, ///< Lines of text that are written as is
+    BINARY_TAG = 2, ///< A tag (or goal) and where the robot was
+    BINARY_SCAN_SET = 3, ///< The time and velocities of a set of scans
+    BINARY_SCAN = 4, ///< A scan from one laser and where the robot was
+    BINARY_INDEX = 5, ///< Where the scans since the last index are in the file
+    BINARY_END = 6 ///< The end of the log
+  };
 protected:
   /// The task which gets attached to the robot
   AREXPORT void robotTask(void);
@@ -124,13 +162,27 @@ protected:
   void internalTakeReading(void);
   // internal function that takes a reading from one laser
   void internalTakeLaserReading(ArLaser *laser, int laserNumber);
-  // internal function that prints the position
-  void internalPrintPos(ArPose encoderPoseTaken, ArPose goalPoseTaken, 
-			ArTime timeTaken);
   // internal function that logs the pose and conf
   void internalPrintLaserPoseAndConf(ArLaser *laser, int laserNumber);
   // internal packet for handling the loop packets
   AREXPORT bool loopPacketHandler(ArRobotPacket *packet);
+  // internal function that queues a text record
+  void internalAddText(const char *str, ...);
+  // internal function that queues a copy of the record for the writer thread
+  void internalQueueRecord(ArBasePacket *record);
+  // internal function that puts the position into a record
+  void internalPosToRecord(ArBasePacket *record, ArPose encoderPoseTaken, 
+			   ArPose globalPoseTaken, ArTime timeTaken);
+  // the thread that writes the records to the file
+  void writerThread(void);
+  // writes out one record, from the writer thread
+  void internalWriteRecord(ArBasePacket *record);
+  // writes the index of the scans since the last one, from the writer thread
+  void internalWriteIndex(void);
+  // writes a record in the text format
+  static bool recordToText(ArBasePacket *record, FILE *file);
+  // writes a position from a record in the text format
+  static void posFromRecordToText(ArBasePacket *record, FILE *file);
 
 
   // what type of readings we are taking
@@ -189,6 +241,30 @@ protected:
 
   ArFunctorC<ArLaserLogger> myGoalKeyCB;
   ArRetFunctor1C<bool, ArLaserLogger, ArRobotPacket *> myLoopPacketHandlerCB;
+
+  // if we're writing the binary format
+  bool myBinaryFile;
+  // the records waiting for the writer thread
+  ArMutex myQueueMutex;
+  ArCondition myQueueCondition;
+  std::list<ArBasePacket *> myQueue;
+  int myQueueLength;
+  long myNumDropped;
+  // if the scans of the set being queued are being dropped
+  bool myDroppingScanSet;
+  // how many sets have been dropped since the writer last kept up
+  long myNumDroppedInRow;
+  bool myWriterRunning;
+  ArThread myWriterThread;
+  ArFunctorC<ArLaserLogger> myWriterCB;
+  // the record the robot task is building
+  ArBasePacket myRecord;
+  // the scan points for the record
+  std::vector<int> myScanPoints;
+  // what the writer thread uses to write the index
+  long myFileOffset;
+  long myLastIndexOffset;
+  std::list<std::pair<int, long> > myIndexEntries;
 };
 
 /// @deprecated
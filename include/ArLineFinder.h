@@ -31,10 +31,57 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ariaUtil.h"
 #include <vector>
 
-class ArLineFinderSegment;
 class ArConfig;
 
+/// Class for ArLineFinder to hold more info than an ArLineSegment
+class ArLineFinderSegment : public ArLineSegment
+{
+public:
+  ArLineFinderSegment() {}
+  ArLineFinderSegment(double x1, double y1, double x2, double y2, 
+		      int numPoints = 0, int startPoint = 0, int endPoint = 0)
+    { newEndPoints(x1, y1, x2, y2, numPoints, startPoint, endPoint); }
+  virtual ~ArLineFinderSegment() {}
+  void newEndPoints(double x1, double y1, double x2, double y2, 
+		    int numPoints = 0, int startPoint = 0, int endPoint = 0)
+    {
+      ArLineSegment::newEndPoints(x1, y1, x2, y2);
+      myLineAngle = ArMath::atan2(y2 - y1, x2 - x1);
+      myLength = ArMath::distanceBetween(x1, y1, x2, y2);
+      myNumPoints = numPoints;
+      myStartPoint = startPoint;
+      myEndPoint = endPoint;
+      myAveDistFromLine = 0;
+    }
+  double getLineAngle(void) const { return myLineAngle; }
+  double getLength(void) const { return myLength; }
+  int getNumPoints(void) const { return myNumPoints; }
+  int getStartPoint(void) const { return myStartPoint; }
+  int getEndPoint(void) const { return myEndPoint; }
+  void setAveDistFromLine(double aveDistFromLine) 
+    { myAveDistFromLine = aveDistFromLine; }
+  double getAveDistFromLine(void) const { return myAveDistFromLine; }
+protected:
+  double myLineAngle;
+  double myLength;
+  int myNumPoints;
+  int myStartPoint;
+  int myEndPoint;
+  double myAveDistFromLine;
+};
+
 /** This class finds lines out of any range device with raw readings (lasers for instance)
+
+    getLines() and getNonLinePoints() build new maps (and a new
+    segment for every line) on each call.  getLineArray() finds the
+    same lines using arrays that are kept between calls, so once it
+    has seen a scan or two it doesn't allocate anything, which makes
+    it the one to use for finding lines every cycle.  With
+    setIncremental() on, getLineArray() also starts from the lines it
+    found on the last scan: runs of points that still lie along one of
+    those lines are refit directly, and only the rest of the points go
+    through creating and combining.
+
  @ingroup OptionalClasses
  @ingroup UtilityClasses
 */
@@ -59,6 +106,19 @@ public:
   /// Finds the lines, and then copies the points that AREN'T in the lines into a new set
   AREXPORT std::set<ArPose> getNonLinePointsAsSet();
 
+#ifndef SWIG
+  /// Finds the lines into an array ArLineFinder keeps between calls
+  /** @swigomit */
+  AREXPORT const std::vector<ArLineFinderSegment> *getLineArray(void);
+  /// Gets the points the last lines were found in (indexed by the lines' start and end points)
+  /** @swigomit */
+  const std::vector<ArPose> *getPointArray(void) { return &myPointArray; }
+#endif
+  /// Sets whether getLineArray starts from the lines found on the last scan
+  AREXPORT void setIncremental(bool incremental);
+  /// Gets whether getLineArray starts from the lines found on the last scan
+  bool getIncremental(void) { return myIncremental; }
+
   /// Gets the position the last lines were gotten at
   ArPose getLinesTakenPose(void) { return myPoseTaken; }
   /// Logs all the points and lines from the last getLines
@@ -109,6 +169,29 @@ protected:
   // removes lines that don't have enough points added in
   AREXPORT void filterLines();
 
+  // the points, lines, and working space for getLineArray
+  std::vector<ArPose> myPointArray;
+  std::vector<ArLineFinderSegment> myLineArray;
+  std::vector<ArLineFinderSegment> myScratchLines;
+  std::vector<ArLineFinderSegment> myLastLines;
+  ArLineFinderSegment myAveragedLine;
+  bool myIncremental;
+  // fills up myPointArray from the range device
+  AREXPORT void fillPointArray(void);
+  // makes lines out of the points from first to last, adds them to lines
+  AREXPORT void internalFindLines(int first, int last, 
+				  std::vector<ArLineFinderSegment> *lines);
+  // combines myLineArray until nothing else will combine
+  AREXPORT void combineLineArray(void);
+  // removes lines that don't have enough points from myLineArray
+  AREXPORT void filterLineArray(void);
+  // puts lines from myLastLines and from the points between them in myLineArray
+  AREXPORT void findLinesFromLast(void);
+  // averages two segments into newLine, returns false if they don't go together
+  AREXPORT bool internalAverageSegments(ArLineFinderSegment *line1, 
+					ArLineFinderSegment *line2,
+					ArLineFinderSegment *newLine);
+
   bool myFlippedFound;
   bool myFlipped;
   int myValidMaxDistFromLine;
@@ -125,41 +208,4 @@ protected:
   ArRangeDevice *myRangeDevice;
 };
 
-/// Class for ArLineFinder to hold more info than an ArLineSegment
-class ArLineFinderSegment : public ArLineSegment
-{
-public:
-  ArLineFinderSegment() {}
-  ArLineFinderSegment(double x1, double y1, double x2, double y2, 
-		      int numPoints = 0, int startPoint = 0, int endPoint = 0)
-    { newEndPoints(x1, y1, x2, y2, numPoints, startPoint, endPoint); }
-  virtual ~ArLineFinderSegment() {}
-  void newEndPoints(double x1, double y1, double x2, double y2, 
-		    int numPoints = 0, int startPoint = 0, int endPoint = 0)
-    {
-      ArLineSegment::newEndPoints(x1, y1, x2, y2);
-      myLineAngle = ArMath::atan2(y2 - y1, x2 - x1);
-      myLength = ArMath::distanceBetween(x1, y1, x2, y2);
-      myNumPoints = numPoints;
-      myStartPoint = startPoint;
-      myEndPoint = endPoint;
-      myAveDistFromLine = 0;
-    }
-  double getLineAngle(void) { return myLineAngle; }
-  double getLength(void) { return myLength; }
-  int getNumPoints(void) { return myNumPoints; }
-  int getStartPoint(void) { return myStartPoint; }
-  int getEndPoint(void) { return myEndPoint; }
-  void setAveDistFromLine(double aveDistFromLine) 
-    { myAveDistFromLine = aveDistFromLine; }
-  double getAveDistFromLine(void) { return myAveDistFromLine; }
-protected:
-  double myLineAngle;
-  double myLength;
-  int myNumPoints;
-  int myStartPoint;
-  int myEndPoint;
-  double myAveDistFromLine;
-};
-
 #endif // ARSICKLINEFINDER_H
@@ -62,6 +62,11 @@ public:
     Normal, ///< Use normal logging
     Verbose ///< Use verbose logging
   } LogLevel;
+  typedef enum {
+    DropNew, ///< Drop messages that don't fit in the queue
+    DropNewUnlessTerse, ///< Drop Normal and Verbose messages that don't fit, wait for room for Terse ones
+    Wait ///< Wait for room in the queue, never dropping messages
+  } AsyncDropPolicy;
 
 #ifndef SWIG
   /** @brief Log a message, with formatting and variable number of arguments
@@ -108,6 +113,18 @@ public:
   /// Use an ArConfig object to control ArLog's options
   AREXPORT static void addToConfig(ArConfig *config);
 
+  /// Sets whether messages are queued and written by their own thread
+  AREXPORT static bool setAsync(bool async, int queueSize = 2048,
+				AsyncDropPolicy dropPolicy = DropNewUnlessTerse);
+  /// Gets whether messages are queued and written by their own thread
+  AREXPORT static bool getAsync(void);
+  /// Waits until all the queued messages have been written
+  AREXPORT static void flushAsync(void);
+  /// Gets how many messages of a level were dropped because the queue was full
+  AREXPORT static long getAsyncNumDropped(LogLevel level);
+  /// Resets the counts of dropped messages
+  AREXPORT static void resetAsyncNumDropped(void);
+
 #ifndef ARINTERFACE
   /// Init for aram behavior
   AREXPORT static void aramInit(const char *prefix, 
@@ -116,7 +133,7 @@ public:
 				bool daemonized = false);
 #endif
   
-  /// Internal functor to be called when a log message is made (this shouldn't really be used)
+  /// Internal functor to be called when a log message is made (this shouldn't really be used, see setAsync() for which thread calls it)
   AREXPORT static void setFunctor(ArFunctor1<const char *> *functor);
   /// Internal function to force a lockup, only for debugging
   AREXPORT static void internalForceLockup(void);
@@ -127,6 +144,14 @@ protected:
   AREXPORT static void filledAramLog(void);
 #endif
   AREXPORT static void invokeFunctor(const char *message);
+  /// Writes out a message (which has the time in it if wanted), must be called with ourMutex locked
+  AREXPORT static void writeMessage(const char *message);
+  /// Queues a message for the async writer, false if it should be written now
+  AREXPORT static bool asyncQueue(LogLevel level, const char *message);
+  /// Writes out the queued messages, returns how many were written
+  AREXPORT static int asyncWriteQueued(void);
+  /// The async writer thread
+  AREXPORT static void asyncWriterThread(void);
   AREXPORT static void checkFileSize(void);
 
   static ArLog *ourLog;
@@ -160,6 +185,9 @@ protected:
   
   static ArFunctor1<const char *> *ourFunctor;
 
+  static bool ourAsync;
+  static AsyncDropPolicy ourAsyncDropPolicy;
+
 };
 
 
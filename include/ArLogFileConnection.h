@@ -33,6 +33,27 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ariaTypedefs.h"
 
 /// For connecting through a log file
+/**
+   Normally the log is read one packet each robot cycle, so it plays
+   back as fast as it was recorded.  With setFastReplay() the log is
+   instead replayed as fast as the robot's cycle can go, on
+   ArTime's virtual clock, which moves forward a fixed amount for each
+   packet.  Since everything that goes by ArTime (the robot cycle,
+   timeouts, when readings were taken, and so on) then sees the same
+   times (relative to when the log was opened) every run, the results
+   of replaying a log are the same every run, as long as the robot is
+   run without its packet reader thread (ie ArRobot::run(true, true)
+   or ArRobot::runAsync(true, true)).
+
+   The virtual clock starts where the system clock is when the log is
+   opened, and goes back to the system clock when the connection is
+   closed or fast replay is turned off.  Since the clock is the whole
+   program's, only one log should be replayed fast at a time.
+
+   When a fast replay reaches the end of the log the clock keeps
+   going, so the robot loses its connection by timing out as it would
+   with a real robot.
+**/
 class ArLogFileConnection: public ArDeviceConnection
 {
  public:
@@ -58,6 +79,14 @@ class ArLogFileConnection: public ArDeviceConnection
   /// Gets the name of the host connected to
   AREXPORT const char *getLogFile(void);
 
+  /// Sets if the log is replayed as fast as possible on a virtual clock
+  AREXPORT void setFastReplay(bool fastReplay, 
+			      unsigned int mSecPerPacket = 100);
+  /// Gets if the log is replayed as fast as possible on a virtual clock
+  bool getFastReplay(void) { return myFastReplay; }
+  /// Gets how far the virtual clock moves for each packet
+  unsigned int getFastReplayMSecPerPacket(void) { return myMSecPerPacket; }
+
   /* This doens't exist in the C++ file so I'm commenting it out
   /// Gets the initial pose of the robot
   AREXPORT ArPose getLogPose(void);
@@ -88,6 +117,11 @@ protected:
   const char *myLogFile;
   FILE *myFD;                   // file descriptor
 
+  bool myFastReplay;
+  unsigned int myMSecPerPacket;
+  // if we turned on the virtual clock (so we turn it back off)
+  bool myUsingVirtualClock;
+
 };
 
 #endif //ARLOGFILECONNECTION_H
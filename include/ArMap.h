@@ -162,6 +162,19 @@ class ArFileParser;
 * However, there is an exception: the readFile() and writeFile() 
 * methods @b do automatically lock the map while they read and write.
 * 
+* @section MapBinaryFile Binary map files
+* 
+* Parsing the text of a large map file can take several seconds.  If 
+* setUseBinaryFile() is enabled, then the map is also written to a binary 
+* companion file (the map file name with ".bin" appended) after it is read or
+* written.  The next time the same map file is read, the binary file is 
+* memory mapped instead, and the data points and lines of each scan are only 
+* converted when getPoints() or getLines() is first called for that scan.  
+* The binary file is ignored if the map checksum (see getMapId()) no longer 
+* matches the text file, so a map edited by another program is always
+* reread from its text.  Note that since getPoints() may then modify the 
+* map, it must be called with the map locked, as described above.
+* 
 * @section MapObjects Map Objects
 * 
 * In addition to lines and points, maps may contain "map objects", points
@@ -540,6 +553,16 @@ public:
 
   AREXPORT virtual bool refresh();
 
+  /// Sets whether a binary companion file is used to speed up reading the map
+  /**
+   * See ArMapSimple::setUseBinaryFile() and @ref MapBinaryFile.
+  **/
+  AREXPORT virtual void setUseBinaryFile(bool isUseBinaryFile);
+  /// Returns whether a binary companion file is used to speed up reading the map
+  AREXPORT virtual bool getUseBinaryFile() const;
+  /// Writes the binary companion file for the current map file
+  AREXPORT virtual bool writeBinaryFile(void);
+
   AREXPORT virtual void setIgnoreEmptyFileName(bool ignore);
 
   AREXPORT virtual bool getIgnoreEmptyFileName(void);
@@ -603,12 +626,23 @@ public:
   /// Changes the config map name
   AREXPORT void changeConfigMapName(const char *fileName);
 
+  /// Gets a grid index of the points and lines of a scan type, building it if needed
+  AREXPORT ArMapGridIndex *getGridIndex
+                         (const char *scanType = ARMAP_DEFAULT_SCAN_TYPE);
+  /// Sets the cell size used for grid indices built after this (mm)
+  AREXPORT void setGridIndexCellSize(double cellSize);
+  /// Gets the cell size used for grid indices (mm)
+  AREXPORT double getGridIndexCellSize(void) const;
+
 
 
  protected:
  
    /// Processes changes to the Aria configuration; loads a new map file if necessary
    bool processFile(char *errorBuffer, size_t errorBufferLen);
+
+   /// Deletes the grid indices so they are rebuilt the next time they are asked for
+   void clearGridIndices();
  
  protected:
  
@@ -646,6 +680,11 @@ public:
   
    /// Callback that processes changes to the Aria config.
    ArRetFunctor2C<bool, ArMap, char *, size_t> myProcessFileCB;
+
+   /// Cell size of the grid indices (mm)
+   double myGridIndexCellSize;
+   /// The grid index of each scan type asked for since the map last changed
+   std::map<std::string, ArMapGridIndex *> myGridIndexMap;
  
 }; // end class ArMap
 
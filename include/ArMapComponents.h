@@ -90,6 +90,7 @@ class ArMapChangeDetails;
 class ArMapFileLineSet;
 class ArFileParser;
 class ArMD5Calculator;
+class ArMapBinaryData;
 
 
 // ============================================================================
@@ -266,9 +267,41 @@ public:
   /// Removes the handlers for the data points and lines keywords from the given file parser.
   AREXPORT virtual bool remExtraFromFileParser(ArFileParser *fileParser);
 
+  /// Writes the scan's data points and lines to the given binary map file.
+  /**
+   * The points and lines are written as packed integer arrays, truncated
+   * the same way that the text map file stores them.  
+   * @param file the FILE * to which to write; must be opened in binary mode
+   * @return bool true if the data was successfully written; false if an 
+   * error occurred or the coordinates do not fit in the binary format
+  **/
+  AREXPORT virtual bool writeBinaryToFile(FILE *file);
+
+  /// Sets up the scan to load its data points and lines from a binary map file.
+  /**
+   * The summary information (e.g. NumPoints, MinPos) must already have been 
+   * parsed from the map header.  The points and lines are not copied 
+   * here; they are only converted when getPoints() or getLines() is first
+   * called (or when they are otherwise needed).
+   * @param data the ArMapBinaryData that contains the scan section; the scan
+   * keeps a reference to it until the points and lines have been loaded
+   * @param offsetInOut the offset of the scan section in the data; set to 
+   * the offset of the following section on return
+   * @return bool true if the scan section was valid; false otherwise
+  **/
+  AREXPORT virtual bool readBinaryFromData(ArMapBinaryData *data,
+                                           size_t *offsetInOut);
+
 
 protected:
 
+  /// Converts any data points that have not yet been loaded from the binary map file.
+  void loadLazyPoints();
+  /// Converts any data lines that have not yet been loaded from the binary map file.
+  void loadLazyLines();
+  /// Releases the binary map file data, without loading any pending points or lines.
+  void releaseLazyData();
+
   /// Writes the list of data lines to the given functor.
   /**
    * @param functor the ArFunctor1<const char *> * to which to write the 
@@ -391,6 +424,17 @@ protected:
   /// List of data lines contained in this scan data.
   std::vector<ArLineSegment> myLines;
 
+  /// Binary map file from which the points and/or lines have not been loaded yet.
+  ArMapBinaryData *myLazyData;
+  /// Packed x, y coordinates of the pending data points in myLazyData (or NULL).
+  const ArTypes::Byte4 *myLazyPoints;
+  /// Number of pending data points in myLazyData.
+  int myLazyNumPoints;
+  /// Packed x1, y1, x2, y2 coordinates of the pending data lines in myLazyData (or NULL).
+  const ArTypes::Byte4 *myLazyLines;
+  /// Number of pending data lines in myLazyData.
+  int myLazyNumLines;
+
   /// Callback to parse the minimum poise from the map file.
   ArRetFunctor1C<bool, ArMapScan, ArArgumentBuilder *> myMinPosCB;
   /// Callback to parse the maximum pose from the map file.
@@ -1101,6 +1145,30 @@ public:
 
   AREXPORT virtual bool refresh();
 
+  /// Sets whether a binary companion file is used to speed up reading the map.
+  /**
+   * If enabled, readFile() first looks for the binary companion file (see
+   * getBinaryFileName()).  If it exists and was written from the same 
+   * version of the text map file -- i.e. the map checksum (or the file size 
+   * and timestamp, if checksums are disabled) still matches -- then the map
+   * header is parsed from the binary file and the data points and lines are
+   * mapped from it, rather than parsing each text line.  The points and 
+   * lines of each scan are only converted when they are first requested.
+   * <p>
+   * If the binary file is missing or stale, then the text file is read as 
+   * usual and a new binary file is written.  writeFile() also rewrites the 
+   * binary file.  The text map file always remains the primary copy of the map.
+  **/
+  AREXPORT virtual void setUseBinaryFile(bool isUseBinaryFile);
+  /// Returns whether a binary companion file is used to speed up reading the map.
+  AREXPORT virtual bool getUseBinaryFile() const;
+
+  /// Writes the binary companion file for the map file that was last read or written.
+  AREXPORT virtual bool writeBinaryFile(bool internalCall = false);
+
+  /// Returns the name of the binary companion file for the given map file.
+  AREXPORT static std::string getBinaryFileName(const char *realFileName);
+
 
   virtual void setIgnoreEmptyFileName(bool ignore);
   virtual bool getIgnoreEmptyFileName(void);
@@ -1267,6 +1335,20 @@ protected:
 
   AREXPORT void updateMapFileInfo(const char *realFileName);
 
+  /// Clears all of the map data in preparation for reading a file.
+  void clearForRead();
+
+  /// Reads the map from the binary companion file of the given map file.
+  /**
+   * @return bool true if the binary file is valid for the current text map
+   * file and was successfully read; false if the text file must be read
+  **/
+  bool readBinaryFile(const char *realFileName);
+
+  /// Writes the portion of the map that precedes the data lines and points.
+  void writeHeaderToFunctor(ArFunctor1<const char *> *functor, 
+			                      const char *endOfLineChars);
+
 
 
   AREXPORT static int getNextFileNumber();
@@ -1368,6 +1450,9 @@ protected:
   bool myIsReadInProgress;
   bool myIsCancelRead;
 
+  /// Whether the binary companion file is read and written
+  bool myIsUseBinaryFile;
+
 }; // end class ArMapSimple
 
 /// --------------------------------------------------------------------------- 
@@ -34,6 +34,9 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
  *
  *  - ArMapId : The unique identifier for an Aria map.
  *
+ *  - ArMapGridIndex : A grid of the points and lines of a map scan, for 
+ *    finding the ones near a spot quickly.
+ *
  *  - ArMapFileLine : The data regarding a text line in a map file; this  
  *    includes the line number and text.  
  *
@@ -277,6 +280,106 @@ protected:
 }; // end class ArMapId
 
 
+// ============================================================================
+// ArMapGridIndex
+// ============================================================================
+
+/// A grid of the points and lines of a map scan, for quickly finding the ones near a spot
+/**
+ * ArMapGridIndex sorts a copy of the points and lines of one scan of a
+ * map into the square cells of a grid, so that finding the points or
+ * lines within a distance of a spot, or in a box, or the line that a
+ * ray hits first, only has to look at the cells near the spot instead
+ * of at every point and line in the map.  
+ * <p>
+ * Normally you get one from ArMap::getGridIndex(), which builds it the
+ * first time it is asked for and throws it away when the map changes.  
+ * <p>
+ * Once it is built the query methods don't change the index, so they
+ * can be called from several threads at once, but building it can't
+ * happen at the same time as any of them.
+ *
+ * @see ArMap::getGridIndex
+**/
+class ArMapGridIndex {
+
+public:
+
+  /// Constructor
+  AREXPORT ArMapGridIndex(double cellSize = 1000);
+  /// Destructor
+  AREXPORT virtual ~ArMapGridIndex();
+
+  /// Builds the index from the given points and lines (either can be NULL)
+  AREXPORT void build(const std::vector<ArPose> *points,
+                      const std::vector<ArLineSegment> *lines);
+  /// Empties the index
+  AREXPORT void clear();
+
+  /// Gets the length of the side of each grid cell (mm)
+  double getCellSize() const { return myCellSize; }
+  /// Gets the number of points in the index
+  int getNumPoints() const { return (int)myPoints.size(); }
+  /// Gets the number of lines in the index
+  int getNumLines() const { return (int)myLines.size(); }
+
+  /// Finds the points within a distance of a spot
+  AREXPORT int getPointsInRadius(const ArPose &center, double radius,
+                                 std::vector<ArPose> *points) const;
+  /// Finds the points in a box
+  AREXPORT int getPointsInBox(double x1, double y1, double x2, double y2,
+                              std::vector<ArPose> *points) const;
+  /// Finds the point closest to a spot
+  AREXPORT bool getClosestPoint(const ArPose &center, double maxDist,
+                                ArPose *closest, 
+                                double *closestDist = NULL) const;
+
+  /// Finds the lines that come within a distance of a spot
+  AREXPORT int getLinesInRadius(const ArPose &center, double radius,
+                                std::vector<ArLineSegment> *lines) const;
+  /// Finds the lines that pass through a box
+  AREXPORT int getLinesInBox(double x1, double y1, double x2, double y2,
+                             std::vector<ArLineSegment> *lines) const;
+
+  /// Finds the first line a ray hits
+  AREXPORT bool castRay(const ArPose &start, double th, double maxRange,
+                        ArPose *hit, double *hitDist = NULL, 
+                        ArLineSegment *hitLine = NULL) const;
+
+protected:
+
+  /// Gets the cell a coordinate is in, clamped to the grid
+  int getCellX(double x) const;
+  /// Gets the cell a coordinate is in, clamped to the grid
+  int getCellY(double y) const;
+  /// Finds the indices of the lines in the cells that overlap a box
+  void findLinesInBox(double x1, double y1, double x2, double y2,
+                      std::vector<int> *lineIndices) const;
+
+  /// Length of the side of each cell (mm)
+  double myCellSize;
+  /// Where the corner of the grid with the smallest x and y is
+  double myMinX;
+  double myMinY;
+  /// How many cells the grid has in x and y
+  int myNumCellsX;
+  int myNumCellsY;
+
+  /// The points, sorted by the cell they are in
+  std::vector<ArPose> myPoints;
+  /// Where in myPoints the points of each cell start (with one extra at the end)
+  std::vector<int> myPointCellStart;
+
+  /// The lines
+  std::vector<ArLineSegment> myLines;
+  /// The indices of the lines that pass through each cell, sorted by cell
+  std::vector<int> myLineCellItems;
+  /// Where in myLineCellItems the lines of each cell start (with one extra at the end)
+  std::vector<int> myLineCellStart;
+
+}; // end class ArMapGridIndex
+
+
 #ifndef SWIG
 
 
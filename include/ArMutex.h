@@ -34,6 +34,7 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 
 class ArTime;
 class ArFunctor;
+class ArMutexContention;
 
 /// Cross-platform mutex wrapper class 
 /**
@@ -141,7 +142,8 @@ public:
   */
   void setLog(bool log) { myLog = log; } 
   /// Sets a name we'll use to log with
-  void setLogName(const char *logName) { myLogName = logName; } 
+  void setLogName(const char *logName) 
+    { myLogName = logName; myContention = NULL; } 
 #ifndef SWIG
   /// Sets a name we'll use to log with formatting
   /** @swigomit use setLogName() */
@@ -169,6 +171,14 @@ public:
   */
   static double getUnlockWarningTime(void)
     { return ourUnlockWarningMS/1000.0; }
+  /** Sets whether named mutexes (see setLogName()) keep statistics on
+      how long threads wait for them and hold them, see
+      ArMutexContention for what is kept and how to get it.
+  */
+  AREXPORT static void setContentionProfiling(bool profiling);
+  /// Gets whether named mutexes keep statistics on waiting and holding
+  static bool getContentionProfiling(void) 
+    { return ourContentionProfiling; }
 protected:
   
   bool myFailedInit;
@@ -202,6 +212,27 @@ protected:
   // Check time it took between lock and unlock against ourUnlockWarningMS and log about it
   void checkUnlockTime();
 
+#if defined(WIN32) && !defined(MINGW)
+  typedef DWORD ContentionThreadType;
+#else
+  typedef pthread_t ContentionThreadType;
+#endif
+  AREXPORT static bool ourContentionProfiling;
+  // the statistics for our name, found on the first profiled lock
+  ArMutexContention *myContention;
+  // how many times the holding thread has locked us (only the
+  // holding thread changes it)
+  int myContentionDepth;
+  unsigned long long myContentionLockedUSec;
+  // the thread that last locked us, for whoever waits for us next
+  ContentionThreadType myContentionHolder;
+  // Counts a lock (the wait is from waitStarted to now if contended, and
+  // blocker is who had us then)
+  void contentionLocked(bool contended, unsigned long long waitStarted, 
+			ContentionThreadType blocker);
+  // Counts how long we were held, call before the actual unlock
+  void contentionUnlocking(void);
+
 
   static ArFunctor *ourNonRecursiveDeadlockFunctor;
 };
@@ -0,0 +1,131 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#ifndef ARMUTEXCONTENTION_H
+#define ARMUTEXCONTENTION_H
+
+#include "ariaTypedefs.h"
+#include "ariaUtil.h"
+#include "ArMutex.h"
+#include <string>
+#include <list>
+#include <map>
+
+/// Statistics on waiting for and holding the mutexes with one name
+/**
+   When ArMutex::setContentionProfiling() is on, each lock of a
+   named mutex (see ArMutex::setLogName()) is counted here, along with
+   how long the thread had to wait to get it (if it had to wait at all)
+   and how long it then held it.  Only the outermost lock of a recursive
+   lock counts, and all the mutexes with the same name count together.
+   For each wait it notes the name (from ArThread) of the thread that
+   held the mutex when the wait started, and it keeps the name of the
+   thread that held the mutex the longest.
+
+   getSnapshot() copies the statistics for every name out (the ones
+   that were waited for the most first), logSnapshot() logs them, and
+   setLogInterval() logs them every so often from a thread of its own,
+   which is the easy way to find which lock is stalling the robot's
+   cycle.
+
+   A mutex that an ArCondition waits with counts as held while the
+   condition is being waited on, since that happens inside the
+   platform's wait.
+
+   Profiling costs a tryLock and a couple of clock reads per lock, plus
+   a look up of the holding thread's name when a thread has to wait, so
+   it is meant to be turned on while looking for a problem.
+
+   @ingroup UtilityClasses
+**/
+class ArMutexContention
+{
+public:
+  /// Constructor
+  AREXPORT ArMutexContention(const char *name = "");
+  /// Copy constructor (the copy is just the statistics)
+  AREXPORT ArMutexContention(const ArMutexContention &contention);
+  /// Assignment operator (copies just the statistics)
+  AREXPORT ArMutexContention &operator=(const ArMutexContention &contention);
+  /// Destructor
+  AREXPORT ~ArMutexContention();
+
+  /// Gets the name of the mutexes these are the statistics for
+  const char *getName(void) const { return myName.c_str(); }
+  /// Gets how many times the mutexes were locked
+  unsigned long long getNumLocks(void) const { return myNumLocks; }
+  /// Gets how many of the locks had to wait for another thread
+  unsigned long long getNumContended(void) const { return myNumContended; }
+  /// Gets how long the locks that had to wait waited (in microseconds)
+  const ArTimingHistogram &getWaitTiming(void) const { return myWaitTiming; }
+  /// Gets how long the mutexes were held for (in microseconds)
+  const ArTimingHistogram &getHoldTiming(void) const { return myHoldTiming; }
+  /// Gets the name of the thread that held one of the mutexes the longest
+  const char *getLongestHolder(void) const 
+    { return myLongestHolder.c_str(); }
+  /// Gets how many waits each holding thread (by name) caused
+  const std::map<std::string, unsigned long long> &getBlockingThreads(void) const
+    { return myBlockingThreads; }
+  /// Gets the name of the holding thread that caused the most waits
+  AREXPORT const char *getMostBlockingThread(void) const;
+  /// Logs these statistics
+  AREXPORT void log(ArLog::LogLevel level = ArLog::Normal) const;
+
+  /// Adds a lock (ArMutex calls this)
+  AREXPORT void addLock(unsigned long long waitUSecs, bool contended,
+			const char *blockingThread);
+  /// Adds how long a mutex was held (ArMutex calls this)
+  AREXPORT void addHold(unsigned long long holdUSecs, 
+			const char *holdingThread);
+  /// Gets the statistics that go with a name, making them if needed
+  AREXPORT static ArMutexContention *findOrAdd(const char *name);
+
+  /// Copies the statistics of every mutex name, most waited for first
+  AREXPORT static void getSnapshot(std::list<ArMutexContention> *snapshot);
+  /// Logs the statistics of the names that have been waited for the most
+  AREXPORT static void logSnapshot(ArLog::LogLevel level = ArLog::Normal,
+				   int maxNames = 20);
+  /// Clears the statistics of every mutex name
+  AREXPORT static void clearAll(void);
+  /// Logs the snapshot every so many seconds from a thread (0 to stop)
+  AREXPORT static void setLogInterval(int seconds, 
+				      ArLog::LogLevel level = ArLog::Normal,
+				      int maxNames = 20);
+protected:
+  AREXPORT void clear(void);
+  AREXPORT static void logThread(void);
+
+  std::string myName;
+  unsigned long long myNumLocks;
+  unsigned long long myNumContended;
+  ArTimingHistogram myWaitTiming;
+  ArTimingHistogram myHoldTiming;
+  std::string myLongestHolder;
+  std::map<std::string, unsigned long long> myBlockingThreads;
+  // only the ones findOrAdd makes get added to, so only they have this
+  ArMutex *myMutex;
+};
+
+#endif // ARMUTEXCONTENTION_H
@@ -27,11 +27,23 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #define ARPRIORITYRESOLVER_H
 
 #include "ArResolver.h"
+#include "ArMutex.h"
+#include <vector>
+
+class ArPriorityResolverWorker;
 
 /// (Default resolver), takes the action list and uses the priority to resolve
 /** 
     This is the default resolver for ArRobot, meaning if you don't do a 
     non-normal init on the robot, or a setResolver, you'll have one these.
+
+    If setParallelThreads() is given a number of threads, then each
+    cycle the active actions that are pure (see ArAction::setPure())
+    are all fired first, by those threads and the robot's thread at the
+    same time.  Then the actions are gone through in the normal order,
+    firing the ones that aren't pure and using the results already
+    gotten for the ones that are, so the combining is exactly the same
+    as if they'd been fired one at a time.
 */
 class ArPriorityResolver : public ArResolver
 {
@@ -43,8 +55,24 @@ public:
   AREXPORT virtual ArActionDesired *resolve(ArResolver::ActionMap *actions,
 					    ArRobot *robot,
 					    bool logActions = false);
+  /// Sets how many extra threads fire pure actions (0, the default, is off)
+  AREXPORT void setParallelThreads(int numThreads);
+  /// Gets how many extra threads fire pure actions
+  int getParallelThreads(void) const { return myWorkers.size(); }
 protected:
+  friend class ArPriorityResolverWorker;
+  // fires the next of myPureActions, returns false if there are none
+  // left (busy is locked while firing so resolve can wait for it)
+  bool firePureAction(ArMutex *busy);
   ArActionDesired myActionDesired;
+  std::vector<ArPriorityResolverWorker *> myWorkers;
+  // myPureMutex protects myPureActions and myPureNext
+  ArMutex myPureMutex;
+  std::vector<ArAction *> myPureActions;
+  std::vector<ArActionDesired *> myPureResults;
+  size_t myPureNext;
+  // what pure actions are fired with
+  ArActionDesired myPureCurrentDesired;
 };
 
 #endif // ARPRIORITYRESOLVER_H
@@ -0,0 +1,142 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#ifndef ARRWMUTEX_H
+#define ARRWMUTEX_H
+
+#include <vector>
+#include "ariaTypedefs.h"
+#include "ArMutex.h"
+
+/// Mutex that many threads can lock for reading at once
+/**
+   ArRWMutex is an ArMutex (and can be used anywhere one is) that
+   additionally lets threads lock it for reading with lockForRead() or
+   tryLockForRead().  Any number of threads can hold read locks at the
+   same time, while lock() (a write lock) is exclusive of everyone.
+   This lets threads that only look at some state (for instance the
+   ArNetworking handlers that send out the robot's pose or a range
+   device's readings) run alongside each other instead of queueing up
+   behind each other.
+
+   Both kinds of lock are recursive: a thread that holds either kind
+   can lock again for reading without blocking, and a thread that has
+   the write lock can lock again for writing.  Each lock must be
+   matched by an unlock(), which releases whichever kind of lock the
+   calling thread most recently took (so nesting has to be in order,
+   as it does with any recursive mutex).
+
+   A thread that holds a read lock can also call lock(), this waits
+   until it is the only reader left and then makes it the writer.  If
+   two threads that hold read locks both do this they deadlock each
+   other, so code that may need to write should take the write lock
+   to begin with.
+
+   Threads waiting for the write lock have priority over threads
+   asking for a new read lock, so a steady stream of readers can't
+   keep the writer out.
+
+   If contention profiling is on (see
+   ArMutex::setContentionProfiling()) the write locks are kept under
+   the mutex's log name like any ArMutex, and read locks are kept
+   under the log name with " (read)" added.  The lock and unlock
+   warning times (ArMutex::setLockWarningTime() and
+   ArMutex::setUnlockWarningTime()) only apply to write locks.
+
+   @note On Windows this is currently an ArMutex with the read locks
+   just being regular locks, so it is correct but readers do not get to
+   run in parallel.
+
+   @ingroup UtilityClasses
+*/
+class ArRWMutex : public ArMutex
+{
+public:
+  /// Constructor
+  AREXPORT ArRWMutex();
+  /// Destructor
+  AREXPORT virtual ~ArRWMutex();
+  /// Lock for writing, blocking until no other thread holds any lock
+  AREXPORT virtual int lock();
+  /// Try to lock for writing without blocking
+  /**
+     @return 0 if the write lock was taken, ArMutex::STATUS_ALREADY_LOCKED
+     if another thread holds a lock (of either kind)
+  **/
+  AREXPORT virtual int tryLock();
+  /// Lock for reading, blocking only while another thread has (or is waiting for) the write lock
+  AREXPORT virtual int lockForRead();
+  /// Try to lock for reading without blocking
+  /**
+     @return 0 if the read lock was taken, ArMutex::STATUS_ALREADY_LOCKED
+     if another thread has (or is waiting for) the write lock
+  **/
+  AREXPORT virtual int tryLockForRead();
+  /// Unlock the most recent lock this thread took
+  AREXPORT virtual int unlock();
+  /// Sets a name we'll use to log with
+  void setLogName(const char *logName) 
+    { ArMutex::setLogName(logName); myReadContention = NULL; }
+#ifndef SWIG
+  /// Sets a name we'll use to log with formatting
+  /** @swigomit use setLogName() */
+  AREXPORT void setLogNameVar(const char *logName, ...);
+#endif
+  /// Gets how many threads currently hold read locks
+  AREXPORT int getNumReaders(void);
+protected:
+  // statistics for the read locks
+  ArMutexContention *myReadContention;
+#if !defined(WIN32) || defined(MINGW)
+  // a thread that holds read locks
+  struct Reader
+  {
+    pthread_t myThread;
+    int myDepth;
+    unsigned long long myLockedUSec;
+  };
+  // finds the reader entry for the thread, or -1 (call with myMutex locked)
+  int findReader(pthread_t thread);
+  // Counts a read lock (call with myMutex unlocked)
+  void readContentionLocked(bool contended, unsigned long long waitStarted,
+			    ContentionThreadType blocker);
+  pthread_cond_t myReadCond;
+  pthread_cond_t myWriteCond;
+  bool myCondsFailedInit;
+  // myMutex (from ArMutex) protects everything below, and is only
+  // ever held briefly to look at or change it
+  bool myWriting;
+  pthread_t myWriter;
+  int myWriteDepth;
+  int myWritersWaiting;
+  std::vector<Reader> myReaders;
+#endif
+private:
+  // copying a lock doesn't make sense, so these aren't implemented
+  ArRWMutex(const ArRWMutex &mutex);
+  ArRWMutex &operator=(const ArRWMutex &mutex);
+};
+
+#endif // ARRWMUTEX_H
@@ -29,10 +29,32 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ariaUtil.h"
 #include "ariaTypedefs.h"
 #include "ArTransform.h"
+#include "ArMutex.h"
 #include <list>
 #include <vector>
 
 /// This class is a buffer that holds ranging information
+/**
+   By default each reading is kept as its own ArPoseWithTime in a
+   std::list (see getBuffer()).  If setPooledStorage(true) is called
+   the readings are instead kept in a fixed capacity ring of parallel
+   x, y and time arrays, which are allocated once when the size is
+   set, so that adding and clearing readings doesn't touch the heap
+   and the closest reading searches walk contiguous memory.
+
+   In pooled mode getBuffer() still works, it hands back a list that
+   points into an internal copy of the readings (which is kept up to
+   date as readings are added), and invalidateReading() still works
+   with iterators from that list.  Changing the poses through that
+   list is not supported in pooled mode though, the changes will not
+   make it back into the buffer.
+
+   Pooled buffers can also keep a grid index of the readings (see
+   setGridIndex()), which lets getClosestPolar(), getClosestBox() and
+   addReadingConditional() only look at the readings in the grid
+   cells they overlap, instead of at every reading.  This is mostly
+   worthwhile for big cumulative buffers.
+**/
 class ArRangeBuffer
 {
 public:
@@ -44,6 +66,16 @@ public:
   AREXPORT size_t getSize(void) const;
   /// Sets the size of the buffer
   AREXPORT void setSize(size_t size);
+  /// Sets if the buffer uses pooled (contiguous ring) storage or not
+  AREXPORT void setPooledStorage(bool pooled);
+  /// Gets if the buffer uses pooled (contiguous ring) storage or not
+  AREXPORT bool getPooledStorage(void) const;
+  /// Gets the number of readings that are in the buffer
+  AREXPORT size_t getNumReadings(void) const;
+  /// Sets the cell size of the grid index for the searches (0 for none)
+  AREXPORT void setGridIndex(double cellSize);
+  /// Gets the cell size of the grid index (0 if there is no grid index)
+  AREXPORT double getGridIndexCellSize(void) const;
   /// Gets the pose of the robot when readings were taken
   AREXPORT ArPose getPoseTaken() const;
   /// Sets the pose of the robot when readings were taken
@@ -99,6 +131,9 @@ public:
   /// End redoing the buffer
   AREXPORT void endRedoBuffer(void);
   /// Gets the buffer as an array instead of as a std::list
+  /** This fills in a vector the buffer keeps, so unlike getBuffer()
+      it needs the device locked with ArRangeDevice::lockDevice(), not
+      just lockDeviceForRead(). **/
   AREXPORT std::vector<ArPoseWithTime> *getBufferAsVector(void);
   /// Gets the closest reading, from an arbitrary buffer
   AREXPORT static double getClosestPolarInList(
@@ -128,6 +163,56 @@ protected:
   std::list<ArPoseWithTime *>::iterator myIterator;
   
   ArPoseWithTime * myReading;
+
+  // pooled storage, the readings are in a ring of myPoolX/Y/Time
+  // with the newest at myPoolHead and the older ones after it
+  bool myPooled;
+  std::vector<double> myPoolX;
+  std::vector<double> myPoolY;
+  std::vector<ArTime> myPoolTime;
+  std::vector<char> myPoolInvalid;
+  size_t myPoolHead;
+  size_t myPoolCount;
+  size_t myPoolNumInvalid;
+  size_t myPoolRedoIndex;
+  // the copy of the pool that getBuffer gives out in pooled mode,
+  // indexed the same as the pool
+  std::vector<ArPoseWithTime> myAdapterPoses;
+  std::list<ArPoseWithTime *> myAdapterSpare;
+  size_t myAdapterListSize;
+  bool myAdapterValid;
+  // getBuffer rebuilds the copy under this, since several threads
+  // with read locks on the device may ask for it at once
+  ArMutex myAdapterMutex;
+  // the grid index, each pool slot is in a list (through myGridNext
+  // and myGridPrev) for the hash bucket of the cell it is in
+  double myGridCellSize;
+  std::vector<int> myGridBucketHead;
+  std::vector<int> myGridNext;
+  std::vector<int> myGridPrev;
+  std::vector<int> myGridBucketOf;
+  
+  /// Gets the physical pool index of the nth newest reading
+  size_t poolIndex(size_t n) const 
+    { return (myPoolHead + n) % myPoolX.size(); }
+  /// Gets the two contiguous spans the pool readings are in
+  void poolSpans(size_t *firstEnd, size_t *secondEnd) const;
+  void poolAddReading(double x, double y);
+  void poolResize(size_t size);
+  void poolCompact(void);
+  void adapterRebuild(void);
+  void adapterUpdate(size_t index);
+  void gridInsert(size_t index);
+  void gridRemove(size_t index);
+  void gridRebuild(void);
+  int gridBucket(int cellX, int cellY) const
+    { return (int)(((unsigned int)cellX * 73856093U ^ 
+		    (unsigned int)cellY * 19349663U) & 
+		   (myGridBucketHead.size() - 1)); }
+  bool gridCells(double minX, double minY, double maxX, double maxY,
+		 int *cellX1, int *cellY1, int *cellX2, int *cellY2) const;
+  static void gridExpand(double x, double y, double *minX, double *minY,
+			 double *maxX, double *maxY);
 };
 
 #endif // ARRANGEBUFFER_H
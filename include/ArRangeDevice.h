@@ -30,7 +30,7 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ArRangeBuffer.h"
 #include "ArSensorReading.h"
 #include "ArDrawingData.h"
-#include "ArMutex.h"
+#include "ArRWMutex.h"
 #include <set>
 
 class ArRobot;
@@ -103,6 +103,11 @@ public:
   AREXPORT virtual void setCumulativeBufferSize(size_t size);
   /// Sets the maximum size of the buffer for cumulative readings
   AREXPORT virtual size_t getCumulativeBufferSize(void) const;
+  /// Sets if the current and cumulative buffers use pooled storage
+  AREXPORT virtual void setPooledBufferStorage(bool current, 
+					       bool cumulative);
+  /// Sets the cell size of the grid index on the cumulative buffer
+  AREXPORT virtual void setCumulativeBufferGridIndex(double cellSize);
   /// Adds a reading to the buffer
   AREXPORT virtual void addReading(double x, double y, bool *wasAdded = NULL);
   /// Gets if this device is location dependent or not
@@ -390,6 +395,27 @@ public:
   AREXPORT virtual int tryLockDevice() {return(myDeviceMutex.tryLock());}
   /// Unlock this device
   AREXPORT virtual int unlockDevice() {return(myDeviceMutex.unlock());}
+  /// Lock this device just for looking at its readings
+  /**
+     Any number of threads can hold this lock at once, so use it
+     instead of lockDevice() when only reading (e.g. getting the
+     buffers to draw or send them), and unlock with
+     unlockDeviceForRead() (not unlockDevice()).  Anything that changes
+     the device (adding or clearing readings, getCurrentBufferAsVector(),
+     etc) still needs lockDevice().  See ArRWMutex.  Subclasses that
+     override lockDevice() and unlockDevice() to use their own mutex
+     must override this, tryLockDeviceForRead() and
+     unlockDeviceForRead() too (ArRangeDeviceThreaded just uses its
+     exclusive lock for them).
+  **/
+  AREXPORT virtual int lockDeviceForRead() 
+    { return(myDeviceMutex.lockForRead()); }
+  /// Try to lock this device just for looking at its readings
+  AREXPORT virtual int tryLockDeviceForRead() 
+    { return(myDeviceMutex.tryLockForRead()); }
+  /// Unlock this device after lockDeviceForRead() or tryLockDeviceForRead()
+  AREXPORT virtual int unlockDeviceForRead() 
+    { return(myDeviceMutex.unlock()); }
 
   /// Internal function to filter the readings based on age and distance
   /// @internal
@@ -435,7 +461,7 @@ protected:
   bool myOwnCurrentDrawingData;
   ArDrawingData *myCumulativeDrawingData;
   bool myOwnCumulativeDrawingData;
-  ArMutex myDeviceMutex;
+  ArRWMutex myDeviceMutex;
   bool myIsLocationDependent;
 };
 
@@ -67,6 +67,12 @@ public:
   AREXPORT virtual int lockDevice(void) { return myTask.lock(); }
   AREXPORT virtual int tryLockDevice(void) { return myTask.tryLock(); }
   AREXPORT virtual int unlockDevice(void) { return myTask.unlock(); }
+  /// The thread's mutex is not a read/write lock, so this is lockDevice()
+  AREXPORT virtual int lockDeviceForRead(void) { return myTask.lock(); }
+  /// The thread's mutex is not a read/write lock, so this is tryLockDevice()
+  AREXPORT virtual int tryLockDeviceForRead(void) { return myTask.tryLock(); }
+  /// The thread's mutex is not a read/write lock, so this is unlockDevice()
+  AREXPORT virtual int unlockDeviceForRead(void) { return myTask.unlock(); }
 protected:
   ArRetFunctor1C<void *, ArRangeDeviceThreaded, void *> myRunThreadCB;
   ArFunctorASyncTask myTask;
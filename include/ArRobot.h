@@ -33,7 +33,8 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ArFunctor.h"
 #include "ArSyncTask.h"
 #include "ArSensorReading.h"
-#include "ArMutex.h"
+#include "ArRWMutex.h"
+#include "ArRobotState.h"
 #include "ArCondition.h"
 #include "ArSyncLoop.h"
 #include "ArRobotPacketReaderThread.h"
@@ -1047,6 +1048,21 @@ public:
   /// Logs the list of all tasks, strictly for your viewing pleasure
   AREXPORT void logAllTasks(void) const;
 
+  /// Turns timing of all the syncronous tasks on or off
+  AREXPORT void setSyncTaskTimingEnabled(bool enabled);
+  /// Gets if timing of the syncronous tasks is on
+  AREXPORT bool getSyncTaskTimingEnabled(void) const;
+  /// Resets the timing of all the syncronous tasks
+  AREXPORT void resetSyncTaskTiming(void);
+  /// Gets the timing of a syncronous task by name (or the whole cycle)
+  AREXPORT bool getSyncTaskTiming(const char *name, 
+				  ArTimingHistogram *timing,
+				  unsigned int *overrunCount = NULL) const;
+  /// Gets how many cycles took longer than the cycle warning time
+  AREXPORT unsigned int getCycleOverrunCount(void) const;
+  /// Logs the timing of all the syncronous tasks
+  AREXPORT void logSyncTaskTiming(void) const;
+
   /// Adds a task under the sensor interp part of the syncronous tasks
   AREXPORT bool addSensorInterpTask(const char *name, int position, 
 				       ArFunctor *functor,
@@ -1140,6 +1156,15 @@ public:
 				     ArPoseWithTime *mostRecent = NULL)
     { return myInterpolation.getPose(timeStamp, position, mostRecent); }
 
+  /// Gets the positions the robot was at at a number of timestamps
+  /** @see ArInterpolation::getPoses
+   */
+  AREXPORT int getPoseInterpPositions(const ArTime *timeStamps, 
+				      ArPose *positions, int *results,
+				      int numTimes)
+    { return myInterpolation.getPoses(timeStamps, positions, results, 
+				      numTimes); }
+
   /// Gets the pose interpolation object, this should only really used internally
   AREXPORT ArInterpolation *getPoseInterpolation(void)
     { return &myInterpolation; }
@@ -1166,6 +1191,15 @@ public:
 					    ArPoseWithTime *mostRecent = NULL)
     { return myEncoderInterpolation.getPose(timeStamp, position, mostRecent); }
 
+  /// Gets the encoder positions the robot was at at a number of timestamps
+  /** @see ArInterpolation::getPoses
+   */
+  AREXPORT int getEncoderPoseInterpPositions(const ArTime *timeStamps, 
+					     ArPose *positions, int *results,
+					     int numTimes)
+    { return myEncoderInterpolation.getPoses(timeStamps, positions, results,
+					     numTimes); }
+
   AREXPORT ArInterpolation *getEncoderPoseInterpolation(void)
     { return &myEncoderInterpolation; }
 
@@ -1270,6 +1304,21 @@ public:
   int tryLock() {return(myMutex.tryLock());}
   /// Unlock the robot instance
   int unlock() {return(myMutex.unlock());}
+  /// Lock the robot instance just for reading its state
+  /**
+     Any number of threads can hold this lock at the same time (while
+     the robot's own thread, or anyone else using lock(), waits for
+     them), so use it instead of lock() when only calling the get
+     functions, e.g. to send the robot's pose to clients.  Unlock it
+     with unlock().  Anything that changes the robot, including
+     requesting motion or adding and removing actions, tasks or
+     devices, needs lock().  See ArRWMutex.
+  **/
+  int lockForRead() {return(myMutex.lockForRead());}
+  /// Try to lock the robot instance for reading without blocking
+  int tryLockForRead() {return(myMutex.tryLockForRead());}
+  /// Gets a copy of the robot's state as of the end of the last cycle, without locking the robot
+  AREXPORT void getStateSnapshot(ArRobotState *state) const;
   /// Turn on verbose locking of robot mutex
   void setMutexLogging(bool v) { myMutex.setLog(v); }
   /// Set robot lock warning time (see ArMutex::setLockWarningTime())
@@ -1391,6 +1440,9 @@ public:
   /// Robot unlocker, internal
   /// @internal
   AREXPORT void robotUnlocker(void);
+  /// State publisher, internal
+  /// @internal
+  AREXPORT void statePublisher(void);
 
   /// Packet handler, internal, for use in the syncloop when there's no threading
   /// @internal
@@ -1439,6 +1491,7 @@ public:
   ArFunctorC<ArRobot> myStateReflectorCB;
   ArFunctorC<ArRobot> myRobotLockerCB;
   ArFunctorC<ArRobot> myRobotUnlockerCB;
+  ArFunctorC<ArRobot> myStatePublisherCB;
   ArFunctorC<ArRobot> myKeyHandlerExitCB;
   ArFunctorC<ArKeyHandler> *myKeyHandlerCB;
 
@@ -1598,7 +1651,12 @@ protected:
   long myPacketsReceivedTrackingCount;
   ArTime myPacketsReceivedTrackingStarted;
   bool myPacketsSentTracking;
-  ArMutex myMutex;
+  ArRWMutex myMutex;
+  // the published state, statePublisher fills in a new one and then
+  // copies it in with myStateMutex locked, which getStateSnapshot
+  // locks to copy it out (the robot's own lock is never needed)
+  mutable ArMutex myStateMutex;
+  ArRobotState myState;
   ArSyncTask *mySyncTaskRoot;
   std::list<ArRetFunctor1<bool, ArRobotPacket *> *> myPacketHandlerList;
 
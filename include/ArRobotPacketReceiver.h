@@ -28,11 +28,17 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 
 #include "ariaTypedefs.h"
 #include "ArRobotPacket.h"
+#include "ArDeviceReadBuffer.h"
 
 
 class ArDeviceConnection;
 
 /// Given a device connection it receives packets from the robot through it
+/**
+   The data is read from the connection in bulk into an
+   ArDeviceReadBuffer that packets are then taken out of, rather than
+   a byte at a time.
+**/
 class ArRobotPacketReceiver
 {
 public:
@@ -91,6 +97,10 @@ protected:
 
   bool myAllocatePackets;
   ArRobotPacket myPacket;
+  // the packet to give away next when allocating packets (so one
+  // isn't allocated and deleted on every call without a packet)
+  ArRobotPacket *myAllocatedPacket;
+  ArDeviceReadBuffer myReadBuffer;
   enum { STATE_SYNC1, STATE_SYNC2, STATE_ACQUIRE_DATA };
   unsigned char mySync1;
   unsigned char mySync2;
@@ -0,0 +1,110 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#ifndef ARROBOTSTATE_H
+#define ARROBOTSTATE_H
+
+#include "ariaTypedefs.h"
+#include "ariaUtil.h"
+
+/// A consistent copy of the commonly used parts of an ArRobot's state
+/**
+   ArRobot fills one of these in at the end of each cycle (just before
+   it unlocks itself after the user tasks), and when it connects, and
+   any thread can get a copy with ArRobot::getStateSnapshot() without
+   locking the robot.  So the copy can be up to a cycle old.
+   All of the values in one snapshot come from the same cycle, so for
+   instance the pose and velocities always go together, which isn't
+   true if you call the ArRobot get functions one at a time without
+   the robot locked.
+
+   The values are the same as the ArRobot functions with the same
+   names return.  getCounter() is the robot's cycle counter
+   (ArRobot::getCounter()) when the snapshot was made, and is 0 if the
+   robot hasn't connected or run a cycle yet.
+**/
+class ArRobotState
+{
+public:
+  /// Constructor
+  ArRobotState() :
+    myVel(0), myRotVel(0), myLatVel(0), myBatteryVoltage(0),
+    myRealBatteryVoltage(0), myHaveStateOfCharge(false), myStateOfCharge(0),
+    myTemperature(0), myFlags(0), myFaultFlags(0), myStallValue(0),
+    myIsConnected(false), myCounter(0) {}
+  /// Gets the robot's global pose (see ArRobot::getPose())
+  ArPose getPose(void) const { return myPose; }
+  /// Gets the robot's encoder pose (see ArRobot::getEncoderPose())
+  ArPose getEncoderPose(void) const { return myEncoderPose; }
+  /// Gets the translational velocity (mm/sec)
+  double getVel(void) const { return myVel; }
+  /// Gets the rotational velocity (deg/sec)
+  double getRotVel(void) const { return myRotVel; }
+  /// Gets the lateral velocity (mm/sec)
+  double getLatVel(void) const { return myLatVel; }
+  /// Gets the battery voltage normalized to 12 volts
+  double getBatteryVoltage(void) const { return myBatteryVoltage; }
+  /// Gets the actual battery voltage
+  double getRealBatteryVoltage(void) const { return myRealBatteryVoltage; }
+  /// Gets if the robot reports its state of charge
+  bool haveStateOfCharge(void) const { return myHaveStateOfCharge; }
+  /// Gets the state of charge (percent)
+  double getStateOfCharge(void) const { return myStateOfCharge; }
+  /// Gets the temperature (deg C, or 255 if unknown)
+  int getTemperature(void) const { return myTemperature; }
+  /// Gets the flags from the SIP (see ArRobot::getFlags())
+  int getFlags(void) const { return myFlags; }
+  /// Gets the fault flags (see ArRobot::getFaultFlags())
+  int getFaultFlags(void) const { return myFaultFlags; }
+  /// Gets the stall value (see ArRobot::getStallValue())
+  int getStallValue(void) const { return myStallValue; }
+  /// Gets if the motors are enabled
+  bool areMotorsEnabled(void) const { return (myFlags & ArUtil::BIT0); }
+  /// Gets if the estop is pressed
+  bool isEStopPressed(void) const { return (myFlags & ArUtil::BIT5); }
+  /// Gets if the robot was connected
+  bool isConnected(void) const { return myIsConnected; }
+  /// Gets the robot's cycle counter when this was made (0 if never)
+  unsigned int getCounter(void) const { return myCounter; }
+protected:
+  friend class ArRobot;
+  ArPose myPose;
+  ArPose myEncoderPose;
+  double myVel;
+  double myRotVel;
+  double myLatVel;
+  double myBatteryVoltage;
+  double myRealBatteryVoltage;
+  bool myHaveStateOfCharge;
+  double myStateOfCharge;
+  int myTemperature;
+  int myFlags;
+  int myFaultFlags;
+  int myStallValue;
+  bool myIsConnected;
+  unsigned int myCounter;
+};
+
+#endif // ARROBOTSTATE_H
@@ -243,6 +243,9 @@ protected:
 
   std::list<ArS3SeriesPacket *> myPackets;
 
+  // the ranges of a scan, for laserConvertScan
+  std::vector<int> myScanRanges;
+
   ArFunctorC<ArS3Series> mySensorInterpTask;
   ArRetFunctorC<bool, ArS3Series> myAriaExitCB;
 };
@@ -172,6 +172,14 @@ public:
 			bool ignoreThisReading = false,
 			int extraInt = 0);
 
+  /// Takes the data, with the positions of the reading already found, and makes the reading reflect it
+  AREXPORT void newData(int range, double localX, double localY,
+			double x, double y, double th,
+			const ArPose &robotPose,
+			const ArPose &encoderPose, unsigned int counter,
+			const ArTime &timeTaken, bool ignoreThisReading = false,
+			int extraInt = 0);
+
   /// Resets the sensors idea of its physical location on the robot
   AREXPORT void resetSensorPosition(double xPos, double yPos, double thPos,
 				    bool forceComputation = false);
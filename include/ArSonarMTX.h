@@ -174,6 +174,12 @@ public:
   AREXPORT virtual int tryLockDevice() {return(myDeviceMutex.tryLock());}
   /// Unlock this device
   AREXPORT virtual int unlockDevice() {return(myDeviceMutex.unlock());}
+  /// Lock this device for reading (the same as lockDevice())
+  AREXPORT virtual int lockDeviceForRead() { return(myDeviceMutex.lock());}
+  /// Try to lock this device for reading (the same as tryLockDevice())
+  AREXPORT virtual int tryLockDeviceForRead() {return(myDeviceMutex.tryLock());}
+  /// Unlock this device after reading (the same as unlockDevice())
+  AREXPORT virtual int unlockDeviceForRead() {return(myDeviceMutex.unlock());}
 
   AREXPORT virtual const char *getName(void) const;
 
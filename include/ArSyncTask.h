@@ -31,6 +31,8 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ariaTypedefs.h"
 #include "ArFunctor.h"
 #include "ArTaskState.h"
+#include "ArMutex.h"
+#include "ariaUtil.h"
 
 /// Class used internally to manage the tasks that are called every cycle
 /**
@@ -72,6 +74,12 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
    The state of a task can be stored in the target of a given ArTaskState::State pointer,
    or if NULL than ArSyncTask will use its own member variable.
 
+   Timing of the tasks can be turned on with setTimingEnabled(), then
+   each node keeps an ArTimingHistogram of how long it took to run
+   (including its children), and a count of how many times it took
+   longer than the warning time.  When timing is off the only cost is
+   checking a flag.
+
   @internal
 */
 
@@ -134,6 +142,19 @@ public:
   /// Gets the functor called to check if there should be a time warning this cycle (should only be used from the robot)
   AREXPORT ArRetFunctor<bool> *getNoTimeWarningCB(void);
   
+  /// Turns timing of this task and its children on or off
+  AREXPORT void setTimingEnabled(bool enabled);
+  /// Gets if timing of this task is on
+  AREXPORT bool getTimingEnabled(void);
+  /// Gets the timing of this task (including its children)
+  AREXPORT ArTimingHistogram getTiming(void);
+  /// Gets how many times this task took longer than the warning time
+  AREXPORT unsigned int getOverrunCount(void);
+  /// Resets the timing of this task and its children
+  AREXPORT void resetTiming(void);
+  /// Logs the timing of this task and its children
+  AREXPORT void logTiming(int depth = 0);
+
   // removes this task from the map
   AREXPORT void remove(ArSyncTask * proc);
 
@@ -153,6 +174,11 @@ protected:
   bool myRunning;
   // this is just a pointer to what we're invoking so we can know later
   ArSyncTask *myInvokingOtherFunctor;
+  // timing
+  bool myTimingEnabled;
+  ArMutex myTimingMutex;
+  ArTimingHistogram myTiming;
+  unsigned int myOverrunCount;
 };
 
 
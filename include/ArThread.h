@@ -228,6 +228,8 @@ public:
   AREXPORT static const ThreadType * getThisThread(void);
   /// Get the underlying os thread type of this thread
   AREXPORT static ThreadType getThisOSThread(void);
+  /// Gets the name of the thread with the given os thread
+  AREXPORT static std::string getOSThreadName(ThreadType thread);
 
 protected:
   static ArMutex ourThreadsMutex;
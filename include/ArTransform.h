@@ -132,6 +132,9 @@ public:
   AREXPORT void doTransform(std::list<ArPose *> *poseList);
   /// Take a std::list of sensor readings and do the transform on it
   AREXPORT void doTransform(std::list<ArPoseWithTime *> *poseList);
+  /// Take arrays of x and y coordinates and do the transform on them
+  AREXPORT void doTransform(const double *sourceX, const double *sourceY,
+			    double *destX, double *destY, int num);
   /// Sets the transform so points in this coord system transform to abs world coords
   AREXPORT void setTransform(ArPose pose);
   /// Sets the transform so that pose1 will be transformed to pose2
@@ -36,6 +36,7 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ArRobotPacket.h"
 #include "ArRobotPacketSender.h"
 #include "ArRobotPacketReceiver.h"
+#include "ArDeviceReadBuffer.h"
 #include "ArRobotConfigPacketReader.h"
 #include "ArRobotTypes.h"
 #include "ariaUtil.h"
@@ -77,6 +78,9 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ArActionGoto.h"
 #include "ArModule.h"
 #include "ArModuleLoader.h"
+#include "ArMutexContention.h"
+#include "ArRWMutex.h"
+#include "ArRobotState.h"
 #include "ArRecurrentTask.h"
 #include "ArInterpolation.h"
 #include "ArGripper.h"
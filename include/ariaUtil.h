@@ -32,6 +32,7 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 // #define _XOPEN_SOURCE 500
 #include <list>
 #include <map>
+#include <vector>
 #include <math.h>
 #include <stdarg.h>
 #include <stdlib.h>
@@ -105,6 +106,16 @@ public:
   /// Get the time in milliseconds
   AREXPORT static unsigned int getTime(void);
 
+  /// Get the time in microseconds
+  AREXPORT static unsigned long long getTimeUSec(void);
+
+  /// Makes sure memory reads and writes aren't reordered across this call
+  AREXPORT static void memoryBarrier(void);
+  /// Atomically increments the value (with a full memory barrier)
+  AREXPORT static long atomicIncrement(volatile long *value);
+  /// Atomically decrements the value (with a full memory barrier)
+  AREXPORT static long atomicDecrement(volatile long *value);
+
   /// Delete all members of a set. Does NOT empty the set.
   /** 
       Assumes that T is an iterator that supports the operator*, operator!=
@@ -995,15 +1006,53 @@ protected:
     an issue.  It looks like the monotonic clocks won't work on linux
     kernels before 2.6.
 
+    ArTime can also be run from a virtual clock instead of the
+    system's (see setUseVirtualClock()), in which case the time only
+    changes when advanceVirtualClock() or setVirtualClock() is
+    called.  This is what ArLogFileConnection uses to replay logs
+    faster than they were recorded.
+
+    Things that just need to timestamp data (rather than time a
+    duration) can use setToCachedNow() (or construct with
+    INIT_CACHED_NOW) instead of setToNow().  Those get the time that
+    was last cached with refreshCachedNow() by the calling thread,
+    so a whole laser scan or robot cycle of readings costs one read
+    of the clock instead of one per reading.  ArRobot refreshes the
+    cache for its thread at the start of each cycle and ArLaser for
+    each scan it processes.  If the calling thread doesn't have a
+    cached time (or it was cleared with clearCachedNow()) they read
+    the clock just like setToNow().  Since the cached time is taken
+    with setToNow() it comes from the virtual clock when that is in
+    use.
+
+    Bulk allocated buffers of times that'll be set later can
+    construct with INIT_NONE so they don't read the clock at all.
+
   @ingroup UtilityClasses
 */
 
 class ArTime
 {
 public:
+  /// How the constructor sets the time
+  typedef enum { 
+    INIT_NOW, ///< Set to the current time (like the default constructor)
+    INIT_CACHED_NOW, ///< Set to this thread's cached time (see setToCachedNow())
+    INIT_NONE ///< Leave it at 0 without reading the clock, for buffers that'll be set later
+  } InitType;
+
   /// Constructor. Time is initialized to the current time.
   ArTime() { setToNow(); }
 
+  /// Constructor that sets the time as the given init type says
+  explicit ArTime(InitType initType) : mySec(0), myMSec(0)
+    {
+      if (initType == INIT_NOW)
+	setToNow();
+      else if (initType == INIT_CACHED_NOW)
+	setToCachedNow();
+    }
+
   /// Copy constructor
   //
   ArTime(const ArTime &other) :
@@ -1135,6 +1184,8 @@ public:
     }
   /// Resets the time
   AREXPORT void setToNow(void);
+  /// Sets the time to the calling thread's cached time (or now if it has none)
+  AREXPORT void setToCachedNow(void);
   /// Add some milliseconds (can be negative) to this time
   bool addMSec(long ms)
     {
@@ -1218,6 +1269,22 @@ public:
       return false;
     }
   
+  /// Sets if the time comes from the virtual clock instead of the system's
+  AREXPORT static void setUseVirtualClock(bool useVirtualClock);
+  /// Gets if the time comes from the virtual clock instead of the system's
+  static bool usingVirtualClock(void) { return ourVirtualClock; }
+  /// Sets the time of the virtual clock
+  AREXPORT static void setVirtualClock(const ArTime &time);
+  /// Moves the virtual clock forward by some milliseconds
+  AREXPORT static void advanceVirtualClock(long long ms);
+
+  /// Caches the current time for setToCachedNow() calls from this thread
+  AREXPORT static void refreshCachedNow(void);
+  /// Clears this thread's cached time, so setToCachedNow() reads the clock
+  AREXPORT static void clearCachedNow(void);
+  /// Gets if this thread has a cached time
+  AREXPORT static bool hasCachedNow(void);
+
   /// Equality operator (for sets)
   bool operator==(const ArTime& other) const
   {
@@ -1241,6 +1308,8 @@ protected:
 #if defined(_POSIX_TIMERS) && defined(_POSIX_MONOTONIC_CLOCK)
   static bool ourMonotonicClock;
 #endif 
+  static bool ourVirtualClock;
+  static volatile long long ourVirtualMSec;
 
 }; // end class ArTime
 
@@ -1257,11 +1326,16 @@ public:
   ArPoseWithTime(double x = 0, double y = 0, double th = 0,
 	 ArTime thisTime = ArTime()) : ArPose(x, y, th)
     { myTime = thisTime; }
+  /// Constructor that sets the time with the given ArTime::InitType
+  ArPoseWithTime(double x, double y, double th, 
+		 ArTime::InitType timeInit) : 
+    ArPose(x, y, th), myTime(timeInit) {}
   /// Copy Constructor
   ArPoseWithTime(const ArPose &pose) : ArPose(pose) {}
   virtual ~ArPoseWithTime() {}
   void setTime(ArTime newTime) { myTime = newTime; }
   void setTimeToNow(void) { myTime.setToNow(); }
+  void setTimeToCachedNow(void) { myTime.setToCachedNow(); }
   ArTime getTime(void) const { return myTime; }
 protected:
   ArTime myTime;
@@ -1764,6 +1838,57 @@ protected:
   std::string myName;
 };
 
+/// This is a class for keeping statistics on how long something takes
+/**
+   Durations (in microseconds) are added with add(), this keeps the
+   count, min, max and average, and also a histogram of the durations
+   from which percentiles can be estimated with getPercentile().  The
+   histogram buckets are exact below 16 us and then there are four per
+   power of two, so the percentiles are within about 20% of the real
+   value.  Adding doesn't allocate so this can be used in the robot's
+   cycle.
+   @ingroup UtilityClasses
+*/
+class ArTimingHistogram
+{
+public:
+  /// Constructor
+  AREXPORT ArTimingHistogram();
+  /// Destructor
+  AREXPORT ~ArTimingHistogram();
+  /// Adds a duration (in microseconds)
+  AREXPORT void add(unsigned long long usecs);
+  /// Clears everything that was added
+  AREXPORT void clear(void);
+  /// Gets the number of durations added
+  unsigned long long getCount(void) const { return myCount; }
+  /// Gets the shortest duration added (in microseconds)
+  unsigned long long getMin(void) const { return myMin; }
+  /// Gets the longest duration added (in microseconds)
+  unsigned long long getMax(void) const { return myMax; }
+  /// Gets the total of the durations added (in microseconds)
+  unsigned long long getTotal(void) const { return myTotal; }
+  /// Gets the average duration (in microseconds)
+  AREXPORT double getAverage(void) const;
+  /// Estimates a percentile (0 to 100) of the durations (in microseconds)
+  AREXPORT unsigned long long getPercentile(double percentile) const;
+  /// Logs the statistics (in ms) on one line with the given prefix
+  AREXPORT void log(const char *prefix, int level = 0) const;
+
+  enum { 
+    NUM_EXACT_BUCKETS = 16, ///< buckets that are one microsecond wide
+    NUM_BUCKETS = 16 + 4 * 44 ///< total number of buckets
+  };
+protected:
+  AREXPORT static int getBucket(unsigned long long usecs);
+  AREXPORT static unsigned long long getBucketTop(int bucket);
+  unsigned long long myCount;
+  unsigned long long myMin;
+  unsigned long long myMax;
+  unsigned long long myTotal;
+  unsigned int myBuckets[NUM_BUCKETS];
+};
+
 
 //class ArStrCaseCmpOp :  public std::binary_function <const std::string&, const std::string&, bool> 
 /// strcasecmp for sets
@@ -1944,6 +2069,25 @@ public:
     buffer[bufferLen-1] = '\0'; }
 };
 
+/** An ArGenericCallbackList invoke in progress, this lives on the invoke's stack
+
+    Each thread keeps the invokes it is in the middle of (innermost
+    first), so ArGenericCallbackList::remCallback() knows which of the
+    invokes it would wait for are its own thread's.
+**/
+class ArCallbackListInvoke
+{
+public:
+  /// The snapshot being invoked
+  void *mySnapshot;
+  /// The invoke this one is inside of in this thread, or NULL
+  ArCallbackListInvoke *myNext;
+  /// Gets the innermost invoke in progress in the calling thread
+  AREXPORT static ArCallbackListInvoke *getThreadInvokes(void);
+  /// Sets the innermost invoke in progress in the calling thread
+  AREXPORT static void setThreadInvokes(ArCallbackListInvoke *invokes);
+};
+
 /** A class to hold a list of callbacks to call
     GenericFunctor must be a pointer to an ArFunctor or subclass.
     e.g. declare like this:
@@ -1955,6 +2099,27 @@ public:
       callbackList.invoke();
     @endcode
     To pass an argument to the callbacks, use ArCallbackList1 instead.
+
+    The list is copy on write: adding or removing callbacks (under
+    the data mutex) builds a new immutable snapshot of the list and
+    swaps it in, and invoking walks whatever snapshot was current
+    when it started, counting itself in that snapshot with atomic
+    operations instead of locking anything.  So a slow callback doesn't
+    hold up other threads adding callbacks, and callbacks can add or
+    remove callbacks (including themselves) from the list they're
+    being called from; the change takes effect the next time the list
+    is invoked.  An old snapshot is deleted on a later change once
+    nothing is invoking the list.
+
+    remCallback() waits for the invokes of the old snapshots (the ones
+    that might still call the removed callback) in other threads to
+    finish, like it did when invoking held the data mutex, so a
+    callback can be deleted as soon as it has been removed.  Invokes in
+    the thread calling remCallback() (when a callback removes something
+    from the list it is being called from) aren't waited for, so a
+    callback that removes another callback from its own list mustn't
+    delete it until that invoke is done.
+
     @ingroup UtilityClasses
 **/
 
@@ -1976,10 +2141,46 @@ public:
       mutexName += "::myDataMutex";
       myDataMutex.setLogName(mutexName.c_str());
       myLogging = true;
+      mySnapshot = new Snapshot;
+      myInvoking = 0;
+    }
+  /// Copy constructor
+  ArGenericCallbackList(const ArGenericCallbackList &other) :
+    myLogLevel(other.myLogLevel),
+    myName(other.myName),
+    myList(other.myList),
+    mySingleShot(other.mySingleShot),
+    myLogging(other.myLogging)
+    {
+      std::string mutexName;
+      mutexName = "ArGenericCallbackList::";
+      mutexName += myName;
+      mutexName += "::myDataMutex";
+      myDataMutex.setLogName(mutexName.c_str());
+      mySnapshot = new Snapshot(myList.begin(), myList.end());
+      myInvoking = 0;
+    }
+  /// Assignment operator
+  ArGenericCallbackList &operator=(const ArGenericCallbackList &other)
+    {
+      if (this != &other)
+      {
+	myDataMutex.lock();
+	myLogLevel = other.myLogLevel;
+	myName = other.myName;
+	myList = other.myList;
+	mySingleShot = other.mySingleShot;
+	myLogging = other.myLogging;
+	publishLocked();
+	myDataMutex.unlock();
+      }
+      return *this;
     }
   /// Destructor
   virtual ~ArGenericCallbackList()
     {
+      delete mySnapshot;
+      ArUtil::deleteSet(myRetired.begin(), myRetired.end());
     }
   /// Adds a callback
   void addCallback(GenericFunctor functor, int position = 50)
@@ -1988,24 +2189,44 @@ public:
       myList.insert(
 	      std::pair<int, GenericFunctor>(-position, 
 					     functor));
+      publishLocked();
       myDataMutex.unlock();
     }
-  /// Removes a callback
+  /// Removes a callback, waiting for other threads' invokes that might call it
   void remCallback(GenericFunctor functor)
     {
       myDataMutex.lock();
       typename std::multimap<int, GenericFunctor>::iterator it;
+      bool removed = false;
+      std::vector<Snapshot *> oldSnapshots;
       
-      for (it = myList.begin(); it != myList.end(); it++)
+      for (it = myList.begin(); it != myList.end(); )
       {
 	if ((*it).second == functor)
 	{
-	  myList.erase(it);
-	  myDataMutex.unlock();
-	  remCallback(functor);
-	  return;
+	  myList.erase(it++);
+	  removed = true;
 	}
+	else
+	  it++;
       }
+      if (!removed)
+      {
+	myDataMutex.unlock();
+	return;
+      }
+      // counting ourselves as invoking keeps the old snapshots from
+      // being deleted while we wait on them
+      ArUtil::atomicIncrement(&myInvoking);
+      publishLocked();
+      oldSnapshots.assign(myRetired.begin(), myRetired.end());
+      myDataMutex.unlock();
+      // this is done without the data mutex since single shot invokes
+      // lock it when they finish
+      waitForInvokes(oldSnapshots);
+      myDataMutex.lock();
+      ArUtil::atomicDecrement(&myInvoking);
+      deleteRetiredLocked();
       myDataMutex.unlock();
     }
   /// Sets the name
@@ -2048,12 +2269,129 @@ public:
     myLogging = on;
   }
 protected:
+  /// An immutable copy of the list, that is what gets invoked
+  class Snapshot : public std::vector<std::pair<int, GenericFunctor> >
+  {
+  public:
+    Snapshot() : myInvoking(0) {}
+    template<class Iterator> Snapshot(Iterator first, Iterator last) :
+      std::vector<std::pair<int, GenericFunctor> >(first, last),
+      myInvoking(0) {}
+    /// How many invokes are using this snapshot
+    volatile long myInvoking;
+  };
+
+  /// Gets the snapshot to invoke, call endInvoke() when done with it
+  const Snapshot *beginInvoke(ArCallbackListInvoke *record)
+    {
+      Snapshot *snapshot;
+      // this keeps publishLocked() from deleting the snapshot we get
+      // before we're counted in it
+      ArUtil::atomicIncrement(&myInvoking);
+      while (true)
+      {
+	snapshot = mySnapshot;
+	ArUtil::atomicIncrement(&snapshot->myInvoking);
+	// if it was swapped out before we were counted in it
+	// remCallback() may not be waiting for us, so use the new one
+	if (snapshot == mySnapshot)
+	  break;
+	ArUtil::atomicDecrement(&snapshot->myInvoking);
+      }
+      record->mySnapshot = snapshot;
+      record->myNext = ArCallbackListInvoke::getThreadInvokes();
+      ArCallbackListInvoke::setThreadInvokes(record);
+      return snapshot;
+    }
+  /// Lets the snapshot from beginInvoke() go
+  void endInvoke(ArCallbackListInvoke *record)
+    {
+      Snapshot *snapshot = (Snapshot *)record->mySnapshot;
+      if (mySingleShot)
+      {
+	myDataMutex.lock();
+	if(myLogging)
+	  ArLog::log(myLogLevel, "%s: Clearing callbacks", myName.c_str());
+	// only take out the callbacks that were just called, anything
+	// added while they were being called gets called next time
+	if (snapshot == mySnapshot)
+	  myList.clear();
+	else
+	  removeLocked(snapshot);
+	publishLocked();
+	myDataMutex.unlock();
+      }
+      ArCallbackListInvoke::setThreadInvokes(record->myNext);
+      ArUtil::atomicDecrement(&snapshot->myInvoking);
+      ArUtil::atomicDecrement(&myInvoking);
+    }
+  /// Waits until invokes of the snapshots in other threads are done
+  void waitForInvokes(const std::vector<Snapshot *> &snapshots)
+    {
+      typename std::vector<Snapshot *>::const_iterator it;
+      ArCallbackListInvoke *record;
+      long own;
+      for (it = snapshots.begin(); it != snapshots.end(); it++)
+      {
+	// the ones this thread is in the middle of won't finish
+	own = 0;
+	for (record = ArCallbackListInvoke::getThreadInvokes(); 
+	     record != NULL; record = record->myNext)
+	  if (record->mySnapshot == (*it))
+	    own++;
+	while ((*it)->myInvoking > own)
+	  ArUtil::sleep(1);
+      }
+    }
+  /// Takes the callbacks in the snapshot out of the list, call with myDataMutex locked
+  void removeLocked(const Snapshot *snapshot)
+    {
+      typename Snapshot::const_iterator sIt;
+      typename std::multimap<int, GenericFunctor>::iterator it;
+      for (sIt = snapshot->begin(); sIt != snapshot->end(); sIt++)
+      {
+	for (it = myList.lower_bound((*sIt).first); 
+	     it != myList.end() && (*it).first == (*sIt).first; it++)
+	{
+	  if ((*it).second == (*sIt).second)
+	  {
+	    myList.erase(it);
+	    break;
+	  }
+	}
+      }
+    }
+  /// Swaps in a new snapshot of the list, call with myDataMutex locked
+  void publishLocked(void)
+    {
+      Snapshot *oldSnapshot = mySnapshot;
+      myRetired.push_back(oldSnapshot);
+      mySnapshot = new Snapshot(myList.begin(), myList.end());
+      deleteRetiredLocked();
+    }
+  /// Deletes the old snapshots if nothing is invoking, call with myDataMutex locked
+  void deleteRetiredLocked(void)
+    {
+      // anything that starts invoking after the barrier sees the new
+      // snapshot, so if nothing is invoking now nothing has the old ones
+      ArUtil::memoryBarrier();
+      if (myInvoking == 0)
+      {
+	ArUtil::deleteSet(myRetired.begin(), myRetired.end());
+	myRetired.clear();
+      }
+    }
+
   ArMutex myDataMutex;
   ArLog::LogLevel myLogLevel;
   std::string myName;
   std::multimap<int, GenericFunctor> myList;
   bool mySingleShot;
   bool myLogging;
+  Snapshot * volatile mySnapshot;
+  // how many invokes are going on (of any snapshot)
+  volatile long myInvoking;
+  std::list<Snapshot *> myRetired;
 };
 
 /** A class to hold a list of callbacks to call sequentially. 
@@ -2076,16 +2414,17 @@ public:
   /// Calls the callback list
   void invoke(void)
     {
-      myDataMutex.lock();
+      ArCallbackListInvoke record;
+      const Snapshot *snapshot = beginInvoke(&record);
       
-      std::multimap<int, ArFunctor *>::iterator it;
+      Snapshot::const_iterator it;
       ArFunctor *functor;
       
       if(myLogging)
 	ArLog::log(myLogLevel, "%s: Starting calls", myName.c_str());
       
-      for (it = myList.begin(); 
-	   it != myList.end(); 
+      for (it = snapshot->begin(); 
+	   it != snapshot->end(); 
 	   it++)
       {
 	functor = (*it).second;
@@ -2107,13 +2446,7 @@ public:
       if(myLogging)
 	ArLog::log(myLogLevel, "%s: Ended calls", myName.c_str());
       
-      if (mySingleShot)
-      {
-	if(myLogging)
-	  ArLog::log(myLogLevel, "%s: Clearing callbacks", myName.c_str());
-	myList.clear();
-      }
-      myDataMutex.unlock();
+      endInvoke(&record);
     }
 protected:
 };
@@ -2154,9 +2487,11 @@ public:
   /// Calls the callback list
   void invoke(P1 p1)
     {
-      ArGenericCallbackList<ArFunctor1<P1> *>::myDataMutex.lock();
+      ArCallbackListInvoke record;
+      const typename ArGenericCallbackList<ArFunctor1<P1> *>::Snapshot *
+	snapshot = ArGenericCallbackList<ArFunctor1<P1> *>::beginInvoke(&record);
       
-      typename std::multimap<int, ArFunctor1<P1> *>::iterator it;
+      typename ArGenericCallbackList<ArFunctor1<P1> *>::Snapshot::const_iterator it;
       ArFunctor1<P1> *functor;
       
       if(ArGenericCallbackList<ArFunctor1<P1> *>::myLogging)
@@ -2165,8 +2500,8 @@ public:
 		"%s: Starting calls1", 
 		ArGenericCallbackList<ArFunctor1<P1> *>::myName.c_str());
       
-      for (it = ArGenericCallbackList<ArFunctor1<P1> *>::myList.begin(); 
-	   it != ArGenericCallbackList<ArFunctor1<P1> *>::myList.end(); 
+      for (it = snapshot->begin(); 
+	   it != snapshot->end(); 
 	   it++)
       {
 	functor = (*it).second;
@@ -2192,15 +2527,7 @@ public:
       if(ArGenericCallbackList<ArFunctor1<P1> *>::myLogging)
 	ArLog::log(ArGenericCallbackList<ArFunctor1<P1> *>::myLogLevel, "%s: Ended calls", ArGenericCallbackList<ArFunctor1<P1> *>::myName.c_str());
       
-      if (ArGenericCallbackList<ArFunctor1<P1> *>::mySingleShot)
-      {
-	if(ArGenericCallbackList<ArFunctor1<P1> *>::myLogging)
-	  ArLog::log(ArGenericCallbackList<ArFunctor1<P1> *>::myLogLevel, 
-		     "%s: Clearing callbacks", 
-		     ArGenericCallbackList<ArFunctor1<P1> *>::myName.c_str());
-	ArGenericCallbackList<ArFunctor1<P1> *>::myList.clear();
-      }
-      ArGenericCallbackList<ArFunctor1<P1> *>::myDataMutex.unlock();
+      ArGenericCallbackList<ArFunctor1<P1> *>::endInvoke(&record);
     }
 protected:
 };
@@ -40,6 +40,7 @@ AREXPORT ArAction::ArAction(const char *name, const char *description)
   myName = name;
   myDescription = description;
   myIsActive = ourDefaultActivationState;
+  myIsPure = false;
 }
 
 AREXPORT ArAction::~ArAction()
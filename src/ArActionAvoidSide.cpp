@@ -47,7 +47,7 @@ AREXPORT ArActionAvoidSide::ArActionAvoidSide(const char *name,
   myTurnAmount = turnAmount;
 
   myTurning = false;
-
+  setPure(true);
 }
 
 AREXPORT ArActionAvoidSide::~ArActionAvoidSide()
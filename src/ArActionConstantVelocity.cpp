@@ -38,6 +38,7 @@ AREXPORT ArActionConstantVelocity::ArActionConstantVelocity(const char *name,
   setNextArgument(ArArg("velocity", &myVelocity, 
 			"The velocity to make the robot travel at. (mm/sec)"));
   myVelocity = velocity;  
+  setPure(true);
 }
 
 AREXPORT ArActionConstantVelocity::~ArActionConstantVelocity()
@@ -64,6 +64,7 @@ AREXPORT ArActionLimiterBackwards::ArActionLimiterBackwards(
 			&myAvoidLocationDependentObstacles, 
 			 "Whether to avoid location dependent obstacles or not"));
   myAvoidLocationDependentObstacles = avoidLocationDependentObstacles;
+  setPure(true);
 }
 
 AREXPORT ArActionLimiterBackwards::~ArActionLimiterBackwards()
@@ -60,6 +60,7 @@ AREXPORT ArActionLimiterForwards::ArActionLimiterForwards(const char *name,
 			"Ratio of the width of the box to look at to the robot radius (multiplier)"));
   myWidthRatio = widthRatio;
   myLastStopped = false;
+  setPure(true);
 }
 
 AREXPORT ArActionLimiterForwards::~ArActionLimiterForwards()
@@ -33,7 +33,7 @@ AREXPORT ArActionLimiterTableSensor::ArActionLimiterTableSensor(
 	const char *name) :
   ArAction(name, "Limits speed to 0 if a table is seen")
 {
-
+  setPure(true);
 }
 
 AREXPORT ArActionLimiterTableSensor::~ArActionLimiterTableSensor()
@@ -207,6 +207,7 @@ AREXPORT ArConfig::ArConfig(const ArConfig &config) :
 
   myCategoryToSectionsMap(config.myCategoryToSectionsMap),
   mySections(),
+  myParamSections(config.myParamSections),
 
   myParserCB(this, &ArConfig::parseArgument),
   myVersionCB(this, &ArConfig::parseVersion),
@@ -223,7 +224,7 @@ AREXPORT ArConfig::ArConfig(const ArConfig &config) :
        it != config.mySections.end(); 
        it++) 
   {
-    mySections.push_back(new ArConfigSection(*(*it)));
+    pushSection(new ArConfigSection(*(*it)));
   }
   copySectionsToParse(config.mySectionsToParse);
 
@@ -289,9 +290,10 @@ AREXPORT ArConfig &ArConfig::operator=(const ArConfig &config)
 	       it != config.mySections.end(); 
 	       it++) 
     {
-      mySections.push_back(new ArConfigSection(*(*it)));
+      pushSection(new ArConfigSection(*(*it)));
     }
 
+    myParamSections = config.myParamSections;
     
     copySectionsToParse(config.mySectionsToParse);
 
@@ -365,10 +367,11 @@ AREXPORT void ArConfig::copyAndDetach(const ArConfig &config)
       ArConfigSection *sectionCopy = new ArConfigSection();
       sectionCopy->setQuiet(myIsQuiet);
       sectionCopy->copyAndDetach(*(*it));
-      mySections.push_back(sectionCopy);
+      pushSection(sectionCopy);
       //mySections.push_back(new ArConfigSection(*(*it)));
     }
 
+    myParamSections = config.myParamSections;
     
     copySectionsToParse(config.mySectionsToParse);
     myHighestPriorityToParse = config.myHighestPriorityToParse;
@@ -532,6 +535,8 @@ AREXPORT void ArConfig::clearSections(void)
                      "%sclearSections() begin",
                      myLogPrefix.c_str()));
 
+  mySectionIndex.clear();
+  myParamSections.clear();
   while (mySections.begin() != mySections.end())
   {
     delete mySections.front();
@@ -681,7 +686,7 @@ AREXPORT bool  ArConfig::addSection(const char *categoryName,
                                   sectionDescription, 
                                   myIsQuiet,
                                   categoryName);
-    mySections.push_back(section);
+    pushSection(section);
   }
   else {
     ArLog::log(ArLog::Verbose, "%sAssigning existing section '%s' to category '%s'", 
@@ -737,7 +742,7 @@ AREXPORT void ArConfig::setSectionComment(const char *sectionName,
     section = new ArConfigSection(sectionName, comment, myIsQuiet);
 
 
-    mySections.push_back(section);
+    pushSection(section);
   }
   else {
     section->setComment(comment);
@@ -768,7 +773,7 @@ AREXPORT bool ArConfig::addSectionFlags(const char *sectionName,
     section->addFlags(flags, myIsQuiet);
 
     translateSection(section);
-    mySections.push_back(section);
+    pushSection(section);
   }
   else
     section->addFlags(flags, myIsQuiet);
@@ -864,7 +869,7 @@ AREXPORT bool ArConfig::addParam(const ArConfigArg &arg,
    
     translateSection(section);
 
-    mySections.push_back(section);
+    pushSection(section);
   }
    
   std::list<ArConfigArg> *params = section->getParams();
@@ -885,39 +890,30 @@ AREXPORT bool ArConfig::addParam(const ArConfigArg &arg,
   }
 
   // see if we have this parameter in another section so we can require sections
-  std::list<ArConfigSection *>::iterator sectionIt;
-  
-  for (sectionIt = mySections.begin(); 
-       sectionIt != mySections.end(); 
-       sectionIt++)
+  std::map<std::string, std::string, ArStrCaseCmpOp>::iterator psIt;
+  if ((strlen(arg.getName()) > 0) && 
+      (psIt = myParamSections.find(arg.getName())) != myParamSections.end())
   {
-    ArConfigSection *curSection = *sectionIt;
-
-    // if we have an argument of this name but we don't have see if
-    // this section is our own, if its not then note we have
-    // duplicates
-    if ((strlen(arg.getName()) > 0) && 
-        (curSection->findParam(arg.getName()) != NULL)) 
-    {
-      if (strcasecmp(curSection->getName(), section->getName()) != 0) {
-        ArLog::log(ArLog::Verbose, 
-                  "%sParameter %s (type %s) name duplicated in section %s and %s",
-                  myLogPrefix.c_str(),
-                  arg.getName(), 
-                  ArConfigArg::toString(arg.getType()),
-                  curSection->getName(), section->getName());
-        myDuplicateParams = true;
-      }
-      else {
-        ArLog::log(ArLog::Verbose, 
-                  "%sParameter %s (type %s) already exists in section %s",
-                  myLogPrefix.c_str(),
-		              arg.getName(), 
-                  ArConfigArg::toString(arg.getType()),
-                  section->getName());
-      }
+    // if we have an argument of this name see if it is in our own
+    // section, if its not then note we have duplicates
+    if (strcasecmp((*psIt).second.c_str(), section->getName()) != 0) {
+      ArLog::log(ArLog::Verbose, 
+                 "%sParameter %s (type %s) name duplicated in section %s and %s",
+                 myLogPrefix.c_str(),
+                 arg.getName(), 
+                 ArConfigArg::toString(arg.getType()),
+                 (*psIt).second.c_str(), section->getName());
+      myDuplicateParams = true;
     }
-  } // end for each section
+    else {
+      ArLog::log(ArLog::Verbose, 
+                 "%sParameter %s (type %s) already exists in section %s",
+                 myLogPrefix.c_str(),
+                 arg.getName(), 
+                 ArConfigArg::toString(arg.getType()),
+                 section->getName());
+    }
+  }
   
   // now make sure we can add it to the file parser (with the section
   // stuff its okay if we can't)
@@ -951,6 +947,12 @@ AREXPORT bool ArConfig::addParam(const ArConfigArg &arg,
 
   params->back().setIgnoreBounds(myIgnoreBounds);
   params->back().replaceSpacesInName();
+  section->indexParam(&params->back());
+  if (params->back().getType() != ArConfigArg::STRING_HOLDER &&
+      params->back().getType() != ArConfigArg::LIST_HOLDER &&
+      strlen(params->back().getName()) > 0)
+    myParamSections.insert(std::pair<std::string, std::string>(
+				   params->back().getName(), section->getName()));
 
   IFDEBUG(ArLog::log(ArLog::Verbose, "%sAdded parameter '%s' to section '%s'", 
                       myLogPrefix.c_str(), arg.getName(), section->getName()));
@@ -1112,7 +1114,7 @@ AREXPORT bool ArConfig::parseSection(ArArgumentBuilder *arg,
 
       translateSection(section);
 
-      mySections.push_back(section);
+      pushSection(section);
     }
     else
     {
@@ -2749,6 +2751,17 @@ AREXPORT std::list<ArConfigSection *> *ArConfig::getSections(void)
   return &mySections;
 }
 
+void ArConfig::pushSection(ArConfigSection *section)
+{
+  mySections.push_back(section);
+  // insert won't replace a section that is already there, so this
+  // finds the first one with a name just like searching the list did
+  if (section != NULL)
+    mySectionIndex.insert(
+	    std::pair<std::string, ArConfigSection *>(section->getName(), 
+						      section));
+}
+
 
 AREXPORT void ArConfig::setNoBlanksBetweenParams(bool noBlanksBetweenParams)
 {
@@ -2887,31 +2900,11 @@ AREXPORT ArConfigSection *ArConfig::findSection(const char *sectionName) const
     return NULL;
   }
 
-  ArConfigSection *section = NULL;
-  ArConfigSection *tempSection = NULL;
-
-  for (std::list<ArConfigSection *>::const_iterator sectionIt = mySections.begin(); 
-       sectionIt != mySections.end(); 
-       sectionIt++)
-  {
-    tempSection = (*sectionIt);
-    if (tempSection == NULL) {
-      ArLog::log(ArLog::Normal,
-                 "ArConfig::findSection(%s) unexpected null section in config",
-                 sectionName);
-      continue;
-    }
-
-   
-    if (ArUtil::strcasecmp(tempSection->getName(), sectionName) == 0)
-    {
-      section = tempSection;
-      // KMC 7/11/12 Added the break here (hoping there's not a compelling
-      // reason to always search the config for null sections.
-      break;
-    }
-  }
-  return section;
+  std::map<std::string, ArConfigSection *, ArStrCaseCmpOp>::const_iterator it =
+    mySectionIndex.find(sectionName);
+  if (it == mySectionIndex.end())
+    return NULL;
+  return (*it).second;
 
 } // end method findSection
 
@@ -3007,6 +3000,7 @@ AREXPORT void ArConfig::removeAllUnsetValues(bool isRemovingUnsetSectionsOnly)
   std::list<ArConfigArg>::iterator paramIt;
   std::list<std::list<ArConfigArg>::iterator> removeParams;
   std::list<std::list<ArConfigArg>::iterator>::iterator removeParamsIt;
+  bool removedAny = false;
 
   sections = getSections();
   for (sectionIt = sections->begin(); 
@@ -3040,7 +3034,29 @@ AREXPORT void ArConfig::removeAllUnsetValues(bool isRemovingUnsetSectionsOnly)
      myLogPrefix.c_str(),
 		 section->getName(), (*(*removeParamsIt)).getName());
       section->getParams()->erase((*removeParamsIt));
+      section->paramsChanged();
       removeParams.pop_front();      
+      removedAny = true;
+    }
+  }
+
+  // the parameters left might not be in the sections they were first
+  // added to anymore
+  if (removedAny)
+  {
+    myParamSections.clear();
+    for (sectionIt = sections->begin(); 
+         sectionIt != sections->end(); 
+         sectionIt++)
+    {
+      params = (*sectionIt)->getParams();
+      for (paramIt = params->begin(); paramIt != params->end(); paramIt++)
+        if ((*paramIt).getType() != ArConfigArg::STRING_HOLDER &&
+            (*paramIt).getType() != ArConfigArg::LIST_HOLDER &&
+            strlen((*paramIt).getName()) > 0)
+          myParamSections.insert(std::pair<std::string, std::string>(
+                                         (*paramIt).getName(), 
+                                         (*sectionIt)->getName()));
     }
   }
 }
@@ -3108,7 +3124,8 @@ AREXPORT ArConfigSection::ArConfigSection(const char *name,
   myDisplayName(""),
   myFlags(NULL),
   myParams(),
-  myIsQuiet(isQuiet)
+  myIsQuiet(isQuiet),
+  myParamIndexValid(true)
 {
   myFlags = new ArArgumentBuilder(512, '|');
   myFlags->setQuiet(myIsQuiet);
@@ -3141,6 +3158,8 @@ AREXPORT ArConfigSection::ArConfigSection(const ArConfigSection &section)
   }
 
   myIsQuiet = section.myIsQuiet;
+  // the indexes point into myParams so they get built, not copied
+  myParamIndexValid = false;
 }
 
 AREXPORT ArConfigSection &ArConfigSection::operator=(const ArConfigSection &section) 
@@ -3166,6 +3185,7 @@ AREXPORT ArConfigSection &ArConfigSection::operator=(const ArConfigSection &sect
     }
       
     myIsQuiet = section.myIsQuiet;
+    myParamIndexValid = false;
 
   }
   return *this;
@@ -3198,6 +3218,7 @@ AREXPORT void ArConfigSection::copyAndDetach(const ArConfigSection &section)
     }
 
     myIsQuiet = section.myIsQuiet;
+    myParamIndexValid = false;
 
   }
   //return *this;
@@ -3206,28 +3227,30 @@ AREXPORT void ArConfigSection::copyAndDetach(const ArConfigSection &section)
 
 
 
+/**
+   If there is more than one parameter with the name, this finds the
+   last one.
+**/
 AREXPORT ArConfigArg *ArConfigSection::findParam(const char *paramName,
                                                  bool isAllowStringHolders)
 {
-  ArConfigArg *param = NULL;
-  ArConfigArg *tempParam = NULL;
+  if (paramName == NULL)
+    return NULL;
 
-  for (std::list<ArConfigArg>::iterator pIter = myParams.begin(); 
-       pIter != myParams.end(); 
-       pIter++)
-  {
-    tempParam = &(*pIter);
-    // ignore string holders 
-    if (!isAllowStringHolders &&
-        ((tempParam->getType() == ArConfigArg::STRING_HOLDER) || 
-         (tempParam->getType() == ArConfigArg::LIST_HOLDER)))
-      continue;
-    if (ArUtil::strcasecmp(tempParam->getName(), paramName) == 0)
-    {
-      param = tempParam;
-    }
-  }
-  return param;
+  if (!myParamIndexValid)
+    buildParamIndex();
+
+  std::map<std::string, ArConfigArg *, ArStrCaseCmpOp> *index;
+  if (isAllowStringHolders)
+    index = &myParamWithHoldersIndex;
+  else
+    index = &myParamIndex;
+
+  std::map<std::string, ArConfigArg *, ArStrCaseCmpOp>::iterator it = 
+    index->find(paramName);
+  if (it == index->end())
+    return NULL;
+  return (*it).second;
 
 } // end method findParam
 
@@ -3368,6 +3391,15 @@ AREXPORT bool ArConfigSection::remStringHolder(const char *paramName)
 {
   ArConfigArg *tempParam = NULL;
   
+  // this is called for every parameter added, so don't search the
+  // list unless there is something to find
+  if (ArUtil::isStrEmpty(paramName))
+    return false;
+  if (!myParamIndexValid)
+    buildParamIndex();
+  if (myHolderCounts.find(paramName) == myHolderCounts.end())
+    return false;
+
   for (std::list<ArConfigArg>::iterator pIter = myParams.begin(); 
        pIter != myParams.end(); 
        pIter++)
@@ -3386,6 +3418,7 @@ AREXPORT bool ArConfigSection::remStringHolder(const char *paramName)
     if (ArUtil::strcasecmp(tempParam->getName(), paramName) == 0)
     {
       myParams.erase(pIter);
+      myParamIndexValid = false;
       // Recurse to ensure that all occurrences of the string holder
       // are removed.
       remStringHolder(paramName);
@@ -3395,6 +3428,34 @@ AREXPORT bool ArConfigSection::remStringHolder(const char *paramName)
   return false;
 }
 
+void ArConfigSection::indexParam(ArConfigArg *param)
+{
+  // if the indexes are already out of date they'll pick this up when
+  // they are rebuilt
+  if (!myParamIndexValid)
+    return;
+
+  // later parameters replace earlier ones with the same name
+  myParamWithHoldersIndex[param->getName()] = param;
+  if ((param->getType() == ArConfigArg::STRING_HOLDER) || 
+      (param->getType() == ArConfigArg::LIST_HOLDER))
+    myHolderCounts[param->getName()]++;
+  else
+    myParamIndex[param->getName()] = param;
+}
+
+void ArConfigSection::buildParamIndex(void)
+{
+  myParamIndex.clear();
+  myParamWithHoldersIndex.clear();
+  myHolderCounts.clear();
+  myParamIndexValid = true;
+  for (std::list<ArConfigArg>::iterator it = myParams.begin(); 
+       it != myParams.end(); 
+       it++)
+    indexParam(&(*it));
+}
+
 AREXPORT bool ArConfigSection::hasFlag(const char *flag) const
 {
   size_t i;
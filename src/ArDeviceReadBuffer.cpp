@@ -0,0 +1,215 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "ArExport.h"
+#include "ariaOSDef.h"
+#include "ArDeviceReadBuffer.h"
+#include "ArDeviceConnection.h"
+#include "ArLog.h"
+
+/**
+   @param conn the connection to read from
+
+   @param size how many bytes the buffer can hold, this is rounded up
+   to a power of two, it should be enough for a couple of the largest
+   packets that will be read
+**/
+AREXPORT ArDeviceReadBuffer::ArDeviceReadBuffer(ArDeviceConnection *conn, 
+						int size)
+{
+  myConn = conn;
+  for (mySize = 64; mySize < size; mySize *= 2)
+    ;
+  myBuf = new unsigned char[mySize];
+  myStart = 0;
+  myNumBytes = 0;
+  myNumReads = 0;
+  myConsumed = 0;
+}
+
+AREXPORT ArDeviceReadBuffer::~ArDeviceReadBuffer()
+{
+  delete[] myBuf;
+}
+
+AREXPORT void ArDeviceReadBuffer::setDeviceConnection(
+	ArDeviceConnection *conn)
+{
+  myConn = conn;
+  clear();
+}
+
+AREXPORT void ArDeviceReadBuffer::clear(void)
+{
+  myConsumed += myNumBytes;
+  myStart = 0;
+  myNumBytes = 0;
+  myReadTimes.clear();
+}
+
+/**
+   This first takes whatever the connection already has without
+   waiting.  If that was nothing it then waits up to @a msWait for
+   something to come in (and takes the rest of what came in with it).
+
+   @return how many bytes were read (0 if there was nothing to read,
+   or the buffer is full), -1 if the connection isn't open or failed
+**/
+AREXPORT int ArDeviceReadBuffer::fill(unsigned int msWait)
+{
+  int ret;
+  int more;
+
+  if (myConn == NULL || 
+      myConn->getStatus() != ArDeviceConnection::STATUS_OPEN)
+  {
+    clear();
+    return -1;
+  }
+  if (myNumBytes >= mySize)
+    return 0;
+
+  if ((ret = internalRead(mySize - myNumBytes, 0)) != 0 || msWait == 0)
+    return ret;
+
+  // nothing was there, so wait for a byte then take whatever else
+  // came in with it
+  if ((ret = internalRead(1, msWait)) <= 0)
+    return ret;
+  if (myNumBytes < mySize && (more = internalRead(mySize - myNumBytes, 0)) > 0)
+    ret += more;
+  return ret;
+}
+
+int ArDeviceReadBuffer::internalRead(int size, unsigned int msWait)
+{
+  int end;
+  int len;
+  int numRead;
+  int total = 0;
+
+  // the free space can be in two pieces if it wraps around
+  while (total < size)
+  {
+    end = (myStart + myNumBytes) & (mySize - 1);
+    len = mySize - end;
+    if (len > size - total)
+      len = size - total;
+    numRead = myConn->read((char *)&myBuf[end], len, msWait);
+    myNumReads++;
+    if (numRead < 0)
+    {
+      if (total > 0)
+	break;
+      return -1;
+    }
+    if (numRead == 0)
+      break;
+    myConn->debugBytesRead(numRead);
+    myNumBytes += numRead;
+    total += numRead;
+    // only go around for the second piece if this one was filled
+    if (numRead < len)
+      break;
+  }
+  if (total > 0)
+    myReadTimes.push_back(std::pair<ArTypes::UByte4, ArTime>(
+				  myConsumed + myNumBytes, 
+				  myConn->getTimeRead(0)));
+  return total;
+}
+
+/**
+   @return the offset (from the front of the buffer) of the first @a c
+   at or after @a start, or -1 if there isn't one
+**/
+AREXPORT int ArDeviceReadBuffer::find(unsigned char c, int start) const
+{
+  const unsigned char *found;
+  int at;
+  int len;
+
+  while (start < myNumBytes)
+  {
+    // look through the contiguous piece at start
+    at = (myStart + start) & (mySize - 1);
+    len = mySize - at;
+    if (len > myNumBytes - start)
+      len = myNumBytes - start;
+    if ((found = (const unsigned char *)memchr(&myBuf[at], c, len)) != NULL)
+      return start + (found - &myBuf[at]);
+    start += len;
+  }
+  return -1;
+}
+
+AREXPORT void ArDeviceReadBuffer::copy(char *dest, int offset, 
+				       int length) const
+{
+  int at;
+  int len;
+
+  if (offset + length > myNumBytes)
+    length = myNumBytes - offset;
+  while (length > 0)
+  {
+    at = (myStart + offset) & (mySize - 1);
+    len = mySize - at;
+    if (len > length)
+      len = length;
+    memcpy(dest, &myBuf[at], len);
+    dest += len;
+    offset += len;
+    length -= len;
+  }
+}
+
+AREXPORT void ArDeviceReadBuffer::consume(int length)
+{
+  if (length >= myNumBytes)
+  {
+    clear();
+    return;
+  }
+  myStart = (myStart + length) & (mySize - 1);
+  myNumBytes -= length;
+  myConsumed += length;
+  while (!myReadTimes.empty() && 
+	 (int)(myReadTimes.front().first - myConsumed) <= 0)
+    myReadTimes.pop_front();
+}
+
+/**
+   @return when the read that brought in the byte at @a offset was
+   made (or now if there's no such byte)
+**/
+AREXPORT ArTime ArDeviceReadBuffer::getTimeRead(int offset) const
+{
+  std::deque<std::pair<ArTypes::UByte4, ArTime> >::const_iterator it;
+  for (it = myReadTimes.begin(); it != myReadTimes.end(); it++)
+    if ((int)((*it).first - myConsumed) > offset)
+      return (*it).second;
+  return ArTime();
+}
@@ -30,6 +30,9 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 AREXPORT ArInterpolation::ArInterpolation(size_t numberOfReadings)
 {
   mySize = numberOfReadings;
+  myReadings.resize(mySize);
+  myNewest = 0;
+  myNum = 0;
   myDataMutex.setLogName("ArInterpolation");
   setAllowedMSForPrediction();
   setAllowedPercentageForPrediction();
@@ -45,13 +48,18 @@ AREXPORT bool ArInterpolation::addReading(ArTime timeOfReading,
 					  ArPose position)
 {
   myDataMutex.lock();
-  if (myTimes.size() >= mySize)
+  if (mySize == 0)
   {
-    myTimes.pop_back();
-    myPoses.pop_back();
+    myDataMutex.unlock();
+    return true;
   }
-  myTimes.push_front(timeOfReading);
-  myPoses.push_front(position);
+  // the newest goes after the last newest, replacing the oldest if
+  // it's full
+  myNewest = (myNewest + 1) % mySize;
+  myReadings[myNewest].setPose(position);
+  myReadings[myNewest].setTime(timeOfReading);
+  if (myNum < mySize)
+    myNum++;
   myDataMutex.unlock();
   return true;
 }
@@ -70,9 +78,45 @@ AREXPORT bool ArInterpolation::addReading(ArTime timeOfReading,
 AREXPORT int ArInterpolation::getPose(
 	ArTime timeStamp, ArPose *position, ArPoseWithTime *mostRecent)
 {
-  std::list<ArTime>::iterator tit;
-  std::list<ArPose>::iterator pit;
-  
+  int ret;
+  myDataMutex.lock();
+  ret = internalGetPose(timeStamp, position, mostRecent);
+  myDataMutex.unlock();
+  return ret;
+}
+
+/**
+   This is the same as calling getPose for each of the times, but
+   only locks once (so the readings can't change partway through),
+   which is what should be used for something like finding where the
+   robot was for each reading in a laser scan.
+
+   @param timeStamps the times we are interested in
+   @param positions where to put the positions for each time
+   @param results where to put what getPose would return for each time
+   @param numTimes how many times there are
+
+   @return how many of the positions were found (the ones with
+   results of 1 or 0)
+**/
+AREXPORT int ArInterpolation::getPoses(const ArTime *timeStamps, 
+				       ArPose *positions, int *results,
+				       int numTimes)
+{
+  int i;
+  int ret = 0;
+  myDataMutex.lock();
+  for (i = 0; i < numTimes; i++)
+    if ((results[i] = internalGetPose(timeStamps[i], &positions[i], 
+				      NULL)) >= 0)
+      ret++;
+  myDataMutex.unlock();
+  return ret;
+}
+
+int ArInterpolation::internalGetPose(
+	ArTime timeStamp, ArPose *position, ArPoseWithTime *mostRecent)
+{
   ArPose thisPose;
   ArTime thisTime;
   ArPose lastPose;
@@ -85,27 +129,48 @@ AREXPORT int ArInterpolation::getPose(
   long toStamp;
   double percentage;
   ArPose retPose;
+  size_t low;
+  size_t high;
+  size_t mid;
   
-  myDataMutex.lock();
-  // find the time we want
-  for (tit = myTimes.begin(), pit = myPoses.begin();
-       tit != myTimes.end() && pit != myPoses.end(); 
-       ++tit, ++pit)
+  // find the time we want, which is the newest reading that's not
+  // after the time stamp... the readings go back in time so do a
+  // binary search for the first one that's at or before it
+  low = 0;
+  high = myNum;
+  while (low < high)
   {
-    lastTime = thisTime;
-    lastPose = thisPose;
-
-    thisTime = (*tit);
-    thisPose = (*pit);
+    mid = (low + high) / 2;
+    if (!timeStamp.isAfter(internalGetReading(mid).getTime()))
+      high = mid;
+    else
+      low = mid + 1;
+  }
 
-    //printf("## %d %d %d b %d at %d after %d\n", timeStamp.getMSec(), thisTime.getMSec(), timeStamp.mSecSince(thisTime), timeStamp.isBefore(thisTime), timeStamp.isAt(thisTime), timeStamp.isAfter(thisTime));
-    //if (timeStamp.isBefore(thisTime) || timeStamp.isAt(thisTime))
-    if (!timeStamp.isAfter(thisTime))
+  // if we're at the end then it was too long ago (then it's the
+  // oldest one that's the relevant data)
+  if (low >= myNum)
+  {
+    if (mostRecent != NULL && myNum > 0)
+    {
+      mostRecent->setPose(internalGetReading(myNum - 1));
+      mostRecent->setTime(internalGetReading(myNum - 1).getTime());
+    }
+    else if (mostRecent != NULL)
     {
-      //printf("Found one!\n");
-      break;
-    } 
+      mostRecent->setPose(thisPose);
+      mostRecent->setTime(thisTime);
+    }
+    //printf("Too old\n");
+    return -2;
+  }
 
+  thisTime = internalGetReading(low).getTime();
+  thisPose = internalGetReading(low);
+  if (low > 0)
+  {
+    lastTime = internalGetReading(low - 1).getTime();
+    lastPose = internalGetReading(low - 1);
   }
 
   if (mostRecent != NULL)
@@ -114,33 +179,18 @@ AREXPORT int ArInterpolation::getPose(
     mostRecent->setTime(thisTime);
   }
     
-
-  // if we're at the end then it was too long ago
-  if (tit == myTimes.end() || pit == myPoses.end())
-  {
-    //printf("Too old\n");
-    myDataMutex.unlock();
-    return -2;
-  }
-  
   // this is for forecasting (for the brave)
-  if ((tit == myTimes.begin() || pit == myPoses.begin()) && 
-      !timeStamp.isAt((*tit)))
+  if (low == 0 && !timeStamp.isAt(thisTime))
   {
-    //printf("Too new %d %d\n", tit == myTimes.begin(), pit == myPoses.begin());
+    //printf("Too new\n");
   
-    thisTime = (*tit);
-    thisPose = (*pit);
-    tit++;
-    pit++;  
-    if (tit == myTimes.end() || pit == myPoses.end())
+    if (myNum < 2)
     {
       //printf("Not enough data\n");
-      myDataMutex.unlock();
       return -3;
     }
-    lastTime = (*tit);
-    lastPose = (*pit);
+    lastTime = internalGetReading(1).getTime();
+    lastPose = internalGetReading(1);
 
     // MPL don't use nowtime, use the time stamp that was passed in...
     //nowTime.setToNow();
@@ -158,7 +208,6 @@ AREXPORT int ArInterpolation::getPose(
       if (myLogPrediction)
 	ArLog::log(ArLog::Normal, "%s: returningPercentage Total time %d, to stamp %d, percentage %.2f (allowed %d)", getName(), total, toStamp, percentage * 100, myAllowedPercentageForPrediction);
       
-      myDataMutex.unlock();
       return -1;
     }
 
@@ -169,7 +218,6 @@ AREXPORT int ArInterpolation::getPose(
       ArLog::log(ArLog::Normal, "%s: returningMS Total time %d, to stamp %d, percentage %.2f (allowed %d)", getName(), total, toStamp, percentage * 100,
 	  myAllowedMSForPrediction);
     
-      myDataMutex.unlock();
       return -1;
     }
 
@@ -192,7 +240,6 @@ AREXPORT int ArInterpolation::getPose(
 
 
     *position = retPose;
-    myDataMutex.unlock();
     return 0;
   }
 
@@ -227,7 +274,6 @@ AREXPORT int ArInterpolation::getPose(
   retPose.log();
 */
   *position = retPose;
-  myDataMutex.unlock();
   return 1;
   
 }
@@ -239,12 +285,26 @@ AREXPORT size_t ArInterpolation::getNumberOfReadings(void) const
 
 AREXPORT void ArInterpolation::setNumberOfReadings(size_t numberOfReadings)
 {
+  std::vector<ArPoseWithTime> readings(numberOfReadings);
+  size_t num;
+  size_t i;
+
   myDataMutex.lock();
-  while (myTimes.size() > numberOfReadings)
-  {
-    myTimes.pop_back();
-    myPoses.pop_back();
-  }
+  // keep the newest ones that fit, oldest first so the newest winds
+  // up last
+  num = myNum;
+  if (num > numberOfReadings)
+    num = numberOfReadings;
+  for (i = 0; i < num; i++)
+    readings[i] = internalGetReading(num - 1 - i);
+  myReadings.swap(readings);
+  myNum = num;
+  if (num > 0)
+    myNewest = num - 1;
+  else if (numberOfReadings > 0)
+    myNewest = numberOfReadings - 1;
+  else
+    myNewest = 0;
   mySize = numberOfReadings;  
   myDataMutex.unlock();
 }
@@ -252,10 +312,7 @@ AREXPORT void ArInterpolation::setNumberOfReadings(size_t numberOfReadings)
 AREXPORT void ArInterpolation::reset(void)
 {
   myDataMutex.lock();
-  while (myTimes.size() > 0)
-    myTimes.pop_back();
-  while (myPoses.size() > 0)
-    myPoses.pop_back();
+  myNum = 0;
   myDataMutex.unlock();
 }
 
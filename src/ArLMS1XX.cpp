@@ -38,10 +38,31 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
   #define IFDEBUG(code)
 #endif
 
+const signed char ArLMS1XXPacket::ourHexValues[256] = {
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
 AREXPORT ArLMS1XXPacket::ArLMS1XXPacket() : 
 ArBasePacket(10000, 1, NULL, 1)
 {
 	myFirstAdd = true;
+	myBinary = false;
+	myLastAddedStr = false;
 	myCommandType[0] = '\0';
 	myCommandName[0] = '\0';
 }
@@ -62,8 +83,42 @@ AREXPORT const char *ArLMS1XXPacket::getCommandName(void)
 }
 
 
+/**
+   Binary packets are four \\002s, the length of the data (4 bytes),
+   the data, then a checksum that's all the data xored together.
+   ASCII ones are just the data between a \\002 and a \\003.
+**/
+AREXPORT void ArLMS1XXPacket::setBinary(bool binary)
+{
+	myBinary = binary;
+	if (myBinary)
+		myHeaderLength = 8;
+	else
+		myHeaderLength = 1;
+	myFooterLength = 1;
+	empty();
+}
+
 AREXPORT void ArLMS1XXPacket::finalizePacket(void)
 {
+	if (myBinary)
+	{
+		ArTypes::UByte4 len = myLength - myHeaderLength;
+		unsigned char checksum = 0;
+		int i;
+		for (i = myHeaderLength; i < myLength; i++)
+			checksum ^= myBuf[i];
+		myBuf[0] = '\002';
+		myBuf[1] = '\002';
+		myBuf[2] = '\002';
+		myBuf[3] = '\002';
+		myBuf[4] = (len >> 24) & 0xff;
+		myBuf[5] = (len >> 16) & 0xff;
+		myBuf[6] = (len >> 8) & 0xff;
+		myBuf[7] = len & 0xff;
+		rawCharToBuf(checksum);
+		return;
+	}
 	myBuf[0] = '\002';
 	rawCharToBuf('\003');
 	myBuf[myLength] = '\0';
@@ -71,7 +126,7 @@ AREXPORT void ArLMS1XXPacket::finalizePacket(void)
 
 AREXPORT void ArLMS1XXPacket::resetRead(void)
 {
-	myReadLength = 1;
+	myReadLength = myHeaderLength;
 
 	myCommandType[0] = '\0';
 	myCommandName[0] = '\0';
@@ -96,6 +151,10 @@ AREXPORT void ArLMS1XXPacket::duplicatePacket(ArLMS1XXPacket *packet)
 	myReadLength = packet->getReadLength();
 	myTimeReceived = packet->getTimeReceived();
 	myFirstAdd = packet->myFirstAdd;
+	myBinary = packet->myBinary;
+	myLastAddedStr = packet->myLastAddedStr;
+	myHeaderLength = packet->myHeaderLength;
+	myFooterLength = packet->myFooterLength;
 	strcpy(myCommandType, packet->myCommandType);
 	strcpy(myCommandName, packet->myCommandName);
 	memcpy(myBuf, packet->getBuf(), myLength);
@@ -103,9 +162,16 @@ AREXPORT void ArLMS1XXPacket::duplicatePacket(ArLMS1XXPacket *packet)
 
 AREXPORT void ArLMS1XXPacket::empty(void)
 {
-	myLength = 0;
+	// binary packets leave room for the header (which finalizePacket
+	// fills in), the ASCII ones put the start char in place of the
+	// first space
+	if (myBinary)
+		myLength = myHeaderLength;
+	else
+		myLength = 0;
 	myReadLength = 0;
 	myFirstAdd = false;
+	myLastAddedStr = false;
 	myCommandType[0] = '\0';
 	myCommandName[0] = '\0';
 }
@@ -113,6 +179,11 @@ AREXPORT void ArLMS1XXPacket::empty(void)
 
 AREXPORT void ArLMS1XXPacket::byteToBuf(ArTypes::Byte val)
 {
+	if (myBinary)
+	{
+		bigEndianToBuf((ArTypes::UByte)val, 1);
+		return;
+	}
 	char buf[1024];
 	if (val > 0)
 		sprintf(buf, "+%d", val);
@@ -123,6 +194,11 @@ AREXPORT void ArLMS1XXPacket::byteToBuf(ArTypes::Byte val)
 
 AREXPORT void ArLMS1XXPacket::byte2ToBuf(ArTypes::Byte2 val)
 {
+	if (myBinary)
+	{
+		bigEndianToBuf((ArTypes::UByte2)val, 2);
+		return;
+	}
 	char buf[1024];
 	if (val > 0)
 		sprintf(buf, "+%d", val);
@@ -133,6 +209,11 @@ AREXPORT void ArLMS1XXPacket::byte2ToBuf(ArTypes::Byte2 val)
 
 AREXPORT void ArLMS1XXPacket::byte4ToBuf(ArTypes::Byte4 val)
 {
+	if (myBinary)
+	{
+		bigEndianToBuf((ArTypes::UByte4)val, 4);
+		return;
+	}
 	char buf[1024];
 	if (val > 0)
 		sprintf(buf, "+%d", val);
@@ -143,6 +224,11 @@ AREXPORT void ArLMS1XXPacket::byte4ToBuf(ArTypes::Byte4 val)
 
 AREXPORT void ArLMS1XXPacket::uByteToBuf(ArTypes::UByte val)
 {
+	if (myBinary)
+	{
+		bigEndianToBuf(val, 1);
+		return;
+	}
 	char buf[1024];
 	sprintf(buf, "%u", val);
 	strToBuf(buf);
@@ -150,12 +236,22 @@ AREXPORT void ArLMS1XXPacket::uByteToBuf(ArTypes::UByte val)
 
 AREXPORT void ArLMS1XXPacket::uByte2ToBuf(ArTypes::UByte2 val)
 {
+	if (myBinary)
+	{
+		bigEndianToBuf(val, 2);
+		return;
+	}
 	uByteToBuf(val & 0xff);
 	uByteToBuf((val >> 8) & 0xff);
 }
 
 AREXPORT void ArLMS1XXPacket::uByte4ToBuf(ArTypes::UByte4 val)
 {
+	if (myBinary)
+	{
+		bigEndianToBuf(val, 4);
+		return;
+	}
 	char buf[1024];
 	sprintf(buf, "%u", val);
 	strToBuf(buf);
@@ -167,7 +263,17 @@ AREXPORT void ArLMS1XXPacket::strToBuf(const char *str)
 		str = "";
 	}
 
-	if (!myFirstAdd && hasWriteCapacity(1))
+	// binary packets only have spaces after strings
+	if (myBinary)
+	{
+		if (myLastAddedStr && hasWriteCapacity(1))
+		{
+			myBuf[myLength] = ' ';
+			myLength++;
+		}
+		myLastAddedStr = true;
+	}
+	else if (!myFirstAdd && hasWriteCapacity(1))
 	{
 		myBuf[myLength] = ' ';
 		myLength++;
@@ -185,10 +291,76 @@ AREXPORT void ArLMS1XXPacket::strToBuf(const char *str)
 	myLength += tempLen;
 }
 
+void ArLMS1XXPacket::bigEndianToBuf(ArTypes::UByte4 val, int size)
+{
+	if (myLastAddedStr && hasWriteCapacity(1))
+	{
+		myBuf[myLength] = ' ';
+		myLength++;
+	}
+	myLastAddedStr = false;
+
+	if (!hasWriteCapacity(size))
+		return;
+	while (size > 0)
+	{
+		size--;
+		myBuf[myLength] = (val >> (size * 8)) & 0xff;
+		myLength++;
+	}
+}
+
+ArTypes::UByte4 ArLMS1XXPacket::bigEndianFromBuf(int size)
+{
+	ArTypes::UByte4 ret = 0;
+	int i;
+
+	if (!isNextGood(size))
+		return 0;
+	for (i = 0; i < size; i++)
+		ret = (ret << 8) | (unsigned char)myBuf[myReadLength + i];
+	myReadLength += size;
+	return ret;
+}
+
+/**
+   This is what the bufToUByte calls use for the ASCII protocol, it
+   goes through the word once with the hex digit table (instead of
+   copying it into a string for strtol).  Like strtol it stops at the
+   first thing that isn't a hex digit, but the whole word is still
+   used up.
+**/
+ArTypes::UByte4 ArLMS1XXPacket::hexWordFromBuf(void)
+{
+	ArTypes::UByte4 ret = 0;
+	signed char digit;
+	bool digits = true;
+
+	if (!isNextGood(1))
+		return 0;
+
+	if (myBuf[myReadLength] == ' ')
+		myReadLength++;
+
+	while (isNextGood(1) && myBuf[myReadLength] != ' ' &&
+			myBuf[myReadLength] != '\003')
+	{
+		if (digits && 
+				(digit = ourHexValues[(unsigned char)myBuf[myReadLength]]) >= 0)
+			ret = (ret << 4) | digit;
+		else
+			digits = false;
+		myReadLength += 1;
+	}
+	return ret;
+}
+
 AREXPORT ArTypes::Byte ArLMS1XXPacket::bufToByte(void)
 {
 	ArTypes::Byte ret=0;
 
+	if (myBinary)
+		return (ArTypes::Byte)bigEndianFromBuf(1);
 
 	if (!isNextGood(1))
 		return 0;
@@ -213,6 +385,9 @@ AREXPORT ArTypes::Byte2 ArLMS1XXPacket::bufToByte2(void)
 {
 	ArTypes::Byte2 ret=0;
 
+	if (myBinary)
+		return (ArTypes::Byte2)bigEndianFromBuf(2);
+
 	if (!isNextGood(1))
 		return 0;
 
@@ -238,6 +413,9 @@ AREXPORT ArTypes::Byte4 ArLMS1XXPacket::bufToByte4(void)
 {
 	ArTypes::Byte4 ret=0;
 
+	if (myBinary)
+		return (ArTypes::Byte4)bigEndianFromBuf(4);
+
 	if (!isNextGood(1))
 		return 0;
 
@@ -265,78 +443,23 @@ AREXPORT ArTypes::Byte4 ArLMS1XXPacket::bufToByte4(void)
 
 AREXPORT ArTypes::UByte ArLMS1XXPacket::bufToUByte(void)
 {
-	ArTypes::UByte ret=0;
-	if (!isNextGood(1))
-		return 0;
-
-	if (myBuf[myReadLength] == ' ')
-		myReadLength++;
-
-	std::string str;
-	while (isNextGood(1) && myBuf[myReadLength] != ' ' &&
-			myBuf[myReadLength] != '\003')
-	{
-		str += myBuf[myReadLength];
-		myReadLength += 1;
-	}
-
-	ret = strtol(str.c_str(), NULL, 16);
-
-	return ret;
+	if (myBinary)
+		return bigEndianFromBuf(1);
+	return hexWordFromBuf();
 }
 
 AREXPORT ArTypes::UByte2 ArLMS1XXPacket::bufToUByte2(void)
 {
-	//printf("@ 1\n");
-
-	ArTypes::UByte2 ret=0;
-
-	if (!isNextGood(1))
-		return 0;
-
-	if (myBuf[myReadLength] == ' ')
-		myReadLength++;
-
-	//printf("@ 2 '%c' %d %d %d %d\n", myBuf[myReadLength], isNextGood(1),
-	// myReadLength, myLength, myFooterLength);
-	std::string str;
-	while (isNextGood(1) && myBuf[myReadLength] != ' ' &&
-			myBuf[myReadLength] != '\003')
-	{
-		//printf("%c\n", myBuf[myReadLength]);
-		str += myBuf[myReadLength];
-		myReadLength += 1;
-	}
-
-
-	ret = strtol(str.c_str(), NULL, 16);
-
-	//printf("@ 3 %d\n", ret);
-	return ret;
+	if (myBinary)
+		return bigEndianFromBuf(2);
+	return hexWordFromBuf();
 }
 
 AREXPORT ArTypes::UByte4 ArLMS1XXPacket::bufToUByte4(void)
 {
-	ArTypes::Byte4 ret=0;
-
-	if (!isNextGood(1))
-		return 0;
-
-	if (myBuf[myReadLength] == ' ')
-		myReadLength++;
-
-	std::string str;
-	while (isNextGood(1) && myBuf[myReadLength] != ' ' &&
-			myBuf[myReadLength] != '\003')
-	{
-		str += myBuf[myReadLength];
-		myReadLength += 1;
-	}
-
-
-	ret = strtol(str.c_str(), NULL, 16);
-
-	return ret;
+	if (myBinary)
+		return bigEndianFromBuf(4);
+	return hexWordFromBuf();
 }
 
 /** 
@@ -365,7 +488,8 @@ AREXPORT void ArLMS1XXPacket::bufToStr(char *buf, int len)
 	if (!isNextGood(1))
 		return;
 
-	if (myBuf[myReadLength] == ' ')
+	// (binary packets use up the space after a string when it's read)
+	if (!myBinary && myBuf[myReadLength] == ' ')
 		myReadLength++;
 
 	// see if we can read
@@ -398,12 +522,143 @@ AREXPORT void ArLMS1XXPacket::bufToStr(char *buf, int len)
 				myReadLength++;
 			}
 		} // end else if output buffer filled before null-terminator
+		if (myBinary && isNextGood(1) && myBuf[myReadLength] == ' ')
+			myReadLength++;
 	} // end if something to read
 
 	// Make absolutely sure that the string is null-terminated...
 	buf[len - 1] = '\0';
 }
 
+/**
+   In ASCII packets this is the same as bufToStr, in binary packets
+   some strings (like the channel names in scans) are a fixed length
+   without anything after them, so this reads that many bytes.
+
+   @param buf where to put the string
+   @param len how long buf is
+   @param binaryLength how long the string is in binary packets
+**/
+AREXPORT void ArLMS1XXPacket::bufToFixedStr(char *buf, int len, 
+					    int binaryLength)
+{
+	int i;
+
+	if (!myBinary)
+	{
+		bufToStr(buf, len);
+		return;
+	}
+	buf[0] = '\0';
+	if (!isNextGood(binaryLength))
+		return;
+	for (i = 0; i < binaryLength && i < len - 1; i++)
+		buf[i] = myBuf[myReadLength + i];
+	buf[i] = '\0';
+	myReadLength += binaryLength;
+}
+
+/*
+  Goes through num hex words in one pass, the words are separated by
+  spaces and the data ends at end.  Anything in a word after the hex
+  digits is skipped (like strtol).  Returns how many words there were.
+*/
+template<class T> 
+static int hexWordsToArray(const signed char *hexValues,
+			   const unsigned char **at, const unsigned char *end,
+			   T *values, int num)
+{
+	const unsigned char *p = *at;
+	ArTypes::UByte4 val;
+	signed char digit;
+	int i;
+
+	for (i = 0; i < num; i++)
+	{
+		while (p < end && *p == ' ')
+			p++;
+		if (p >= end || *p == '\003')
+			break;
+		val = 0;
+		while (p < end && (digit = hexValues[*p]) >= 0)
+		{
+			val = (val << 4) | digit;
+			p++;
+		}
+		while (p < end && *p != ' ' && *p != '\003')
+			p++;
+		values[i] = (T)val;
+	}
+	*at = p;
+	return i;
+}
+
+/**
+   This is for the readings in scans, it gets the same values as
+   calling bufToUByte2 @a num times, but goes through the data once
+   (for ASCII packets with a table of the hex digits, for binary ones
+   just swapping bytes).
+
+   @param values where to put the values (must have room for @a num)
+   @param num how many values to get
+
+   @return how many values were in the packet, the ones after that
+   (if it was short) are 0, like bufToUByte2 would give
+**/
+AREXPORT int ArLMS1XXPacket::bufToUByte2Array(ArTypes::UByte2 *values, 
+					      int num)
+{
+	const unsigned char *p;
+	const unsigned char *end;
+	int ret;
+	int i;
+
+	if (num <= 0)
+		return 0;
+	p = (const unsigned char *)&myBuf[myReadLength];
+	end = (const unsigned char *)&myBuf[myLength - myFooterLength];
+	if (myBinary)
+	{
+		for (ret = 0; ret < num && p + 2 <= end; ret++, p += 2)
+			values[ret] = (p[0] << 8) | p[1];
+	}
+	else
+		ret = hexWordsToArray(ourHexValues, &p, end, values, num);
+	myReadLength = (char *)p - myBuf;
+	for (i = ret; i < num; i++)
+		values[i] = 0;
+	return ret;
+}
+
+/**
+   This is for the 8 bit channels in scans, it gets the same values
+   as calling bufToUByte @a num times (see bufToUByte2Array).
+**/
+AREXPORT int ArLMS1XXPacket::bufToUByteArray(ArTypes::UByte *values, 
+					     int num)
+{
+	const unsigned char *p;
+	const unsigned char *end;
+	int ret;
+	int i;
+
+	if (num <= 0)
+		return 0;
+	p = (const unsigned char *)&myBuf[myReadLength];
+	end = (const unsigned char *)&myBuf[myLength - myFooterLength];
+	if (myBinary)
+	{
+		for (ret = 0; ret < num && p + 1 <= end; ret++, p++)
+			values[ret] = p[0];
+	}
+	else
+		ret = hexWordsToArray(ourHexValues, &p, end, values, num);
+	myReadLength = (char *)p - myBuf;
+	for (i = ret; i < num; i++)
+		values[i] = 0;
+	return ret;
+}
+
 AREXPORT void ArLMS1XXPacket::rawCharToBuf(unsigned char c)
 {
 	if (!hasWriteCapacity(1)) {
@@ -416,19 +671,21 @@ AREXPORT void ArLMS1XXPacket::rawCharToBuf(unsigned char c)
 
 int ArLMS1XXPacket::deascii(char c)
 {
-	if (c >= '0' && c <= '9')
-		return c - '0';
-	else if (c >= 'a' && c <= 'f')
-		return 10 + c - 'a';
-	else if (c >= 'A' && c <= 'F')
-		return 10 + c - 'a';
+	if (ourHexValues[(unsigned char)c] >= 0)
+		return ourHexValues[(unsigned char)c];
 	else
 		return 0;
 }
 
-AREXPORT ArLMS1XXPacketReceiver::ArLMS1XXPacketReceiver()
+AREXPORT ArLMS1XXPacketReceiver::ArLMS1XXPacketReceiver() :
+	myReadBuffer(NULL, 65536)
 {
+	myConn = NULL;
 	myState = STARTING;
+	myNameLength = 0;
+	myName[0] = '\0';
+	myReadTimeout = 5;
+	myInfoLogLevel = ArLog::Verbose;
 }
 
 AREXPORT ArLMS1XXPacketReceiver::~ArLMS1XXPacketReceiver()
@@ -439,6 +696,7 @@ AREXPORT ArLMS1XXPacketReceiver::~ArLMS1XXPacketReceiver()
 AREXPORT void ArLMS1XXPacketReceiver::setDeviceConnection(ArDeviceConnection *conn)
 {
 	myConn = conn;
+	myReadBuffer.setDeviceConnection(myConn);
 }
 
 AREXPORT ArDeviceConnection *ArLMS1XXPacketReceiver::getDeviceConnection(void)
@@ -447,17 +705,31 @@ AREXPORT ArDeviceConnection *ArLMS1XXPacketReceiver::getDeviceConnection(void)
 }
 
 
+/**
+   The data is read in bulk into a ring buffer, then packets are
+   framed by looking for the \\002 that starts them and the \\003
+   that ends them (so a packet is split out of the buffer the same way
+   regardless of how the reads happened to break up, or which laser
+   it is).  Binary (CoLa-B) packets start with four \\002s and are
+   framed by the length after that instead, and are checked with
+   their checksum.
+
+   @param msWait how long to wait for a packet
+
+   @param ignoreRemainders if true then anything read after the end of
+   the packet is thrown away
+**/
 ArLMS1XXPacket *ArLMS1XXPacketReceiver::receivePacket(unsigned int msWait,
 						      bool scandataShortcut,
 						      bool ignoreRemainders)
 {
 	ArLMS1XXPacket *packet;
-	unsigned char c;
 	long timeToRunFor;
 	ArTime timeDone;
-	ArTime lastDataRead;
 	ArTime packetReceived;
 	int numRead;
+	int start;
+	int end;
 	int i;
 
 	//if (myLaserModel == ArLMS1XX::TiM3XX)
@@ -476,258 +748,185 @@ ArLMS1XXPacket *ArLMS1XXPacketReceiver::receivePacket(unsigned int msWait,
 				myName,msWait);
 	}
 
-	do
+	while (true)
 	{
-		timeToRunFor = timeDone.mSecTo();
-		if (timeToRunFor < 0)
-			timeToRunFor = 0;
-
-		//printf("%x\n", c);
-		if (myState == STARTING)
+		// throw out anything before the start of a packet
+		if ((start = myReadBuffer.find('\002')) != 0 &&
+				myReadBuffer.getNumBytes() > 0)
 		{
-			if ((numRead = myConn->read((char *)&c, 1, timeToRunFor)) <= 0) {
-
-				//ArLog::log(ArLog::Terse,
-				//			"%s::receivePacket() Timeout on initial read - read timeout = (%d)",
-				//					myName, timeToRunFor);
-				return NULL;
-
-			}//printf("%x\n", c);
-
-			if (c == '\002')
-			{
-				myState = DATA;
-				myPacket.empty();
-				myPacket.setLength(0);
-				myPacket.rawCharToBuf(c);
-				myReadCount = 0;
-				packetReceived = myConn->getTimeRead(0);
-				myPacket.setTimeReceived(packetReceived);
-			}
-			else
-			{
-				ArLog::log(ArLog::Terse,
-							"%s::receivePacket() Received invalid char during STARTING, looking for 0x02 got 0x%02x %c",
-									myName, c, c);
-			}
+			if (start < 0)
+				start = myReadBuffer.getNumBytes();
+			ArLog::log(ArLog::Terse,
+					"%s::receivePacket() Received %d invalid chars looking for 0x02, first was 0x%02x",
+					myName, start, myReadBuffer.peek(0));
+			myReadBuffer.consume(start);
 		}
-		else if (myState == DATA)
-		{
-			numRead = myConn->read(&myReadBuf[myReadCount],
-					sizeof(myReadBuf) - myReadCount, myReadTimeout);
-
-			// trap if we failed the read
-			if (numRead < 0)
-			{
-				//printf("read failed \n");
-				ArLog::log(ArLog::Normal,
-						"%s::receivePacket() Failed read (%d)",
-						myName,numRead);
-				myState = STARTING;
-				return NULL;
-			}
-			/*
-			ArLog::log(ArLog::Normal, "%s::receivePacket() Read %d bytes",
-					myName,numRead);
-			*/
 
-            IFDEBUG(
-
-			if (numRead != 0)
+		if (myReadBuffer.getNumBytes() > 0)
+		{
+			// binary packets start with four \002s (if all we have so far
+			// is \002s we can't tell which it is yet)
+			for (i = 1; i < 4 && i < myReadBuffer.getNumBytes() &&
+					 myReadBuffer.peek(i) == '\002'; i++)
+				;
+			if (i == 4 && myReadBuffer.getNumBytes() >= 8)
 			{
-
-				// print out using logging
-				int i;
-				char x[100000];
-				x[0] = '\0';
-				int idx=0;
-				strcat(&x[idx],"<STX>");
-				idx = idx+5;
-				for (i = 0;i < numRead;i++)
-				{
-					//
-					if (myReadBuf[i] == '\002')
-					{
-						strcat(&x[idx], "<STX>");
-						idx = idx+5;
-					}
-					else if (myReadBuf[i] == '\003')
-					{
-						strcat(&x[idx], "<ETX>");
-						idx = idx+5;
-					}
-					else
-						sprintf(&x[idx++], "%c",(char *)myReadBuf[i]);
-				}
-
-					ArLog::log(ArLog::Normal,
-							"%s::receivePacket() Buffer with %d bytes = %s", myName, numRead, x);
+				numRead = myReadBuffer.getNumBytes();
+				if ((packet = internalBinaryPacket(ignoreRemainders)) != NULL)
+					return packet;
+				// if it was bad (and the front was thrown out) look again
+				if (myReadBuffer.getNumBytes() != numRead)
+					continue;
 			}
-             ); // end IFDEBUG
-
-			// see if we found the end of the packet
-			for (i = myReadCount; i < myReadCount + numRead; i++)
+			else if (i < 4 && i < myReadBuffer.getNumBytes())
 			{
-				if (myReadBuf[i] == '\002')
+				end = myReadBuffer.find('\003', 1);
+				start = myReadBuffer.find('\002', 1);
+				// if another packet started before this one ended then
+				// this one got hosed, so go with the new one
+				if (start > 0 && (end < 0 || start < end))
 				{
-//					ArLog::log(myInfoLogLevel, "%s::receivePacket() Data found start of new packet...",
 					ArLog::log(myInfoLogLevel, "%s::receivePacket() Data found start of new packet...",
 							myName);
-					myPacket.empty();
-					myPacket.setLength(0);
-					memmove(myReadBuf, &myReadBuf[i], myReadCount + numRead - i);
-					numRead -= (i - myReadCount);
-					myReadCount -= i;
-					i = 0;
+					myReadBuffer.consume(start);
 					continue;
 				}
-				if (myReadBuf[i] == '\003')
+				if (end > 0)
 				{
-
-					myPacket.dataToBuf(myReadBuf, i + 1);
+					// a packet too big to hold is thrown out, and we
+					// look for the start of the next one
+					if (end + 1 > myPacket.getMaxLength())
+					{
+						ArLog::log(ArLog::Normal,
+								"%s::receivePacket() Packet of %d bytes is longer than the maximum of %d, dropping it",
+								myName, end + 1, myPacket.getMaxLength());
+						myReadBuffer.consume(end + 1);
+						continue;
+					}
+					myPacket.empty();
+					myPacket.setLength(0);
+					packetReceived = myReadBuffer.getTimeRead(0);
+					myReadBuffer.copy(myPacket.getBuf(), 0, end + 1);
+					myPacket.setLength(end + 1);
+					myPacket.setTimeReceived(packetReceived);
 					myPacket.resetRead();
+					myReadBuffer.consume(end + 1);
+
 					packet = new ArLMS1XXPacket;
 					packet->duplicatePacket(&myPacket);
 					myPacket.empty();
 					myPacket.setLength(0);
-
-					// if it's the end of the data just go back to the beginning
-					//printf("i=%d, myReadCount = %d, numRead = %d\n",i, myReadCount, numRead);
-
-					if (i == myReadCount + numRead - 1)
-					{
-						//ArLog::log(myLogLevel1XXPacketReceiver: Starting again");
-						myState = STARTING;
-					}
-					// if it isn't move the data up and start again
-					else
-					{
-					  if (!ignoreRemainders)
-					  {
-					    memmove(myReadBuf, &myReadBuf[i+1], myReadCount + numRead - i - 1);
-					    myReadCount = myReadCount + numRead - i - 1;
-					    myState = REMAINDER;
-					    ArLog::log(myInfoLogLevel, "%s::receivePacket() Got remainder, %d bytes beyond one packet ...",
-						       myName,myReadCount);
-					  }
-					  else
-					  {
-					    myState = STARTING;
-					    ArLog::log(myInfoLogLevel, "%s::receivePacket() Got remainder, %d bytes beyond one packet ... ignoring it",
-						       myName,myReadCount);
-					  }
-					}
+					internalRemainder(ignoreRemainders);
 					return packet;
 				}
 			}
-			//printf("didn't get enough bytes\n");
-			myReadCount += numRead;
-			if (numRead != 0)
-				ArLog::log(myInfoLogLevel, "%s::receivePacket() Got %d bytes (but not end char), up to %d",
-						myName, numRead, myReadCount);
-		}
-		else if (myState == REMAINDER)
-		{
-			//printf("In remainder ('%c' %d) \n", myReadBuf[0], myReadBuf[0]);
-			if (myReadBuf[0] != '\002')
+			// if the buffer filled without the end of a packet it
+			// isn't going to come
+			if (myReadBuffer.getNumBytes() >= myReadBuffer.getSize())
 			{
-				ArLog::log(myInfoLogLevel,
-						"%s::receivePacket() Remainder didn't start with \\002, starting over...",myName);
-				myState = STARTING;
+				ArLog::log(ArLog::Normal,
+						"%s::receivePacket() Got %d bytes without an end char, starting over",
+						myName, myReadBuffer.getNumBytes());
+				myReadBuffer.clear();
 				continue;
 			}
 
-			// PS - 9/1/11 not sure why, but for LMS500 this is off by 1 and it dosn't see the <EXT>
-			// and thinks the last
-			// packet does not have the last byte
-			// so for the LMS500 - just use one less byte in the for loop
-
-			int loopcount;
-
-			switch (myLaserModel) {
-
-				case ArLMS1XX::LMS1XX:
-					loopcount = myReadCount - 1;
-				break;
-
-				case ArLMS1XX::TiM3XX:
-				case ArLMS1XX::LMS5XX:
-					loopcount = myReadCount;
-				break;
-			
-			} // end switch laserModel
-
-
-//			if (myIsLMS5XX)
-//				loopcount = myReadCount;
-//			else
-//				loopcount = myReadCount - 1;
-
-			for (i = 0; i < loopcount; i++)
-			//for (i = 0; i < myReadCount - 1; i++)
+			// we're in the middle of a packet so get the rest of it
+			if ((numRead = myReadBuffer.fill(myReadTimeout)) < 0)
 			{
-				//printf("%03d '%c' %d\n", i, myReadBuf[i], myReadBuf[i]);
-				if (myReadBuf[i] == '\002' && i != 0)
-				{
-					ArLog::log(myInfoLogLevel, "%s::receivePacket() Remainder found start of new packet...",
-							myName, myReadCount);
-					myPacket.empty();
-					myPacket.setLength(0);
-					memmove(myReadBuf, &myReadBuf[i], myReadCount + i);
-					myReadCount -= i;
-					i = 0;
-					continue;
-				}
-				if (myReadBuf[i] == '\003')
-				{
-					myPacket.dataToBuf(myReadBuf, i + 1);
-					myPacket.resetRead();
-					packet = new ArLMS1XXPacket;
-					packet->duplicatePacket(&myPacket);
-					myPacket.empty();
-					myPacket.setLength(0);
-
-					// if it's the end of the data just go back to the beginning
-					if (i == myReadCount - 1)
-					{
-						myState = STARTING;
-						ArLog::log(myInfoLogLevel,
-								"%s::receivePacket() Remainder was one packet...",myName);
-					}
-					// if it isn't move the data up and start again
-					else
-					{
-						// PS - took out this printf and replaced with a log
-						if (myReadCount - i < 50)
-							//printf("read buf (%d %d) %s\n", myReadCount, i, myReadBuf);
-						   ArLog::log(ArLog::Terse, "%s::receivePacket() read buf (%d %d) %s",
-								   myName, myReadCount, i, myReadBuf);
-
-						memmove(myReadBuf, &myReadBuf[i+1], myReadCount - i);
-						myReadCount = myReadCount - i - 1;
-						myState = REMAINDER;
-						ArLog::log(myInfoLogLevel,
-								"%s::receivePacket() Remainder was more than one packet... (%d %d)", myName, myReadCount, i);
-					}
-					return packet;
-				}
+				ArLog::log(ArLog::Normal,
+						"%s::receivePacket() Failed read (%d)",
+						myName,numRead);
+				return NULL;
 			}
-			// if we didn't find the end of the packet, then get the rest of the data
-			myState = DATA;
-			ArLog::log(myInfoLogLevel,
-					"%s::receivePacket() Remainder didn't contain a whole packet...",myName);
-
+			if (numRead != 0)
+				ArLog::log(myInfoLogLevel, "%s::receivePacket() Got %d bytes (but not end char), up to %d",
+						myName, numRead, myReadBuffer.getNumBytes());
+			else if (timeDone.mSecTo() < 0)
+				return NULL;
 			continue;
 		}
-		else
+
+		timeToRunFor = timeDone.mSecTo();
+		if (timeToRunFor < 0)
+			timeToRunFor = 0;
+		if (myReadBuffer.fill(timeToRunFor) <= 0)
 		{
-			ArLog::log(ArLog::Terse, "%s::receivePacket() Bad state (%d)",
-					myName,myState);
-			myState = STARTING;
+			//ArLog::log(ArLog::Terse,
+			//			"%s::receivePacket() Timeout on initial read - read timeout = (%d)",
+			//					myName, timeToRunFor);
+			return NULL;
 		}
-	} while (timeDone.mSecTo() >= 0); // || !myStarting)
+	}
+}
 
-	return NULL;
+/**
+   Takes the binary packet at the front of the buffer out if it's all
+   there.  If the packet is bad, its first byte is thrown out.
+**/
+ArLMS1XXPacket *ArLMS1XXPacketReceiver::internalBinaryPacket(
+	bool ignoreRemainders)
+{
+	ArLMS1XXPacket *packet;
+	ArTime packetReceived;
+	long length;
+	unsigned char checksum;
+	int i;
+
+	length = (((long)myReadBuffer.peek(4) << 24) |
+		  ((long)myReadBuffer.peek(5) << 16) |
+		  ((long)myReadBuffer.peek(6) << 8) | (long)myReadBuffer.peek(7));
+	if (8 + length + 1 > myPacket.getMaxLength())
+	{
+		ArLog::log(ArLog::Normal,
+				"%s::receivePacket() Binary packet of %ld bytes is longer than the maximum of %d",
+				myName, length, myPacket.getMaxLength());
+		myReadBuffer.consume(1);
+		return NULL;
+	}
+	if (myReadBuffer.getNumBytes() < 8 + length + 1)
+		return NULL;
+
+	myPacket.setBinary(true);
+	packetReceived = myReadBuffer.getTimeRead(0);
+	myReadBuffer.copy(myPacket.getBuf(), 0, 8 + length + 1);
+	myPacket.setLength(8 + length + 1);
+	myPacket.setTimeReceived(packetReceived);
+	checksum = 0;
+	for (i = 8; i < 8 + length; i++)
+		checksum ^= myPacket.getBuf()[i];
+	if (checksum != (unsigned char)myPacket.getBuf()[8 + length])
+	{
+		ArLog::log(ArLog::Normal,
+				"%s::receivePacket() Bad checksum on binary packet", myName);
+		myPacket.setBinary(false);
+		// only skip the start, in case there's a real packet in what
+		// looked like this one
+		myReadBuffer.consume(1);
+		return NULL;
+	}
+	myPacket.resetRead();
+	myReadBuffer.consume(8 + length + 1);
+	packet = new ArLMS1XXPacket;
+	packet->duplicatePacket(&myPacket);
+	myPacket.setBinary(false);
+	internalRemainder(ignoreRemainders);
+	return packet;
+}
+
+void ArLMS1XXPacketReceiver::internalRemainder(bool ignoreRemainders)
+{
+	if (myReadBuffer.getNumBytes() == 0)
+		return;
+	if (!ignoreRemainders)
+		ArLog::log(myInfoLogLevel, "%s::receivePacket() Got remainder, %d bytes beyond one packet ...",
+				myName, myReadBuffer.getNumBytes());
+	else
+	{
+		ArLog::log(myInfoLogLevel, "%s::receivePacket() Got remainder, %d bytes beyond one packet ... ignoring it",
+				myName, myReadBuffer.getNumBytes());
+		myReadBuffer.clear();
+	}
 }
 
 
@@ -915,6 +1114,7 @@ AREXPORT ArLMS1XX::ArLMS1XX(int laserNumber,
 {
 
 	myLaserModel = laserModel;
+	myUseBinaryProtocol = false;
 
 	clear();
 	myRawReadings = new std::list<ArSensorReading *>;
@@ -1102,6 +1302,7 @@ AREXPORT ArLMS1XX::~ArLMS1XX()
 void ArLMS1XX::clear(void)
 {
 	myIsConnected = false;
+	myUsingBinaryProtocol = false;
 	myTryingToConnect = false;
 	myStartConnect = false;
 
@@ -1407,7 +1608,7 @@ void ArLMS1XX::sensorInterp (void)
 			bool measuringDistance = false;
 			bool measuringReflectance = false;
 			eachChanMeasured[0] = '\0';
-			packet->bufToStr (eachChanMeasured, sizeof (eachChanMeasured));
+			packet->bufToFixedStr (eachChanMeasured, sizeof (eachChanMeasured), 5);
 			if (strcasecmp (eachChanMeasured, "DIST1") == 0)
 				measuringDistance = true;
 			else if (strcasecmp (eachChanMeasured, "RSSI1") == 0)
@@ -1494,6 +1695,14 @@ void ArLMS1XX::sensorInterp (void)
 			}
 			startedProcessing = true;
 			bool ignore;
+			if (measuringDistance) {
+				myScanRanges.resize (eachNumberData);
+				myScanIgnores.resize (eachNumberData);
+			}
+			// decode all the values in one go instead of one at a time
+			myScanValues.resize (eachNumberData);
+			if (eachNumberData > 0)
+				packet->bufToUByte2Array (&myScanValues[0], eachNumberData);
 
 			for (atDeg = start,
 			     it = myRawReadings->begin(),
@@ -1534,13 +1743,8 @@ void ArLMS1XX::sensorInterp (void)
 //	}
 				reading = (*it);
 
-				if (myFirstReadings)
-					reading->resetSensorPosition (ArMath::roundInt (mySensorPose.getX()),
-					                              ArMath::roundInt (mySensorPose.getY()),
-					                              atDeg);
-
 				if (measuringDistance) {
-					dist = packet->bufToUByte2();
+					dist = myScanValues[onReading];
 					// this was the original code, that just ignored 0s as a
 					// reading... however sometimes the sensor reports very close
 					// distances for rays it gets no return on... Sick wasn't very
@@ -1603,10 +1807,11 @@ void ArLMS1XX::sensorInterp (void)
 					  eachChanMeasured, dist);
 					  }
 					*/
-					reading->newData (dist, pose, encoderPose, transform, counter,
-					                  time, ignore, 0); // no reflector yet
+					// the readings are all converted at once after this loop
+					myScanRanges[onReading] = dist;
+					myScanIgnores[onReading] = ignore;
 				} else if (measuringReflectance) {
-					refl = packet->bufToUByte2();
+					refl = myScanValues[onReading];
 					if (refl > 254 * 255) {
 						reading->setExtraInt (refl/255);
 						ArLog::log (ArLog::Normal, "%s: refl at %g of %d (raw %d)", getName(), atDeg, refl/255, refl);
@@ -1617,6 +1822,10 @@ void ArLMS1XX::sensorInterp (void)
 					}
 				}
 			}
+			if (measuringDistance && eachNumberData > 0)
+				laserConvertScan (&myScanRanges[0], &myScanIgnores[0],
+				                  eachNumberData, start, increment, pose,
+				                  encoderPose, transform, counter, time);
 			/*
 			ArLog::log(ArLog::Normal,
 			"Received: %s %s scan %d numReadings %d",
@@ -1626,8 +1835,8 @@ void ArLMS1XX::sensorInterp (void)
 		} // end for 16bit
 
 		// if we processed the readings and they were our first ones set
-		// it so it's not our first ones anymore so that we only do the
-		// sin/cos once
+		// it so it's not our first ones anymore (laserConvertScan keeps
+		// the sin/cos for us)
 		if (startedProcessing && myFirstReadings)
 			myFirstReadings = false;
 		// read the 8 bit channels, that's just reflectance for now
@@ -1638,7 +1847,7 @@ void ArLMS1XX::sensorInterp (void)
 
 		for (i = 0; i < myNumChans8Bit; i++) {
 			eachChanMeasured8Bit[0] = '\0';
-			packet->bufToStr (eachChanMeasured8Bit, sizeof (eachChanMeasured));
+			packet->bufToFixedStr (eachChanMeasured8Bit, sizeof (eachChanMeasured8Bit), 5);
 			/*
 			// for LMS5XX Scaling Factor is a real number
 			if (myIsLMS5XX)
@@ -1677,6 +1886,10 @@ void ArLMS1XX::sensorInterp (void)
 				ArLog::log (ArLog::Normal, "%s: Processing 8bit %s", getName(),
 				            eachChanMeasured8Bit);
 
+			myScanValues8Bit.resize (eachNumberData);
+			if (eachNumberData > 0)
+				packet->bufToUByteArray (&myScanValues8Bit[0], eachNumberData);
+
 			for (atDeg = start,
 			     it = myRawReadings->begin(),
 			     onReading = 0;
@@ -1685,7 +1898,7 @@ void ArLMS1XX::sensorInterp (void)
 			     it++,
 			     onReading++) {
 				reading = (*it);
-				refl = packet->bufToUByte();
+				refl = myScanValues8Bit[onReading];
 				if (refl == 254) {
 					reading->setExtraInt (32);
 					// ArLog::log(ArLog::Normal, "%s: refl at %g of %d", getName(), atDeg, refl);
@@ -1741,6 +1954,52 @@ void ArLMS1XX::sensorInterp (void)
 	*/
 }
 
+/**
+   This only does something if setUseBinaryProtocol(true) was called,
+   in which case it asks the laser for its DeviceIdent with a binary
+   (CoLa-B) telegram.  The laser answers in the protocol it was asked
+   in, so if it answers in binary then the scans are asked for in
+   binary too.  If it doesn't then ASCII is used like normal.
+
+   @return true if the binary protocol will be used
+**/
+bool ArLMS1XX::negotiateBinaryProtocol(ArTime timeDone)
+{
+	ArLMS1XXPacket sendPacket;
+	ArLMS1XXPacket *packet;
+	ArTime timeout;
+
+	myUsingBinaryProtocol = false;
+	// the TiM3XX is serial and has its own checksum in the ASCII scans
+	if (!myUseBinaryProtocol || myLaserModel == ArLMS1XX::TiM3XX)
+		return false;
+
+	// don't wait long, since it just means using ASCII
+	if (!timeout.addMSec(3000) || timeDone.isBefore(timeout))
+		timeout = timeDone;
+
+	sendPacket.setBinary(true);
+	sendPacket.strToBuf("sRN");
+	sendPacket.strToBuf("DeviceIdent");
+	sendPacket.finalizePacket();
+
+	if ((packet = sendAndRecv(timeout, &sendPacket, "DeviceIdent")) != NULL &&
+			packet->isBinary())
+	{
+		ArLog::log(ArLog::Normal, 
+				"%s::negotiateBinaryProtocol() Laser answered in binary, will use binary (CoLa-B) scans",
+				getName());
+		myUsingBinaryProtocol = true;
+	}
+	else
+		ArLog::log(ArLog::Normal, 
+				"%s::negotiateBinaryProtocol() Laser did not answer in binary, will use ASCII (CoLa-A) scans",
+				getName());
+	if (packet != NULL)
+		delete packet;
+	return myUsingBinaryProtocol;
+}
+
 AREXPORT ArLMS1XXPacket *ArLMS1XX::sendAndRecv(
 		ArTime timeout, ArLMS1XXPacket *sendPacket, const char *recvName)
 {
@@ -2362,6 +2621,9 @@ AREXPORT bool ArLMS1XX::lms5xxConnect(void)
 			return false;			
 		}
 
+		// see if the laser will send the scans in binary
+		negotiateBinaryProtocol(timeDone);
+		sendPacket.setBinary(myUsingBinaryProtocol);
 		sendPacket.empty();
 		sendPacket.strToBuf("sEN");
 		sendPacket.strToBuf("LMDscandata");
@@ -2686,6 +2948,9 @@ AREXPORT bool ArLMS1XX::lms1xxConnect(void)
   }
 		 */
 
+		// see if the laser will send the scans in binary
+		negotiateBinaryProtocol(timeDone);
+		sendPacket.setBinary(myUsingBinaryProtocol);
 		sendPacket.empty();
 		sendPacket.strToBuf("sEN");
 		sendPacket.strToBuf("LMDscandata");
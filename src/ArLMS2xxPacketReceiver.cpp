@@ -44,6 +44,7 @@ AREXPORT ArLMS2xxPacketReceiver::ArLMS2xxPacketReceiver(
   myReceivingAddress = receivingAddress;
   myDeviceConn = NULL;
   myUseBase0Address = useBase0Address;
+  myReadBuffer.setDeviceConnection(myDeviceConn);
 }
 
 /*
@@ -61,6 +62,7 @@ AREXPORT ArLMS2xxPacketReceiver::ArLMS2xxPacketReceiver(
   myAllocatePackets = allocatePackets;
   myReceivingAddress = receivingAddress;
   myUseBase0Address = useBase0Address;
+  myReadBuffer.setDeviceConnection(myDeviceConn);
 }
 
 AREXPORT ArLMS2xxPacketReceiver::~ArLMS2xxPacketReceiver() 
@@ -72,6 +74,7 @@ AREXPORT void ArLMS2xxPacketReceiver::setDeviceConnection(
 	ArDeviceConnection *deviceConnection)
 {
   myDeviceConn = deviceConnection;
+  myReadBuffer.setDeviceConnection(myDeviceConn);
 }
 
 AREXPORT ArDeviceConnection *ArLMS2xxPacketReceiver::getDeviceConnection(void)
@@ -93,24 +96,19 @@ AREXPORT ArLMS2xxPacket *ArLMS2xxPacketReceiver::receivePacket(
 {
   ArLMS2xxPacket *packet;
   unsigned char c;
-  char buf[2048];
-  long count = 0;
-  // state can be one of the STATE_ enums in the class
-  int state = STATE_START;
-  //unsigned int timeDone;
-  //unsigned int curTime;
+  int start;
+  int numRead;
   long timeToRunFor;
   long packetLength;
   ArTime timeDone;
   ArTime lastDataRead;
   ArTime packetReceived;
-  int numRead;
-
 
   if (myDeviceConn == NULL || 
       myDeviceConn->getStatus() != ArDeviceConnection::STATUS_OPEN)
   {
-    myDeviceConn->debugEndPacket(false, -10);
+    if (myDeviceConn != NULL)
+      myDeviceConn->debugEndPacket(false, -10);
     return NULL;
   }
   
@@ -120,154 +118,112 @@ AREXPORT ArLMS2xxPacket *ArLMS2xxPacketReceiver::receivePacket(
                "ArLMS2xxPacketReceiver::receivePacket() error adding msecs (%i)",
                msWait);
   }
-  do
-  {
-    timeToRunFor = timeDone.mSecTo();
-    if (timeToRunFor < 0)
-      timeToRunFor = 0;
 
-    if (state == STATE_START)
-      myDeviceConn->debugStartPacket();
+  myDeviceConn->debugStartPacket();
+  // if there's part of a packet left from before, it's been waiting
+  // since it was read
+  if (myReadBuffer.getNumBytes() > 0)
+    lastDataRead = myReadBuffer.getTimeRead(myReadBuffer.getNumBytes() - 1);
+  while (true)
+  {
+    // throw out anything before the start of a packet
+    if ((start = myReadBuffer.find(0x02)) != 0)
+      myReadBuffer.consume(start < 0 ? myReadBuffer.getNumBytes() : start);
 
-    if (myDeviceConn->read((char *)&c, 1, timeToRunFor) == 0) 
+    if (myReadBuffer.getNumBytes() >= 2)
     {
-      myDeviceConn->debugBytesRead(0);
-      if (state == STATE_START)
-      {
-	myDeviceConn->debugEndPacket(false, -20);
-	return NULL;
-      }
-      else
-      {
-	//ArUtil::sleep(1);
-	continue;
-      }
-    }
-
-    myDeviceConn->debugBytesRead(1);
-
-    //printf("%x\n", c);
-    switch (state) {
-    case STATE_START:
-      if (c == 0x02) // move on, resetting packet
-      {
-	//printf("###############\n");
-	state = STATE_ADDR;
-	myPacket.empty();
-	myPacket.setLength(0);
-	myPacket.uByteToBuf(c);
-	packetReceived = myDeviceConn->getTimeRead(0);
-	myPacket.setTimeReceived(packetReceived);
-      }
-      /*else
-      {
-	//printf(" BAD\n");
-	}*/
-      break;
-    case STATE_ADDR:
-      // if this is correct move on, adding this byte... this is taken
-      // out in favor of a more inclusive approach, if someone ever
-      // wnats to drive multiple robots off of one serial port just
-      // put this back in, or I don't know, punt
-      //if (c == ((unsigned char)0x80 + myReceivingAddress)) 
-      if (!myUseBase0Address && c >= 0x80 && c <= 0x84)
-      {
-	state = STATE_START_COUNT;
-	myPacket.uByteToBuf(c);
-      }
-      // c will always be >= 0 since its unsigned
-      else if (myUseBase0Address && c <= 0x4)
-      {
-	state = STATE_START_COUNT;
-	myPacket.uByteToBuf(c);
-      }
-      else // go back to beginning, packet hosed
+      c = myReadBuffer.peek(1);
+      // if this is correct move on... checking for our own receiving
+      // address is left out in favor of a more inclusive approach, if
+      // someone ever wants to drive multiple lasers off of one serial
+      // port just put that back in, or I don't know, punt
+      // (c will always be >= 0 since its unsigned)
+      if (!((!myUseBase0Address && c >= 0x80 && c <= 0x84) ||
+	    (myUseBase0Address && c <= 0x4)))
       {
 	ArLog::log(ArLog::Terse, 
 		   "ArLMS2xxPacketReceiver::receivePacket: wrong address (0x%x instead of 0x%x)", c, (unsigned) 0x80 + myReceivingAddress);
-	state = STATE_START;
+	// go back to beginning, packet hosed
+	myReadBuffer.consume(1);
+	continue;
       }
-      break;
-    case STATE_START_COUNT:
-      packetLength = c;
-      myPacket.uByteToBuf(c);
-      state = STATE_ACQUIRE_DATA;
-      break;
-    case STATE_ACQUIRE_DATA:
-      // the character c is high ordre byte of the packet length count 
-      // so we'll just build the length of the packet then get the 
-      //rest of the data
-      myPacket.uByteToBuf(c);
-      packetLength = packetLength | (c << 8);
-      count = 0;
-      // make sure the length isn't longer than the maximum packet length...
-      // getting some wierd 25k or 44k long packets (um, no)
-      if (packetLength > ((long)myPacket.getMaxLength() -
-			  (long)myPacket.getHeaderLength()))
+    }
+    if (myReadBuffer.getNumBytes() >= 4)
+    {
+      packetLength = myReadBuffer.peek(2) | (myReadBuffer.peek(3) << 8);
+      // make sure the length isn't longer than the maximum packet
+      // length (with the header and crc)... getting some wierd 25k or
+      // 44k long packets (um, no)
+      if (packetLength + 2 > ((long)myPacket.getMaxLength() -
+			      (long)myPacket.getHeaderLength()))
       {
 	ArLog::log(ArLog::Normal, 
 	   "ArLMS2xxPacketReceiver::receivePacket: packet too long, it is %d long while the maximum is %d.", packetLength, myPacket.getMaxLength());
-	state = STATE_START;
-	//myPacket.log();
-	break;
+	myReadBuffer.consume(1);
+	continue;
       }
-      // here we read until we get as much as we want, OR until
-      // we go 100 ms without data... its arbitrary but it doesn't happen often
-      // and it'll mean a bad packet anyways
-      lastDataRead.setToNow();
-      while (count < packetLength + 2)
+      // the header, the data, then the two byte crc
+      if (myReadBuffer.getNumBytes() >= 4 + packetLength + 2)
       {
-	numRead = myDeviceConn->read(buf + count, packetLength + 2- count, 1);
-	if (numRead > 0)
-	{	
-	  myDeviceConn->debugBytesRead(numRead);
-	  lastDataRead.setToNow();
-	}
-	else
-	{
-	  myDeviceConn->debugBytesRead(0);
-	}
-	if (lastDataRead.mSecTo() < -100)
+	myPacket.empty();
+	myPacket.setLength(0);
+	packetReceived = myReadBuffer.getTimeRead(0);
+	myPacket.setTimeReceived(packetReceived);
+	myReadBuffer.copy(myPacket.getBuf(), 0, 4 + packetLength + 2);
+	myPacket.setLength(4 + packetLength + 2);
+	if (myPacket.verifyCRC()) 
 	{
-	  myDeviceConn->debugEndPacket(false, -30);
-	  return NULL;
+	  myReadBuffer.consume(4 + packetLength + 2);
+	  myPacket.resetRead();
+	  myDeviceConn->debugEndPacket(true, myPacket.getID());
+	  //printf("Received ");
+	  //myPacket.log();
+	  if (myAllocatePackets)
+	  {
+	    packet = new ArLMS2xxPacket;
+	    packet->duplicatePacket(&myPacket);
+	    return packet;
+	  }
+	  else
+	    return &myPacket;
 	}
-	count += numRead;
-      }
-      myPacket.dataToBuf(buf, packetLength + 2);
-      if (myPacket.verifyCRC()) 
-      {
-	myPacket.resetRead();
-	myDeviceConn->debugEndPacket(true, myPacket.getID());
-	//printf("Received ");
-	//myPacket.log();
-	if (myAllocatePackets)
+	else 
 	{
-	  packet = new ArLMS2xxPacket;
-	  packet->duplicatePacket(&myPacket);
-	  return packet;
+	  ArLog::log(ArLog::Normal, 
+	     "ArLMS2xxPacketReceiver::receivePacket: bad packet, bad checksum");
+	  // only skip the start, since a real packet might be inside
+	  // what looked like this one
+	  myReadBuffer.consume(1);
+	  myDeviceConn->debugStartPacket();
+	  continue;
 	}
-	else
-	  return &myPacket;
       }
-      else 
+    }
+
+    // we need more data, if we're in the middle of a packet wait for
+    // the rest of it, unless we go 100 ms without data... its
+    // arbitrary but it doesn't happen often and it'll mean a bad
+    // packet anyways
+    if (myReadBuffer.getNumBytes() > 0)
+    {
+      if ((numRead = myReadBuffer.fill(1)) > 0)
+	lastDataRead.setToNow();
+      else if (numRead < 0 || lastDataRead.mSecTo() < -100)
       {
-	ArLog::log(ArLog::Normal, 
-	   "ArLMS2xxPacketReceiver::receivePacket: bad packet, bad checksum");
-	state = STATE_START;
-	//myPacket.log();
-	break;
+	myDeviceConn->debugEndPacket(false, -30);
+	return NULL;
       }
-      break;
-    default:
-      break;
+      continue;
     }
-  } while (timeDone.mSecTo() >= 0 || state != STATE_START);
-
-  myDeviceConn->debugEndPacket(false, -40);
-  //printf("finished the loop...\n");
-  return NULL;
-
+    timeToRunFor = timeDone.mSecTo();
+    if (timeToRunFor < 0)
+      timeToRunFor = 0;
+    if ((numRead = myReadBuffer.fill(timeToRunFor)) <= 0)
+    {
+      myDeviceConn->debugBytesRead(0);
+      myDeviceConn->debugEndPacket(false, numRead < 0 ? -20 : -40);
+      return NULL;
+    }
+    lastDataRead.setToNow();
+  }
 }
-
-
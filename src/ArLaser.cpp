@@ -67,6 +67,13 @@ AREXPORT ArLaser::ArLaser(
 
   myHaveSensorPose = false;
 
+  myScanTableValid = false;
+  myScanTableNumReadings = 0;
+  myScanTableStart = 0;
+  myScanTableIncrement = 0;
+  myScanTableSensorX = 0;
+  myScanTableSensorY = 0;
+
   myFlipped = false;
   myFlippedSet = false;
 
@@ -216,6 +223,13 @@ void ArLaser::laserProcessReadings(void)
 	  myRawReadings->front()->getEncoderPoseTaken());
   myCurrentBuffer.beginRedoBuffer();	  
 
+  // the readings that go into the cumulative buffer all get the time
+  // from one read of the clock (see ArTime::setToCachedNow), if
+  // we're being called from a thread that already caches the time
+  // (like the robot's) leave it cached when we're done
+  bool hadCachedNow = ArTime::hasCachedNow();
+  ArTime::refreshCachedNow();
+
   // walk the buffer of all the readings and see if we want to add them
   for (sensIt = myRawReadings->begin(); 
        sensIt != myRawReadings->end(); 
@@ -299,6 +313,8 @@ void ArLaser::laserProcessReadings(void)
     //i++;
   }
   myCurrentBuffer.endRedoBuffer();
+  if (!hadCachedNow)
+    ArTime::clearCachedNow();
   /*  Put this in to see how long the cumulative filtering is taking  
   if (clean)
     printf("### %ld %d\n", len.mSecSince(), myCumulativeBuffer.getBuffer()->size());
@@ -306,6 +322,123 @@ void ArLaser::laserProcessReadings(void)
   internalGotReading();
 }
 
+/**
+   This is for subclasses that get a whole scan of ranges at once, it
+   does the same thing as calling ArSensorReading::resetSensorPosition
+   and ArSensorReading::newData on each of the raw readings, but much
+   more quickly.  The cos and sin of the angle of each beam are found
+   once and kept until the scan's angles or the sensor position
+   change, and the whole scan is then converted into local and global
+   coordinates in a couple of loops over plain arrays (that the
+   compiler can vectorize).
+
+   Raw readings are created if there aren't enough, and the
+   ArSensorReading::getSensorPosition of each reading is set to the
+   sensor position (with its x and y rounded to the mm) and beam
+   angle.  The extra int of each reading is set to 0.
+
+   @param ranges the range of each beam in mm
+
+   @param ignore if this isn't NULL a nonzero value means that
+   reading should be ignored
+
+   @param numReadings the number of ranges
+
+   @param startAngle the angle of the first beam relative to the robot
+   (so including the heading the sensor is mounted at)
+
+   @param increment the angle between each beam (negative if the
+   laser is flipped)
+
+   @param robotPose the robot's pose when the scan was taken
+
+   @param encoderPose the robot's encoder pose when the scan was taken
+
+   @param transform the transform from robot to global coordinates
+   when the scan was taken
+
+   @param counter the robot's counter when the scan was taken
+   
+   @param timeTaken the time the scan was taken
+**/
+AREXPORT void ArLaser::laserConvertScan(const int *ranges, const char *ignore,
+					int numReadings, double startAngle,
+					double increment, ArPose robotPose,
+					ArPose encoderPose, 
+					ArTransform transform,
+					unsigned int counter, ArTime timeTaken)
+{
+  std::list<ArSensorReading *>::iterator it;
+  double sensorX = ArMath::roundInt(mySensorPose.getX());
+  double sensorY = ArMath::roundInt(mySensorPose.getY());
+  bool resetSensorPositions = false;
+  int i;
+
+  if (myRawReadings == NULL || numReadings <= 0)
+    return;
+
+  while (myRawReadings->size() < (size_t)numReadings)
+  {
+    myRawReadings->push_back(new ArSensorReading);
+    resetSensorPositions = true;
+  }
+
+  // make the tables if the angles changed
+  if (!myScanTableValid || myScanTableNumReadings != numReadings || 
+      fabs(myScanTableStart - startAngle) > .00001 ||
+      fabs(myScanTableIncrement - increment) > .00001 ||
+      myScanTableSensorX != sensorX || myScanTableSensorY != sensorY)
+  {
+    myScanCos.resize(numReadings);
+    myScanSin.resize(numReadings);
+    myScanDoubleRanges.resize(numReadings);
+    myScanLocalX.resize(numReadings);
+    myScanLocalY.resize(numReadings);
+    myScanX.resize(numReadings);
+    myScanY.resize(numReadings);
+    for (i = 0; i < numReadings; i++)
+    {
+      myScanCos[i] = ArMath::cos(startAngle + i * increment);
+      myScanSin[i] = ArMath::sin(startAngle + i * increment);
+    }
+    myScanTableValid = true;
+    myScanTableNumReadings = numReadings;
+    myScanTableStart = startAngle;
+    myScanTableIncrement = increment;
+    myScanTableSensorX = sensorX;
+    myScanTableSensorY = sensorY;
+    resetSensorPositions = true;
+  }
+
+  const double *scanCos = &myScanCos[0];
+  const double *scanSin = &myScanSin[0];
+  double *scanRanges = &myScanDoubleRanges[0];
+  double *localX = &myScanLocalX[0];
+  double *localY = &myScanLocalY[0];
+
+  for (i = 0; i < numReadings; i++)
+    scanRanges[i] = ranges[i];
+  for (i = 0; i < numReadings; i++)
+  {
+    localX[i] = sensorX + scanRanges[i] * scanCos[i];
+    localY[i] = sensorY + scanRanges[i] * scanSin[i];
+  }
+  transform.doTransform(localX, localY, &myScanX[0], &myScanY[0], 
+			numReadings);
+
+  double th = ArMath::addAngle(0, transform.getTh());
+  for (i = 0, it = myRawReadings->begin(); 
+       i < numReadings && it != myRawReadings->end(); 
+       i++, ++it)
+  {
+    if (resetSensorPositions)
+      (*it)->resetSensorPosition(sensorX, sensorY, 
+				 startAngle + i * increment);
+    (*it)->newData(ranges[i], localX[i], localY[i], myScanX[i], myScanY[i],
+		   th, robotPose, encoderPose, counter, timeTaken,
+		   ignore != NULL && ignore[i] != 0, 0);
+  }
+}
 
 void ArLaser::internalProcessReading(double x, double y, 
 				     unsigned int range, bool clean,
@@ -328,7 +461,7 @@ void ArLaser::internalProcessReading(double x, double y,
   double xTaken = myCurrentBuffer.getPoseTaken().getX();
   double yTaken = myCurrentBuffer.getPoseTaken().getY();
   ArPose intersection;
-  ArPoseWithTime reading(x, y);
+  ArPoseWithTime reading(x, y, 0, ArTime::INIT_NONE);
 
   // if we're not cleaning and its further than we're keeping track of
   // readings ignore it... replaced with the part thats 'until here'
@@ -787,6 +920,7 @@ AREXPORT void ArLaser::setSensorPosition(ArPose pose, double z)
   myHaveSensorPose = true;
   mySensorPose.setPose(pose);
   mySensorZ = z;
+  myScanTableValid = false;
 }
 
 bool ArLaser::internalCheckChoice(const char *check, const char *choice, 
@@ -935,6 +1069,7 @@ AREXPORT bool ArLaser::setStartDegrees(double startDegrees)
   }
   myStartDegreesSet = true;
   myStartDegrees = startDegrees;
+  myScanTableValid = false;
   return true;
 }
     
@@ -1006,6 +1141,7 @@ AREXPORT bool ArLaser::chooseDegrees(
 
   myDegreesChoice = degreesChoice;
   myDegreesChoiceDouble = degreesChoiceDouble;
+  myScanTableValid = false;
   return true;      
 }
 
@@ -1051,6 +1187,7 @@ AREXPORT bool ArLaser::setIncrement(double increment)
   }
   myIncrementSet = true;
   myIncrement = increment;
+  myScanTableValid = false;
   return true;
 }
 
@@ -1094,6 +1231,7 @@ AREXPORT bool ArLaser::chooseIncrement(const char *incrementChoice)
     return false;
   myIncrementChoice = incrementChoice;
   myIncrementChoiceDouble = incrementChoiceDouble;
+  myScanTableValid = false;
   return true;      
 }
 
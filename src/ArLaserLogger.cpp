@@ -34,6 +34,13 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ArRobotJoyHandler.h"
 #include "ariaInternal.h"
 
+/// The first line of a binary laser log
+static const char *ourBinaryMagic = "ArLaserLogBinary 1";
+/// How many records can wait for the writer before scans are dropped
+static const int ourMaxQueuedRecords = 1000;
+/// How many scans go between the indexes in the binary log
+static const int ourScansPerIndex = 100;
+
 
 /** @page LaserLogFileFormat Laser Scan Log File Format 
  *
@@ -151,6 +158,52 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
  *  etc.).  This goal will be added to the final map at the position of the
  *  robot to define a goal or other point of interest in the map.
  *
+ *  The log ends with a <code>\# End of log</code> comment line.
+ *
+ *  @section LaserLogBinaryFormat Binary Format
+ *
+ *  ArLaserLogger can also write the log in a binary format, which is
+ *  much smaller and cheaper to write than the text (which matters
+ *  with lasers that give many readings quickly).
+ *  ArLaserLogger::convertBinaryToText() turns a binary log into the
+ *  text format above, which is what other software expects.
+ *
+ *  The binary file starts with the line <code>ArLaserLogBinary 1</code>,
+ *  after which comes a series of records.  Each record is a 4 byte
+ *  length followed by that many bytes of data, the first byte of which
+ *  is the type of the record (ArLaserLogger::BinaryRecordType).  All
+ *  numbers are little endian, strings are null terminated, and
+ *  positions are given as three 4 byte integers (X and Y in mm, and
+ *  Theta in hundredths of a degree).  The records are:
+ *
+ *  <ul>
+ *  <li> TEXT: a string, which is a line of the text format (the header
+ *  and information added with ArLaserLogger::addInfoToLog)
+ *  <li> TAG: the time (4 bytes, in ms), the positions, then a string
+ *  which is a tag added with ArLaserLogger::addTagToLog
+ *  <li> SCAN_SET: the time (4 bytes, in ms) then the velocity,
+ *  rotational velocity and lateral velocity (4 bytes each, in
+ *  hundredths); this starts a set of scans taken at the same time
+ *  <li> SCAN: the scan id (4 bytes), the positions, the laser number
+ *  (1 byte), which kinds of data follow (1 byte: 1 for reflector values,
+ *  2 for sick1 ranges, 4 for scan points, 8 if the values are 4 bytes
+ *  instead of 2), the number of readings (2 bytes), and then for each
+ *  kind of data the values for every reading
+ *  <li> INDEX: the offset of the previous index (4 bytes, -1 if there
+ *  is none), the number of entries (4 bytes) then for each entry a
+ *  scan id and the offset in the file of the SCAN record for it (4
+ *  bytes each)
+ *  <li> END: the offset of the last index (4 bytes)
+ *  </ul>
+ *
+ *  The positions are the robot (encoder) position, the robotGlobal
+ *  position, a byte that is 1 if a robotRaw position follows, and
+ *  then a byte with how many extra positions follow, each of which
+ *  is its name (a string), a byte that is 1 if it was valid, and the
+ *  position (only if it was valid).
+ *
+ *  The index chain can be followed from the END record (see
+ *  ArLaserLogger::readBinaryIndex()) to seek straight to a scan.
  */
 
 /**
@@ -195,6 +248,8 @@ joystick
 output log file 
   @param extraLasers if given, include data from these lasers in the laser log in addition
 to the primary laser @a laser.
+  @param binaryFile if true write the log in the binary format (see
+@ref LaserLogFileFormat) instead of text
 **/
 AREXPORT ArLaserLogger::ArLaserLogger(
 	ArRobot *robot, ArLaser *laser, 
@@ -205,11 +260,14 @@ AREXPORT ArLaserLogger::ArLaserLogger(
 	const std::map<std::string, 
 		       ArRetFunctor3<int, ArTime, ArPose *, ArPoseWithTime *> *, 
 		       ArStrCaseCmpOp> *extraLocationData,
-	std::list<ArLaser *> *extraLasers) :
+	std::list<ArLaser *> *extraLasers,
+	bool binaryFile) :
   mySectors(18), 
   myTaskCB(this, &ArLaserLogger::robotTask),
   myGoalKeyCB(this, &ArLaserLogger::goalKeyCallback), 
-  myLoopPacketHandlerCB(this, &ArLaserLogger::loopPacketHandler)
+  myLoopPacketHandlerCB(this, &ArLaserLogger::loopPacketHandler),
+  myWriterCB(this, &ArLaserLogger::writerThread),
+  myRecord(65535)
 {
   ArKeyHandler *keyHandler;
 
@@ -245,7 +303,34 @@ AREXPORT ArLaserLogger::ArLaserLogger(
 
 
 
-  myFile = ArUtil::fopen(realFileName.c_str(), "w+");
+  myBinaryFile = binaryFile;
+  myQueueLength = 0;
+  myNumDropped = 0;
+  myDroppingScanSet = false;
+  myNumDroppedInRow = 0;
+  myWriterRunning = false;
+  myFileOffset = 0;
+  myLastIndexOffset = -1;
+
+  if (myBinaryFile)
+    myFile = ArUtil::fopen(realFileName.c_str(), "wb+");
+  else
+    myFile = ArUtil::fopen(realFileName.c_str(), "w+");
+
+  if (myFile != NULL)
+  {
+    if (myBinaryFile)
+    {
+      fprintf(myFile, "%s\n", ourBinaryMagic);
+      myFileOffset = ftell(myFile);
+    }
+    myWriterRunning = true;
+    if (myWriterThread.create(&myWriterCB, true, false) != 0)
+    {
+      ArLog::log(ArLog::Terse, "ArLaserLogger could not start its writer thread");
+      myWriterRunning = false;
+    }
+  }
 
   if (laser->getLaserNumber() != 1 && 
       extraLasers != NULL && !extraLasers->empty())
@@ -265,9 +350,9 @@ AREXPORT ArLaserLogger::ArLaserLogger(
   {
     //const ArRobotParams *params;
     //params = robot->getRobotParams();
-    fprintf(myFile, "LaserOdometryLog\n");
-    fprintf(myFile, "#Created by ArLaserLogger\n");
-    fprintf(myFile, "version: 4\n");
+    internalAddText("LaserOdometryLog");
+    internalAddText("#Created by ArLaserLogger");
+    internalAddText("version: 4");
 
     std::list<ArLaser *>::iterator laserIt;
     for (laserIt = myLasers.begin(); laserIt != myLasers.end(); laserIt++)
@@ -291,7 +376,7 @@ AREXPORT ArLaserLogger::ArLaserLogger(
 	 it++)
       available += " " + (*it).first;
 
-    fprintf(myFile, "locationTypes: %s\n", available.c_str());
+    internalAddText("locationTypes: %s", available.c_str());
   }
   else
   {
@@ -348,9 +433,482 @@ AREXPORT ArLaserLogger::~ArLaserLogger()
   myRobot->comStr(94, "");
   if (myFile != NULL)
   {
-    fprintf(myFile, "# End of log\n");
+    if (myWriterRunning)
+    {
+      // the writer puts out the last index and the end when it gets this
+      myRecord.empty();
+      myRecord.uByteToBuf(BINARY_END);
+      internalQueueRecord(&myRecord);
+      myQueueMutex.lock();
+      myWriterRunning = false;
+      myQueueMutex.unlock();
+      myQueueCondition.signal();
+      myWriterThread.join();
+    }
     fclose(myFile);
+    if (myNumDropped > 0)
+      ArLog::log(ArLog::Normal, 
+		 "ArLaserLogger: %ld sets of scans were dropped from %s because writing fell behind",
+		 myNumDropped, myFileName.c_str());
+  }
+  while (!myQueue.empty())
+  {
+    delete myQueue.front();
+    myQueue.pop_front();
+  }
+}
+
+/**
+   @return how many sets of scans haven't made it into the file
+   because the thread writing the file had too many records waiting
+   to be written
+**/
+AREXPORT long ArLaserLogger::getNumDropped(void)
+{
+  long ret;
+  myQueueMutex.lock();
+  ret = myNumDropped;
+  myQueueMutex.unlock();
+  return ret;
+}
+
+void ArLaserLogger::internalAddText(const char *str, ...)
+{
+  char buf[2048];
+  va_list ptr;
+  va_start(ptr, str);
+  vsnprintf(buf, sizeof(buf), str, ptr);
+  buf[sizeof(buf) - 1] = '\0';
+  va_end(ptr);
+
+  myRecord.empty();
+  myRecord.uByteToBuf(BINARY_TEXT);
+  myRecord.strToBuf(buf);
+  internalQueueRecord(&myRecord);
+}
+
+void ArLaserLogger::internalQueueRecord(ArBasePacket *record)
+{
+  if (!record->isValid())
+  {
+    ArLog::log(ArLog::Normal, "ArLaserLogger: Record of type %d is too big to log", 
+	       (unsigned char)record->getBuf()[0]);
+    return;
+  }
+
+  myQueueMutex.lock();
+  if (!myWriterRunning)
+  {
+    myQueueMutex.unlock();
+    return;
+  }
+  // don't let the writer get too far behind (it's better to lose
+  // some data than to slow down the robot), but only scans are
+  // dropped and a set of them is dropped whole (or the log would have
+  // a scan set without all of its scans), so whether to drop is
+  // decided at the start of each set and its scans follow that
+  unsigned char type = record->getBuf()[0];
+  if (type == BINARY_SCAN_SET)
+  {
+    if (myQueueLength >= ourMaxQueuedRecords)
+    {
+      myDroppingScanSet = true;
+      myNumDropped++;
+      myNumDroppedInRow++;
+      if (myNumDroppedInRow == 1)
+	ArLog::log(ArLog::Normal, 
+		   "ArLaserLogger: Writing to %s is behind, dropping scans",
+		   myFileName.c_str());
+    }
+    else
+    {
+      myDroppingScanSet = false;
+      if (myNumDroppedInRow > 0)
+	ArLog::log(ArLog::Normal, 
+		   "ArLaserLogger: Writing to %s caught up after dropping %ld sets of scans (%ld total)",
+		   myFileName.c_str(), myNumDroppedInRow, myNumDropped);
+      myNumDroppedInRow = 0;
+    }
+  }
+  if (myDroppingScanSet && (type == BINARY_SCAN_SET || type == BINARY_SCAN))
+  {
+    myQueueMutex.unlock();
+    return;
+  }
+  myQueue.push_back(new ArBasePacket(*record));
+  myQueueLength++;
+  myQueueMutex.unlock();
+  myQueueCondition.signal();
+}
+
+void ArLaserLogger::writerThread(void)
+{
+  std::list<ArBasePacket *> records;
+  bool running;
+
+  while (true)
+  {
+    myQueueMutex.lock();
+    records.swap(myQueue);
+    myQueueLength = 0;
+    running = myWriterRunning;
+    myQueueMutex.unlock();
+
+    if (records.empty())
+    {
+      if (!running)
+	break;
+      myQueueCondition.timedWait(100);
+      continue;
+    }
+
+    while (!records.empty())
+    {
+      internalWriteRecord(records.front());
+      delete records.front();
+      records.pop_front();
+    }
+    fflush(myFile);
+  }
+}
+
+/// Writes a record with its length in front of it
+static bool writeBinaryRecord(FILE *file, ArBasePacket *record)
+{
+  ArTypes::UByte4 length = record->getLength();
+  unsigned char lengthBuf[4];
+  lengthBuf[0] = length & 0xff;
+  lengthBuf[1] = (length >> 8) & 0xff;
+  lengthBuf[2] = (length >> 16) & 0xff;
+  lengthBuf[3] = (length >> 24) & 0xff;
+  return (fwrite(lengthBuf, 1, 4, file) == 4 && 
+	  fwrite(record->getBuf(), 1, length, file) == length);
+}
+
+void ArLaserLogger::internalWriteRecord(ArBasePacket *record)
+{
+  if (!myBinaryFile)
+  {
+    recordToText(record, myFile);
+    return;
+  }
+
+  unsigned char type = record->getBuf()[0];
+  if (type == BINARY_END)
+  {
+    if (!myIndexEntries.empty())
+      internalWriteIndex();
+    ArBasePacket end(5);
+    end.uByteToBuf(BINARY_END);
+    end.byte4ToBuf(myLastIndexOffset);
+    writeBinaryRecord(myFile, &end);
+    myFileOffset += 4 + end.getLength();
+    return;
+  }
+
+  if (type == BINARY_SCAN)
+  {
+    record->resetRead();
+    record->bufToUByte();
+    myIndexEntries.push_back(std::pair<int, long>(record->bufToByte4(),
+						    myFileOffset));
+  }
+  writeBinaryRecord(myFile, record);
+  myFileOffset += 4 + record->getLength();
+
+  if (myIndexEntries.size() >= (size_t)ourScansPerIndex)
+    internalWriteIndex();
+}
+
+void ArLaserLogger::internalWriteIndex(void)
+{
+  ArBasePacket index(9 + myIndexEntries.size() * 8);
+  std::list<std::pair<int, long> >::iterator it;
+
+  index.uByteToBuf(BINARY_INDEX);
+  index.byte4ToBuf(myLastIndexOffset);
+  index.uByte4ToBuf(myIndexEntries.size());
+  for (it = myIndexEntries.begin(); it != myIndexEntries.end(); it++)
+  {
+    index.byte4ToBuf((*it).first);
+    index.byte4ToBuf((*it).second);
+  }
+  myIndexEntries.clear();
+
+  myLastIndexOffset = myFileOffset;
+  writeBinaryRecord(myFile, &index);
+  myFileOffset += 4 + index.getLength();
+}
+
+void ArLaserLogger::posFromRecordToText(ArBasePacket *record, FILE *file)
+{
+  char name[2048];
+  int x, y, th;
+  int numExtra;
+  
+  x = record->bufToByte4();
+  y = record->bufToByte4();
+  th = record->bufToByte4();
+  fprintf(file, "robot: %d %d %.2f\n", x, y, th / 100.0);
+  x = record->bufToByte4();
+  y = record->bufToByte4();
+  th = record->bufToByte4();
+  fprintf(file, "robotGlobal: %d %d %.2f\n", x, y, th / 100.0);
+  if (record->bufToUByte())
+  {
+    x = record->bufToByte4();
+    y = record->bufToByte4();
+    th = record->bufToByte4();
+    fprintf(file, "robotRaw: %d %d %.2f\n", x, y, th / 100.0);
+  }
+  for (numExtra = record->bufToUByte(); numExtra > 0; numExtra--)
+  {
+    record->bufToStr(name, sizeof(name));
+    if (record->bufToUByte())
+    {
+      x = record->bufToByte4();
+      y = record->bufToByte4();
+      th = record->bufToByte4();
+      fprintf(file, "%s: %d %d %.2f\n", name, x, y, th / 100.0);
+    }
+    else
+      fprintf(file, "%s: \n", name);
+  }
+}
+
+bool ArLaserLogger::recordToText(ArBasePacket *record, FILE *file)
+{
+  char str[2048];
+  unsigned long msec;
+  int laserNumber;
+  int flags;
+  int num;
+  int i;
+  bool wide;
+  int vel, rotVel, latVel;
+
+  record->resetRead();
+  switch (record->bufToUByte())
+  {
+  case BINARY_TEXT:
+    record->bufToStr(str, sizeof(str));
+    fprintf(file, "%s\n", str);
+    return true;
+  case BINARY_TAG:
+    msec = record->bufToUByte4();
+    fprintf(file, "time: %ld.%03ld\n", msec / 1000, msec % 1000);
+    posFromRecordToText(record, file);
+    record->bufToStr(str, sizeof(str));
+    fprintf(file, "%s\n", str);
+    return true;
+  case BINARY_SCAN_SET:
+    msec = record->bufToUByte4();
+    vel = record->bufToByte4();
+    rotVel = record->bufToByte4();
+    latVel = record->bufToByte4();
+    fprintf(file, "logTime: %ld.%03ld\n", msec / 1000, msec % 1000);
+    fprintf(file, "velocities: %.2f %.2f %.2f\n", 
+	    vel / 100.0, rotVel / 100.0, latVel / 100.0);
+    return true;
+  case BINARY_SCAN:
+    fprintf(file, "scanId: %d\n", record->bufToByte4());
+    posFromRecordToText(record, file);
+    laserNumber = record->bufToUByte();
+    flags = record->bufToUByte();
+    num = record->bufToUByte2();
+    wide = (flags & 8);
+    if (flags & 1)
+    {
+      fprintf(file, "reflector%d: ", laserNumber);
+      for (i = 0; i < num; i++)
+	fprintf(file, "%d ", wide ? record->bufToByte4() : record->bufToByte2());
+      fprintf(file, "\n");
+    }
+    if (flags & 2)
+    {
+      fprintf(file, "sick1: ");
+      for (i = 0; i < num; i++)
+	fprintf(file, "%d ", wide ? record->bufToByte4() : record->bufToByte2());
+      fprintf(file, "\n");
+    }
+    if (flags & 4)
+    {
+      fprintf(file, "scan%d: ", laserNumber);
+      for (i = 0; i < num; i++)
+      {
+	int x = wide ? record->bufToByte4() : record->bufToByte2();
+	int y = wide ? record->bufToByte4() : record->bufToByte2();
+	fprintf(file, "%d %d  ", x, y);
+      }
+      fprintf(file, "\n");
+    }
+    return true;
+  case BINARY_INDEX:
+    return true;
+  case BINARY_END:
+    fprintf(file, "# End of log\n");
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// Reads the next record of a binary log, returns false at the end
+static bool readBinaryRecord(FILE *file, ArBasePacket *record)
+{
+  unsigned char lengthBuf[4];
+  ArTypes::UByte4 length;
+
+  if (fread(lengthBuf, 1, 4, file) != 4)
+    return false;
+  length = (lengthBuf[0] | (lengthBuf[1] << 8) | (lengthBuf[2] << 16) | 
+	    ((ArTypes::UByte4)lengthBuf[3] << 24));
+  if (length == 0 || length > record->getMaxLength())
+    return false;
+  if (fread(record->getBuf(), 1, length, file) != length)
+    return false;
+  record->setLength(length);
+  record->resetRead();
+  return true;
+}
+
+/// Opens a binary log and checks its first line, leaving it at the first record
+static FILE *openBinaryLog(const char *binaryFileName)
+{
+  FILE *file;
+  char line[1024];
+  
+  if ((file = ArUtil::fopen(binaryFileName, "rb")) == NULL)
+  {
+    ArLog::log(ArLog::Normal, "ArLaserLogger: Could not open %s", 
+	       binaryFileName);
+    return NULL;
+  }
+  if (fgets(line, sizeof(line), file) == NULL || 
+      strncmp(line, ourBinaryMagic, strlen(ourBinaryMagic)) != 0)
+  {
+    ArLog::log(ArLog::Normal, "ArLaserLogger: %s is not a binary laser log", 
+	       binaryFileName);
+    fclose(file);
+    return NULL;
+  }
+  return file;
+}
+
+/**
+   @param binaryFileName the binary log to read
+   @param textFileName the text log to write
+
+   @return true if the whole binary log was converted, false if it
+   couldn't be read or written, or was cut off (in which case what
+   could be read is still converted)
+**/
+AREXPORT bool ArLaserLogger::convertBinaryToText(const char *binaryFileName,
+						 const char *textFileName)
+{
+  FILE *binaryFile;
+  FILE *textFile;
+  ArBasePacket record(65535);
+  bool sawEnd = false;
+
+  if ((binaryFile = openBinaryLog(binaryFileName)) == NULL)
+    return false;
+  if ((textFile = ArUtil::fopen(textFileName, "w")) == NULL)
+  {
+    ArLog::log(ArLog::Normal, "ArLaserLogger: Could not open %s to write", 
+	       textFileName);
+    fclose(binaryFile);
+    return false;
+  }
+  while (readBinaryRecord(binaryFile, &record))
+  {
+    if ((unsigned char)record.getBuf()[0] == BINARY_END)
+      sawEnd = true;
+    if (!recordToText(&record, textFile))
+      ArLog::log(ArLog::Normal, 
+		 "ArLaserLogger: Ignoring unknown record type %d in %s", 
+		 (unsigned char)record.getBuf()[0], binaryFileName);
+  }
+  if (!sawEnd)
+    ArLog::log(ArLog::Normal, "ArLaserLogger: %s was cut off", 
+	       binaryFileName);
+  fclose(binaryFile);
+  fclose(textFile);
+  return sawEnd;
+}
+
+/**
+   This follows the indexes back from the end of the file, if the log
+   was cut off (so it has no end) it reads through the whole log
+   instead.
+
+   @param binaryFileName the binary log to read
+
+   @param scanOffsets this is filled in with the scan ids and the
+   offset in the file of each (which can be given to fseek)
+
+   @return true if the index could be read
+**/
+AREXPORT bool ArLaserLogger::readBinaryIndex(const char *binaryFileName,
+					     std::map<int, long> *scanOffsets)
+{
+  FILE *file;
+  ArBasePacket record(65535);
+  long offset;
+  long indexOffset = -1;
+  ArTypes::UByte4 numEntries;
+  int scanId;
+  
+  scanOffsets->clear();
+  if ((file = openBinaryLog(binaryFileName)) == NULL)
+    return false;
+
+  // the end is a fixed size, so look for it first
+  if (fseek(file, -9, SEEK_END) == 0 && 
+      readBinaryRecord(file, &record) && 
+      record.bufToUByte() == BINARY_END)
+  {
+    indexOffset = record.bufToByte4();
+    while (indexOffset >= 0)
+    {
+      if (fseek(file, indexOffset, SEEK_SET) != 0 || 
+	  !readBinaryRecord(file, &record) || 
+	  record.bufToUByte() != BINARY_INDEX)
+      {
+	ArLog::log(ArLog::Normal, "ArLaserLogger: Bad index at %ld in %s", 
+		   indexOffset, binaryFileName);
+	fclose(file);
+	return false;
+      }
+      indexOffset = record.bufToByte4();
+      for (numEntries = record.bufToUByte4(); numEntries > 0; numEntries--)
+      {
+	scanId = record.bufToByte4();
+	(*scanOffsets)[scanId] = record.bufToByte4();
+      }
+    }
+    fclose(file);
+    return true;
+  }
+
+  ArLog::log(ArLog::Normal, 
+	     "ArLaserLogger: %s has no end, reading through it for the index", 
+	     binaryFileName);
+  fclose(file);
+  if ((file = openBinaryLog(binaryFileName)) == NULL)
+    return false;
+  offset = ftell(file);
+  while (readBinaryRecord(file, &record))
+  {
+    if (record.bufToUByte() == BINARY_SCAN)
+    {
+      scanId = record.bufToByte4();
+      (*scanOffsets)[scanId] = offset;
+    }
+    offset = ftell(file);
   }
+  fclose(file);
+  return true;
 }
 
 void ArLaserLogger::internalPrintLaserPoseAndConf(ArLaser *laser, int laserNumber)
@@ -381,34 +939,34 @@ void ArLaserLogger::internalPrintLaserPoseAndConf(ArLaser *laser, int laserNumbe
   // probably shouldn't have sick1pose and scan1pose, but it's a lot
   // easier for now before the other lasers are really supported by
   // the map processing software
-  fprintf(myFile, "sick%dpose: %.0f %.0f %.2f\n", 
-	  laserNumber,
-	  laser->getSensorPositionX(),
-	  laser->getSensorPositionY(),
-	  laser->getSensorPositionTh());
-  fprintf(myFile, "sick%dconf: %.2f %.2f %d\n", 
-	  laserNumber,
-	  firstAngle, 
-	  lastAngle,
-	  readings->size());
-  fprintf(myFile, "sick%dname: %s\n", 
-	  laserNumber,
-	  laser->getName());  
-
-  fprintf(myFile, "scan%dpose: %.0f %.0f %.0f %.2f\n", 
-	  laserNumber,
-	  laser->getSensorPositionX(),
-	  laser->getSensorPositionY(),
-	  laser->getSensorPositionZ(),
-	  laser->getSensorPositionTh());
-  fprintf(myFile, "scan%dconf: %.2f %.2f %d\n", 
-	  laserNumber,
-	  firstAngle, 
-	  lastAngle,
-	  readings->size());
-  fprintf(myFile, "scan%dname: %s\n", 
-	  laserNumber,
-	  laser->getName());  
+  internalAddText("sick%dpose: %.0f %.0f %.2f", 
+		  laserNumber,
+		  laser->getSensorPositionX(),
+		  laser->getSensorPositionY(),
+		  laser->getSensorPositionTh());
+  internalAddText("sick%dconf: %.2f %.2f %d", 
+		  laserNumber,
+		  firstAngle, 
+		  lastAngle,
+		  (int)readings->size());
+  internalAddText("sick%dname: %s", 
+		  laserNumber,
+		  laser->getName());  
+
+  internalAddText("scan%dpose: %.0f %.0f %.0f %.2f", 
+		  laserNumber,
+		  laser->getSensorPositionX(),
+		  laser->getSensorPositionY(),
+		  laser->getSensorPositionZ(),
+		  laser->getSensorPositionTh());
+  internalAddText("scan%dconf: %.2f %.2f %d", 
+		  laserNumber,
+		  firstAngle, 
+		  lastAngle,
+		  (int)readings->size());
+  internalAddText("scan%dname: %s", 
+		  laserNumber,
+		  laser->getName());  
 }
   
 AREXPORT bool ArLaserLogger::loopPacketHandler(ArRobotPacket *packet)
@@ -575,7 +1133,7 @@ void ArLaserLogger::internalWriteTags(void)
     if (myFile != NULL)
     {
       myWrote = true;
-      fprintf(myFile, "%s\n", (*myInfos.begin()).c_str());
+      internalAddText("%s", (*myInfos.begin()).c_str());
     }
     myInfos.pop_front();
   }
@@ -588,10 +1146,13 @@ void ArLaserLogger::internalWriteTags(void)
     {
       myWrote = true;
       msec = myStartTime.mSecSince();
-      fprintf(myFile, "time: %ld.%03ld\n", msec / 1000, msec % 1000);
-      internalPrintPos(myRobot->getEncoderPose(), myRobot->getPose(), 
-		       myStartTime);
-      fprintf(myFile, "%s\n", (*myTags.begin()).c_str());
+      myRecord.empty();
+      myRecord.uByteToBuf(BINARY_TAG);
+      myRecord.uByte4ToBuf(msec);
+      internalPosToRecord(&myRecord, myRobot->getEncoderPose(), 
+			  myRobot->getPose(), myStartTime);
+      myRecord.strToBuf((*myTags.begin()).c_str());
+      internalQueueRecord(&myRecord);
     }
     myTags.pop_front();
   }
@@ -607,7 +1168,7 @@ void ArLaserLogger::internalTakeReading(void)
   // myDegDiff if we've switched sign on velocity and gone more than
   // 50 mm (so it doesn't oscilate and cause us to trigger)
 
-  if (myRobot->isConnected() && 
+  if (myFile != NULL && myRobot->isConnected() && 
       (!myFirstTaken || myTakeReadingExplicit || 
        myLast.findDistanceTo(myRobot->getEncoderPose()) > myDistDiff ||
        fabs(ArMath::subAngle(myLast.getTh(), 
@@ -621,9 +1182,13 @@ void ArLaserLogger::internalTakeReading(void)
     myFirstTaken = true;
     myLast = myRobot->getEncoderPose();
     msec = myStartTime.mSecSince();
-    fprintf(myFile, "logTime: %ld.%03ld\n", msec / 1000, msec % 1000);
-    fprintf(myFile, "velocities: %.2f %.2f %.2f\n", 
-	    myRobot->getVel(), myRobot->getRotVel(), myRobot->getLatVel());
+    myRecord.empty();
+    myRecord.uByteToBuf(BINARY_SCAN_SET);
+    myRecord.uByte4ToBuf(msec);
+    myRecord.byte4ToBuf(ArMath::roundInt(myRobot->getVel() * 100));
+    myRecord.byte4ToBuf(ArMath::roundInt(myRobot->getRotVel() * 100));
+    myRecord.byte4ToBuf(ArMath::roundInt(myRobot->getLatVel() * 100));
+    internalQueueRecord(&myRecord);
 
     std::list<ArLaser *>::iterator laserIt;
     std::multimap<ArTime, ArLaser *> lasersToLog;
@@ -704,35 +1269,80 @@ void ArLaserLogger::internalTakeLaserReading(ArLaser *laser, int laserNumber)
   globalPoseTaken = (*readings->begin())->getPoseTaken();
   timeTaken = (*readings->begin())->getTimeTaken();
   myLastVel = myRobot->getVel();
-  fprintf(myFile, "scanId: %d\n", myScanNumber);
+  myRecord.empty();
+  myRecord.uByteToBuf(BINARY_SCAN);
+  myRecord.byte4ToBuf(myScanNumber);
   myScanNumber++;
-  internalPrintPos(encoderPoseTaken, globalPoseTaken, timeTaken);
+  internalPosToRecord(&myRecord, encoderPoseTaken, globalPoseTaken, 
+		      timeTaken);
 
-  if (myUseReflectorValues)
+  /**
+     Note that the the sick1: or scan1: must be the last thing in
+     that timestamp, ie that you should put any other data before
+     it (the text conversion puts them out in the order of the flags).
+  **/
+  bool reflector = myUseReflectorValues;
+  bool sick1 = (myOldReadings && laserNumber == 1);
+  bool scan = (myNewReadings || laserNumber != 1);
+  int num = readings->size();
+  int i;
+
+  // figure out the scan points first, since whether they fit in two
+  // bytes decides how all the values are stored
+  myScanPoints.resize(num * 2);
+  bool wide = false;
+  ArTransform sensorTransform;
+  sensorTransform.setTransform(laser->getSensorPosition(),
+			       ArPose(0, 0, 0));
+  ArPose pose;
+  for (it = readings->begin(), i = 0; it != readings->end(); it++, i++)
+  {
+    reading = (*it);
+    if (scan && !reading->getIgnoreThisReading())
+    {
+      pose = sensorTransform.doTransform(reading->getLocalPose());
+      myScanPoints[i * 2] = ArMath::roundInt(pose.getX());
+      myScanPoints[i * 2 + 1] = ArMath::roundInt(pose.getY());
+    }
+    else
+    {
+      myScanPoints[i * 2] = 0;
+      myScanPoints[i * 2 + 1] = 0;
+    }
+    if ((scan && (myScanPoints[i * 2] > 32767 || 
+		  myScanPoints[i * 2] < -32768 ||
+		  myScanPoints[i * 2 + 1] > 32767 ||
+		  myScanPoints[i * 2 + 1] < -32768)) ||
+	(sick1 && reading->getRange() > 32767) || 
+	(reflector && !reading->getIgnoreThisReading() && 
+	 (reading->getExtraInt() > 32767 || reading->getExtraInt() < -32768)))
+      wide = true;
+  }
+
+  myRecord.uByteToBuf(laserNumber);
+  myRecord.uByteToBuf((reflector ? 1 : 0) | (sick1 ? 2 : 0) | 
+		      (scan ? 4 : 0) | (wide ? 8 : 0));
+  myRecord.uByte2ToBuf(num);
+
+  if (reflector)
   {
-    fprintf(myFile, "reflector%d: ", laserNumber);
-    
     // make sure that the list is in increasing order
     for (it = readings->begin(); it != readings->end(); it++)
     {
       reading = (*it);
       if (!reading->getIgnoreThisReading())
-	fprintf(myFile, "%d ", reading->getExtraInt());
+	i = reading->getExtraInt();
       else
-	fprintf(myFile, "0 ");
+	i = 0;
+      if (wide)
+	myRecord.byte4ToBuf(i);
+      else
+	myRecord.byte2ToBuf(i);
     }
-    fprintf(myFile, "\n");
   }
 
-  /**
-     Note that the the sick1: or scan1: must be the last thing in
-     that timestamp, ie that you should put any other data before
-     it.
-  **/
-  if (myOldReadings && laserNumber == 1)
+  if (sick1)
   {
-    fprintf(myFile, "sick1: ");
-    
     // 8/21/11 MPL it was this
     //if (!myFlipped) //myLaser->isLaserFlipped())
     // but I don't know why, and this should work or the underlying
@@ -743,7 +1353,10 @@ void ArLaserLogger::internalTakeLaserReading(ArLaser *laser, int laserNumber)
       for (it = readings->begin(); it != readings->end(); it++)
       {
 	reading = (*it);
-	fprintf(myFile, "%d ", reading->getRange());
+	if (wide)
+	  myRecord.byte4ToBuf(reading->getRange());
+	else
+	  myRecord.byte2ToBuf(reading->getRange());
       }
     }
     else
@@ -751,60 +1364,39 @@ void ArLaserLogger::internalTakeLaserReading(ArLaser *laser, int laserNumber)
       for (rit = readings->rbegin(); rit != readings->rend(); rit++)
       {
 	reading = (*rit);
-	fprintf(myFile, "%d ", reading->getRange());
+	if (wide)
+	  myRecord.byte4ToBuf(reading->getRange());
+	else
+	  myRecord.byte2ToBuf(reading->getRange());
       }
     }
-    fprintf(myFile, "\n");
   }
 
-  if (myNewReadings || laserNumber != 1)
+  if (scan)
   {
-    fprintf(myFile, "scan%d: ", laserNumber);
-    
-    ArTransform sensorTransform;
-    sensorTransform.setTransform(laser->getSensorPosition(),
-				 ArPose(0, 0, 0));
-    ArPose pose;
-    
-    for (it = readings->begin(); it != readings->end(); it++)
+    for (i = 0; i < num * 2; i++)
     {
-      reading = (*it);
-      if (!reading->getIgnoreThisReading())
-      {
-	pose = sensorTransform.doTransform(reading->getLocalPose());
-	fprintf(myFile, "%.0f %.0f  ", pose.getX(), pose.getY());
-      }
+      if (wide)
+	myRecord.byte4ToBuf(myScanPoints[i]);
       else
-	fprintf(myFile, "0 0  ");
+	myRecord.byte2ToBuf(myScanPoints[i]);
     }
-    fprintf(myFile, "\n");
   }
-
+  internalQueueRecord(&myRecord);
 }
 
-void ArLaserLogger::internalPrintPos(ArPose encoderPoseTaken, 
-				    ArPose globalPoseTaken, ArTime timeTaken)
+void ArLaserLogger::internalPosToRecord(ArBasePacket *record, 
+					ArPose encoderPoseTaken, 
+					ArPose globalPoseTaken, 
+					ArTime timeTaken)
 {
-  if (myFile == NULL)
-    return;
-
-  /*
-  long long msec = myStartTime.mSecSinceLL(timeTaken);
-  if (msec > 0)
-    fprintf(myFile, "time: %lld.%03lld\n", msec / 1000, msec % 1000);
-  else
-    fprintf(myFile, "time: 0.0\n");
-  */
-
-  fprintf(myFile, "robot: %.0f %.0f %.2f\n", 
-	  encoderPoseTaken.getX(), 
-	  encoderPoseTaken.getY(), 
-	  encoderPoseTaken.getTh());
+  record->byte4ToBuf(ArMath::roundInt(encoderPoseTaken.getX()));
+  record->byte4ToBuf(ArMath::roundInt(encoderPoseTaken.getY()));
+  record->byte4ToBuf(ArMath::roundInt(encoderPoseTaken.getTh() * 100));
 
-  fprintf(myFile, "robotGlobal: %.0f %.0f %.2f\n", 
-	  globalPoseTaken.getX(), 
-	  globalPoseTaken.getY(), 
-	  globalPoseTaken.getTh());
+  record->byte4ToBuf(ArMath::roundInt(globalPoseTaken.getX()));
+  record->byte4ToBuf(ArMath::roundInt(globalPoseTaken.getY()));
+  record->byte4ToBuf(ArMath::roundInt(globalPoseTaken.getTh() * 100));
 
   if (myIncludeRawEncoderPose)
   {
@@ -814,33 +1406,35 @@ void ArLaserLogger::internalPrintPos(ArPose encoderPoseTaken,
     
     ArPose rawPose;
     rawPose = normalToRaw.doInvTransform(encoderPoseTaken);
-    fprintf(myFile, "robotRaw: %.0f %.0f %.2f\n", 
-	    rawPose.getX(), 
-	    rawPose.getY(), 
-	    rawPose.getTh());
+    record->uByteToBuf(1);
+    record->byte4ToBuf(ArMath::roundInt(rawPose.getX()));
+    record->byte4ToBuf(ArMath::roundInt(rawPose.getY()));
+    record->byte4ToBuf(ArMath::roundInt(rawPose.getTh() * 100));
   }
+  else
+    record->uByteToBuf(0);
   
   std::map<std::string, ArRetFunctor3<int, ArTime, ArPose *, ArPoseWithTime *> *, 
 	   ArStrCaseCmpOp>::iterator it;
+  record->uByteToBuf(myExtraLocationData.size());
   for (it = myExtraLocationData.begin(); it != myExtraLocationData.end(); it++)
   {
     ArPose pose;
     int ret;
     ArPoseWithTime mostRecent;
+    record->strToBuf((*it).first.c_str());
     if ((ret = (*it).second->invokeR(timeTaken, &pose, &mostRecent)) >= 0)
     {
-      fprintf(myFile, "%s: %.0f %.0f %.2f\n", 
-	      (*it).first.c_str(),
-	      pose.getX(), 
-	      pose.getY(), 
-	      pose.getTh());
+      record->uByteToBuf(1);
+      record->byte4ToBuf(ArMath::roundInt(pose.getX()));
+      record->byte4ToBuf(ArMath::roundInt(pose.getY()));
+      record->byte4ToBuf(ArMath::roundInt(pose.getTh() * 100));
     }
     else
     {
       ArLog::log(ArLog::Verbose, "Could not use %s it returned %d",
 		 (*it).first.c_str(), ret);
-      fprintf(myFile, "%s: \n", 
-	      (*it).first.c_str());
+      record->uByteToBuf(0);
     }
   }
 }
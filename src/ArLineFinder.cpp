@@ -37,6 +37,7 @@ AREXPORT ArLineFinder::ArLineFinder(ArRangeDevice *rangeDevice)
   myLines = NULL;  
   myNonLinePoints = NULL;
   myFlippedFound = false;
+  myIncremental = false;
 
   mySinMultiplier = (ArMath::sin(1) / ArMath::sin(5));
 
@@ -100,16 +101,28 @@ AREXPORT std::map<int, ArPose> *ArLineFinder::getNonLinePoints(void)
 
 AREXPORT void ArLineFinder::fillPointsFromLaser(void)
 {
-  const std::list<ArSensorReading *> *readings;
-  std::list<ArSensorReading *>::const_iterator it;
-  std::list<ArSensorReading *>::const_reverse_iterator rit;
-  ArSensorReading *reading;
-  int pointCount = 0;
+  size_t i;
 
   if (myPoints != NULL)
     delete myPoints;
 
   myPoints = new std::map<int, ArPose>;
+
+  fillPointArray();
+  for (i = 0; i < myPointArray.size(); i++)
+    (*myPoints)[i] = myPointArray[i];
+}
+
+AREXPORT void ArLineFinder::fillPointArray(void)
+{
+  const std::list<ArSensorReading *> *readings;
+  std::list<ArSensorReading *>::const_iterator it;
+  std::list<ArSensorReading *>::const_reverse_iterator rit;
+  ArSensorReading *reading;
+
+  // clear keeps the capacity, so this only allocates when a scan has
+  // more points than any before it
+  myPointArray.clear();
   
   myRangeDevice->lockDevice();
   readings = myRangeDevice->getRawReadings();
@@ -154,8 +167,7 @@ AREXPORT void ArLineFinder::fillPointsFromLaser(void)
       reading = (*rit);
       if (reading->getRange() > 5000 || reading->getIgnoreThisReading())
 	continue;
-      (*myPoints)[pointCount] = reading->getPose();
-      pointCount++;
+      myPointArray.push_back(reading->getPose());
     }
   }
   else
@@ -165,8 +177,7 @@ AREXPORT void ArLineFinder::fillPointsFromLaser(void)
       reading = (*it);
       if (reading->getRange() > 5000 || reading->getIgnoreThisReading())
 	continue;
-      (*myPoints)[pointCount] = reading->getPose();
-      pointCount++;
+      myPointArray.push_back(reading->getPose());
     }
   }
   myRangeDevice->unlockDevice();
@@ -174,9 +185,7 @@ AREXPORT void ArLineFinder::fillPointsFromLaser(void)
 
 AREXPORT void ArLineFinder::findLines(void)
 {
-  int start = 0;
-  int pointsLen = myPoints->size();
-  int end;
+  size_t i;
 
   if (myLines != NULL)
   {
@@ -185,100 +194,88 @@ AREXPORT void ArLineFinder::findLines(void)
     myLines = NULL;
   }
   myLines = new std::map<int, ArLineFinderSegment *>;
-  int numLines = 0;
 
-  FILE *lineFile = NULL;
-  /*
-  if ((lineFile = ArUtil::fopen("firstLines", "w+")) == NULL)
-  {
-    printf("Couldn't open 'lines' for writing\n");
-    return;
-  }
-  */
-  ArLineFinderSegment *newLine;
+  myScratchLines.clear();
+  internalFindLines(0, (int)myPointArray.size() - 1, &myScratchLines);
+  for (i = 0; i < myScratchLines.size(); i++)
+    (*myLines)[i] = new ArLineFinderSegment(myScratchLines[i]);
+}
+
+/**
+   Makes the small lines that combining then builds up, out of the
+   points in myPointArray from first to last (inclusive), and adds them
+   to the end of lines.
+**/
+AREXPORT void ArLineFinder::internalFindLines(
+	int first, int last, std::vector<ArLineFinderSegment> *lines)
+{
+  int start;
+  int end;
+  ArLineFinderSegment newLine;
   double totalDistFromLine = 0;
-  double dist;
   int i;
   bool maxDistTriggered;
 
-  while (1)
+  for (start = first; start <= last; start++)
   {
+    const ArPose &startPoint = myPointArray[start];
     maxDistTriggered = false;
     // first we try to find the first place we'll check for lines
     // move out from the start as far as we should for the first one
     for (end = start; ; end++)
     {
       // if we hit the end stop
-      if (end >= pointsLen)
+      if (end > last)
 	break;
       // if we've moved at least two spots AND at least 50 mm then go
       if (end - start >= myMakingMinPoints && 
-  (*myPoints)[start].findDistanceTo((*myPoints)[end]) > myMakingMinLen)
+	  startPoint.findDistanceTo(myPointArray[end]) > myMakingMinLen)
 	break;
       // if the distance between any of the points is too great than
       // break (to try and get rid of spots where a laser spot half
       // way between things hurts us)
       if (myMaxDistBetweenPoints > 0 && end > start && 
-	  ((*myPoints)[end-1].findDistanceTo((*myPoints)[end]) > 
+	  (myPointArray[end-1].findDistanceTo(myPointArray[end]) > 
 	   myMaxDistBetweenPoints))
       {
 	maxDistTriggered = true;
 	break;
       }
     } 
-    if (end < pointsLen)
+    if (end > last)
+      continue;
+
+    const ArPose &endPoint = myPointArray[end];
+    // if the distance between any of the points is too great don't
+    // make a line out of it (to try and get rid of spots where a
+    // laser spot half way between things hurts us)
+    if (maxDistTriggered)
     {
-      // if the distance between any of the points is too great don't
-      // make a line out of it (to try and get rid of spots where a
-      // laser spot half way between things hurts us)
-      if (maxDistTriggered)
-      {
-	if (myPrinting)
-	  ArLog::log(ArLog::Normal, "too great a distance between some points on the line %d %d", start, end);
-      }
-      // see if its too far between these line segments
-      else if ((*myPoints)[start].findDistanceTo((*myPoints)[end]) <
-	       ((*myPoints)[start].findDistanceTo(myPoseTaken) * mySinMultiplier))
-      {
-	if (lineFile != NULL)
-	  fprintf(lineFile, "%.0f %.0f %.0f %.0f\n",
-		  (*myPoints)[start].getX(), (*myPoints)[start].getY(),
-		  (*myPoints)[end].getX() - (*myPoints)[start].getX(),
-		  (*myPoints)[end].getY() - (*myPoints)[start].getY());
-	
-	newLine = new ArLineFinderSegment(
-		(*myPoints)[start].getX(), 
-		(*myPoints)[start].getY(),
-		(*myPoints)[end].getX(),
-		(*myPoints)[end].getY(), 
-		1, start, end);
-	
-	totalDistFromLine = 0;
-	// Make sure none of the points are too far away from the new line
-	for (i = newLine->getStartPoint(); i <= newLine->getEndPoint(); i++)
-	{
-	  dist = newLine->getDistToLine((*myPoints)[i]);
-	  totalDistFromLine += dist;
-	}
-	newLine->setAveDistFromLine(totalDistFromLine / (end - start));
-	
-	(*myLines)[numLines] = newLine;
-	numLines++;
-      }
-      else
-      {
-	if (myPrinting)
-	  ArLog::log(ArLog::Normal, "too great a distance between the two line points %d %d", start, end);
-      }
+      if (myPrinting)
+	ArLog::log(ArLog::Normal, "too great a distance between some points on the line %d %d", start, end);
+    }
+    // see if its too far between these line segments
+    else if (startPoint.findDistanceTo(endPoint) <
+	     (startPoint.findDistanceTo(myPoseTaken) * mySinMultiplier))
+    {
+      newLine.newEndPoints(startPoint.getX(), startPoint.getY(),
+			   endPoint.getX(), endPoint.getY(), 
+			   1, start, end);
+      
+      totalDistFromLine = 0;
+      // Make sure none of the points are too far away from the new line
+      for (i = start; i <= end; i++)
+	totalDistFromLine += newLine.getDistToLine(myPointArray[i]);
+      newLine.setAveDistFromLine(totalDistFromLine / (end - start));
+      
+      lines->push_back(newLine);
+    }
+    else
+    {
+      if (myPrinting)
+	ArLog::log(ArLog::Normal, "too great a distance between the two line points %d %d", start, end);
     }
-    
-    start += 1;
-    if (start >= pointsLen)
-      break;
   }
-  
-  if (lineFile != NULL)
-    fclose(lineFile);
 }
 
 AREXPORT bool ArLineFinder::combineLines(void)
@@ -367,6 +364,24 @@ AREXPORT ArLineFinderSegment *ArLineFinder::averageSegments(
 	ArLineFinderSegment *line1,
 	ArLineFinderSegment *line2)
 {
+  if (!internalAverageSegments(line1, line2, &myAveragedLine))
+    return NULL;
+  return new ArLineFinderSegment(myAveragedLine);
+}
+
+/**
+   Sets newLine to the average of line1 and line2, weighted by how
+   many points are in each, if they're close enough to being the same
+   line and all the points between them are close enough to the new
+   line.
+
+   @return true if newLine was set, false if the lines don't go together
+**/
+AREXPORT bool ArLineFinder::internalAverageSegments(
+	ArLineFinderSegment *line1,
+	ArLineFinderSegment *line2,
+	ArLineFinderSegment *newLine)
+{
 
   // the angles can be myCombiningAngleTol diff but if its more than myCombiningAngleTol / 2
   // then the resulting line angle should be between the other two
@@ -389,7 +404,7 @@ AREXPORT ArLineFinderSegment *ArLineFinder::averageSegments(
     if (myPrinting)
       ArLog::log(ArLog::Normal, 
 		 "distance between the two line end points greater than maxDistBetweenPoints");
-    return NULL;
+    return false;
   }
 
   // see if its too far between these line segments
@@ -399,7 +414,7 @@ AREXPORT ArLineFinderSegment *ArLineFinder::averageSegments(
     if (myPrinting)
       ArLog::log(ArLog::Normal, 
 		 "too great a distance between the two line points");
-    return NULL;
+    return false;
   }
   // make sure they're pointing in the same direction at least
   double angleOff;
@@ -409,7 +424,7 @@ AREXPORT ArLineFinderSegment *ArLineFinder::averageSegments(
   {
     if (myPrinting)
       ArLog::log(ArLog::Normal, "greater than angle tolerance");
-    return NULL;	
+    return false;	
   }
 
   ArPose endPose2(line2->getX2(), line2->getY2());
@@ -426,7 +441,7 @@ AREXPORT ArLineFinderSegment *ArLineFinder::averageSegments(
     
     if (myPrinting)
       ArLog::log(ArLog::Normal, "endPose2 too far from line1");
-    return NULL;
+    return false;
   }
 
   ArPose endPose1(line1->getX1(), line1->getY1());
@@ -443,14 +458,13 @@ AREXPORT ArLineFinderSegment *ArLineFinder::averageSegments(
     //printf("e2 %d %.0f\n", line2Line.intersects(&perpLine2, &intersection2), 	   intersection2.findDistanceTo(endPose1));
     if (myPrinting)
       ArLog::log(ArLog::Normal, "endPose1 too far from line2");
-    return NULL;
+    return false;
   }
 
 
 
-  ArLineFinderSegment *newLine;
   /*
-  newLine = new ArLineFinderSegment((endPose1.getX() + intersection2.getX()) / 2,
+  newLine->newEndPoints((endPose1.getX() + intersection2.getX()) / 2,
 			      (endPose1.getY() + intersection2.getY()) / 2,
 			      (endPose2.getX() + intersection1.getX()) / 2,
 			      (endPose2.getY() + intersection1.getY()) / 2,
@@ -460,7 +474,7 @@ AREXPORT ArLineFinderSegment *ArLineFinder::averageSegments(
   // many points are in each line
   int l1C = line1->getNumPoints();
   int l2C = line2->getNumPoints();
-  newLine = new ArLineFinderSegment((endPose1.getX() * l1C +
+  newLine->newEndPoints((endPose1.getX() * l1C +
 				     intersection2.getX() * l2C) / (l1C + l2C),
 				    (endPose1.getY() * l1C + 
 				     intersection2.getY() * l2C) / (l1C + l2C),
@@ -480,7 +494,7 @@ AREXPORT ArLineFinderSegment *ArLineFinder::averageSegments(
   // Make sure none of the points are too far away from the new line
   for (i = newLine->getStartPoint(); i <= newLine->getEndPoint(); i++)
   {
-    if ((dist = newLine->getDistToLine((*myPoints)[i])) > 
+    if ((dist = newLine->getDistToLine(myPointArray[i])) > 
 	myValidMaxDistFromLine && 
 	i != newLine->getStartPoint() &&
 	i != newLine->getEndPoint())
@@ -490,8 +504,7 @@ AREXPORT ArLineFinderSegment *ArLineFinder::averageSegments(
 		   "Had a point %d that was to far from our line at %.0f (max %d)",
 		   i, dist, myValidMaxDistFromLine);
 
-      delete newLine;
-      return NULL;
+      return false;
     }
     //printf("d %.0f\n", dist);
     totalDistFromLine += dist;
@@ -506,8 +519,7 @@ AREXPORT ArLineFinderSegment *ArLineFinder::averageSegments(
 		 "Ave dist from line was too great at %.0f (max %d)",
 		 newLine->getAveDistFromLine(), myValidMaxDistFromLine);
     
-    delete newLine;
-    return NULL;
+    return false;
   }
   if (newLine->getAveDistFromLine() > (line1->getAveDistFromLine() + 
 				       line2->getAveDistFromLine()) * 1.25)
@@ -519,27 +531,25 @@ AREXPORT ArLineFinderSegment *ArLineFinder::averageSegments(
 		 line1->getAveDistFromLine(), 
 		 line2->getAveDistFromLine());
     
-    delete newLine;
-    return NULL;
+    return false;
 
   }
   // if we're in myCombiningAngleTol / 2 then its close enough
   if (angleOff < myCombiningAngleTol / 2)
-    return newLine;
+    return true;
 
   // if the new angle is in between the two lines and within myCombiningAngleTol we're ok
   if ((ArMath::subAngle(newLine->getLineAngle(), line2->getLineAngle()) > 0 &&
        ArMath::subAngle(line1->getLineAngle(), newLine->getLineAngle()) > 0) ||
       (ArMath::subAngle(newLine->getLineAngle(), line1->getLineAngle()) > 0 &&
        ArMath::subAngle(line2->getLineAngle(), newLine->getLineAngle()) > 0))
-    return newLine;
+    return true;
   
   //printf("%g\n", newLine->getLineAngle());
   if (myPrinting)
     ArLog::log(ArLog::Normal, "angles wonky");
   // if we got down here hte line didn't work
-  delete newLine;
-  return NULL; 
+  return false; 
 }
 
 AREXPORT void ArLineFinder::filterLines(void)
@@ -596,6 +606,249 @@ AREXPORT void ArLineFinder::filterLines(void)
 }
 
 
+/**
+   This finds the same lines getLines() would, but the points and lines
+   live in arrays ArLineFinder keeps between calls, the small lines are
+   made in place, and combining swaps between two arrays instead of
+   recursing with new maps, so once the arrays have grown to fit a scan
+   this doesn't allocate anything.
+
+   If setIncremental() is on then this starts from the lines found on
+   the last scan instead (see findLinesFromLast()).
+
+   @return a pointer to ArLineFinder's array of lines, which is
+   only good until the next call; the start and end points of the
+   lines are indexes into getPointArray()
+**/
+AREXPORT const std::vector<ArLineFinderSegment> *ArLineFinder::getLineArray(
+	void)
+{
+  fillPointArray();
+  if (myIncremental && !myLastLines.empty())
+  {
+    findLinesFromLast();
+  }
+  else
+  {
+    myLineArray.clear();
+    internalFindLines(0, (int)myPointArray.size() - 1, &myLineArray);
+  }
+  combineLineArray();
+  filterLineArray();
+  combineLineArray();
+  if (myIncremental)
+    myLastLines = myLineArray;
+  return &myLineArray;
+}
+
+/**
+   Scans in a row usually see the same walls, so with this on
+   getLineArray() looks for runs of points along each line from the
+   last scan and fits those runs directly, only making and combining
+   small lines for the points between them.  The lines are kept in the
+   same coordinates as the readings, so the robot moving doesn't
+   invalidate them.  The first scan after turning this on (or after a
+   scan with no lines) is done the whole way.
+**/
+AREXPORT void ArLineFinder::setIncremental(bool incremental)
+{
+  myIncremental = incremental;
+  myLastLines.clear();
+}
+
+AREXPORT void ArLineFinder::combineLineArray(void)
+{
+  size_t start;
+  size_t len;
+  bool merged = true;
+
+  while (merged)
+  {
+    if (myPrinting)
+      ArLog::log(ArLog::Normal, "new iteration\n");
+
+    merged = false;
+    myScratchLines.clear();
+    len = myLineArray.size();
+    for (start = 0; start < len; start++)
+    {
+      if (start + 1 < len && 
+	  internalAverageSegments(&myLineArray[start], &myLineArray[start+1],
+				  &myAveragedLine))
+      {
+	if (myPrinting)
+	  ArLog::log(ArLog::Normal, "merged %g %g to %g", 
+		     myLineArray[start].getLength(),
+		     myLineArray[start+1].getLength(),
+		     myAveragedLine.getLength());
+	myScratchLines.push_back(myAveragedLine);
+	merged = true;
+	// the next one went into this one
+	start++;
+      }
+      else
+      {
+	myScratchLines.push_back(myLineArray[start]);
+      }
+    }
+    // swap keeps both arrays' space around for the next time through
+    myLineArray.swap(myScratchLines);
+  }
+}
+
+AREXPORT void ArLineFinder::filterLineArray(void)
+{
+  size_t i;
+  size_t numKept = 0;
+
+  if (myPrinting)
+    ArLog::log(ArLog::Normal, "filtering lines\n");
+
+  for (i = 0; i < myLineArray.size(); i++)
+  {
+    ArLineFinderSegment &line = myLineArray[i];
+    if (line.getNumPoints() >= myFilteringMinPointsInLine &&
+	line.getEndPoint1().findDistanceTo(line.getEndPoint2()) > 
+	myFilteringMinLineLength)
+    {
+      if (myPrinting)
+	ArLog::log(ArLog::Normal, "kept %g (%d points)", 
+		   line.getLength(), line.getNumPoints());
+      if (numKept != i)
+	myLineArray[numKept] = line;
+      numKept++;
+    }
+    else if (myPrinting)
+    {
+      ArLog::log(ArLog::Normal, "Clipped %g (%d points)",
+		 line.getLength(), line.getNumPoints());
+    }
+  }
+  myLineArray.resize(numKept);
+}
+
+/**
+   Goes through the lines from the last scan in order, and for each
+   one looks (from where the last one left off) for a run of points
+   that are within the valid distance of it, not past its ends by more
+   than the combining distance, and not too far apart from each other.
+   A long enough run gets a least squares fit and goes into
+   myLineArray as a line of its own, if it passes the same checks
+   combining uses; the points between runs get small lines made out of
+   them as usual.  Combining and filtering then go over all of it, so
+   lines that grew or that are new come out like they would from a
+   full pass.
+**/
+AREXPORT void ArLineFinder::findLinesFromLast(void)
+{
+  int numPoints = myPointArray.size();
+  int next = 0;
+  int i, j, k;
+  size_t l;
+  double x1, y1, dx, dy, len, along, across;
+  double meanX, meanY, sxx, syy, sxy, ex, ey, angle, t1, t2, dist, total;
+  bool good;
+
+  myLineArray.clear();
+  for (l = 0; l < myLastLines.size() && next < numPoints; l++)
+  {
+    const ArLineFinderSegment &last = myLastLines[l];
+    len = last.getLength();
+    if (len < 1)
+      continue;
+    x1 = last.getX1();
+    y1 = last.getY1();
+    dx = (last.getX2() - x1) / len;
+    dy = (last.getY2() - y1) / len;
+    for (i = next; i < numPoints; i = (j > i) ? j : i + 1)
+    {
+      // find how far the run of points along the last line goes
+      for (j = i; j < numPoints; j++)
+      {
+	const ArPose &point = myPointArray[j];
+	along = (point.getX() - x1) * dx + (point.getY() - y1) * dy;
+	across = ArMath::fabs((point.getY() - y1) * dx - 
+			      (point.getX() - x1) * dy);
+	if (across > myValidMaxDistFromLine || 
+	    along < -myCombiningLinesCloseEnough || 
+	    along > len + myCombiningLinesCloseEnough)
+	  break;
+	if (j > i && 
+	    ((myMaxDistBetweenPoints > 0 && 
+	      myPointArray[j-1].findDistanceTo(point) > 
+	      myMaxDistBetweenPoints) ||
+	     myPointArray[j-1].findDistanceTo(point) >
+	     myPointArray[j-1].findDistanceTo(myPoseTaken) * mySinMultiplier))
+	  break;
+      }
+      if (j - i <= myFilteringMinPointsInLine)
+	continue;
+
+      // fit the run, using the point numbers as the ends like
+      // combining would have
+      meanX = 0;
+      meanY = 0;
+      for (k = i; k < j; k++)
+      {
+	meanX += myPointArray[k].getX();
+	meanY += myPointArray[k].getY();
+      }
+      meanX /= (j - i);
+      meanY /= (j - i);
+      sxx = 0;
+      syy = 0;
+      sxy = 0;
+      for (k = i; k < j; k++)
+      {
+	ex = myPointArray[k].getX() - meanX;
+	ey = myPointArray[k].getY() - meanY;
+	sxx += ex * ex;
+	syy += ey * ey;
+	sxy += ex * ey;
+      }
+      angle = ArMath::atan2(2 * sxy, sxx - syy) / 2;
+      ex = ArMath::cos(angle);
+      ey = ArMath::sin(angle);
+      t1 = ((myPointArray[i].getX() - meanX) * ex + 
+	    (myPointArray[i].getY() - meanY) * ey);
+      t2 = ((myPointArray[j-1].getX() - meanX) * ex + 
+	    (myPointArray[j-1].getY() - meanY) * ey);
+      myAveragedLine.newEndPoints(meanX + t1 * ex, meanY + t1 * ey,
+				  meanX + t2 * ex, meanY + t2 * ey,
+				  j - 1 - i, i, j - 1);
+
+      good = (myAveragedLine.getLength() > myFilteringMinLineLength);
+      total = 0;
+      for (k = i; k < j && good; k++)
+      {
+	dist = ArMath::fabs((myPointArray[k].getY() - meanY) * ex - 
+			    (myPointArray[k].getX() - meanX) * ey);
+	if (dist > myValidMaxDistFromLine && k != i && k != j - 1)
+	  good = false;
+	total += dist;
+      }
+      if (!good || total / (j - 1 - i) > myValidMaxAveFromLine)
+      {
+	if (myPrinting)
+	  ArLog::log(ArLog::Normal, 
+		     "Points %d to %d along last line %d didn't fit", 
+		     i, j - 1, (int)l);
+	continue;
+      }
+      myAveragedLine.setAveDistFromLine(total / (j - 1 - i));
+
+      if (myPrinting)
+	ArLog::log(ArLog::Normal, "Points %d to %d along last line %d", 
+		   i, j - 1, (int)l);
+      internalFindLines(next, i - 1, &myLineArray);
+      myLineArray.push_back(myAveragedLine);
+      next = j;
+      break;
+    }
+  }
+  internalFindLines(next, numPoints - 1, &myLineArray);
+}
+
 
 /**
    Saves the points in the "points" with all the points file in the
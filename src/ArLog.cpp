@@ -32,6 +32,8 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include <stdarg.h>
 #include <ctype.h>
 #include "ariaInternal.h"
+#include "ArThread.h"
+#include "ArCondition.h"
 
 
 #ifdef WIN32
@@ -78,6 +80,95 @@ bool ArLog::ourAramDaemonized = false;
 
 ArFunctor1<const char *> *ArLog::ourFunctor;
 
+bool ArLog::ourAsync = false;
+ArLog::AsyncDropPolicy ArLog::ourAsyncDropPolicy = ArLog::DropNewUnlessTerse;
+
+/*
+  The queue for async logging.  It is a bounded lock free queue that
+  any thread can add to and only the writer thread takes from.  Each
+  record has a sequence number that says whether it is free to be
+  filled (it equals the position being queued to) or full and ready
+  to be written (it is one more than the position being written).  A
+  thread queuing a message claims a position by moving
+  ourAsyncQueuePos along with a compare and swap, fills in the record,
+  and then sets the sequence number, so no thread ever waits on
+  another one.
+*/
+struct ArLogAsyncRecord
+{
+  volatile unsigned long mySequence;
+  ArLog::LogLevel myLevel;
+  time_t myTime;
+  // messages too long for myMessage are copied here
+  char *myLongMessage;
+  char myMessage[232];
+};
+
+static ArLogAsyncRecord *ourAsyncRecords = NULL;
+static unsigned long ourAsyncMask = 0;
+static volatile unsigned long ourAsyncQueuePos = 0;
+static volatile unsigned long ourAsyncWritePos = 0;
+static volatile long ourAsyncDropped[3] = { 0, 0, 0 };
+static long ourAsyncReportedDropped = 0;
+static volatile bool ourAsyncRunning = false;
+// how many threads are in asyncQueue, so setAsync(false) can wait for them
+static volatile long ourAsyncQueuing = 0;
+static bool ourAsyncInBatch = false;
+static ArThread *ourAsyncThread = NULL;
+// the writer sets this so it can tell when it is the one logging
+static ArThread::ThreadType ourAsyncWriterSelf;
+// made with the queue, ArCondition can't be constructed statically
+static ArCondition *ourAsyncCondition = NULL;
+static ArMutex ourAsyncSetMutex;
+static bool ourAsyncAddedExitCB = false;
+
+static void asyncExit(void)
+{
+  ArLog::setAsync(false);
+}
+static ArGlobalFunctor ourAsyncExitCB(&asyncExit);
+
+#ifndef WIN32
+static inline bool asyncCompareAndSwap(volatile unsigned long *ptr, 
+				       unsigned long oldVal, 
+				       unsigned long newVal)
+{
+  return __sync_bool_compare_and_swap(ptr, oldVal, newVal);
+}
+static inline void asyncIncrement(volatile long *ptr)
+{
+  __sync_fetch_and_add(ptr, 1);
+}
+static inline void asyncDecrement(volatile long *ptr)
+{
+  __sync_fetch_and_sub(ptr, 1);
+}
+static inline void asyncMemoryBarrier(void)
+{
+  __sync_synchronize();
+}
+#else
+static inline bool asyncCompareAndSwap(volatile unsigned long *ptr, 
+				       unsigned long oldVal, 
+				       unsigned long newVal)
+{
+  return ((unsigned long)InterlockedCompareExchange(
+		  (volatile LONG *)ptr, (LONG)newVal, (LONG)oldVal) == oldVal);
+}
+static inline void asyncIncrement(volatile long *ptr)
+{
+  InterlockedIncrement((volatile LONG *)ptr);
+}
+static inline void asyncDecrement(volatile long *ptr)
+{
+  InterlockedDecrement((volatile LONG *)ptr);
+}
+static inline void asyncMemoryBarrier(void)
+{
+  MemoryBarrier();
+}
+#endif
+
 
 AREXPORT void ArLog::logPlain(LogLevel level, const char *str)
 {
@@ -103,7 +194,20 @@ AREXPORT void ArLog::log(LogLevel level, const char *str, ...)
   int timeLen = 0; // this is a value based on the standard length of
                        // ctime return
   time_t now;
+  va_list ptr;
 
+  // when logging asynchronously the message is formatted here without
+  // the lock and the writer thread puts the time on it
+  if (ourAsync)
+  {
+    va_start(ptr, str);
+    vsnprintf(buf, sizeof(buf) - 2, str, ptr);
+    buf[sizeof(buf) - 1] = '\0';
+    va_end(ptr);
+    if (!asyncQueue(level, buf))
+      log(level, "%s", buf);
+    return;
+  }
 
   ourMutex.lock();
   // put our time in if we want it
@@ -119,49 +223,13 @@ AREXPORT void ArLog::log(LogLevel level, const char *str, ...)
   }
   else
     bufPtr = buf;
-  va_list ptr;
   va_start(ptr, str);
   
   vsnprintf(bufPtr, sizeof(buf) - timeLen - 2, str, ptr);
   bufPtr[sizeof(buf) - timeLen - 1] = '\0';
   //vsprintf(bufPtr, str, ptr);
   // can do whatever you want with the buf now
-  if (ourType == Colbert)
-  {
-    if (colbertPrint)		// check if we have a print routine
-      (*colbertPrint)(ourColbertStream, buf);
-  }
-  else if (ourFP)
-  {
-    int written;
-    if ((written = fprintf(ourFP, "%s\n", buf)) > 0)
-      ourCharsLogged += written;
-    fflush(ourFP);
-    checkFileSize();
-  }
-  else if (ourType != None)
-  {
-    printf("%s\n", buf);
-    fflush(stdout);
-  }
-  if (ourAlsoPrint)
-    printf("%s\n", buf);
-
-  invokeFunctor(buf);
-
-#ifndef ARINTERFACE
-  // check this down here instead of up in the if ourFP so that the log filled shows up after the printf
-  if (ourUseAramBehavior && ourFP && ourAramLogSize > 0 && 
-      ourCharsLogged > ourAramLogSize)
-  {
-    filledAramLog();
-  }
-#endif // ARINTERFACE
-
-// Also send it to the VC++ debug output window...
-#ifdef HAVEATL
-  ATLTRACE2("%s\n", buf);
-#endif
+  writeMessage(buf);
   
   va_end(ptr);
   ourMutex.unlock();
@@ -206,10 +274,13 @@ AREXPORT void ArLog::logErrorFromOS(LogLevel level, const char *str, ...)
                        // ctime return
   time_t now;
 
-
-  ourMutex.lock();
+  // when logging asynchronously the message is formatted here without
+  // the lock and the writer thread puts the time on it
+  bool async = ourAsync;
+  if (!async)
+    ourMutex.lock();
   // put our time in if we want it
-  if (ourLoggingTime)
+  if (ourLoggingTime && !async)
   {
     now = time(NULL);
     timeStr = ctime(&now);
@@ -255,44 +326,15 @@ AREXPORT void ArLog::logErrorFromOS(LogLevel level, const char *str, ...)
 
   //vsprintf(bufPtr, str, ptr);
   // can do whatever you want with the buf now
-  if (ourType == Colbert)
-  {
-    if (colbertPrint)		// check if we have a print routine
-      (*colbertPrint)(ourColbertStream, bufWithError);
-  }
-  else if (ourFP)
-  {
-    int written;
-    if ((written = fprintf(ourFP, "%s\n", bufWithError)) > 0)
-      ourCharsLogged += written;
-    fflush(ourFP);
-    checkFileSize();
-  }
-  else if (ourType != None)
-  {
-    printf("%s\n", bufWithError);
-    fflush(stdout);
-  }
-  if (ourAlsoPrint)
-    printf("%s\n", bufWithError);
-
-  invokeFunctor(bufWithError);
-
-#ifndef ARINTERFACE
-  // check this down here instead of up in the if ourFP so that the log filled shows up after the printf
-  if (ourUseAramBehavior && ourFP && ourAramLogSize > 0 && 
-      ourCharsLogged > ourAramLogSize)
+  va_end(ptr);
+  if (async)
   {
-    filledAramLog();
+    if (!asyncQueue(level, bufWithError))
+      log(level, "%s", bufWithError);
+    return;
   }
-#endif // ARINTERFACE
-
-// Also send it to the VC++ debug output window...
-#ifdef HAVEATL
-  ATLTRACE2("%s\n", buf);
-#endif
+  writeMessage(bufWithError);
   
-  va_end(ptr);
   ourMutex.unlock();
 }
 
@@ -861,3 +903,397 @@ AREXPORT void ArLog::internalForceLockup(void)
   ourMutex.lock();
 }
 
+/**
+   This writes the message wherever the log is set to go, calls the
+   functor, and checks the aram log size.
+**/
+AREXPORT void ArLog::writeMessage(const char *message)
+{
+  if (ourType == Colbert)
+  {
+    if (colbertPrint)		// check if we have a print routine
+      (*colbertPrint)(ourColbertStream, message);
+  }
+  else if (ourFP)
+  {
+    int written;
+    if ((written = fprintf(ourFP, "%s\n", message)) > 0)
+      ourCharsLogged += written;
+    // the async writer flushes once it has written what's queued
+    if (!ourAsyncInBatch)
+      fflush(ourFP);
+    checkFileSize();
+  }
+  else if (ourType != None)
+  {
+    printf("%s\n", message);
+    if (!ourAsyncInBatch)
+      fflush(stdout);
+  }
+  if (ourAlsoPrint)
+    printf("%s\n", message);
+
+  invokeFunctor(message);
+
+#ifndef ARINTERFACE
+  // check this down here instead of up in the if ourFP so that the log filled shows up after the printf
+  if (ourUseAramBehavior && ourFP && ourAramLogSize > 0 && 
+      ourCharsLogged > ourAramLogSize)
+  {
+    filledAramLog();
+  }
+#endif // ARINTERFACE
+
+// Also send it to the VC++ debug output window...
+#ifdef HAVEATL
+  ATLTRACE2("%s\n", message);
+#endif
+}
+
+/**
+   Normally each log call formats the message and writes it out (to
+   the file or stdout, and to the functor set with setFunctor()) while
+   holding a lock that every logging thread shares, so a thread that
+   logs waits on any other thread that is logging and on the disk.
+   When logging asynchronously a log call formats its message and puts
+   it on a queue without taking any locks, and a writer thread writes
+   the queued messages (putting the time on them if that is set) and
+   does the log file rotation.
+
+   While this is on the functor set with setFunctor() is called from
+   the writer thread, not from the thread that made the log call, and
+   after that call has returned.
+
+   A message shorter than 232 characters is copied into the queue, a
+   longer one is copied into memory allocated for it (which the writer
+   frees), so only the shorter messages are logged without allocating.
+
+   The queue holds a fixed number of messages, if it is full when a
+   message is logged the message is dropped or the logging thread
+   waits, depending on @p dropPolicy.  The number of messages dropped
+   at each level is counted (see getAsyncNumDropped()), and the writer
+   thread logs how many were dropped when it catches up.
+
+   Turning this off waits for any messages that are being queued right
+   then, stops the writer thread and writes whatever is left in the
+   queue before returning, so nothing logged before it returns is
+   left behind.  Aria::exit() turns this off so the messages are
+   written, if you exit without that call flushAsync() first.
+
+   @param async true to log asynchronously, false to log in the thread
+   making the log call
+
+   @param queueSize the number of messages the queue holds (rounded up
+   to a power of two), this is only used the first time async logging
+   is turned on
+
+   @param dropPolicy what to do with messages when the queue is full
+
+   @return true if the logging is now set as requested, false if the
+   writer thread couldn't be started
+**/
+AREXPORT bool ArLog::setAsync(bool async, int queueSize,
+			      AsyncDropPolicy dropPolicy)
+{
+  static ArGlobalFunctor writerCB(&ArLog::asyncWriterThread);
+  unsigned long i;
+
+  ourAsyncSetMutex.lock();
+  ourAsyncDropPolicy = dropPolicy;
+  if (async == ourAsync)
+  {
+    ourAsyncSetMutex.unlock();
+    return true;
+  }
+
+  if (!async)
+  {
+    // new messages go the normal way, then once the ones being queued
+    // right now are in (the writer keeps going so they can get in if
+    // the queue is full) stop the writer and write what's left
+    ourAsync = false;
+    asyncMemoryBarrier();
+    while (ourAsyncQueuing != 0)
+    {
+      ourAsyncCondition->signal();
+      ArUtil::sleep(1);
+    }
+    ourAsyncRunning = false;
+    ourAsyncCondition->signal();
+    if (ourAsyncThread != NULL)
+    {
+      ourAsyncThread->join();
+      delete ourAsyncThread;
+      ourAsyncThread = NULL;
+    }
+    ourMutex.lock();
+    asyncWriteQueued();
+    ourMutex.unlock();
+    ourAsyncSetMutex.unlock();
+    return true;
+  }
+
+  if (ourAsyncRecords == NULL)
+  {
+    unsigned long size;
+    for (size = 16; size < (unsigned long)queueSize && size < (1ul << 20); 
+	 size *= 2);
+    ourAsyncRecords = new ArLogAsyncRecord[size];
+    ourAsyncMask = size - 1;
+    ourAsyncCondition = new ArCondition;
+    for (i = 0; i < size; i++)
+    {
+      ourAsyncRecords[i].mySequence = i;
+      ourAsyncRecords[i].myLongMessage = NULL;
+    }
+    ourAsyncQueuePos = 0;
+    ourAsyncWritePos = 0;
+    asyncMemoryBarrier();
+  }
+
+  ourAsyncRunning = true;
+  ourAsyncThread = new ArThread;
+  ourAsyncThread->setThreadName("ArLog async writer");
+  if (ourAsyncThread->create(&writerCB, true, false) != 0)
+  {
+    ourAsyncRunning = false;
+    delete ourAsyncThread;
+    ourAsyncThread = NULL;
+    ourAsyncSetMutex.unlock();
+    ArLog::log(ArLog::Terse, 
+	       "ArLog::setAsync: Could not start the writer thread");
+    return false;
+  }
+  ourAsync = true;
+  if (!ourAsyncAddedExitCB)
+  {
+    ourAsyncAddedExitCB = true;
+    ourAsyncExitCB.setName("ArLogAsync");
+    Aria::addExitCallback(&ourAsyncExitCB, -1000);
+  }
+  ourAsyncSetMutex.unlock();
+  return true;
+}
+
+AREXPORT bool ArLog::getAsync(void)
+{
+  return ourAsync;
+}
+
+/**
+   This returns once the messages queued before it was called have
+   been written (or after 10 seconds if they haven't been).  It returns
+   right away if called from the writer thread (ie from the functor).
+**/
+AREXPORT void ArLog::flushAsync(void)
+{
+  unsigned long queuePos;
+  ArTime start;
+
+  if (ArThread::osSelf() == ourAsyncWriterSelf)
+    return;
+  ourAsyncSetMutex.lock();
+  if (!ourAsync)
+  {
+    ourAsyncSetMutex.unlock();
+    return;
+  }
+  queuePos = ourAsyncQueuePos;
+  while ((long)(ourAsyncWritePos - queuePos) < 0 && start.mSecSince() < 10000)
+  {
+    ourAsyncCondition->signal();
+    ArUtil::sleep(1);
+  }
+  ourAsyncSetMutex.unlock();
+}
+
+AREXPORT long ArLog::getAsyncNumDropped(LogLevel level)
+{
+  if (level < Terse || level > Verbose)
+    return 0;
+  return ourAsyncDropped[level];
+}
+
+AREXPORT void ArLog::resetAsyncNumDropped(void)
+{
+  ourMutex.lock();
+  ourAsyncDropped[Terse] = 0;
+  ourAsyncDropped[Normal] = 0;
+  ourAsyncDropped[Verbose] = 0;
+  ourAsyncReportedDropped = 0;
+  ourMutex.unlock();
+}
+
+/**
+   @return true if the message was queued or dropped, false if async
+   logging isn't on (so the caller should write the message itself)
+**/
+AREXPORT bool ArLog::asyncQueue(LogLevel level, const char *message)
+{
+  ArLogAsyncRecord *record;
+  unsigned long pos;
+  long diff;
+  size_t len;
+
+  if (!ourAsync || ourAsyncRecords == NULL)
+    return false;
+  // this is counted before ourAsync is checked again, so either
+  // setAsync(false) sees us and waits or we see that it's off
+  asyncIncrement(&ourAsyncQueuing);
+  if (!ourAsync)
+  {
+    asyncDecrement(&ourAsyncQueuing);
+    return false;
+  }
+
+  pos = ourAsyncQueuePos;
+  while (1)
+  {
+    record = &ourAsyncRecords[pos & ourAsyncMask];
+    diff = (long)(record->mySequence - pos);
+    asyncMemoryBarrier();
+    // the record is free, try to claim it
+    if (diff == 0)
+    {
+      if (asyncCompareAndSwap(&ourAsyncQueuePos, pos, pos + 1))
+	break;
+      pos = ourAsyncQueuePos;
+    }
+    // the queue is full
+    else if (diff < 0)
+    {
+      if ((ourAsyncDropPolicy == Wait || 
+	   (ourAsyncDropPolicy == DropNewUnlessTerse && level == Terse)) &&
+	  ourAsyncRunning && ArThread::osSelf() != ourAsyncWriterSelf)
+      {
+	ourAsyncCondition->signal();
+	ArUtil::sleep(1);
+	pos = ourAsyncQueuePos;
+	continue;
+      }
+      if (level >= Terse && level <= Verbose)
+	asyncIncrement(&ourAsyncDropped[level]);
+      asyncDecrement(&ourAsyncQueuing);
+      return true;
+    }
+    // someone else claimed it first
+    else
+      pos = ourAsyncQueuePos;
+  }
+
+  record->myLevel = level;
+  record->myTime = time(NULL);
+  len = strlen(message);
+  if (len < sizeof(record->myMessage))
+  {
+    memcpy(record->myMessage, message, len + 1);
+    record->myLongMessage = NULL;
+  }
+  else
+  {
+    record->myLongMessage = new char[len + 1];
+    memcpy(record->myLongMessage, message, len + 1);
+  }
+  asyncMemoryBarrier();
+  record->mySequence = pos + 1;
+
+  // the writer checks every so often, but wake it up if the queue is
+  // getting full
+  if (pos - ourAsyncWritePos > ourAsyncMask / 2)
+    ourAsyncCondition->signal();
+  asyncDecrement(&ourAsyncQueuing);
+  return true;
+}
+
+/**
+   This must be called with ourMutex locked, and only from one thread
+   at a time (the writer thread, or setAsync once that has stopped).
+**/
+AREXPORT int ArLog::asyncWriteQueued(void)
+{
+  ArLogAsyncRecord *record;
+  const char *message;
+  char buf[10100];
+  int num = 0;
+  time_t now;
+  long dropped;
+
+  if (ourAsyncRecords == NULL)
+    return 0;
+
+  ourAsyncInBatch = true;
+  while (1)
+  {
+    record = &ourAsyncRecords[ourAsyncWritePos & ourAsyncMask];
+    if ((long)(record->mySequence - (ourAsyncWritePos + 1)) != 0)
+      break;
+    asyncMemoryBarrier();
+    if (record->myLongMessage != NULL)
+      message = record->myLongMessage;
+    else
+      message = record->myMessage;
+    if (ourLoggingTime)
+    {
+      // 20 is the part of the ctime we want, like the normal log
+      strncpy(buf, ctime(&record->myTime), 20);
+      buf[20] = '\0';
+      strncpy(&buf[20], message, sizeof(buf) - 21);
+      buf[sizeof(buf) - 1] = '\0';
+      writeMessage(buf);
+    }
+    else
+      writeMessage(message);
+    if (record->myLongMessage != NULL)
+    {
+      delete [] record->myLongMessage;
+      record->myLongMessage = NULL;
+    }
+    asyncMemoryBarrier();
+    record->mySequence = ourAsyncWritePos + ourAsyncMask + 1;
+    ourAsyncWritePos++;
+    num++;
+  }
+
+  dropped = (ourAsyncDropped[Terse] + ourAsyncDropped[Normal] + 
+	     ourAsyncDropped[Verbose]);
+  if (dropped != ourAsyncReportedDropped)
+  {
+    int timeLen = 0;
+    if (ourLoggingTime)
+    {
+      now = time(NULL);
+      strncpy(buf, ctime(&now), 20);
+      timeLen = 20;
+    }
+    snprintf(&buf[timeLen], sizeof(buf) - timeLen, 
+	     "ArLog: %ld messages dropped since the log queue was full (%ld terse, %ld normal, %ld verbose total)", 
+	     dropped - ourAsyncReportedDropped, ourAsyncDropped[Terse], 
+	     ourAsyncDropped[Normal], ourAsyncDropped[Verbose]);
+    writeMessage(buf);
+    ourAsyncReportedDropped = dropped;
+  }
+  ourAsyncInBatch = false;
+
+  if (num > 0)
+  {
+    if (ourFP)
+      fflush(ourFP);
+    else if (ourType != None && ourType != Colbert)
+      fflush(stdout);
+  }
+  return num;
+}
+
+AREXPORT void ArLog::asyncWriterThread(void)
+{
+  int num;
+  ourAsyncWriterSelf = ArThread::osSelf();
+  while (ourAsyncRunning)
+  {
+    ourMutex.lock();
+    num = asyncWriteQueued();
+    ourMutex.unlock();
+    if (num == 0)
+      ourAsyncCondition->timedWait(10);
+  }
+}
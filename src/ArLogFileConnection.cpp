@@ -37,6 +37,9 @@ AREXPORT ArLogFileConnection::ArLogFileConnection()
   myLogFile = NULL;
   myFD = NULL;
   stopAfter = 1;
+  myFastReplay = false;
+  myMSecPerPacket = 100;
+  myUsingVirtualClock = false;
   strcpy(myName, "random");
   strcpy(myType, "amigo");
   strcpy(mySubtype, "amigo");
@@ -44,8 +47,7 @@ AREXPORT ArLogFileConnection::ArLogFileConnection()
 
 AREXPORT ArLogFileConnection::~ArLogFileConnection()
 {
-  if (myFD != NULL)
-    fclose(myFD);
+  close();
 }
 
 
@@ -57,6 +59,32 @@ AREXPORT void ArLogFileConnection::setLogFile(const char *fname)
     myLogFile = fname;
 }
 
+/**
+   Turning this on needs to be done before the log is opened, since
+   opening the log is what starts the virtual clock.  Turning it off
+   puts ArTime back on the system clock.  The log has no times in it,
+   so each packet is taken to be a robot cycle after the last.
+
+   @param fastReplay if true replay the log as fast as possible on
+   ArTime's virtual clock, if false replay it at the speed it was
+   recorded at (on the system clock)
+
+   @param mSecPerPacket how many milliseconds the virtual clock moves
+   for each packet (this should be the cycle time of the robot the
+   log was recorded on)
+**/
+AREXPORT void ArLogFileConnection::setFastReplay(bool fastReplay, 
+						 unsigned int mSecPerPacket)
+{
+  myFastReplay = fastReplay;
+  myMSecPerPacket = mSecPerPacket;
+  if (!myFastReplay && myUsingVirtualClock)
+  {
+    ArTime::setUseVirtualClock(false);
+    myUsingVirtualClock = false;
+  }
+}
+
 AREXPORT bool ArLogFileConnection::openSimple(void)
 {
   if (internalOpen() == 0)
@@ -125,6 +153,15 @@ AREXPORT int ArLogFileConnection::internalOpen(void)
         }
     }
 
+  // the virtual clock starts at the system's time (so times already
+  // taken don't end up in the future), so it's the times since the
+  // log was opened that come out the same every replay
+  if (myFastReplay && !myUsingVirtualClock)
+  {
+    ArTime::setUseVirtualClock(true);
+    myUsingVirtualClock = true;
+  }
+
   myStatus = STATUS_OPEN;
   return 0;
 }
@@ -146,6 +183,11 @@ AREXPORT bool ArLogFileConnection::close(void)
   if (myFD != NULL)
     fclose(myFD);
   myFD = NULL;
+  if (myUsingVirtualClock)
+  {
+    ArTime::setUseVirtualClock(false);
+    myUsingVirtualClock = false;
+  }
   return true;
 }
 
@@ -154,7 +196,7 @@ AREXPORT int ArLogFileConnection::read(const char *data, unsigned int size,
 {
   ArTime timeDone;
   unsigned int bytesRead = 0;
-  int n;
+  int n = 0;
 
   if (getStatus() != STATUS_OPEN) 
   {
@@ -170,9 +212,14 @@ AREXPORT int ArLogFileConnection::read(const char *data, unsigned int size,
                msWait);
   }
 
-  if (stopAfter-- <= 0)
+  // there's one packet per robot cycle, so when we say there's
+  // nothing more to read the cycle is done and the virtual clock
+  // moves on (past the end of the log each read is a cycle)
+  if (stopAfter-- <= 0 || (myFastReplay && myFD == NULL))
     {
       stopAfter= 1;
+      if (myFastReplay)
+        ArTime::advanceVirtualClock(myMSecPerPacket);
       return 0;
     }
 
@@ -181,6 +228,16 @@ AREXPORT int ArLogFileConnection::read(const char *data, unsigned int size,
       char line[1000];
       if (fgets(line, 1000, myFD) == NULL) // done with file, close
         {
+          // when replaying fast leave the connection open so that
+          // the robot times out on the virtual clock
+          if (myFastReplay)
+            {
+              fclose(myFD);
+              myFD = NULL;
+              stopAfter = 1;
+              ArTime::advanceVirtualClock(myMSecPerPacket);
+              return 0;
+            }
           close();
           return -1;
         }
@@ -512,7 +512,9 @@ AREXPORT ArMap::ArMap(const char *baseDirectory,
 
   myIsQuiet(false),
 
-  myProcessFileCB(this, &ArMap::processFile)
+  myProcessFileCB(this, &ArMap::processFile),
+  myGridIndexCellSize(1000),
+  myGridIndexMap()
 {
   myMutex.setLogName("ArMap::myMutex");
   myConfigMapName[0] = '\0';
@@ -567,7 +569,9 @@ AREXPORT ArMap::ArMap(const ArMap &other) :
   myIsQuiet(false),
 
   //myCurrentMapChangedCB(this, &ArMap::handleCurrentMapChanged),
-  myProcessFileCB(this, &ArMap::processFile)
+  myProcessFileCB(this, &ArMap::processFile),
+  myGridIndexCellSize(other.myGridIndexCellSize),
+  myGridIndexMap()
 {
   myMutex.setLogName("ArMap::myMutex");
   myConfigMapName[0] = '\0';
@@ -607,6 +611,8 @@ AREXPORT ArMap &ArMap::operator=(const ArMap &other)
     **/
 
     *myCurrentMap = *other.myCurrentMap;
+    clearGridIndices();
+    myGridIndexCellSize = other.myGridIndexCellSize;
     
     delete myLoadingMap;
     myLoadingMap = NULL;
@@ -631,6 +637,8 @@ AREXPORT ArMap &ArMap::operator=(const ArMap &other)
 
 AREXPORT ArMap::~ArMap(void)
 { 
+  clearGridIndices();
+
   delete myLoadingMap;
   //myLoadingMap = NULL;
 
@@ -664,6 +672,7 @@ AREXPORT bool ArMap::set(ArMapInterface *other)
   // TODO: What about mapChanged and times?
 
   bool isSuccess = myCurrentMap->set(other);
+  clearGridIndices();
   return isSuccess;
 
 } // end method set
@@ -672,6 +681,7 @@ AREXPORT bool ArMap::set(ArMapInterface *other)
 AREXPORT void ArMap::clear()
 {
   myCurrentMap->clear();
+  clearGridIndices();
 }
 
 
@@ -749,6 +759,7 @@ AREXPORT bool ArMap::readFile(const char *fileName,
                                  myCurrentMap->getTempDirectory(), 
                                  "ArMapLoading::myMutex");
   myLoadingMap->setQuiet(myIsQuiet);
+  myLoadingMap->setUseBinaryFile(myCurrentMap->getUseBinaryFile());
 
   std::string realFileName = ArMapInterface::createRealFileName
                                                   (myBaseDirectory.c_str(),
@@ -961,6 +972,8 @@ AREXPORT void ArMap::setQuiet(bool isQuiet)
 
 AREXPORT void ArMap::mapChanged(void)
 { 
+  // the indices are rebuilt from the new points and lines when asked for
+  clearGridIndices();
   myCurrentMap->mapChanged();
 
 } // end method mapChanged
@@ -1286,6 +1299,7 @@ AREXPORT void ArMap::setPoints(const std::vector<ArPose> *points,
                                ArMapChangeDetails *changeDetails)
 { 
   myCurrentMap->setPoints(points, scanType, isSorted, changeDetails);
+  clearGridIndices();
 
 } // end method setPoints
 
@@ -1295,6 +1309,7 @@ AREXPORT void ArMap::setLines(const std::vector<ArLineSegment> *lines,
                               ArMapChangeDetails *changeDetails)
 { 
   myCurrentMap->setLines(lines, scanType, isSorted, changeDetails);
+  clearGridIndices();
 
 } // end method setLines
 
@@ -1508,6 +1523,24 @@ void ArMap::handleCurrentMapChanged()
 } // end method handleCurrentMapChanged
 ***/
 
+AREXPORT void ArMap::setUseBinaryFile(bool isUseBinaryFile)
+{
+  myCurrentMap->setUseBinaryFile(isUseBinaryFile);
+}
+
+AREXPORT bool ArMap::getUseBinaryFile() const
+{
+  return myCurrentMap->getUseBinaryFile();
+}
+
+AREXPORT bool ArMap::writeBinaryFile(void)
+{
+  lock();
+  bool isSuccess = myCurrentMap->writeBinaryFile(true);
+  unlock();
+  return isSuccess;
+}
+
 AREXPORT bool ArMap::refresh()
 {
   ArLog::log(ArLog::Normal, "ArMap::refresh()");
@@ -1587,6 +1620,75 @@ bool ArMap::processFile(char *errorBuffer, size_t errorBufferLen)
 } // end method processFile
 
 
+/**
+ * The index is built from the points and lines of the scan type the
+ * first time it is asked for, and kept until the map changes (it is
+ * thrown away by mapChanged(), and when the points or lines are set
+ * through this ArMap).  So if you change the points or lines you get
+ * from getPoints() or getLines() you need to call mapChanged() (as you
+ * do anyways) before using the index again.
+ * <p>
+ * Like getPoints(), the map should be locked while this is called and
+ * while the index is used.
+ *
+ * @param scanType the scan type whose points and lines to index
+ * @return the index, which belongs to the map and should not be deleted
+ * @see ArMapGridIndex
+**/
+AREXPORT ArMapGridIndex *ArMap::getGridIndex(const char *scanType)
+{
+  std::string scanTypeStr = ((scanType != NULL) ? scanType : "");
+  std::map<std::string, ArMapGridIndex *>::iterator iter = 
+                                           myGridIndexMap.find(scanTypeStr);
+  if (iter != myGridIndexMap.end()) {
+    return iter->second;
+  }
+
+  ArTime started;
+  ArMapGridIndex *gridIndex = new ArMapGridIndex(myGridIndexCellSize);
+  gridIndex->build(getPoints(scanType), getLines(scanType));
+  myGridIndexMap[scanTypeStr] = gridIndex;
+
+  ArLog::log(ArLog::Verbose,
+             "ArMap::getGridIndex() Indexed %d points and %d lines for scan type \"%s\" in %ld msecs",
+             gridIndex->getNumPoints(), gridIndex->getNumLines(),
+             scanTypeStr.c_str(), started.mSecSince());
+  return gridIndex;
+
+} // end method getGridIndex
+
+
+/**
+ * Indices that were already built keep their cell size until the map
+ * next changes.
+**/
+AREXPORT void ArMap::setGridIndexCellSize(double cellSize)
+{
+  myGridIndexCellSize = cellSize;
+
+} // end method setGridIndexCellSize
+
+
+AREXPORT double ArMap::getGridIndexCellSize(void) const
+{
+  return myGridIndexCellSize;
+
+} // end method getGridIndexCellSize
+
+
+void ArMap::clearGridIndices()
+{
+  for (std::map<std::string, ArMapGridIndex *>::iterator iter = 
+                                                   myGridIndexMap.begin();
+       iter != myGridIndexMap.end();
+       iter++) {
+    delete iter->second;
+  }
+  myGridIndexMap.clear();
+
+} // end method clearGridIndices
+
+
 AREXPORT bool ArMap::readFileAndChangeConfig(const char *fileName)
 {
   std::string beforeFileName = myConfigMapName;
@@ -32,6 +32,11 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include <process.h>
 #endif 
 #include <ctype.h>
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "ArFileParser.h"
 #include "ArMapUtils.h"
@@ -44,6 +49,204 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #define IFDEBUG(code)
 #endif 
 
+// ---------------------------------------------------------------------------- 
+// ArMapBinaryData
+// ---------------------------------------------------------------------------- 
+
+/// Identifies a binary map file (see ArMapSimple::setUseBinaryFile())
+static const char ourBinaryMagic[8] = { 'A', 'r', 'M', 'a', 'p', 'B', 'i', 'n' };
+/// Incremented whenever the layout of the binary map file changes
+static const ArTypes::UByte4 ourBinaryVersion = 1;
+/// Written in host byte order, so that files from other hosts are rejected
+static const ArTypes::UByte4 ourBinaryByteOrder = 0x01020304;
+
+/// Header at the start of a binary map file.
+/**
+ * The header is followed by the map header text (NUL-terminated) and then
+ * by one section per scan type, in the order of the map's scan type list.
+ * All sections start at a multiple of 8 bytes.
+**/
+struct ArMapBinaryHeader 
+{
+  char myMagic[8];
+  ArTypes::UByte4 myVersion;
+  ArTypes::UByte4 myByteOrder;
+  /// Size of the text map file from which the binary file was written
+  long long myFileSize;
+  /// Modification time of the text map file from which the binary file was written
+  long long myFileTimestamp;
+  ArTypes::UByte4 myChecksumLength;
+  unsigned char myChecksum[ArMD5Calculator::DIGEST_LENGTH];
+  /// Length of the map header text, including the terminating NUL
+  ArTypes::UByte4 myHeaderTextLength;
+  ArTypes::UByte4 myNumScans;
+  ArTypes::UByte4 myPad;
+};
+
+/// Header at the start of each scan section of a binary map file.
+/**
+ * The header is followed by the scan type (NUL-terminated), the packed 
+ * x, y coordinates of the data points, and the packed x1, y1, x2, y2 
+ * coordinates of the data lines, each padded to a multiple of 8 bytes.
+**/
+struct ArMapBinaryScanHeader 
+{
+  ArTypes::UByte4 myScanTypeLength;
+  ArTypes::Byte4 myNumPoints;
+  ArTypes::Byte4 myNumLines;
+  ArTypes::UByte4 myPad;
+  double myMin[2];
+  double myMax[2];
+  double myLineMin[2];
+  double myLineMax[2];
+};
+
+/// Rounds the given length up to the alignment of the binary map file sections.
+static size_t binaryPadLength(size_t len)
+{
+  return (len + 7) & ~((size_t) 7);
+}
+
+/// Writes the given data followed by padding up to the section alignment.
+static bool binaryWrite(FILE *file, const void *data, size_t len)
+{
+  static const char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+  size_t padLen = binaryPadLength(len) - len;
+
+  return (((len == 0) || (fwrite(data, len, 1, file) == 1)) &&
+          ((padLen == 0) || (fwrite(padding, padLen, 1, file) == 1)));
+}
+
+/// Accumulates the map header text that is stored in the binary map file.
+static void appendBinaryHeaderText(const char *text, std::string *headerText)
+{
+  *headerText += text;
+}
+
+/// Read-only contents of a binary map file, shared by the scans loaded from it.
+/**
+ * The file is memory mapped (except on Windows, where it is simply read), 
+ * so the data points and lines are only paged in when a scan actually 
+ * converts them.  The data is reference counted because the map (and 
+ * therefore its scans) may be copied before the points are loaded.
+**/
+class ArMapBinaryData
+{
+public:
+
+  /// Opens the given binary map file; returns NULL if it cannot be read.
+  static ArMapBinaryData *open(const char *fileName);
+
+  /// Adds a reference to the data.
+  void addRef();
+  /// Removes a reference to the data, and deletes it if it was the last one.
+  void release();
+
+  /// Returns a pointer to len bytes at offset, or NULL if they are not all in the file.
+  const char *getSection(size_t offset, size_t len) const
+  {
+    if ((offset > mySize) || (len > mySize - offset)) {
+      return NULL;
+    }
+    return myData + offset;
+  }
+
+protected:
+
+  ArMapBinaryData(char *data, size_t size, bool isMapped);
+  ~ArMapBinaryData();
+
+  ArMutex myMutex;
+  int myRefCount;
+  char *myData;
+  size_t mySize;
+  bool myIsMapped;
+
+}; // end class ArMapBinaryData
+
+
+ArMapBinaryData::ArMapBinaryData(char *data, size_t size, bool isMapped) :
+  myMutex(),
+  myRefCount(1),
+  myData(data),
+  mySize(size),
+  myIsMapped(isMapped)
+{
+  myMutex.setLogName("ArMapBinaryData::myMutex");
+}
+
+ArMapBinaryData::~ArMapBinaryData()
+{
+#ifndef WIN32
+  if (myIsMapped) {
+    munmap(myData, mySize);
+    return;
+  }
+#endif 
+  delete [] myData;
+}
+
+ArMapBinaryData *ArMapBinaryData::open(const char *fileName)
+{
+#ifndef WIN32
+  int fd = ::open(fileName, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat fileStat;
+  if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size <= 0)) {
+    close(fd);
+    return NULL;
+  }
+  void *data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+  if (data == MAP_FAILED) {
+    ArLog::log(ArLog::Normal,
+               "ArMapBinaryData::open() could not map %s",
+               fileName);
+    return NULL;
+  }
+  return new ArMapBinaryData((char *) data, fileStat.st_size, true);
+#else
+  FILE *file = ArUtil::fopen(fileName, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  struct stat fileStat;
+  if ((fstat(fileno(file), &fileStat) != 0) || (fileStat.st_size <= 0)) {
+    fclose(file);
+    return NULL;
+  }
+  char *data = new char[fileStat.st_size];
+  size_t readLen = fread(data, 1, fileStat.st_size, file);
+  fclose(file);
+  if (readLen != (size_t) fileStat.st_size) {
+    delete [] data;
+    return NULL;
+  }
+  return new ArMapBinaryData(data, fileStat.st_size, false);
+#endif
+}
+
+void ArMapBinaryData::addRef()
+{
+  myMutex.lock();
+  myRefCount++;
+  myMutex.unlock();
+}
+
+void ArMapBinaryData::release()
+{
+  myMutex.lock();
+  bool isLast = (--myRefCount == 0);
+  myMutex.unlock();
+  if (isLast) {
+    delete this;
+  }
+}
+
+
 // ---------------------------------------------------------------------------- 
 // ArMapScan
 // ---------------------------------------------------------------------------- 
@@ -74,6 +277,12 @@ AREXPORT ArMapScan::ArMapScan(const char *scanType) :
   myPoints(),
   myLines(),
 
+  myLazyData(NULL),
+  myLazyPoints(NULL),
+  myLazyNumPoints(0),
+  myLazyLines(NULL),
+  myLazyNumLines(0),
+
   myMinPosCB(this, &ArMapScan::handleMinPos),
   myMaxPosCB(this, &ArMapScan::handleMaxPos),
   myIsSortedPointsCB(this, &ArMapScan::handleIsSortedPoints),
@@ -134,6 +343,13 @@ AREXPORT ArMapScan::ArMapScan(const ArMapScan &other) :
   myPoints(other.myPoints),
   myLines(other.myLines),
 
+  // Any points and lines that are still in the binary map file are shared
+  myLazyData(other.myLazyData),
+  myLazyPoints(other.myLazyPoints),
+  myLazyNumPoints(other.myLazyNumPoints),
+  myLazyLines(other.myLazyLines),
+  myLazyNumLines(other.myLazyNumLines),
+
   // Not entirely sure what to do with these in a copy ctor situation...
   // but this seems safest
   myMinPosCB(this, &ArMapScan::handleMinPos),
@@ -153,9 +369,12 @@ AREXPORT ArMapScan::ArMapScan(const ArMapScan &other) :
   myPointCB(this, &ArMapScan::handlePoint),
   myLineCB(this, &ArMapScan::handleLine)
 {
+  if (myLazyData != NULL) {
+    myLazyData->addRef();
+  }
 
   if (!myIsSummaryScan) {
-    myNumLines = other.myLines.size();
+    myNumLines = other.myLines.size() + other.myLazyNumLines;
   }
   else {
     myNumLines = other.myNumLines;
@@ -169,7 +388,7 @@ AREXPORT ArMapScan::ArMapScan(const ArMapScan &other) :
   }
 
   if (!myIsSummaryScan) {
-    myNumPoints = other.myPoints.size();
+    myNumPoints = other.myPoints.size() + other.myLazyNumPoints;
   }
   else {
     myNumPoints = other.myNumPoints;
@@ -203,7 +422,7 @@ AREXPORT ArMapScan &ArMapScan::operator=(const ArMapScan &other)
     //myNumPoints   = other.myNumPoints;
     //myNumLines = other.myNumLines;
     if (!myIsSummaryScan) {
-      myNumLines = other.myLines.size();
+      myNumLines = other.myLines.size() + other.myLazyNumLines;
     }
     else {
       myNumLines = other.myNumLines;
@@ -217,7 +436,7 @@ AREXPORT ArMapScan &ArMapScan::operator=(const ArMapScan &other)
     }
 
     if (!myIsSummaryScan) {
-      myNumPoints = other.myPoints.size();
+      myNumPoints = other.myPoints.size() + other.myLazyNumPoints;
     }
     else {
       myNumPoints = other.myNumPoints;
@@ -239,6 +458,16 @@ AREXPORT ArMapScan &ArMapScan::operator=(const ArMapScan &other)
     myIsSortedLines = other.myIsSortedLines;
     myPoints = other.myPoints;
     myLines = other.myLines;
+
+    releaseLazyData();
+    if (other.myLazyData != NULL) {
+      other.myLazyData->addRef();
+    }
+    myLazyData = other.myLazyData;
+    myLazyPoints = other.myLazyPoints;
+    myLazyNumPoints = other.myLazyNumPoints;
+    myLazyLines = other.myLazyLines;
+    myLazyNumLines = other.myLazyNumLines;
   }
   return *this;
 }
@@ -246,6 +475,7 @@ AREXPORT ArMapScan &ArMapScan::operator=(const ArMapScan &other)
 
 AREXPORT ArMapScan::~ArMapScan()
 {
+  releaseLazyData();
 }
 
 AREXPORT bool ArMapScan::addToFileParser(ArFileParser *fileParser)
@@ -358,6 +588,8 @@ AREXPORT void ArMapScan::clear()
   myPoints.clear();
   myLines.clear();
 
+  releaseLazyData();
+
 } // end method clear
 
 AREXPORT const char *ArMapScan::getDisplayString(const char *scanType)
@@ -367,11 +599,13 @@ AREXPORT const char *ArMapScan::getDisplayString(const char *scanType)
 
 AREXPORT std::vector<ArPose> *ArMapScan::getPoints(const char *scanType)
 {
+  loadLazyPoints();
   return &myPoints;
 }
 
 AREXPORT std::vector<ArLineSegment> *ArMapScan::getLines(const char *scanType)
 {
+  loadLazyLines();
   return &myLines;
 }
 
@@ -426,6 +660,8 @@ AREXPORT void ArMapScan::setPoints(const std::vector<ArPose> *points,
                                    bool isSorted,
                                    ArMapChangeDetails *changeDetails)
 {
+  loadLazyPoints();
+
   if (!myIsSortedPoints) {
 	  std::sort(myPoints.begin(), myPoints.end());
     myIsSortedPoints = true;
@@ -606,6 +842,8 @@ AREXPORT void ArMapScan::setLines(const std::vector<ArLineSegment> *lines,
                                   bool isSorted,
                                   ArMapChangeDetails *changeDetails)
 {
+  loadLazyLines();
+
   if (!myIsSortedLines) {
 	  std::sort(myLines.begin(), myLines.end());
     myIsSortedLines = true;
@@ -830,6 +1068,7 @@ AREXPORT void ArMapScan::writePointsToFunctor
                           getPointsKeyword(),
                           "");
   }
+  loadLazyPoints();
 	functor->invoke(myNumPoints, &myPoints);
 
 } // end method writePointsToFunctor
@@ -845,6 +1084,7 @@ AREXPORT void ArMapScan::writeLinesToFunctor
                           getLinesKeyword(),
                           "");
   }
+  loadLazyLines();
 	functor->invoke(myNumLines, &myLines);
 } // end method writeLinesToFunctor
 
@@ -914,6 +1154,8 @@ AREXPORT void ArMapScan::writePointsToFunctor
                         getPointsKeyword(),
                         endOfLineChars);
 
+  loadLazyPoints();
+
   if (myPoints.empty()) {
     return;
   }
@@ -962,6 +1204,7 @@ AREXPORT void ArMapScan::writeLinesToFunctor
                                  const char *endOfLineChars,
                                  const char *scanType)
 {
+  loadLazyLines();
   writeLinesToFunctor(functor, myLines, endOfLineChars, scanType);
 
 } // end method writeLinesToFunctor
@@ -1309,6 +1552,7 @@ AREXPORT void ArMapScan::loadDataPoint(double x, double y)
   if (y < myMin.getY())
     myMin.setY(y);
   
+  loadLazyPoints();
   myPoints.push_back(ArPose(x, y));
   
 } // end method loadDataPoint
@@ -1337,11 +1581,216 @@ AREXPORT void ArMapScan::loadLineSegment(double x1, double y1,
   if (y2 < myLineMin.getY())
     myLineMin.setY(y2);
   
+  loadLazyLines();
   myLines.push_back(ArLineSegment(x1, y1, x2, y2));
 
 } // end method loadLineSegment
 
 
+AREXPORT bool ArMapScan::writeBinaryToFile(FILE *file)
+{
+  loadLazyPoints();
+  loadLazyLines();
+
+  ArMapBinaryScanHeader header;
+  memset(&header, 0, sizeof(header));
+
+  header.myScanTypeLength = myScanType.length() + 1;
+  header.myNumPoints = myPoints.size();
+  header.myNumLines = myLines.size();
+  header.myMin[0] = myMin.getX();
+  header.myMin[1] = myMin.getY();
+  header.myMax[0] = myMax.getX();
+  header.myMax[1] = myMax.getY();
+  header.myLineMin[0] = myLineMin.getX();
+  header.myLineMin[1] = myLineMin.getY();
+  header.myLineMax[0] = myLineMax.getX();
+  header.myLineMax[1] = myLineMax.getY();
+
+  if (!binaryWrite(file, &header, sizeof(header)) ||
+      !binaryWrite(file, myScanType.c_str(), header.myScanTypeLength)) {
+    return false;
+  }
+
+  // The coordinates are truncated to integers just like the text map file,
+  // so reading either file results in the same map.
+  std::vector<ArTypes::Byte4> coords;
+  size_t i = 0;
+
+  coords.reserve(myPoints.size() * 2);
+  for (i = 0; i < myPoints.size(); i++) {
+    if ((fabs(myPoints[i].getX()) >= INT_MAX) || 
+        (fabs(myPoints[i].getY()) >= INT_MAX)) {
+      ArLog::log(ArLog::Normal,
+                 "%sArMapScan::writeBinaryToFile() point %.0f %.0f out of range",
+                 myLogPrefix.c_str(), 
+                 myPoints[i].getX(), myPoints[i].getY());
+      return false;
+    }
+    coords.push_back((ArTypes::Byte4) myPoints[i].getX());
+    coords.push_back((ArTypes::Byte4) myPoints[i].getY());
+  }
+  if (!binaryWrite(file, 
+                   (coords.empty() ? NULL : &coords[0]),
+                   coords.size() * sizeof(ArTypes::Byte4))) {
+    return false;
+  }
+
+  coords.clear();
+  coords.reserve(myLines.size() * 4);
+  for (i = 0; i < myLines.size(); i++) {
+    const ArLineSegment &line = myLines[i];
+    if ((fabs(line.getX1()) >= INT_MAX) || (fabs(line.getY1()) >= INT_MAX) ||
+        (fabs(line.getX2()) >= INT_MAX) || (fabs(line.getY2()) >= INT_MAX)) {
+      ArLog::log(ArLog::Normal,
+                 "%sArMapScan::writeBinaryToFile() line out of range",
+                 myLogPrefix.c_str());
+      return false;
+    }
+    coords.push_back((ArTypes::Byte4) line.getX1());
+    coords.push_back((ArTypes::Byte4) line.getY1());
+    coords.push_back((ArTypes::Byte4) line.getX2());
+    coords.push_back((ArTypes::Byte4) line.getY2());
+  }
+  return binaryWrite(file, 
+                     (coords.empty() ? NULL : &coords[0]),
+                     coords.size() * sizeof(ArTypes::Byte4));
+
+} // end method writeBinaryToFile
+
+
+AREXPORT bool ArMapScan::readBinaryFromData(ArMapBinaryData *data,
+                                            size_t *offsetInOut)
+{
+  if ((data == NULL) || (offsetInOut == NULL)) {
+    return false;
+  }
+  size_t offset = *offsetInOut;
+
+  const ArMapBinaryScanHeader *header = (const ArMapBinaryScanHeader *)
+                            data->getSection(offset, sizeof(ArMapBinaryScanHeader));
+  if ((header == NULL) || 
+      (header->myNumPoints < 0) || (header->myNumLines < 0)) {
+    return false;
+  }
+  offset += sizeof(ArMapBinaryScanHeader);
+
+  const char *scanType = data->getSection(offset, header->myScanTypeLength);
+  if ((scanType == NULL) || 
+      (header->myScanTypeLength != myScanType.length() + 1) ||
+      (strncmp(scanType, myScanType.c_str(), header->myScanTypeLength) != 0)) {
+    ArLog::log(ArLog::Normal,
+               "%sArMapScan::readBinaryFromData() scan type does not match",
+               myLogPrefix.c_str());
+    return false;
+  }
+  offset += binaryPadLength(header->myScanTypeLength);
+
+  // Check the counts first so that a corrupt count cannot overflow the lengths
+  if ((header->myNumPoints > (int) (INT_MAX / (2 * sizeof(ArTypes::Byte4)))) ||
+      (header->myNumLines > (int) (INT_MAX / (4 * sizeof(ArTypes::Byte4))))) {
+    return false;
+  }
+  size_t pointsLen = header->myNumPoints * 2 * sizeof(ArTypes::Byte4);
+  size_t linesLen = header->myNumLines * 4 * sizeof(ArTypes::Byte4);
+  const char *points = NULL;
+  const char *lines = NULL;
+
+  if (((points = data->getSection(offset, pointsLen)) == NULL) ||
+      ((lines = data->getSection(offset + binaryPadLength(pointsLen),
+                                 linesLen)) == NULL)) {
+    ArLog::log(ArLog::Normal,
+               "%sArMapScan::readBinaryFromData() data is truncated",
+               myLogPrefix.c_str());
+    return false;
+  }
+  offset += binaryPadLength(pointsLen) + binaryPadLength(linesLen);
+
+  releaseLazyData();
+
+  // Drop the space that was reserved when the NumPoints and NumLines 
+  // keywords were parsed
+  std::vector<ArPose>().swap(myPoints);
+  std::vector<ArLineSegment>().swap(myLines);
+
+  myMin.setPose(header->myMin[0], header->myMin[1]);
+  myMax.setPose(header->myMax[0], header->myMax[1]);
+  myLineMin.setPose(header->myLineMin[0], header->myLineMin[1]);
+  myLineMax.setPose(header->myLineMax[0], header->myLineMax[1]);
+
+  if (header->myNumPoints > 0) {
+    myLazyPoints = (const ArTypes::Byte4 *) points;
+    myLazyNumPoints = header->myNumPoints;
+  }
+  if (header->myNumLines > 0) {
+    myLazyLines = (const ArTypes::Byte4 *) lines;
+    myLazyNumLines = header->myNumLines;
+  }
+  if ((myLazyPoints != NULL) || (myLazyLines != NULL)) {
+    data->addRef();
+    myLazyData = data;
+  }
+
+  *offsetInOut = offset;
+  return true;
+
+} // end method readBinaryFromData
+
+
+void ArMapScan::loadLazyPoints()
+{
+  if (myLazyPoints == NULL) {
+    return;
+  }
+  myPoints.reserve(myPoints.size() + myLazyNumPoints);
+
+  const ArTypes::Byte4 *coord = myLazyPoints;
+  for (int i = 0; i < myLazyNumPoints; i++, coord += 2) {
+    myPoints.push_back(ArPose(coord[0], coord[1]));
+  }
+  myLazyPoints = NULL;
+  myLazyNumPoints = 0;
+
+  if (myLazyLines == NULL) {
+    releaseLazyData();
+  }
+} // end method loadLazyPoints
+
+
+void ArMapScan::loadLazyLines()
+{
+  if (myLazyLines == NULL) {
+    return;
+  }
+  myLines.reserve(myLines.size() + myLazyNumLines);
+
+  const ArTypes::Byte4 *coord = myLazyLines;
+  for (int i = 0; i < myLazyNumLines; i++, coord += 4) {
+    myLines.push_back(ArLineSegment(coord[0], coord[1], coord[2], coord[3]));
+  }
+  myLazyLines = NULL;
+  myLazyNumLines = 0;
+
+  if (myLazyPoints == NULL) {
+    releaseLazyData();
+  }
+} // end method loadLazyLines
+
+
+void ArMapScan::releaseLazyData()
+{
+  if (myLazyData != NULL) {
+    myLazyData->release();
+    myLazyData = NULL;
+  }
+  myLazyPoints = NULL;
+  myLazyNumPoints = 0;
+  myLazyLines = NULL;
+  myLazyNumLines = 0;
+
+} // end method releaseLazyData
+
+
 AREXPORT bool ArMapScan::unite(ArMapScan *other,
                                bool isIncludeDataPointsAndLines)
 {
@@ -3149,7 +3598,8 @@ AREXPORT ArMapSimple::ArMapSimple(const char *baseDirectory,
 
   myIsQuiet(false),
   myIsReadInProgress(false),
-  myIsCancelRead(false)
+  myIsCancelRead(false),
+  myIsUseBinaryFile(false)
 
 {
   if (overrideMutexName == NULL) {
@@ -3253,7 +3703,8 @@ AREXPORT ArMapSimple::ArMapSimple(const ArMapSimple &other) :
 
   myIsQuiet(false),
   myIsReadInProgress(false),
-  myIsCancelRead(false)
+  myIsCancelRead(false),
+  myIsUseBinaryFile(other.myIsUseBinaryFile)
 {
   myMapId.log("ArMapSimple::copy_ctor");
 
@@ -3997,36 +4448,7 @@ AREXPORT bool ArMapSimple::readFile(const char *fileName,
   lock();
   myIsReadInProgress = true;
 
-  if (myMapInfo != NULL) {
-    myMapInfo->clear();
-  }
-  if (myMapObjects != NULL) {
-    myMapObjects->clear();
-  }
-  if (myMapSupplement != NULL) {
-    myMapSupplement->clear();
-  }
-  for (ArTypeToScanMap::iterator iter =
-          myTypeToScanMap.begin();
-       iter != myTypeToScanMap.end();
-       iter++) {
-    ArMapScan *scan = iter->second;
-    if (scan != NULL) {
-      scan->clear();
-    }
-  } // end for each scan type
-
-  if (myInactiveInfo != NULL) {
-    myInactiveInfo->clear();
-  }
-  if (myInactiveObjects != NULL) {
-    myInactiveObjects->clear();
-  }
-  if (myChildObjects != NULL) {
-    myChildObjects->clear();
-  }
-
-  reset();
+  clearForRead();
 
   // stat(fileName, &myReadFileStat);
   FILE *file = NULL;
@@ -4039,6 +4461,40 @@ AREXPORT bool ArMapSimple::readFile(const char *fileName,
              "Opening map file %s, given %s", 
              realFileName.c_str(), fileName);
 
+  ArTime binaryTime;
+
+  if (myIsUseBinaryFile && readBinaryFile(realFileName.c_str())) {
+
+    updateSummaryScan();
+
+    ArLog::log(ArLog::Normal, 
+               "ArMapSimple::readFile() %s took %i msecs to read binary map of %i points",
+               realFileName.c_str(),
+               binaryTime.mSecSince(),
+               getNumPoints(ARMAP_SUMMARY_SCAN_TYPE));	
+
+    updateMapFileInfo(realFileName.c_str());
+
+    if ((myChecksumCalculator != NULL) && (md5DigestBuffer != NULL)) {
+      memset(md5DigestBuffer, 0, md5DigestBufferLen);
+      memcpy(md5DigestBuffer, myChecksumCalculator->getDigest(), 
+             ArUtil::findMin(md5DigestBufferLen, ArMD5Calculator::DIGEST_LENGTH));
+    }
+
+    myFileName = fileName;
+    
+    ArLog::log(myMapChangedHelper->getMapChangedLogLevel(), 
+               "ArMapSimple:: Calling mapChanged()");	
+    mapChanged();
+    ArLog::log(myMapChangedHelper->getMapChangedLogLevel(), 
+               "ArMapSimple:: Finished mapChanged()");
+
+    myIsReadInProgress = false;
+    unlock();
+    return true;
+
+  } // end if binary file read
+
 
   // Open file in binary mode to avoid conversion of CRLF in windows. 
   // This is necessary so that a consistent checksum value is obtained.
@@ -4232,6 +4688,11 @@ AREXPORT bool ArMapSimple::readFile(const char *fileName,
     if (isSuccess) {
       // move the stuff over from reading to new
       myFileName = fileName;
+
+      // The binary file was either missing or stale, so write a new one
+      if (myIsUseBinaryFile) {
+        writeBinaryFile(true);
+      }
     
       ArLog::log(myMapChangedHelper->getMapChangedLogLevel(), 
                 "ArMapSimple:: Calling mapChanged()");	
@@ -4250,6 +4711,298 @@ AREXPORT bool ArMapSimple::readFile(const char *fileName,
 } // end method readFile
 
 
+void ArMapSimple::clearForRead()
+{
+  if (myMapInfo != NULL) {
+    myMapInfo->clear();
+  }
+  if (myMapObjects != NULL) {
+    myMapObjects->clear();
+  }
+  if (myMapSupplement != NULL) {
+    myMapSupplement->clear();
+  }
+  for (ArTypeToScanMap::iterator iter =
+          myTypeToScanMap.begin();
+       iter != myTypeToScanMap.end();
+       iter++) {
+    ArMapScan *scan = iter->second;
+    if (scan != NULL) {
+      scan->clear();
+    }
+  } // end for each scan type
+
+  if (myInactiveInfo != NULL) {
+    myInactiveInfo->clear();
+  }
+  if (myInactiveObjects != NULL) {
+    myInactiveObjects->clear();
+  }
+  if (myChildObjects != NULL) {
+    myChildObjects->clear();
+  }
+
+  reset();
+
+} // end method clearForRead
+
+
+AREXPORT void ArMapSimple::setUseBinaryFile(bool isUseBinaryFile)
+{
+  myIsUseBinaryFile = isUseBinaryFile;
+}
+
+AREXPORT bool ArMapSimple::getUseBinaryFile() const
+{
+  return myIsUseBinaryFile;
+}
+
+AREXPORT std::string ArMapSimple::getBinaryFileName(const char *realFileName)
+{
+  std::string binaryFileName = ((realFileName != NULL) ? realFileName : "");
+  binaryFileName += ".bin";
+  return binaryFileName;
+}
+
+
+bool ArMapSimple::readBinaryFile(const char *realFileName)
+{
+  std::string binaryFileName = getBinaryFileName(realFileName);
+
+  struct stat textFileStat;
+  if (stat(realFileName, &textFileStat) != 0) {
+    return false;
+  }
+
+  ArMapBinaryData *data = ArMapBinaryData::open(binaryFileName.c_str());
+  if (data == NULL) {
+    ArLog::log(ArLog::Verbose,
+               "ArMapSimple::readBinaryFile() no binary file %s",
+               binaryFileName.c_str());
+    return false;
+  }
+
+  const ArMapBinaryHeader *header = (const ArMapBinaryHeader *)
+                              data->getSection(0, sizeof(ArMapBinaryHeader));
+  const char *headerText = NULL;
+
+  bool isValid = ((header != NULL) &&
+                  (memcmp(header->myMagic, ourBinaryMagic, 
+                          sizeof(ourBinaryMagic)) == 0) &&
+                  (header->myVersion == ourBinaryVersion) &&
+                  (header->myByteOrder == ourBinaryByteOrder) &&
+                  (header->myFileSize == textFileStat.st_size) &&
+                  (header->myHeaderTextLength > 0));
+  if (isValid) {
+    headerText = data->getSection(sizeof(ArMapBinaryHeader), 
+                                  header->myHeaderTextLength);
+    isValid = ((headerText != NULL) && 
+               (headerText[header->myHeaderTextLength - 1] == '\0'));
+  }
+
+  if (isValid) {
+    if (myChecksumCalculator != NULL) {
+      // The checksum of the text file is needed for the map ID anyway, and 
+      // comparing it is the only reliable way to tell that the binary file 
+      // is not stale.  This is still much faster than parsing the text.
+      FILE *file = ArUtil::fopen(realFileName, "rb");
+      char line[10000];
+
+      isValid = (file != NULL);
+      myChecksumCalculator->reset();
+      while (isValid && (fgets(line, sizeof(line), file) != NULL)) {
+        myChecksumCalculator->append(line);
+      }
+      if (file != NULL) {
+        fclose(file);
+      }
+      isValid = (isValid &&
+                 (header->myChecksumLength == ArMD5Calculator::DIGEST_LENGTH) &&
+                 (memcmp(header->myChecksum, 
+                         myChecksumCalculator->getDigest(),
+                         ArMD5Calculator::DIGEST_LENGTH) == 0));
+    }
+    else { // checksums turned off
+      isValid = (header->myFileTimestamp == textFileStat.st_mtime);
+    }
+  } // end if header valid
+
+  if (!isValid) {
+    ArLog::log(ArLog::Normal,
+               "ArMapSimple::readBinaryFile() ignoring stale binary file %s",
+               binaryFileName.c_str());
+    data->release();
+    return false;
+  }
+
+  // Parse the map header just as if it were read from the text file, 
+  // until the first data introduction keyword is found.
+  myLoadingParser->setPreParseFunctor(NULL);
+
+  char line[10000];
+  const char *lineStart = headerText;
+  const char *textEnd = headerText + header->myHeaderTextLength - 1;
+  bool isHeaderParsed = false;
+
+  while (lineStart < textEnd) {
+    const char *lineEnd = (const char *) memchr(lineStart, '\n', 
+                                                textEnd - lineStart);
+    size_t lineLen = ((lineEnd != NULL) ? lineEnd - lineStart + 1 : 
+                                          textEnd - lineStart);
+    if (lineLen >= sizeof(line)) {
+      break;
+    }
+    memcpy(line, lineStart, lineLen);
+    line[lineLen] = '\0';
+    lineStart += lineLen;
+
+    if (!myLoadingParser->parseLine(line)) {
+      isHeaderParsed = !myLoadingDataTag.empty();
+      break;
+    }
+  } // end while more header lines
+
+  isValid = (isHeaderParsed && myLoadingGotMapCategory);
+
+  // The scan sections are in the same order as the scan type list 
+  size_t offset = sizeof(ArMapBinaryHeader) + 
+                  binaryPadLength(header->myHeaderTextLength);
+
+  if (isValid && (header->myNumScans != myScanTypeList.size())) {
+    isValid = false;
+  }
+  for (std::list<std::string>::iterator iter = myScanTypeList.begin();
+       isValid && (iter != myScanTypeList.end());
+       iter++) {
+
+    ArMapScan *scan = getScan((*iter).c_str());
+
+    isValid = ((scan != NULL) && scan->readBinaryFromData(data, &offset));
+    if (isValid) {
+      // Track the data introductions as if the text file had been read
+      if (scan->getNumLines() > 0) {
+        findScanWithDataKeyword(scan->getLinesKeyword(), NULL);
+      }
+      findScanWithDataKeyword(scan->getPointsKeyword(), NULL);
+    }
+  } // end for each scan type
+
+  // The scans keep their own references to the data
+  data->release();
+
+  if (!isValid) {
+    ArLog::log(ArLog::Normal,
+               "ArMapSimple::readBinaryFile() could not read binary file %s",
+               binaryFileName.c_str());
+    clearForRead();
+    return false;
+  }
+  return true;
+
+} // end method readBinaryFile
+
+
+AREXPORT bool ArMapSimple::writeBinaryFile(bool internalCall)
+{
+  if (!internalCall) {
+    lock();
+  }
+  if (myFileName.empty()) {
+    ArLog::log(ArLog::Normal,
+               "ArMapSimple::writeBinaryFile() map has not been read or written");
+    if (!internalCall) {
+      unlock();
+    }
+    return false;
+  }
+
+  std::string realFileName = createRealFileName(myFileName.c_str());
+  std::string binaryFileName = getBinaryFileName(realFileName.c_str());
+  // Written to a temp file and then renamed, so that a map that is still 
+  // using the old file (or another process reading it) is not disturbed
+  std::string tempFileName = binaryFileName + ".tmp";
+
+  ArTime writeTime;
+
+  std::string headerText;
+  ArGlobalFunctor2<const char *, std::string *> functor(&appendBinaryHeaderText,
+                                                        "", &headerText);
+  writeHeaderToFunctor(&functor, "\n");
+  
+  // End the header with a data introduction, as in the text file
+  ArMapScan *firstScan = NULL;
+  if (!myScanTypeList.empty()) {
+    firstScan = getScan(myScanTypeList.front().c_str());
+  }
+  if (firstScan != NULL) {
+    headerText += firstScan->getPointsKeyword();
+    headerText += "\n";
+  }
+
+  ArMapBinaryHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.myMagic, ourBinaryMagic, sizeof(ourBinaryMagic));
+  header.myVersion = ourBinaryVersion;
+  header.myByteOrder = ourBinaryByteOrder;
+  header.myFileSize = myReadFileStat.st_size;
+  header.myFileTimestamp = myReadFileStat.st_mtime;
+  if ((myMapId.getChecksum() != NULL) && 
+      (myMapId.getChecksumLength() == ArMD5Calculator::DIGEST_LENGTH)) {
+    header.myChecksumLength = ArMD5Calculator::DIGEST_LENGTH;
+    memcpy(header.myChecksum, myMapId.getChecksum(), 
+           ArMD5Calculator::DIGEST_LENGTH);
+  }
+  header.myHeaderTextLength = headerText.length() + 1;
+  header.myNumScans = myScanTypeList.size();
+
+  FILE *file = ArUtil::fopen(tempFileName.c_str(), "wb");
+  bool isSuccess = (file != NULL);
+
+  isSuccess = (isSuccess &&
+               binaryWrite(file, &header, sizeof(header)) &&
+               binaryWrite(file, headerText.c_str(), header.myHeaderTextLength));
+
+  for (std::list<std::string>::iterator iter = myScanTypeList.begin();
+       isSuccess && (iter != myScanTypeList.end());
+       iter++) {
+    ArMapScan *scan = getScan((*iter).c_str());
+    isSuccess = ((scan != NULL) && scan->writeBinaryToFile(file));
+  }
+
+  if (file != NULL) {
+    if (fclose(file) != 0) {
+      isSuccess = false;
+    }
+  }
+  if (isSuccess) {
+#ifdef WIN32
+    // rename does not replace an existing file on Windows
+    remove(binaryFileName.c_str());
+#endif
+    isSuccess = (rename(tempFileName.c_str(), binaryFileName.c_str()) == 0);
+  }
+
+  if (isSuccess) {
+    ArLog::log(ArLog::Normal,
+               "ArMapSimple::writeBinaryFile() took %i msecs to write %s",
+               writeTime.mSecSince(),
+               binaryFileName.c_str());
+  }
+  else {
+    ArLog::log(ArLog::Terse,
+               "ArMapSimple::writeBinaryFile() could not write %s",
+               binaryFileName.c_str());
+    remove(tempFileName.c_str());
+  }
+
+  if (!internalCall) {
+    unlock();
+  }
+  return isSuccess;
+
+} // end method writeBinaryFile
+
+
 AREXPORT bool ArMapSimple::isDataTag(const char *line) 
 {
   // Pre: Line is not null
@@ -4498,6 +5251,10 @@ AREXPORT bool ArMapSimple::writeFile(const char *fileName,
   // Reset the file statistics to reflect the newly written file.	
 	stat(realFileName.c_str(), &myReadFileStat);
 
+  if (myIsUseBinaryFile) {
+    writeBinaryFile(true);
+  }
+
   if (myChecksumCalculator != NULL) {
 
     if (md5DigestBuffer != NULL) {
@@ -5682,6 +6439,38 @@ AREXPORT void ArMapSimple::writeSupplementToFunctor(ArFunctor1<const char *> *fu
 
 AREXPORT void ArMapSimple::writeToFunctor(ArFunctor1<const char *> *functor, 
 			                                    const char *endOfLineChars)
+{ 
+  writeHeaderToFunctor(functor, endOfLineChars);
+
+  std::list<std::string>::iterator iter = myScanTypeList.end();
+
+  // Write the lines...
+  for (iter = myScanTypeList.begin(); iter != myScanTypeList.end(); iter++) {
+
+    const char *scanType = (*iter).c_str();
+    ArMapScan *mapScan = getScan(scanType);
+    
+    if (mapScan != NULL) {
+      mapScan->writeLinesToFunctor(functor, endOfLineChars, scanType);
+    }
+  }
+
+  // Write the points...
+  for (iter = myScanTypeList.begin(); iter != myScanTypeList.end(); iter++) {
+
+    const char *scanType = (*iter).c_str();
+    ArMapScan *mapScan = getScan(scanType);
+    
+    if (mapScan != NULL) {
+      mapScan->writePointsToFunctor(functor, endOfLineChars, scanType);
+    }
+  } 
+
+} // end method writeToFunctor
+
+
+void ArMapSimple::writeHeaderToFunctor(ArFunctor1<const char *> *functor, 
+			                                 const char *endOfLineChars)
 { 
   // Write the header information and Cairn objects...
   ArUtil::functorPrintf(functor, "%s%s", 
@@ -5730,30 +6519,7 @@ AREXPORT void ArMapSimple::writeToFunctor(ArFunctor1<const char *> *functor,
 
   } // end for each remainder line
 
-
-  // Write the lines...
-  for (iter = myScanTypeList.begin(); iter != myScanTypeList.end(); iter++) {
-
-    const char *scanType = (*iter).c_str();
-    ArMapScan *mapScan = getScan(scanType);
-    
-    if (mapScan != NULL) {
-      mapScan->writeLinesToFunctor(functor, endOfLineChars, scanType);
-    }
-  }
-
-  // Write the points...
-  for (iter = myScanTypeList.begin(); iter != myScanTypeList.end(); iter++) {
-
-    const char *scanType = (*iter).c_str();
-    ArMapScan *mapScan = getScan(scanType);
-    
-    if (mapScan != NULL) {
-      mapScan->writePointsToFunctor(functor, endOfLineChars, scanType);
-    }
-  } 
-
-} // end method writeToFunctor
+} // end method writeHeaderToFunctor
 
 
 AREXPORT ArMapInfoInterface *ArMapSimple::getInactiveInfo()
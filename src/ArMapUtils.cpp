@@ -559,6 +559,683 @@ AREXPORT bool ArMapId::create(const char *mapFileName,
 } // end method create
 
 
+// -----------------------------------------------------------------------------
+// ArMapGridIndex
+// -----------------------------------------------------------------------------
+
+// The most cells a grid will have, if the map is big enough for more
+// than this the cells are made bigger
+static const double ARMAPGRIDINDEX_MAX_CELLS = 4000000;
+
+/// Clips the segment from (x1, y1) to (x2, y2) to a box, returns false if none of it is in the box
+static bool armapGridIndexClip(double x1, double y1, double x2, double y2,
+                               double minX, double minY, 
+                               double maxX, double maxY,
+                               double *tEnter, double *tExit)
+{
+  double p[4];
+  double q[4];
+  double t0 = 0;
+  double t1 = 1;
+  double r;
+  int i;
+
+  p[0] = x1 - x2;  q[0] = x1 - minX;
+  p[1] = x2 - x1;  q[1] = maxX - x1;
+  p[2] = y1 - y2;  q[2] = y1 - minY;
+  p[3] = y2 - y1;  q[3] = maxY - y1;
+
+  for (i = 0; i < 4; i++) 
+  {
+    if (fabs(p[i]) < 1e-12)
+    {
+      if (q[i] < 0)
+        return false;
+      continue;
+    }
+    r = q[i] / p[i];
+    if (p[i] < 0)
+    {
+      if (r > t1)
+        return false;
+      if (r > t0)
+        t0 = r;
+    }
+    else
+    {
+      if (r < t0)
+        return false;
+      if (r < t1)
+        t1 = r;
+    }
+  }
+  if (tEnter != NULL)
+    *tEnter = t0;
+  if (tExit != NULL)
+    *tExit = t1;
+  return true;
+
+} // end function armapGridIndexClip
+
+/// Gets the squared distance from a point to a line segment
+static double armapGridIndexSquaredDist(const ArLineSegment &line, 
+                                        double x, double y)
+{
+  double dx = line.getX2() - line.getX1();
+  double dy = line.getY2() - line.getY1();
+  double lenSquared = dx * dx + dy * dy;
+  double t = 0;
+
+  if (lenSquared > 0)
+  {
+    t = ((x - line.getX1()) * dx + (y - line.getY1()) * dy) / lenSquared;
+    if (t < 0)
+      t = 0;
+    else if (t > 1)
+      t = 1;
+  }
+  dx = line.getX1() + t * dx - x;
+  dy = line.getY1() + t * dy - y;
+  return dx * dx + dy * dy;
+
+} // end function armapGridIndexSquaredDist
+
+
+/**
+ * @param cellSize the length of the side of each grid cell (mm); cells
+ * about the size of the queries that will be done work well
+**/
+AREXPORT ArMapGridIndex::ArMapGridIndex(double cellSize) :
+  myCellSize((cellSize > 1) ? cellSize : 1),
+  myMinX(0),
+  myMinY(0),
+  myNumCellsX(0),
+  myNumCellsY(0),
+  myPoints(),
+  myPointCellStart(),
+  myLines(),
+  myLineCellItems(),
+  myLineCellStart()
+{
+} // end ctor
+
+
+AREXPORT ArMapGridIndex::~ArMapGridIndex()
+{
+} // end dtor
+
+
+AREXPORT void ArMapGridIndex::clear()
+{
+  myMinX = 0;
+  myMinY = 0;
+  myNumCellsX = 0;
+  myNumCellsY = 0;
+  myPoints.clear();
+  myPointCellStart.clear();
+  myLines.clear();
+  myLineCellItems.clear();
+  myLineCellStart.clear();
+
+} // end method clear
+
+
+/**
+ * The points and lines are copied, so the vectors can change after
+ * this is called (but then the index won't match them anymore).
+ * If the grid would need too many cells the cell size is increased.
+**/
+AREXPORT void ArMapGridIndex::build(const std::vector<ArPose> *points,
+                                    const std::vector<ArLineSegment> *lines)
+{
+  std::vector<ArPose>::const_iterator pIt;
+  std::vector<ArLineSegment>::const_iterator lIt;
+  std::vector<int> counts;
+  std::vector<int> cellOf;
+  double minX = HUGE_VAL;
+  double minY = HUGE_VAL;
+  double maxX = -HUGE_VAL;
+  double maxY = -HUGE_VAL;
+  int cell;
+  int numCells;
+  int i;
+  int cx, cy, cx1, cy1, cx2, cy2;
+
+  clear();
+
+  if (points != NULL)
+  {
+    for (pIt = points->begin(); pIt != points->end(); pIt++)
+    {
+      minX = ArUtil::findMin(minX, (*pIt).getX());
+      minY = ArUtil::findMin(minY, (*pIt).getY());
+      maxX = ArUtil::findMax(maxX, (*pIt).getX());
+      maxY = ArUtil::findMax(maxY, (*pIt).getY());
+    }
+  }
+  if (lines != NULL)
+  {
+    for (lIt = lines->begin(); lIt != lines->end(); lIt++)
+    {
+      minX = ArUtil::findMin(minX, 
+                             ArUtil::findMin((*lIt).getX1(), (*lIt).getX2()));
+      minY = ArUtil::findMin(minY, 
+                             ArUtil::findMin((*lIt).getY1(), (*lIt).getY2()));
+      maxX = ArUtil::findMax(maxX, 
+                             ArUtil::findMax((*lIt).getX1(), (*lIt).getX2()));
+      maxY = ArUtil::findMax(maxY, 
+                             ArUtil::findMax((*lIt).getY1(), (*lIt).getY2()));
+    }
+  }
+  // nothing in the map
+  if (minX > maxX)
+    return;
+
+  while ((floor((maxX - minX) / myCellSize) + 1) * 
+         (floor((maxY - minY) / myCellSize) + 1) > ARMAPGRIDINDEX_MAX_CELLS)
+    myCellSize *= 2;
+
+  myMinX = minX;
+  myMinY = minY;
+  myNumCellsX = (int) floor((maxX - minX) / myCellSize) + 1;
+  myNumCellsY = (int) floor((maxY - minY) / myCellSize) + 1;
+  numCells = myNumCellsX * myNumCellsY;
+
+  // count the points in each cell, then put them in order by cell
+  if (points != NULL && !points->empty())
+  {
+    counts.assign(numCells + 1, 0);
+    cellOf.resize(points->size());
+    for (pIt = points->begin(), i = 0; pIt != points->end(); pIt++, i++)
+    {
+      cell = getCellY((*pIt).getY()) * myNumCellsX + getCellX((*pIt).getX());
+      cellOf[i] = cell;
+      counts[cell + 1]++;
+    }
+    for (cell = 0; cell < numCells; cell++)
+      counts[cell + 1] += counts[cell];
+    myPointCellStart = counts;
+    myPoints.resize(points->size());
+    for (pIt = points->begin(), i = 0; pIt != points->end(); pIt++, i++)
+      myPoints[counts[cellOf[i]]++] = *pIt;
+  }
+
+  // put each line in every cell it passes through
+  if (lines != NULL && !lines->empty())
+  {
+    std::vector<std::pair<int, int> > cellLines;
+    myLines = *lines;
+    for (i = 0; i < (int)myLines.size(); i++)
+    {
+      const ArLineSegment &line = myLines[i];
+      cx1 = getCellX(ArUtil::findMin(line.getX1(), line.getX2()));
+      cx2 = getCellX(ArUtil::findMax(line.getX1(), line.getX2()));
+      cy1 = getCellY(ArUtil::findMin(line.getY1(), line.getY2()));
+      cy2 = getCellY(ArUtil::findMax(line.getY1(), line.getY2()));
+      for (cy = cy1; cy <= cy2; cy++)
+      {
+        for (cx = cx1; cx <= cx2; cx++)
+        {
+          // lines that only cover one row or column of cells pass
+          // through all of them, otherwise check
+          if ((cx1 == cx2 || cy1 == cy2) ||
+              armapGridIndexClip(line.getX1(), line.getY1(), 
+                                 line.getX2(), line.getY2(),
+                                 myMinX + cx * myCellSize - .5,
+                                 myMinY + cy * myCellSize - .5,
+                                 myMinX + (cx + 1) * myCellSize + .5,
+                                 myMinY + (cy + 1) * myCellSize + .5,
+                                 NULL, NULL))
+            cellLines.push_back(std::pair<int, int>(cy * myNumCellsX + cx, 
+                                                    i));
+        }
+      }
+    }
+    std::sort(cellLines.begin(), cellLines.end());
+    myLineCellStart.assign(numCells + 1, 0);
+    myLineCellItems.resize(cellLines.size());
+    for (i = 0; i < (int)cellLines.size(); i++)
+    {
+      myLineCellItems[i] = cellLines[i].second;
+      myLineCellStart[cellLines[i].first + 1]++;
+    }
+    for (cell = 0; cell < numCells; cell++)
+      myLineCellStart[cell + 1] += myLineCellStart[cell];
+  }
+
+} // end method build
+
+
+int ArMapGridIndex::getCellX(double x) const
+{
+  int cx = (int) floor((x - myMinX) / myCellSize);
+  if (cx < 0)
+    return 0;
+  if (cx >= myNumCellsX)
+    return myNumCellsX - 1;
+  return cx;
+
+} // end method getCellX
+
+
+int ArMapGridIndex::getCellY(double y) const
+{
+  int cy = (int) floor((y - myMinY) / myCellSize);
+  if (cy < 0)
+    return 0;
+  if (cy >= myNumCellsY)
+    return myNumCellsY - 1;
+  return cy;
+
+} // end method getCellY
+
+
+/**
+ * @param center the spot to find points near
+ * @param radius the distance from center the points must be within (mm)
+ * @param points the points found are added to this (it isn't cleared first)
+ * @return the number of points found
+**/
+AREXPORT int ArMapGridIndex::getPointsInRadius(
+                                       const ArPose &center, 
+                                       double radius,
+                                       std::vector<ArPose> *points) const
+{
+  double radiusSquared = radius * radius;
+  double dx, dy;
+  int found = 0;
+  int cx, cy, cx1, cy1, cx2, cy2;
+  int i, cell;
+
+  if (myPoints.empty() || points == NULL)
+    return 0;
+
+  cx1 = getCellX(center.getX() - radius);
+  cx2 = getCellX(center.getX() + radius);
+  cy1 = getCellY(center.getY() - radius);
+  cy2 = getCellY(center.getY() + radius);
+  for (cy = cy1; cy <= cy2; cy++)
+  {
+    for (cx = cx1; cx <= cx2; cx++)
+    {
+      cell = cy * myNumCellsX + cx;
+      for (i = myPointCellStart[cell]; i < myPointCellStart[cell + 1]; i++)
+      {
+        dx = myPoints[i].getX() - center.getX();
+        dy = myPoints[i].getY() - center.getY();
+        if (dx * dx + dy * dy <= radiusSquared)
+        {
+          points->push_back(myPoints[i]);
+          found++;
+        }
+      }
+    }
+  }
+  return found;
+
+} // end method getPointsInRadius
+
+
+/**
+ * @param x1 the x of one corner of the box
+ * @param y1 the y of one corner of the box
+ * @param x2 the x of the opposite corner of the box
+ * @param y2 the y of the opposite corner of the box
+ * @param points the points found are added to this (it isn't cleared first)
+ * @return the number of points found
+**/
+AREXPORT int ArMapGridIndex::getPointsInBox(double x1, double y1, 
+                                            double x2, double y2,
+                                            std::vector<ArPose> *points) const
+{
+  double minX = ArUtil::findMin(x1, x2);
+  double maxX = ArUtil::findMax(x1, x2);
+  double minY = ArUtil::findMin(y1, y2);
+  double maxY = ArUtil::findMax(y1, y2);
+  int found = 0;
+  int cx, cy, cx1, cy1, cx2, cy2;
+  int i, cell;
+
+  if (myPoints.empty() || points == NULL)
+    return 0;
+
+  cx1 = getCellX(minX);
+  cx2 = getCellX(maxX);
+  cy1 = getCellY(minY);
+  cy2 = getCellY(maxY);
+  for (cy = cy1; cy <= cy2; cy++)
+  {
+    for (cx = cx1; cx <= cx2; cx++)
+    {
+      cell = cy * myNumCellsX + cx;
+      for (i = myPointCellStart[cell]; i < myPointCellStart[cell + 1]; i++)
+      {
+        if (myPoints[i].getX() >= minX && myPoints[i].getX() <= maxX &&
+            myPoints[i].getY() >= minY && myPoints[i].getY() <= maxY)
+        {
+          points->push_back(myPoints[i]);
+          found++;
+        }
+      }
+    }
+  }
+  return found;
+
+} // end method getPointsInBox
+
+
+/**
+ * This looks at the cells in rings around the one center is in,
+ * stopping once no cell further out could have a closer point.
+ *
+ * @param center the spot to find the closest point to
+ * @param maxDist only points within this distance are considered (mm)
+ * @param closest the closest point is put here, if one is found
+ * @param closestDist if not NULL the distance to the closest point is 
+ * put here, if one is found
+ * @return true if a point was found, false otherwise
+**/
+AREXPORT bool ArMapGridIndex::getClosestPoint(const ArPose &center, 
+                                              double maxDist,
+                                              ArPose *closest,
+                                              double *closestDist) const
+{
+  double bestSquared = maxDist * maxDist;
+  double dx, dy, distSquared;
+  int best = -1;
+  int ccx, ccy, cx, cy, ring, maxRing;
+  int i, cell;
+
+  if (myPoints.empty())
+    return false;
+
+  ccx = (int) floor((center.getX() - myMinX) / myCellSize);
+  ccy = (int) floor((center.getY() - myMinY) / myCellSize);
+  // the furthest ring that could have any cells of the grid in it
+  maxRing = ArUtil::findMax(ArUtil::findMax(abs(ccx), 
+                                            abs(ccx - myNumCellsX + 1)),
+                            ArUtil::findMax(abs(ccy), 
+                                            abs(ccy - myNumCellsY + 1)));
+
+  for (ring = 0; ring <= maxRing; ring++)
+  {
+    // every cell in this ring is at least this far away
+    if (ring > 0)
+    {
+      dx = (ring - 1) * myCellSize;
+      if (dx * dx > bestSquared)
+        break;
+    }
+    for (cy = ccy - ring; cy <= ccy + ring; cy++)
+    {
+      if (cy < 0 || cy >= myNumCellsY)
+        continue;
+      for (cx = ccx - ring; cx <= ccx + ring; 
+           // only the edges of the ring
+           cx += (cy == ccy - ring || cy == ccy + ring || ring == 0) ? 
+             1 : 2 * ring)
+      {
+        if (cx < 0 || cx >= myNumCellsX)
+          continue;
+        cell = cy * myNumCellsX + cx;
+        for (i = myPointCellStart[cell]; i < myPointCellStart[cell + 1]; i++)
+        {
+          dx = myPoints[i].getX() - center.getX();
+          dy = myPoints[i].getY() - center.getY();
+          distSquared = dx * dx + dy * dy;
+          if (distSquared <= bestSquared)
+          {
+            bestSquared = distSquared;
+            best = i;
+          }
+        }
+      }
+    }
+  }
+  if (best < 0)
+    return false;
+  if (closest != NULL)
+    *closest = myPoints[best];
+  if (closestDist != NULL)
+    *closestDist = sqrt(bestSquared);
+  return true;
+
+} // end method getClosestPoint
+
+
+void ArMapGridIndex::findLinesInBox(double x1, double y1, 
+                                    double x2, double y2,
+                                    std::vector<int> *lineIndices) const
+{
+  int cx, cy, cx1, cy1, cx2, cy2;
+  int i, cell;
+
+  cx1 = getCellX(x1);
+  cx2 = getCellX(x2);
+  cy1 = getCellY(y1);
+  cy2 = getCellY(y2);
+  for (cy = cy1; cy <= cy2; cy++)
+  {
+    for (cx = cx1; cx <= cx2; cx++)
+    {
+      cell = cy * myNumCellsX + cx;
+      for (i = myLineCellStart[cell]; i < myLineCellStart[cell + 1]; i++)
+        lineIndices->push_back(myLineCellItems[i]);
+    }
+  }
+  // a line can be in more than one cell
+  std::sort(lineIndices->begin(), lineIndices->end());
+  lineIndices->erase(std::unique(lineIndices->begin(), lineIndices->end()),
+                     lineIndices->end());
+
+} // end method findLinesInBox
+
+
+/**
+ * @param center the spot to find lines near
+ * @param radius the distance from center some part of the line must 
+ * be within (mm)
+ * @param lines the lines found are added to this (it isn't cleared first)
+ * @return the number of lines found
+**/
+AREXPORT int ArMapGridIndex::getLinesInRadius(
+                                   const ArPose &center, 
+                                   double radius,
+                                   std::vector<ArLineSegment> *lines) const
+{
+  std::vector<int> lineIndices;
+  std::vector<int>::iterator it;
+  double radiusSquared = radius * radius;
+  int found = 0;
+
+  if (myLines.empty() || lines == NULL)
+    return 0;
+
+  findLinesInBox(center.getX() - radius, center.getY() - radius,
+                 center.getX() + radius, center.getY() + radius,
+                 &lineIndices);
+  for (it = lineIndices.begin(); it != lineIndices.end(); it++)
+  {
+    if (armapGridIndexSquaredDist(myLines[*it], center.getX(), 
+                                  center.getY()) <= radiusSquared)
+    {
+      lines->push_back(myLines[*it]);
+      found++;
+    }
+  }
+  return found;
+
+} // end method getLinesInRadius
+
+
+/**
+ * @param x1 the x of one corner of the box
+ * @param y1 the y of one corner of the box
+ * @param x2 the x of the opposite corner of the box
+ * @param y2 the y of the opposite corner of the box
+ * @param lines the lines found are added to this (it isn't cleared first)
+ * @return the number of lines found
+**/
+AREXPORT int ArMapGridIndex::getLinesInBox(
+                                   double x1, double y1, 
+                                   double x2, double y2,
+                                   std::vector<ArLineSegment> *lines) const
+{
+  std::vector<int> lineIndices;
+  std::vector<int>::iterator it;
+  double minX = ArUtil::findMin(x1, x2);
+  double maxX = ArUtil::findMax(x1, x2);
+  double minY = ArUtil::findMin(y1, y2);
+  double maxY = ArUtil::findMax(y1, y2);
+  int found = 0;
+
+  if (myLines.empty() || lines == NULL)
+    return 0;
+
+  findLinesInBox(minX, minY, maxX, maxY, &lineIndices);
+  for (it = lineIndices.begin(); it != lineIndices.end(); it++)
+  {
+    const ArLineSegment &line = myLines[*it];
+    if (armapGridIndexClip(line.getX1(), line.getY1(), 
+                           line.getX2(), line.getY2(),
+                           minX, minY, maxX, maxY, NULL, NULL))
+    {
+      lines->push_back(line);
+      found++;
+    }
+  }
+  return found;
+
+} // end method getLinesInBox
+
+
+/**
+ * This walks the cells the ray passes through in order, checking the
+ * lines in each, so it stops as soon as it finds a hit instead of
+ * checking every line in the map.
+ *
+ * @param start where the ray starts
+ * @param th the direction of the ray (deg)
+ * @param maxRange how far the ray goes (mm)
+ * @param hit where the ray hit the line is put here, if it hit one
+ * @param hitDist if not NULL how far from start the hit was is put here
+ * @param hitLine if not NULL the line that was hit is put here
+ * @return true if the ray hit a line, false otherwise
+**/
+AREXPORT bool ArMapGridIndex::castRay(const ArPose &start, double th, 
+                                      double maxRange, ArPose *hit, 
+                                      double *hitDist,
+                                      ArLineSegment *hitLine) const
+{
+  double dirX = ArMath::cos(th);
+  double dirY = ArMath::sin(th);
+  double endX = start.getX() + dirX * maxRange;
+  double endY = start.getY() + dirY * maxRange;
+  double tEnter, tExit;
+  double tMaxX, tMaxY, tDeltaX, tDeltaY;
+  double ex, ey, denom, t, u;
+  double bestT;
+  int best;
+  int cx, cy, stepX, stepY;
+  int i, cell;
+
+  if (myLines.empty() || maxRange <= 0)
+    return false;
+
+  // find where the ray is in the grid
+  if (!armapGridIndexClip(start.getX(), start.getY(), endX, endY,
+                          myMinX, myMinY, 
+                          myMinX + myNumCellsX * myCellSize,
+                          myMinY + myNumCellsY * myCellSize,
+                          &tEnter, &tExit))
+    return false;
+  tEnter *= maxRange;
+  tExit *= maxRange;
+
+  cx = getCellX(start.getX() + dirX * tEnter);
+  cy = getCellY(start.getY() + dirY * tEnter);
+  stepX = (dirX > 0) ? 1 : -1;
+  stepY = (dirY > 0) ? 1 : -1;
+  // how far along the ray the next cell boundaries are, and how far
+  // it is between boundaries
+  if (fabs(dirX) > 1e-12)
+  {
+    tMaxX = (myMinX + (cx + (stepX > 0 ? 1 : 0)) * myCellSize - 
+             start.getX()) / dirX;
+    tDeltaX = myCellSize / fabs(dirX);
+  }
+  else
+  {
+    tMaxX = HUGE_VAL;
+    tDeltaX = HUGE_VAL;
+  }
+  if (fabs(dirY) > 1e-12)
+  {
+    tMaxY = (myMinY + (cy + (stepY > 0 ? 1 : 0)) * myCellSize - 
+             start.getY()) / dirY;
+    tDeltaY = myCellSize / fabs(dirY);
+  }
+  else
+  {
+    tMaxY = HUGE_VAL;
+    tDeltaY = HUGE_VAL;
+  }
+
+  while (cx >= 0 && cx < myNumCellsX && cy >= 0 && cy < myNumCellsY)
+  {
+    best = -1;
+    bestT = HUGE_VAL;
+    cell = cy * myNumCellsX + cx;
+    for (i = myLineCellStart[cell]; i < myLineCellStart[cell + 1]; i++)
+    {
+      const ArLineSegment &line = myLines[myLineCellItems[i]];
+      ex = line.getX2() - line.getX1();
+      ey = line.getY2() - line.getY1();
+      denom = dirX * ey - dirY * ex;
+      if (fabs(denom) < 1e-12)
+        continue;
+      // how far along the ray and along the line they cross
+      t = ((line.getX1() - start.getX()) * ey - 
+           (line.getY1() - start.getY()) * ex) / denom;
+      u = ((line.getX1() - start.getX()) * dirY - 
+           (line.getY1() - start.getY()) * dirX) / denom;
+      if (t >= 0 && t <= maxRange && u >= 0 && u <= 1 && t < bestT)
+      {
+        bestT = t;
+        best = myLineCellItems[i];
+      }
+    }
+    // a hit only counts if it is in this cell, if it is further along
+    // the ray a line in a cell in between could be closer
+    if (best >= 0 && bestT <= ArUtil::findMin(tMaxX, tMaxY) + 1e-6)
+    {
+      if (hit != NULL)
+        hit->setPose(start.getX() + dirX * bestT, 
+                     start.getY() + dirY * bestT);
+      if (hitDist != NULL)
+        *hitDist = bestT;
+      if (hitLine != NULL)
+        *hitLine = myLines[best];
+      return true;
+    }
+    if (ArUtil::findMin(tMaxX, tMaxY) > tExit)
+      break;
+    if (tMaxX < tMaxY)
+    {
+      tMaxX += tDeltaX;
+      cx += stepX;
+    }
+    else
+    {
+      tMaxY += tDeltaY;
+      cy += stepY;
+    }
+  }
+  return false;
+
+} // end method castRay
+
+
 // -----------------------------------------------------------------------------
 // ArMapFileLineSet
 // -----------------------------------------------------------------------------
@@ -29,6 +29,7 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ariaOSDef.h"
 #include "ariaUtil.h"
 #include "ArThread.h"
+#include "ArMutexContention.h"
 #include <stdio.h>
 #include <stdarg.h>
 
@@ -36,6 +37,7 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 unsigned int ArMutex::ourLockWarningMS = 0;
 unsigned int ArMutex::ourUnlockWarningMS = 0;
 ArFunctor *ArMutex::ourNonRecursiveDeadlockFunctor = NULL;
+AREXPORT bool ArMutex::ourContentionProfiling = false;
 
 
 AREXPORT void ArMutex::setLogNameVar(const char *logName, ...)
@@ -54,6 +56,10 @@ void ArMutex::initLockTiming()
   myFirstLock = true;
   myLockTime = new ArTime;
   myLockStarted = new ArTime;
+  myContention = NULL;
+  myContentionDepth = 0;
+  myContentionLockedUSec = 0;
+  myContentionHolder = ArThread::osSelf();
 }
 
 void ArMutex::uninitLockTiming()
@@ -115,3 +121,58 @@ void ArMutex::checkUnlockTime() {
 #endif
 		    myLockTime->mSecSince() / 1000.0);
 }
+
+/**
+   Turning this off leaves the statistics there to be looked at, use
+   ArMutexContention::clearAll() to start over.
+**/
+AREXPORT void ArMutex::setContentionProfiling(bool profiling)
+{
+  ourContentionProfiling = profiling;
+}
+
+void ArMutex::contentionLocked(bool contended, 
+			       unsigned long long waitStarted,
+			       ContentionThreadType blocker)
+{
+  unsigned long long now;
+  std::string blockerName;
+
+  // only the outermost lock of a recursive lock counts, this also
+  // means that the ArThread and ArMutexContention calls below (which
+  // lock mutexes of their own) don't come back around to here for the
+  // mutex they're locking
+  if (++myContentionDepth > 1)
+    return;
+
+  now = ArUtil::getTimeUSec();
+  if (myContention == NULL)
+    myContention = ArMutexContention::findOrAdd(myLogName.c_str());
+  if (contended)
+    blockerName = ArThread::getOSThreadName(blocker);
+  myContention->addLock(contended ? now - waitStarted : 0, contended,
+			blockerName.c_str());
+  myContentionHolder = ArThread::osSelf();
+  myContentionLockedUSec = ArUtil::getTimeUSec();
+}
+
+void ArMutex::contentionUnlocking(void)
+{
+  unsigned long long held;
+  const char *holderName = NULL;
+
+  if (myContentionDepth > 1)
+  {
+    myContentionDepth--;
+    return;
+  }
+
+  held = ArUtil::getTimeUSec() - myContentionLockedUSec;
+  // only look up our name if it might be the longest hold (this is
+  // done while the depth is still 1, see contentionLocked)
+  if (myContention != NULL && held >= myContention->getHoldTiming().getMax())
+    holderName = ArThread::getThisThreadName();
+  myContentionDepth = 0;
+  if (myContention != NULL)
+    myContention->addHold(held, holderName);
+}
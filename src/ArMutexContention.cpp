@@ -0,0 +1,315 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "ArExport.h"
+#include "ariaOSDef.h"
+#include "ArMutexContention.h"
+#include "ArLog.h"
+#include "ArThread.h"
+#include "ArCondition.h"
+#include "ariaInternal.h"
+
+// every name's statistics, these are never deleted so ArMutex can
+// keep pointers to them (these mutexes are unnamed so they aren't
+// profiled themselves)
+static std::map<std::string, ArMutexContention *> ourContentions;
+static ArMutex ourContentionsMutex;
+
+static ArMutex ourLogSetMutex;
+static ArThread *ourLogThread = NULL;
+static ArCondition *ourLogCondition = NULL;
+static volatile bool ourLogRunning = false;
+static int ourLogSeconds = 0;
+static ArLog::LogLevel ourLogLevel = ArLog::Normal;
+static int ourLogMaxNames = 20;
+static bool ourLogAddedExitCB = false;
+
+static void logExit(void)
+{
+  ArMutexContention::setLogInterval(0);
+}
+static ArGlobalFunctor ourLogExitCB(&logExit);
+
+AREXPORT ArMutexContention::ArMutexContention(const char *name)
+{
+  myName = name;
+  myMutex = NULL;
+  clear();
+}
+
+AREXPORT ArMutexContention::ArMutexContention(
+	const ArMutexContention &contention)
+{
+  myMutex = NULL;
+  *this = contention;
+}
+
+AREXPORT ArMutexContention &ArMutexContention::operator=(
+	const ArMutexContention &contention)
+{
+  if (this != &contention)
+  {
+    myName = contention.myName;
+    myNumLocks = contention.myNumLocks;
+    myNumContended = contention.myNumContended;
+    myWaitTiming = contention.myWaitTiming;
+    myHoldTiming = contention.myHoldTiming;
+    myLongestHolder = contention.myLongestHolder;
+    myBlockingThreads = contention.myBlockingThreads;
+  }
+  return *this;
+}
+
+AREXPORT ArMutexContention::~ArMutexContention()
+{
+  if (myMutex != NULL)
+    delete myMutex;
+}
+
+AREXPORT void ArMutexContention::clear(void)
+{
+  myNumLocks = 0;
+  myNumContended = 0;
+  myWaitTiming.clear();
+  myHoldTiming.clear();
+  myLongestHolder = "";
+  myBlockingThreads.clear();
+}
+
+AREXPORT const char *ArMutexContention::getMostBlockingThread(void) const
+{
+  std::map<std::string, unsigned long long>::const_iterator it;
+  std::map<std::string, unsigned long long>::const_iterator most;
+
+  most = myBlockingThreads.end();
+  for (it = myBlockingThreads.begin(); it != myBlockingThreads.end(); it++)
+    if (most == myBlockingThreads.end() || (*it).second > (*most).second)
+      most = it;
+  if (most == myBlockingThreads.end())
+    return "";
+  return (*most).first.c_str();
+}
+
+AREXPORT void ArMutexContention::log(ArLog::LogLevel level) const
+{
+  ArLog::log(level, 
+	     "MutexContention: '%s' locked %llu times, %llu waited (%.1f%%), longest held by '%s', most waits behind '%s'",
+	     myName.c_str(), myNumLocks, myNumContended,
+	     myNumLocks > 0 ? myNumContended * 100.0 / myNumLocks : 0.0,
+	     myLongestHolder.c_str(), getMostBlockingThread());
+  myWaitTiming.log("MutexContention:     waits", level);
+  myHoldTiming.log("MutexContention:     holds", level);
+}
+
+/**
+   @param waitUSecs how long the lock waited (0 if it didn't)
+   @param contended whether the lock had to wait for another thread
+   @param blockingThread the name of the thread that held the mutex
+   when the wait started (ignored if it didn't wait)
+**/
+AREXPORT void ArMutexContention::addLock(unsigned long long waitUSecs,
+					 bool contended,
+					 const char *blockingThread)
+{
+  myMutex->lock();
+  myNumLocks++;
+  if (contended)
+  {
+    myNumContended++;
+    myWaitTiming.add(waitUSecs);
+    myBlockingThreads[blockingThread]++;
+  }
+  myMutex->unlock();
+}
+
+/**
+   @param holdUSecs how long the mutex was held
+   @param holdingThread the name of the thread that held it, this can
+   be NULL unless this is the longest hold so far
+**/
+AREXPORT void ArMutexContention::addHold(unsigned long long holdUSecs,
+					 const char *holdingThread)
+{
+  myMutex->lock();
+  if (holdUSecs > myHoldTiming.getMax() || myHoldTiming.getCount() == 0)
+    myLongestHolder = (holdingThread != NULL) ? holdingThread : "";
+  myHoldTiming.add(holdUSecs);
+  myMutex->unlock();
+}
+
+AREXPORT ArMutexContention *ArMutexContention::findOrAdd(const char *name)
+{
+  std::map<std::string, ArMutexContention *>::iterator it;
+  ArMutexContention *contention;
+
+  ourContentionsMutex.lock();
+  if ((it = ourContentions.find(name)) != ourContentions.end())
+  {
+    contention = (*it).second;
+  }
+  else
+  {
+    contention = new ArMutexContention(name);
+    contention->myMutex = new ArMutex;
+    ourContentions[name] = contention;
+  }
+  ourContentionsMutex.unlock();
+  return contention;
+}
+
+static bool waitedLonger(const ArMutexContention &contention1, 
+			 const ArMutexContention &contention2)
+{
+  return (contention1.getWaitTiming().getTotal() > 
+	  contention2.getWaitTiming().getTotal());
+}
+
+AREXPORT void ArMutexContention::getSnapshot(
+	std::list<ArMutexContention> *snapshot)
+{
+  std::map<std::string, ArMutexContention *>::iterator it;
+
+  snapshot->clear();
+  ourContentionsMutex.lock();
+  for (it = ourContentions.begin(); it != ourContentions.end(); it++)
+  {
+    (*it).second->myMutex->lock();
+    snapshot->push_back(*(*it).second);
+    (*it).second->myMutex->unlock();
+  }
+  ourContentionsMutex.unlock();
+  snapshot->sort(waitedLonger);
+}
+
+/**
+   @param level the level to log at
+   @param maxNames the most mutex names to log (the ones waited for the
+   longest in total are logged), 0 for all of them
+**/
+AREXPORT void ArMutexContention::logSnapshot(ArLog::LogLevel level, 
+					     int maxNames)
+{
+  std::list<ArMutexContention> snapshot;
+  std::list<ArMutexContention>::iterator it;
+  int num;
+
+  // this copies everything out first so that logging (which locks
+  // ArLog's mutex) doesn't happen with any of these locked
+  getSnapshot(&snapshot);
+  ArLog::log(level, "MutexContention: %d mutex names (%s profiling)", 
+	     (int)snapshot.size(), 
+	     ArMutex::getContentionProfiling() ? "still" : "not");
+  for (it = snapshot.begin(), num = 0; 
+       it != snapshot.end() && (maxNames <= 0 || num < maxNames); 
+       it++)
+  {
+    // skip the ones that haven't been used since they were cleared
+    if ((*it).getNumLocks() == 0)
+      continue;
+    (*it).log(level);
+    num++;
+  }
+}
+
+AREXPORT void ArMutexContention::clearAll(void)
+{
+  std::map<std::string, ArMutexContention *>::iterator it;
+
+  ourContentionsMutex.lock();
+  for (it = ourContentions.begin(); it != ourContentions.end(); it++)
+  {
+    (*it).second->myMutex->lock();
+    (*it).second->clear();
+    (*it).second->myMutex->unlock();
+  }
+  ourContentionsMutex.unlock();
+}
+
+/**
+   This starts a thread that calls logSnapshot() every @a seconds
+   (it doesn't turn profiling on, see
+   ArMutex::setContentionProfiling()).  Calling it again changes the
+   interval, and calling it with 0 stops the thread.
+**/
+AREXPORT void ArMutexContention::setLogInterval(int seconds, 
+						ArLog::LogLevel level,
+						int maxNames)
+{
+  static ArGlobalFunctor logCB(&ArMutexContention::logThread);
+
+  ourLogSetMutex.lock();
+  ourLogSeconds = seconds;
+  ourLogLevel = level;
+  ourLogMaxNames = maxNames;
+
+  if (seconds <= 0 && ourLogThread != NULL)
+  {
+    ourLogRunning = false;
+    ourLogCondition->signal();
+    ourLogThread->join();
+    delete ourLogThread;
+    ourLogThread = NULL;
+  }
+  else if (seconds > 0 && ourLogThread == NULL)
+  {
+    if (ourLogCondition == NULL)
+      ourLogCondition = new ArCondition;
+    ourLogRunning = true;
+    ourLogThread = new ArThread;
+    ourLogThread->setThreadName("ArMutexContention logger");
+    if (ourLogThread->create(&logCB, true, false) != 0)
+    {
+      ourLogRunning = false;
+      delete ourLogThread;
+      ourLogThread = NULL;
+      ArLog::log(ArLog::Terse, 
+		 "ArMutexContention::setLogInterval: Could not start the logging thread");
+    }
+    else if (!ourLogAddedExitCB)
+    {
+      ourLogAddedExitCB = true;
+      ourLogExitCB.setName("ArMutexContention");
+      Aria::addExitCallback(&ourLogExitCB, -1000);
+    }
+  }
+  ourLogSetMutex.unlock();
+}
+
+AREXPORT void ArMutexContention::logThread(void)
+{
+  ArTime lastLog;
+
+  while (ourLogRunning)
+  {
+    // wake up often so that stopping doesn't take long
+    ourLogCondition->timedWait(100);
+    if (ourLogRunning && ourLogSeconds > 0 && 
+	lastLog.mSecSince() >= ourLogSeconds * 1000)
+    {
+      logSnapshot(ourLogLevel, ourLogMaxNames);
+      lastLog.setToNow();
+    }
+  }
+}
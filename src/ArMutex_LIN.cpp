@@ -47,7 +47,8 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 **/
 ArMutex::ArMutex(bool recursive) :
   myFailedInit(false),
-  myMutex()
+  myMutex(),
+  myContentionDepth(0)
 {
   myLog = false;
   initLockTiming();
@@ -99,7 +100,8 @@ ArMutex::~ArMutex()
   uninitLockTiming();
 }
 
-ArMutex::ArMutex(const ArMutex &mutex)
+ArMutex::ArMutex(const ArMutex &mutex) :
+  myContentionDepth(0)
 {
   myLog = mutex.myLog;
   if (pthread_mutex_init(&myMutex, 0) != 0)
@@ -145,7 +147,25 @@ int ArMutex::lock()
   }
 
   int ret;
-  if ((ret = pthread_mutex_lock(&myMutex)) != 0)
+  bool contended = false;
+  unsigned long long waitStarted = 0;
+  ContentionThreadType blocker = myContentionHolder;
+  // when profiling, try first so we know whether we had to wait
+  if (ourContentionProfiling && !myLogName.empty() &&
+      pthread_mutex_trylock(&myMutex) == 0)
+  {
+    ret = 0;
+  }
+  else
+  {
+    if (ourContentionProfiling && !myLogName.empty())
+    {
+      contended = true;
+      waitStarted = ArUtil::getTimeUSec();
+    }
+    ret = pthread_mutex_lock(&myMutex);
+  }
+  if (ret != 0)
   {
     if (ret == EDEADLK)
     {
@@ -197,7 +217,8 @@ int ArMutex::lock()
 
   if(ourLockWarningMS > 0) checkLockTime();
   if(ourUnlockWarningMS > 0) startUnlockTimer();
-
+  if (ourContentionProfiling && !myLogName.empty()) 
+    contentionLocked(contended, waitStarted, blocker);
   
   return(0);
 }
@@ -281,6 +302,9 @@ int ArMutex::tryLock()
 		     ArThread::getThisThreadName(), 
 		     ArThread::getThisThread(), getpid());
 
+  if (ourContentionProfiling && !myLogName.empty()) 
+    contentionLocked(false, 0, myContentionHolder);
+
   return(0);
 }
 
@@ -294,6 +318,9 @@ int ArMutex::unlock()
 		     ArThread::getThisThread(), getpid());
 
   if(ourUnlockWarningMS > 0) checkUnlockTime();
+  // this is done even if profiling was just turned off, so that the
+  // depth comes back down
+  if (myContentionDepth > 0) contentionUnlocking();
 
   if (myFailedInit)
   {
@@ -31,6 +31,7 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ArThread.h"
 #include "ariaInternal.h"
 #include "ArThread.h"
+#include "ariaUtil.h"
 
 //#include <process.h> // for getpid()
 
@@ -44,7 +45,8 @@ ArMutex::ArMutex(bool recursive) :
   myWasAlreadyLocked(false),
   myFirstLock(true),
   myLockTime(NULL),
-  myLockStarted(NULL)
+  myLockStarted(NULL),
+  myContentionDepth(0)
 {
   myMutex=CreateMutex(0, true, 0);
   if (!myMutex)
@@ -74,7 +76,8 @@ AREXPORT ArMutex::ArMutex(const ArMutex &mutex) :
   myWasAlreadyLocked(false),
   myFirstLock(true),
   myLockTime(NULL),
-  myLockStarted(NULL)
+  myLockStarted(NULL),
+  myContentionDepth(0)
 {
   myMutex = CreateMutex(0, true, 0);
   if(!myMutex)
@@ -115,7 +118,21 @@ int ArMutex::lock()
   }
 
   if(ourLockWarningMS > 0) startLockTimer();
-  ret=WaitForSingleObject(myMutex, INFINITE);
+  bool contended = false;
+  unsigned long long waitStarted = 0;
+  ContentionThreadType blocker = myContentionHolder;
+  // when profiling, try first so we know whether we had to wait
+  if (ourContentionProfiling && !myLogName.empty() &&
+      (ret = WaitForSingleObject(myMutex, 0)) == WAIT_TIMEOUT)
+  {
+    contended = true;
+    waitStarted = ArUtil::getTimeUSec();
+    ret = WaitForSingleObject(myMutex, INFINITE);
+  }
+  else if (!ourContentionProfiling || myLogName.empty())
+  {
+    ret = WaitForSingleObject(myMutex, INFINITE);
+  }
   if (ret == WAIT_ABANDONED)
   {
     ArLog::logNoLock(ArLog::Terse, "ArMutex::lock: Tried to lock a mutex %s which was locked by a different thread and never unlocked before that thread exited. This is a recoverable error", myLogName.c_str());
@@ -126,6 +143,8 @@ int ArMutex::lock()
     // locked
 	if(ourLockWarningMS > 0) checkLockTime();
 	if(ourUnlockWarningMS > 0) startUnlockTimer();
+    if (ourContentionProfiling && !myLogName.empty()) 
+      contentionLocked(contended, waitStarted, blocker);
     return(0);
   }
   else
@@ -193,7 +212,11 @@ int ArMutex::tryLock()
     return(STATUS_ALREADY_LOCKED);
   }
   else if (ret == WAIT_OBJECT_0)
+  {
+    if (ourContentionProfiling && !myLogName.empty()) 
+      contentionLocked(false, 0, myContentionHolder);
     return(0);
+  }
   else
   {
     ArLog::logNoLock(ArLog::Terse, "ArMutex::lock: Failed to lock %s due to an unknown error", myLogName.c_str());
@@ -245,6 +268,9 @@ int ArMutex::unlock()
   }
 
   if(ourUnlockWarningMS > 0) checkUnlockTime();
+  // this is done even if profiling was just turned off, so that the
+  // depth comes back down
+  if (myContentionDepth > 0) contentionUnlocking();
 
   if (!ReleaseMutex(myMutex))
   {
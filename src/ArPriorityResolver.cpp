@@ -28,15 +28,108 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ArPriorityResolver.h"
 #include "ArAction.h"
 #include "ArRobot.h"
+#include "ArASyncTask.h"
+#include "ArCondition.h"
+
+/// Thread that fires pure actions for ArPriorityResolver
+/// @internal
+class ArPriorityResolverWorker : public ArASyncTask
+{
+public:
+  ArPriorityResolverWorker(ArPriorityResolver *resolver) :
+    myResolver(resolver) {}
+  virtual void *runThread(void *arg)
+  {
+    while (getRunningWithLock())
+    {
+      while (myResolver->firePureAction(&myBusy))
+	;
+      // resolve doesn't depend on us waking up (it fires whatever we
+      // don't get to itself), so missing a broadcast just means this
+      // thread sits out a cycle
+      myCondition.timedWait(100);
+    }
+    return NULL;
+  }
+  // locked while this thread is firing an action
+  ArMutex myBusy;
+  // broadcast when there are actions to fire (each worker has its
+  // own since ArCondition only takes one waiter at a time)
+  ArCondition myCondition;
+protected:
+  ArPriorityResolver *myResolver;
+};
 
 AREXPORT ArPriorityResolver::ArPriorityResolver() :
   ArResolver("ArPriorityResolver", "Resolves strictly by using priority, the highest priority action to act is the one that gets to go.  Does no mixing of any variety.")
 {
+  myPureNext = 0;
+  myPureMutex.setLogName("ArPriorityResolver::myPureMutex");
 }
 
 
 AREXPORT ArPriorityResolver::~ArPriorityResolver()
 {
+  setParallelThreads(0);
+}
+
+/**
+   The threads are only used to fire the actions that are pure (see
+   ArAction::setPure()), so this only helps if there are several of
+   those and they take a while (for instance each checking the range
+   devices).  The robot's own thread fires pure actions too, so on a
+   machine with N cores N-1 threads is the most that makes sense.
+   This should be called with the robot locked (or before it runs).
+
+   @param numThreads the number of threads, 0 to fire every action
+   one at a time in the robot's thread
+**/
+AREXPORT void ArPriorityResolver::setParallelThreads(int numThreads)
+{
+  ArPriorityResolverWorker *worker;
+
+  if (numThreads < 0)
+    numThreads = 0;
+  while ((int)myWorkers.size() > numThreads)
+  {
+    worker = myWorkers.back();
+    myWorkers.pop_back();
+    worker->stopRunning();
+    worker->myCondition.broadcast();
+    worker->join();
+    delete worker;
+  }
+  while ((int)myWorkers.size() < numThreads)
+  {
+    worker = new ArPriorityResolverWorker(this);
+    worker->setThreadName("ArPriorityResolver worker");
+    worker->runAsync();
+    myWorkers.push_back(worker);
+  }
+}
+
+bool ArPriorityResolver::firePureAction(ArMutex *busy)
+{
+  size_t index;
+
+  myPureMutex.lock();
+  if (myPureNext >= myPureActions.size())
+  {
+    myPureMutex.unlock();
+    return false;
+  }
+  index = myPureNext++;
+  // this is locked before the pure mutex is let go so that once
+  // resolve sees no actions left it can wait on busy for the last ones
+  if (busy != NULL)
+    busy->lock();
+  myPureMutex.unlock();
+
+  myPureResults[index] = myPureActions[index]->fire(myPureCurrentDesired);
+
+  if (busy != NULL)
+    busy->unlock();
+  return true;
 }
 
 AREXPORT ArActionDesired *ArPriorityResolver::resolve(
@@ -50,10 +143,44 @@ AREXPORT ArActionDesired *ArPriorityResolver::resolve(
   int lastPriority;
   bool printedFirst = true;
   int printedLast;
+  size_t pureIndex;
+  size_t i;
   
   if (actions == NULL)
     return NULL;
 
+  // fire the pure actions all at once, our thread helps and then
+  // waits for the workers to finish the ones they took
+  pureIndex = 0;
+  if (!myWorkers.empty())
+  {
+    myPureMutex.lock();
+    myPureActions.clear();
+    for (it = actions->rbegin(); it != actions->rend(); ++it)
+    {
+      action = (*it).second;
+      if (action != NULL && action->isActive() && action->isPure())
+	myPureActions.push_back(action);
+    }
+    myPureResults.resize(myPureActions.size());
+    myPureNext = 0;
+    myPureMutex.unlock();
+    if (myPureActions.size() > 1)
+      for (i = 0; i < myWorkers.size(); i++)
+	myWorkers[i]->myCondition.broadcast();
+    while (firePureAction(NULL))
+      ;
+    for (i = 0; i < myWorkers.size(); i++)
+    {
+      myWorkers[i]->myBusy.lock();
+      myWorkers[i]->myBusy.unlock();
+    }
+  }
+  else if (!myPureActions.empty())
+  {
+    myPureActions.clear();
+  }
+
   myActionDesired.reset();
   averaging.reset();
   averaging.startAverage();
@@ -73,7 +200,14 @@ AREXPORT ArActionDesired *ArPriorityResolver::resolve(
 	first = false;
 	lastPriority = (*it).first;
       }
-      act = action->fire(myActionDesired);
+      // pure actions were fired above, in this same order
+      while (pureIndex < myPureActions.size() && action->isPure() &&
+	     myPureActions[pureIndex] != action)
+	pureIndex++;
+      if (pureIndex < myPureActions.size() && action->isPure())
+	act = myPureResults[pureIndex++];
+      else
+	act = action->fire(myActionDesired);
       if (robot != NULL && act != NULL)
 	act->accountForRobotHeading(robot->getTh());
       if (act != NULL)
@@ -0,0 +1,408 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "ArExport.h"
+#include <errno.h>
+#include <stdarg.h>
+#include "ariaOSDef.h"
+#include "ArRWMutex.h"
+#include "ArMutexContention.h"
+#include "ArLog.h"
+#include "ArThread.h"
+#include "ariaUtil.h"
+
+#include <sys/types.h>
+#include <unistd.h>     // for getpid()
+
+AREXPORT ArRWMutex::ArRWMutex() :
+  ArMutex(true),
+  myReadContention(NULL),
+  myCondsFailedInit(false),
+  myWriting(false),
+  myWriter(),
+  myWriteDepth(0),
+  myWritersWaiting(0)
+{
+  if (pthread_cond_init(&myReadCond, 0) != 0 ||
+      pthread_cond_init(&myWriteCond, 0) != 0)
+  {
+    myCondsFailedInit = true;
+    myFailedInit = true;
+    ArLog::logNoLock(ArLog::Terse, 
+		     "ArRWMutex::ArRWMutex: Failed to initialize conditions");
+  }
+}
+
+AREXPORT ArRWMutex::~ArRWMutex()
+{
+  if (!myCondsFailedInit)
+  {
+    pthread_cond_destroy(&myReadCond);
+    pthread_cond_destroy(&myWriteCond);
+  }
+}
+
+AREXPORT void ArRWMutex::setLogNameVar(const char *logName, ...)
+{
+  char arg[2048];
+  va_list ptr;
+  va_start(ptr, logName);
+  vsnprintf(arg, sizeof(arg), logName, ptr);
+  arg[sizeof(arg) - 1] = '\0';
+  va_end(ptr);
+  setLogName(arg);
+}
+
+int ArRWMutex::findReader(pthread_t thread)
+{
+  size_t i;
+  for (i = 0; i < myReaders.size(); i++)
+    if (pthread_equal(myReaders[i].myThread, thread))
+      return (int)i;
+  return -1;
+}
+
+AREXPORT int ArRWMutex::getNumReaders(void)
+{
+  int ret;
+  if (myFailedInit)
+    return 0;
+  pthread_mutex_lock(&myMutex);
+  ret = myReaders.size();
+  pthread_mutex_unlock(&myMutex);
+  return ret;
+}
+
+/**
+   Blocks until no other thread holds a read or write lock.  If this
+   thread already has the write lock this just counts another level of
+   locking, if this thread has a read lock this waits for the other
+   readers to finish (see the class description).
+**/
+AREXPORT int ArRWMutex::lock()
+{
+  pthread_t self = pthread_self();
+  int reader;
+  bool contended = false;
+  unsigned long long waitStarted = 0;
+  ContentionThreadType blocker = myContentionHolder;
+  bool profiling = ourContentionProfiling && !myLogName.empty();
+
+  if (myFailedInit)
+  {
+    ArLog::logNoLock(ArLog::Terse, "ArRWMutex::lock: Initialization of mutex '%s' failed, failed lock", myLogName.c_str());
+    return(STATUS_FAILED_INIT);
+  }
+
+  if (myLog)
+    ArLog::logNoLock(ArLog::Terse, "Locking '%s' from thread '%s' %d pid %d", 
+		     myLogName.c_str(), ArThread::getThisThreadName(), 
+		     ArThread::getThisThread(), getpid());
+
+  pthread_mutex_lock(&myMutex);
+  if (myWriting && pthread_equal(myWriter, self))
+  {
+    myWriteDepth++;
+    pthread_mutex_unlock(&myMutex);
+    return 0;
+  }
+
+  if(ourLockWarningMS > 0) startLockTimer();
+  reader = findReader(self);
+  myWritersWaiting++;
+  // if we're a reader ourselves we wait for everyone else
+  while (myWriting || (int)myReaders.size() > (reader >= 0 ? 1 : 0))
+  {
+    if (profiling && !contended)
+    {
+      contended = true;
+      waitStarted = ArUtil::getTimeUSec();
+      if (myWriting)
+	blocker = myWriter;
+      else if (reader != 0)
+	blocker = myReaders[0].myThread;
+      else
+	blocker = myReaders[1].myThread;
+    }
+    pthread_cond_wait(&myWriteCond, &myMutex);
+    // the readers may have shuffled while we waited
+    if (reader >= 0)
+      reader = findReader(self);
+  }
+  myWritersWaiting--;
+  myWriting = true;
+  myWriter = self;
+  myWriteDepth = 1;
+  pthread_mutex_unlock(&myMutex);
+
+  if(ourLockWarningMS > 0) checkLockTime();
+  if(ourUnlockWarningMS > 0) startUnlockTimer();
+  if (profiling)
+    contentionLocked(contended, waitStarted, blocker);
+  return 0;
+}
+
+AREXPORT int ArRWMutex::tryLock()
+{
+  pthread_t self = pthread_self();
+  int reader;
+
+  if (myFailedInit)
+  {
+    ArLog::logNoLock(ArLog::Terse, "ArRWMutex::tryLock: Initialization of mutex '%s' failed, failed trylock", myLogName.c_str());
+    return(STATUS_FAILED_INIT);
+  }
+
+  pthread_mutex_lock(&myMutex);
+  if (myWriting && pthread_equal(myWriter, self))
+  {
+    myWriteDepth++;
+    pthread_mutex_unlock(&myMutex);
+    return 0;
+  }
+  reader = findReader(self);
+  if (myWriting || (int)myReaders.size() > (reader >= 0 ? 1 : 0))
+  {
+    pthread_mutex_unlock(&myMutex);
+    if (myLog)
+      ArLog::logNoLock(ArLog::Terse, "ArRWMutex::tryLock: Mutex %s is already locked", myLogName.c_str());
+    return(STATUS_ALREADY_LOCKED);
+  }
+  myWriting = true;
+  myWriter = self;
+  myWriteDepth = 1;
+  pthread_mutex_unlock(&myMutex);
+
+  if (myLog)
+    ArLog::logNoLock(ArLog::Terse, "Try locked '%s' from thread '%s' %d pid %d", 
+		     myLogName.c_str(), ArThread::getThisThreadName(), 
+		     ArThread::getThisThread(), getpid());
+  if(ourUnlockWarningMS > 0) startUnlockTimer();
+  if (ourContentionProfiling && !myLogName.empty()) 
+    contentionLocked(false, 0, myContentionHolder);
+  return 0;
+}
+
+/**
+   Blocks while another thread has the write lock or is waiting for
+   it.  If this thread already holds a lock of either kind this
+   never blocks.
+**/
+AREXPORT int ArRWMutex::lockForRead()
+{
+  pthread_t self = pthread_self();
+  int reader;
+  Reader newReader;
+  bool contended = false;
+  unsigned long long waitStarted = 0;
+  ContentionThreadType blocker = self;
+  bool profiling = ourContentionProfiling && !myLogName.empty();
+
+  if (myFailedInit)
+  {
+    ArLog::logNoLock(ArLog::Terse, "ArRWMutex::lockForRead: Initialization of mutex '%s' failed, failed lock", myLogName.c_str());
+    return(STATUS_FAILED_INIT);
+  }
+
+  if (myLog)
+    ArLog::logNoLock(ArLog::Terse, "Locking '%s' for read from thread '%s' %d pid %d", 
+		     myLogName.c_str(), ArThread::getThisThreadName(), 
+		     ArThread::getThisThread(), getpid());
+
+  pthread_mutex_lock(&myMutex);
+  // a writer reading is just another level of writing
+  if (myWriting && pthread_equal(myWriter, self))
+  {
+    myWriteDepth++;
+    pthread_mutex_unlock(&myMutex);
+    return 0;
+  }
+  if ((reader = findReader(self)) >= 0)
+  {
+    myReaders[reader].myDepth++;
+    pthread_mutex_unlock(&myMutex);
+    return 0;
+  }
+  while (myWriting || myWritersWaiting > 0)
+  {
+    if (profiling && !contended)
+    {
+      contended = true;
+      waitStarted = ArUtil::getTimeUSec();
+      if (myWriting)
+	blocker = myWriter;
+    }
+    pthread_cond_wait(&myReadCond, &myMutex);
+  }
+  newReader.myThread = self;
+  newReader.myDepth = 1;
+  newReader.myLockedUSec = 0;
+  if (profiling)
+    newReader.myLockedUSec = ArUtil::getTimeUSec();
+  myReaders.push_back(newReader);
+  // looked up in here so readers don't race each other to set it
+  if (profiling && myReadContention == NULL)
+    myReadContention = ArMutexContention::findOrAdd(
+	    (myLogName + " (read)").c_str());
+  pthread_mutex_unlock(&myMutex);
+
+  if (profiling)
+    readContentionLocked(contended, waitStarted, blocker);
+  return 0;
+}
+
+AREXPORT int ArRWMutex::tryLockForRead()
+{
+  pthread_t self = pthread_self();
+  int reader;
+  Reader newReader;
+  bool profiling = ourContentionProfiling && !myLogName.empty();
+
+  if (myFailedInit)
+  {
+    ArLog::logNoLock(ArLog::Terse, "ArRWMutex::tryLockForRead: Initialization of mutex '%s' failed, failed trylock", myLogName.c_str());
+    return(STATUS_FAILED_INIT);
+  }
+
+  pthread_mutex_lock(&myMutex);
+  if (myWriting && pthread_equal(myWriter, self))
+  {
+    myWriteDepth++;
+    pthread_mutex_unlock(&myMutex);
+    return 0;
+  }
+  if ((reader = findReader(self)) >= 0)
+  {
+    myReaders[reader].myDepth++;
+    pthread_mutex_unlock(&myMutex);
+    return 0;
+  }
+  if (myWriting || myWritersWaiting > 0)
+  {
+    pthread_mutex_unlock(&myMutex);
+    if (myLog)
+      ArLog::logNoLock(ArLog::Terse, "ArRWMutex::tryLockForRead: Mutex %s is already locked", myLogName.c_str());
+    return(STATUS_ALREADY_LOCKED);
+  }
+  newReader.myThread = self;
+  newReader.myDepth = 1;
+  newReader.myLockedUSec = 0;
+  if (profiling)
+    newReader.myLockedUSec = ArUtil::getTimeUSec();
+  myReaders.push_back(newReader);
+  // looked up in here so readers don't race each other to set it
+  if (profiling && myReadContention == NULL)
+    myReadContention = ArMutexContention::findOrAdd(
+	    (myLogName + " (read)").c_str());
+  pthread_mutex_unlock(&myMutex);
+
+  if (profiling)
+    readContentionLocked(false, 0, self);
+  return 0;
+}
+
+AREXPORT int ArRWMutex::unlock()
+{
+  pthread_t self = pthread_self();
+  int reader;
+  unsigned long long readLockedUSec = 0;
+
+  if (myLog)
+    ArLog::logNoLock(ArLog::Terse, "Unlocking '%s' from thread '%s' %d pid %d", 
+		     myLogName.c_str(), ArThread::getThisThreadName(), 
+		     ArThread::getThisThread(), getpid());
+
+  if (myFailedInit)
+  {
+    ArLog::logNoLock(ArLog::Terse, "ArRWMutex::unlock: Initialization of mutex '%s' failed, failed unlock", myLogName.c_str());
+    return(STATUS_FAILED_INIT);
+  }
+
+  pthread_mutex_lock(&myMutex);
+  if (myWriting && pthread_equal(myWriter, self))
+  {
+    if (myWriteDepth > 1)
+    {
+      myWriteDepth--;
+      pthread_mutex_unlock(&myMutex);
+      return 0;
+    }
+    pthread_mutex_unlock(&myMutex);
+    // these only get touched by the writer, so do them before we
+    // let the next one in
+    if(ourUnlockWarningMS > 0) checkUnlockTime();
+    if (myContentionDepth > 0) contentionUnlocking();
+    pthread_mutex_lock(&myMutex);
+    myWriteDepth = 0;
+    myWriting = false;
+    if (myWritersWaiting > 0)
+      pthread_cond_broadcast(&myWriteCond);
+    else
+      pthread_cond_broadcast(&myReadCond);
+    pthread_mutex_unlock(&myMutex);
+    return 0;
+  }
+
+  if ((reader = findReader(self)) < 0)
+  {
+    pthread_mutex_unlock(&myMutex);
+    ArLog::logNoLock(ArLog::Terse, "ArRWMutex::unlock: Trying to unlock a mutex ('%s') which this thread ('%s' %d pid %d) does not own", 
+		     myLogName.c_str(), ArThread::getThisThreadName(),
+		     ArThread::getThisThread(), getpid());
+    return(STATUS_ALREADY_LOCKED);
+  }
+  if (--myReaders[reader].myDepth > 0)
+  {
+    pthread_mutex_unlock(&myMutex);
+    return 0;
+  }
+  readLockedUSec = myReaders[reader].myLockedUSec;
+  myReaders[reader] = myReaders.back();
+  myReaders.pop_back();
+  // a waiting writer might be an upgrading reader, so wake them when
+  // there's one reader left too
+  if (myWritersWaiting > 0 && myReaders.size() <= 1)
+    pthread_cond_broadcast(&myWriteCond);
+  pthread_mutex_unlock(&myMutex);
+
+  if (readLockedUSec != 0 && myReadContention != NULL)
+    myReadContention->addHold(ArUtil::getTimeUSec() - readLockedUSec, NULL);
+  return 0;
+}
+
+void ArRWMutex::readContentionLocked(bool contended, 
+				     unsigned long long waitStarted,
+				     ContentionThreadType blocker)
+{
+  std::string blockerName;
+
+  if (myReadContention == NULL)
+    return;
+  if (contended)
+    blockerName = ArThread::getOSThreadName(blocker);
+  myReadContention->addLock(
+	  contended ? ArUtil::getTimeUSec() - waitStarted : 0,
+	  contended, blockerName.c_str());
+}
@@ -0,0 +1,86 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "ArExport.h"
+#include <stdarg.h>
+#include "ariaOSDef.h"
+#include "ArRWMutex.h"
+
+/*
+  There's no reader/writer lock on all of the versions of Windows we
+  build for, so for now this is just an ArMutex and reading locks it
+  the same as writing does.
+*/
+
+AREXPORT ArRWMutex::ArRWMutex() :
+  ArMutex(true),
+  myReadContention(NULL)
+{
+}
+
+AREXPORT ArRWMutex::~ArRWMutex()
+{
+}
+
+AREXPORT void ArRWMutex::setLogNameVar(const char *logName, ...)
+{
+  char arg[2048];
+  va_list ptr;
+  va_start(ptr, logName);
+  vsnprintf(arg, sizeof(arg), logName, ptr);
+  arg[sizeof(arg) - 1] = '\0';
+  va_end(ptr);
+  setLogName(arg);
+}
+
+AREXPORT int ArRWMutex::getNumReaders(void)
+{
+  return 0;
+}
+
+AREXPORT int ArRWMutex::lock()
+{
+  return ArMutex::lock();
+}
+
+AREXPORT int ArRWMutex::tryLock()
+{
+  return ArMutex::tryLock();
+}
+
+AREXPORT int ArRWMutex::lockForRead()
+{
+  return ArMutex::lock();
+}
+
+AREXPORT int ArRWMutex::tryLockForRead()
+{
+  return ArMutex::tryLock();
+}
+
+AREXPORT int ArRWMutex::unlock()
+{
+  return ArMutex::unlock();
+}
@@ -28,15 +28,27 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ArRangeBuffer.h"
 #include "ArLog.h"
 
+#include <algorithm>
+
 /** @param size The size of the buffer, in number of readings */
 AREXPORT ArRangeBuffer::ArRangeBuffer(int size)
 {
   mySize = size;
+  myPooled = false;
+  myPoolHead = 0;
+  myPoolCount = 0;
+  myPoolNumInvalid = 0;
+  myPoolRedoIndex = 0;
+  myAdapterListSize = 0;
+  myAdapterValid = false;
+  myGridCellSize = 0;
 }
 
 AREXPORT ArRangeBuffer::~ArRangeBuffer()
 {
-  ArUtil::deleteSet(myBuffer.begin(), myBuffer.end());
+  // in pooled mode the list just points into myAdapterPoses
+  if (!myPooled)
+    ArUtil::deleteSet(myBuffer.begin(), myBuffer.end());
   ArUtil::deleteSet(myInvalidBuffer.begin(), myInvalidBuffer.end());
 }
 
@@ -74,6 +86,11 @@ AREXPORT void ArRangeBuffer::setEncoderPoseTaken(ArPose p)
 AREXPORT void ArRangeBuffer::setSize(size_t size) 
 {
   mySize = size;
+  if (myPooled)
+  {
+    poolResize(size);
+    return;
+  }
   // if its smaller then chop the lists down to size
   while (myInvalidBuffer.size() + myBuffer.size() > mySize)
   {
@@ -92,17 +109,143 @@ AREXPORT void ArRangeBuffer::setSize(size_t size)
   }
 }
 
+/**
+   Pooled storage keeps the readings in a ring of x, y and time
+   arrays that are allocated when the size is set, instead of
+   allocating an ArPoseWithTime for each reading.  The readings that
+   are in the buffer are kept (in the same order) when this is
+   changed.
+
+   @param pooled true to use pooled storage, false to use the list
+**/
+AREXPORT void ArRangeBuffer::setPooledStorage(bool pooled)
+{
+  std::list<ArPoseWithTime *>::reverse_iterator rit;
+  size_t i;
+
+  if (pooled == myPooled)
+    return;
+
+  if (pooled)
+  {
+    myPooled = true;
+    myPoolHead = 0;
+    myPoolCount = 0;
+    myPoolNumInvalid = 0;
+    poolResize(mySize);
+    // put the old readings in oldest first so the order is the same
+    for (rit = myBuffer.rbegin(); rit != myBuffer.rend(); ++rit)
+    {
+      poolAddReading((*rit)->getX(), (*rit)->getY());
+      myPoolTime[myPoolHead] = (*rit)->getTime();
+    }
+    ArUtil::deleteSet(myBuffer.begin(), myBuffer.end());
+    ArUtil::deleteSet(myInvalidBuffer.begin(), myInvalidBuffer.end());
+    myBuffer.clear();
+    myInvalidBuffer.clear();
+    myAdapterValid = false;
+  }
+  else
+  {
+    // the list just has pointers into the adapter, so toss those
+    myBuffer.clear();
+    myAdapterSpare.clear();
+    myAdapterListSize = 0;
+    myAdapterValid = false;
+    for (i = myPoolCount; i > 0; i--)
+      myBuffer.push_front(new ArPoseWithTime(myPoolX[poolIndex(i - 1)],
+					     myPoolY[poolIndex(i - 1)], 0,
+					     myPoolTime[poolIndex(i - 1)]));
+    myPooled = false;
+    myPoolHead = 0;
+    myPoolCount = 0;
+    myPoolNumInvalid = 0;
+    myPoolX.clear();
+    myPoolY.clear();
+    myPoolTime.clear();
+    myPoolInvalid.clear();
+    myAdapterPoses.clear();
+    myGridCellSize = 0;
+    myGridBucketHead.clear();
+    myGridNext.clear();
+    myGridPrev.clear();
+    myGridBucketOf.clear();
+  }
+}
+
+AREXPORT bool ArRangeBuffer::getPooledStorage(void) const
+{
+  return myPooled;
+}
+
+AREXPORT size_t ArRangeBuffer::getNumReadings(void) const
+{
+  if (myPooled)
+    return myPoolCount;
+  else
+    return myBuffer.size();
+}
+
+/**
+   The grid index splits the plane into square cells and keeps track
+   of which readings are in which cell, it is kept up to date as
+   readings are added, moved, transformed and removed.  The searches
+   then only look at readings in the cells their region overlaps.
+   The grid needs pooled storage, so this turns that on.
+
+   The cell size should be somewhere around the size of the regions
+   that are searched, if it is too small the searches have to look in
+   lots of cells, if it is too big each cell has lots of readings
+   that aren't in the region.
+
+   Note that with the grid getClosestPolar() only looks out to the
+   maxRange it is given, so if there is no reading closer than that
+   the angle will not be set.
+
+   @param cellSize the size of the grid cells in mm, 0 or less to not
+   keep a grid
+**/
+AREXPORT void ArRangeBuffer::setGridIndex(double cellSize)
+{
+  if (cellSize <= 0)
+  {
+    myGridCellSize = 0;
+    myGridBucketHead.clear();
+    myGridNext.clear();
+    myGridPrev.clear();
+    myGridBucketOf.clear();
+    return;
+  }
+  setPooledStorage(true);
+  myGridCellSize = cellSize;
+  gridRebuild();
+}
+
+AREXPORT double ArRangeBuffer::getGridIndexCellSize(void) const
+{
+  return myGridCellSize;
+}
+
 /** 
     This function returns a pointer to a list that has all of the readings
     in it.  This list is mostly for reference, ie for finding some 
     particular value or for using the readings to draw them.  Don't do 
     any modification at all to the list unless you really know what you're 
     doing... and if you do you'd better lock the rangeDevice this came from
-    so nothing messes with the list while you are doing so.
+    so nothing messes with the list while you are doing so.  Just
+    looking at the list only needs ArRangeDevice::lockDeviceForRead().
     @return the list of positions this range buffer has
 */
 AREXPORT const std::list<ArPoseWithTime *> *ArRangeBuffer::getBuffer(void) const
 { 
+  if (myPooled)
+  {
+    ArRangeBuffer *self = const_cast<ArRangeBuffer *>(this);
+    self->myAdapterMutex.lock();
+    if (!myAdapterValid)
+      self->adapterRebuild();
+    self->myAdapterMutex.unlock();
+  }
   return &myBuffer; 
 }
 
@@ -117,6 +260,13 @@ AREXPORT const std::list<ArPoseWithTime *> *ArRangeBuffer::getBuffer(void) const
 */
 AREXPORT std::list<ArPoseWithTime *> *ArRangeBuffer::getBuffer(void)
 { 
+  if (myPooled)
+  {
+    myAdapterMutex.lock();
+    if (!myAdapterValid)
+      adapterRebuild();
+    myAdapterMutex.unlock();
+  }
   return &myBuffer; 
 }
 
@@ -141,14 +291,108 @@ AREXPORT std::list<ArPoseWithTime *> *ArRangeBuffer::getBuffer(void)
    to the closest reading, if it is >= maxRange, then there was no reading 
    in the given section
 */
+/// The part of the pooled closest polar search done for each reading
+static inline void polarCheck(double x, double y, const ArPose &startPos,
+			      double startAngle, double endAngle, 
+			      bool *foundOne, double *closestSquared, 
+			      double *closeTh)
+{
+  double dx = x - startPos.getX();
+  double dy = y - startPos.getY();
+  double distSquared = dx * dx + dy * dy;
+  double th;
+  // only bother with the angle if it'd be the closest
+  if (*foundOne && distSquared >= *closestSquared)
+    return;
+  th = ArMath::subAngle(ArMath::radToDeg(atan2(dy, dx)), startPos.getTh());
+  if (ArMath::angleBetween(th, startAngle, endAngle))
+  {
+    *closestSquared = distSquared;
+    *closeTh = th;
+    *foundOne = true;
+  }
+}
+
 AREXPORT double ArRangeBuffer::getClosestPolar(double startAngle, 
 					       double endAngle, 
 					       ArPose startPos, 
 					       unsigned int maxRange,
 					       double *angle) const
 {
-  return getClosestPolarInList(startAngle, endAngle, 
-			       startPos, maxRange, angle, &myBuffer);
+  if (!myPooled)
+    return getClosestPolarInList(startAngle, endAngle, 
+				 startPos, maxRange, angle, &myBuffer);
+
+  double closestSquared = 0;
+  bool foundOne = false;
+  double closeTh = 0;
+  size_t spanEnd[2];
+  size_t spanStart[2];
+  size_t span, i;
+  int cellX, cellY, cellX1, cellY1, cellX2, cellY2;
+  int index;
+  double minX = 0, minY = 0, maxX = 0, maxY = 0;
+  double globalTh;
+  int axis;
+
+  startAngle = ArMath::fixAngle(startAngle);
+  endAngle = ArMath::fixAngle(endAngle);
+
+  // with the grid we only look at the cells that the slice (out to
+  // the max range) overlaps, so find the bounding box of the slice:
+  // the center, the ends of the two edges, and wherever the arc
+  // crosses an axis
+  if (myGridCellSize > 0)
+  {
+    minX = maxX = startPos.getX();
+    minY = maxY = startPos.getY();
+    for (axis = -2; axis < 4; axis++)
+    {
+      if (axis == -2)
+	globalTh = startAngle + startPos.getTh();
+      else if (axis == -1)
+	globalTh = endAngle + startPos.getTh();
+      else if (ArMath::angleBetween(
+		       ArMath::subAngle(axis * 90, startPos.getTh()), 
+		       startAngle, endAngle))
+	globalTh = axis * 90;
+      else
+	continue;
+      gridExpand(startPos.getX() + ArMath::cos(globalTh) * maxRange, 
+		 startPos.getY() + ArMath::sin(globalTh) * maxRange,
+		 &minX, &minY, &maxX, &maxY);
+    }
+  }
+  if (myGridCellSize > 0 && 
+      gridCells(minX, minY, maxX, maxY, &cellX1, &cellY1, &cellX2, &cellY2))
+  {
+    for (cellX = cellX1; cellX <= cellX2; cellX++)
+      for (cellY = cellY1; cellY <= cellY2; cellY++)
+	for (index = myGridBucketHead[gridBucket(cellX, cellY)]; 
+	     index >= 0; index = myGridNext[index])
+	  polarCheck(myPoolX[index], myPoolY[index], startPos, 
+		     startAngle, endAngle, 
+		     &foundOne, &closestSquared, &closeTh);
+  }
+  else
+  {
+    poolSpans(&spanEnd[0], &spanEnd[1]);
+    spanStart[0] = myPoolHead;
+    spanStart[1] = 0;
+    for (span = 0; span < 2; span++)
+      for (i = spanStart[span]; i < spanEnd[span]; i++)
+	polarCheck(myPoolX[i], myPoolY[i], startPos, startAngle, endAngle, 
+		   &foundOne, &closestSquared, &closeTh);
+  }
+  if (!foundOne)
+    return maxRange;
+  if (angle != NULL)
+    *angle = closeTh;
+  double closest = sqrt(closestSquared);
+  if (closest > maxRange)
+    return maxRange;
+  else
+    return closest;  
 }
 
 AREXPORT double ArRangeBuffer::getClosestPolarInList(
@@ -217,14 +461,137 @@ AREXPORT double ArRangeBuffer::getClosestPolarInList(
    to the closest reading, if it is >= maxRange, then there was no reading 
    in the given section
 */
+/// The state for the pooled closest box search
+class ArRangeBufferBoxSearch
+{
+public:
+  double transX, transY, transCos, transSin;
+  double x1, y1, x2, y2;
+  double targetX, targetY;
+  double closestSquared;
+  double closestX, closestY;
+  bool foundOne;
+  /// Checks one reading (same as ArTransform::doTransform, but
+  /// without the pose copies)
+  void check(double readingX, double readingY)
+    {
+      double x = transX + transCos * readingX + transSin * readingY;
+      double y = transY + transCos * readingY - transSin * readingX;
+      double dx, dy, distSquared;
+      if (x < x1 || x > x2 || y < y1 || y > y2)
+	return;
+      dx = x - targetX;
+      dy = y - targetY;
+      distSquared = dx * dx + dy * dy;
+      if (distSquared < closestSquared)
+      {
+	closestSquared = distSquared;
+	closestX = x;
+	closestY = y;
+	foundOne = true;
+      }
+    }
+};
+
 AREXPORT double ArRangeBuffer::getClosestBox(double x1, double y1, double x2,
 					     double y2, ArPose startPos,
 					     unsigned int maxRange, 
 					     ArPose *readingPos,
 					     ArPose targetPose) const
 {
-  return getClosestBoxInList(x1, y1, x2, y2, startPos, maxRange, readingPos, 
-			     targetPose, &myBuffer);
+  if (!myPooled)
+    return getClosestBoxInList(x1, y1, x2, y2, startPos, maxRange, 
+			       readingPos, targetPose, &myBuffer);
+
+  ArRangeBufferBoxSearch search;
+  ArTransform trans;
+  ArTransform toGlobal(startPos);
+  ArPose corner;
+  double temp;
+  size_t spanEnd[2];
+  size_t spanStart[2];
+  size_t span, i;
+  int cellX, cellY, cellX1, cellY1, cellX2, cellY2;
+  int index;
+  double minX = 0, minY = 0, maxX = 0, maxY = 0;
+
+  trans.setTransform(startPos, ArPose(0, 0, 0));
+  search.transX = trans.getX();
+  search.transY = trans.getY();
+  search.transCos = ArMath::cos(-trans.getTh());
+  search.transSin = ArMath::sin(-trans.getTh());
+  search.targetX = targetPose.getX();
+  search.targetY = targetPose.getY();
+  search.closestSquared = (double)maxRange * (double)maxRange;
+  search.foundOne = false;
+  search.closestX = 0;
+  search.closestY = 0;
+
+  if (x1 >= x2)
+  {
+    temp = x1, 
+    x1 = x2;
+    x2 = temp;
+  }
+  if (y1 >= y2)
+  {
+    temp = y1, 
+    y1 = y2;
+    y2 = temp;
+  }
+
+  search.x1 = x1;
+  search.y1 = y1;
+  search.x2 = x2;
+  search.y2 = y2;
+
+  // with the grid only look at the cells the box (in global coords) overlaps
+  if (myGridCellSize > 0)
+  {
+    corner = toGlobal.doTransform(ArPose(x1, y1));
+    minX = maxX = corner.getX();
+    minY = maxY = corner.getY();
+    corner = toGlobal.doTransform(ArPose(x1, y2));
+    gridExpand(corner.getX(), corner.getY(), &minX, &minY, &maxX, &maxY);
+    corner = toGlobal.doTransform(ArPose(x2, y1));
+    gridExpand(corner.getX(), corner.getY(), &minX, &minY, &maxX, &maxY);
+    corner = toGlobal.doTransform(ArPose(x2, y2));
+    gridExpand(corner.getX(), corner.getY(), &minX, &minY, &maxX, &maxY);
+  }
+  if (myGridCellSize > 0 && 
+      gridCells(minX, minY, maxX, maxY, &cellX1, &cellY1, &cellX2, &cellY2))
+  {
+    for (cellX = cellX1; cellX <= cellX2; cellX++)
+      for (cellY = cellY1; cellY <= cellY2; cellY++)
+	for (index = myGridBucketHead[gridBucket(cellX, cellY)]; 
+	     index >= 0; index = myGridNext[index])
+	  search.check(myPoolX[index], myPoolY[index]);
+  }
+  else
+  {
+    poolSpans(&spanEnd[0], &spanEnd[1]);
+    spanStart[0] = myPoolHead;
+    spanStart[1] = 0;
+    for (span = 0; span < 2; span++)
+      for (i = spanStart[span]; i < spanEnd[span]; i++)
+	search.check(myPoolX[i], myPoolY[i]);
+  }
+
+  if (readingPos != NULL)
+  {
+    if (search.foundOne)
+      readingPos->setPose(search.closestX, search.closestY, 
+			  ArMath::fixAngle(trans.getTh()));
+    else
+      *readingPos = ArPose();
+  }
+  if (!search.foundOne)
+    return maxRange;
+  double closest = sqrt(search.closestSquared);
+  if (closest > maxRange)
+    return maxRange;
+  else
+    return closest;
 }
 
 /**
@@ -315,7 +682,23 @@ AREXPORT double ArRangeBuffer::getClosestBoxInList(
 */    
 AREXPORT void ArRangeBuffer::applyTransform(ArTransform trans)
 {
-  trans.doTransform(&myBuffer);
+  if (!myPooled)
+  {
+    trans.doTransform(&myBuffer);
+    return;
+  }
+
+  ArPose pose;
+  size_t i;
+  for (i = 0; i < myPoolCount; i++)
+  {
+    pose = trans.doTransform(ArPose(myPoolX[poolIndex(i)], 
+				    myPoolY[poolIndex(i)]));
+    myPoolX[poolIndex(i)] = pose.getX();
+    myPoolY[poolIndex(i)] = pose.getY();
+    adapterUpdate(poolIndex(i));
+  }
+  gridRebuild();
 }
 
 AREXPORT void ArRangeBuffer::clear(void)
@@ -333,6 +716,22 @@ AREXPORT void ArRangeBuffer::clearOlderThan(int milliSeconds)
 {
   std::list<ArPoseWithTime *>::iterator it;
 
+  if (myPooled)
+  {
+    size_t i;
+    beginInvalidationSweep();
+    for (i = 0; i < myPoolCount; i++)
+    {
+      if (myPoolTime[poolIndex(i)].mSecSince() > milliSeconds)
+      {
+	myPoolInvalid[poolIndex(i)] = 1;
+	myPoolNumInvalid++;
+      }
+    }
+    endInvalidationSweep();
+    return;
+  }
+
   beginInvalidationSweep();
   for (it = myBuffer.begin(); it != myBuffer.end(); ++it)
   {
@@ -359,7 +758,9 @@ AREXPORT void ArRangeBuffer::clearOlderThanSeconds(int seconds)
 **/     
 AREXPORT void ArRangeBuffer::beginRedoBuffer(void)
 {
-  myRedoIt = myBuffer.begin();
+  if (!myPooled)
+    myRedoIt = myBuffer.begin();
+  myPoolRedoIndex = 0;
   myHitEnd = false;
   myNumRedone = 0;
 }
@@ -371,6 +772,26 @@ AREXPORT void ArRangeBuffer::beginRedoBuffer(void)
 */
 AREXPORT void ArRangeBuffer::redoReading(double x, double y)
 {
+  if (myPooled)
+  {
+    if (myPoolRedoIndex < myPoolCount && !myHitEnd)
+    {
+      gridRemove(poolIndex(myPoolRedoIndex));
+      myPoolX[poolIndex(myPoolRedoIndex)] = x;
+      myPoolY[poolIndex(myPoolRedoIndex)] = y;
+      gridInsert(poolIndex(myPoolRedoIndex));
+      adapterUpdate(poolIndex(myPoolRedoIndex));
+      myPoolRedoIndex++;
+    }
+    else
+    {
+      addReading(x, y);
+      myHitEnd = true;
+    }
+    myNumRedone++;
+    return;
+  }
+
   if (myRedoIt != myBuffer.end() && !myHitEnd)
   {
     (*myRedoIt)->setPose(x, y);
@@ -391,6 +812,18 @@ AREXPORT void ArRangeBuffer::redoReading(double x, double y)
 **/
 AREXPORT void ArRangeBuffer::endRedoBuffer(void)
 {
+  if (myPooled)
+  {
+    // the ones that weren't redone are the oldest, so just drop them
+    if (!myHitEnd && myPoolRedoIndex < myPoolCount)
+    {
+      myPoolCount = myPoolRedoIndex;
+      myAdapterValid = false;
+      gridRebuild();
+    }
+    return;
+  }
+
   if (!myHitEnd)
   {
     // now we get rid of the extra readings on the end
@@ -417,7 +850,57 @@ AREXPORT void ArRangeBuffer::endRedoBuffer(void)
 AREXPORT void ArRangeBuffer::addReadingConditional(
 	double x, double y, double closeDistSquared, bool *wasAdded)
 {
-  if (closeDistSquared >= 0)
+  int cellX, cellY, cellX1, cellY1, cellX2, cellY2;
+  int index;
+  double closeDist = 0;
+  if (closeDistSquared > 0)
+    closeDist = sqrt(closeDistSquared);
+  if (closeDistSquared > 0 && myGridCellSize > 0 &&
+      gridCells(x - closeDist, y - closeDist, 
+		x + closeDist, y + closeDist, 
+		&cellX1, &cellY1, &cellX2, &cellY2))
+  {
+    for (cellX = cellX1; cellX <= cellX2; cellX++)
+      for (cellY = cellY1; cellY <= cellY2; cellY++)
+	for (index = myGridBucketHead[gridBucket(cellX, cellY)]; 
+	     index >= 0; index = myGridNext[index])
+	{
+	  if (ArMath::squaredDistanceBetween(myPoolX[index], myPoolY[index],
+					     x, y) < closeDistSquared)
+	  {
+	    myPoolTime[index].setToCachedNow();
+	    adapterUpdate(index);
+	    if (wasAdded != NULL)
+	      *wasAdded = false;
+	    return;
+	  }
+	}
+  }
+  else if (closeDistSquared >= 0 && myPooled)
+  {
+    size_t spanEnd[2];
+    size_t spanStart[2];
+    size_t span, i;
+    poolSpans(&spanEnd[0], &spanEnd[1]);
+    spanStart[0] = myPoolHead;
+    spanStart[1] = 0;
+    for (span = 0; span < 2; span++)
+    {
+      for (i = spanStart[span]; i < spanEnd[span]; i++)
+      {
+	if (ArMath::squaredDistanceBetween(myPoolX[i], myPoolY[i],
+					   x, y) < closeDistSquared)
+	{
+	  myPoolTime[i].setToCachedNow();
+	  adapterUpdate(i);
+	  if (wasAdded != NULL)
+	    *wasAdded = false;
+	  return;
+	}
+      }
+    }
+  }
+  else if (closeDistSquared >= 0)
   {  
     std::list<ArPoseWithTime *>::iterator it;
     ArPoseWithTime *pose;
@@ -427,7 +910,7 @@ AREXPORT void ArRangeBuffer::addReadingConditional(
       if (ArMath::squaredDistanceBetween(pose->getX(), pose->getY(),
 					 x, y) < closeDistSquared)
       {
-	pose->setTimeToNow();
+	pose->setTimeToCachedNow();
 	if (wasAdded != NULL)
 	  *wasAdded = false;
 	return;
@@ -441,29 +924,40 @@ AREXPORT void ArRangeBuffer::addReadingConditional(
 }
 
 /**
+   The reading is timestamped with ArTime::setToCachedNow(), so
+   readings added in the same robot cycle or laser scan share the
+   time that was cached at the start of it.
+
    @param x the x position of the reading
    @param y the y position of the reading
 */
 AREXPORT void ArRangeBuffer::addReading(double x, double y) 
 {
+  if (myPooled)
+  {
+    poolAddReading(x, y);
+    return;
+  }
+
   if (myBuffer.size() < mySize)
   {
     if ((myIterator = myInvalidBuffer.begin()) != myInvalidBuffer.end())
     {
       myReading = (*myIterator);
       myReading->setPose(x, y);
-      myReading->setTimeToNow();
+      myReading->setTimeToCachedNow();
       myBuffer.push_front(myReading);
       myInvalidBuffer.pop_front();
     }
     else
-      myBuffer.push_front(new ArPoseWithTime(x, y));
+      myBuffer.push_front(new ArPoseWithTime(x, y, 0, 
+					     ArTime::INIT_CACHED_NOW));
   }
   else if ((myRevIterator = myBuffer.rbegin()) != myBuffer.rend())
   {
     myReading = (*myRevIterator);
     myReading->setPose(x, y);
-    myReading->setTimeToNow();
+    myReading->setTimeToCachedNow();
     myBuffer.pop_back();
     myBuffer.push_front(myReading);
   }
@@ -482,6 +976,13 @@ AREXPORT void ArRangeBuffer::addReading(double x, double y)
 */
 void ArRangeBuffer::beginInvalidationSweep(void)
 {
+  if (myPooled)
+  {
+    if (myPoolNumInvalid > 0)
+      std::fill(myPoolInvalid.begin(), myPoolInvalid.end(), 0);
+    myPoolNumInvalid = 0;
+    return;
+  }
   myInvalidSweepList.clear();
 }
 
@@ -495,6 +996,17 @@ void ArRangeBuffer::beginInvalidationSweep(void)
 AREXPORT void ArRangeBuffer::invalidateReading(
 	std::list<ArPoseWithTime*>::iterator readingIt)
 {
+  if (myPooled)
+  {
+    // the list points into the adapter, which is indexed like the pool
+    size_t index = (*readingIt) - &myAdapterPoses[0];
+    if (index < myPoolInvalid.size() && !myPoolInvalid[index])
+    {
+      myPoolInvalid[index] = 1;
+      myPoolNumInvalid++;
+    }
+    return;
+  }
   myInvalidSweepList.push_front(readingIt);
 }
 
@@ -506,6 +1018,12 @@ AREXPORT void ArRangeBuffer::invalidateReading(
 */
 void ArRangeBuffer::endInvalidationSweep(void)
 {
+  if (myPooled)
+  {
+    if (myPoolNumInvalid > 0)
+      poolCompact();
+    return;
+  }
   while ((myInvalidIt = myInvalidSweepList.begin()) != 
 	 myInvalidSweepList.end())
   {
@@ -529,6 +1047,19 @@ AREXPORT std::vector<ArPoseWithTime> *ArRangeBuffer::getBufferAsVector(void)
 {
   std::list<ArPoseWithTime *>::iterator it;
 
+  if (myPooled)
+  {
+    size_t i;
+    myVector.reserve(myPoolCount);
+    myVector.clear();
+    // oldest first, same as the list version
+    for (i = myPoolCount; i > 0; i--)
+      myVector.push_back(ArPoseWithTime(myPoolX[poolIndex(i - 1)],
+					myPoolY[poolIndex(i - 1)], 0,
+					myPoolTime[poolIndex(i - 1)]));
+    return &myVector;
+  }
+
   myVector.reserve(myBuffer.size());
   myVector.clear();
   // start filling the array with the buffer until we run out of
@@ -541,3 +1072,246 @@ AREXPORT std::vector<ArPoseWithTime> *ArRangeBuffer::getBufferAsVector(void)
 }
 
 
+
+void ArRangeBuffer::poolSpans(size_t *firstEnd, size_t *secondEnd) const
+{
+  *firstEnd = myPoolHead + myPoolCount;
+  *secondEnd = 0;
+  if (*firstEnd > myPoolX.size())
+  {
+    *secondEnd = *firstEnd - myPoolX.size();
+    *firstEnd = myPoolX.size();
+  }
+}
+
+void ArRangeBuffer::poolAddReading(double x, double y)
+{
+  size_t capacity = myPoolX.size();
+  if (capacity == 0)
+    return;
+
+  // the newest goes in front of the head, when we're full that's
+  // the slot the oldest reading was in
+  myPoolHead = (myPoolHead + capacity - 1) % capacity;
+  gridRemove(myPoolHead);
+  myPoolX[myPoolHead] = x;
+  myPoolY[myPoolHead] = y;
+  myPoolTime[myPoolHead].setToCachedNow();
+  myPoolInvalid[myPoolHead] = 0;
+  gridInsert(myPoolHead);
+
+  if (myAdapterValid)
+  {
+    // the list doesn't need to be rebuilt, just move the oldest node
+    // (which already points at this slot) to the front, or add a node
+    if (myPoolCount == capacity)
+      myBuffer.splice(myBuffer.begin(), myBuffer, --myBuffer.end());
+    else 
+    {
+      if (!myAdapterSpare.empty())
+	myBuffer.splice(myBuffer.begin(), myAdapterSpare, 
+			myAdapterSpare.begin());
+      else
+	myBuffer.push_front(NULL);
+      myAdapterListSize++;
+      myBuffer.front() = &myAdapterPoses[myPoolHead];
+    }
+    adapterUpdate(myPoolHead);
+  }
+
+  if (myPoolCount < capacity)
+    myPoolCount++;
+}
+
+void ArRangeBuffer::poolResize(size_t size)
+{
+  std::vector<double> xs(size);
+  std::vector<double> ys(size);
+  std::vector<ArTime> times(size, ArTime(ArTime::INIT_NONE));
+  size_t i;
+
+  // keep the newest readings, starting at the front of the new arrays
+  if (myPoolCount > size)
+    myPoolCount = size;
+  for (i = 0; i < myPoolCount; i++)
+  {
+    xs[i] = myPoolX[poolIndex(i)];
+    ys[i] = myPoolY[poolIndex(i)];
+    times[i] = myPoolTime[poolIndex(i)];
+  }
+  myPoolX.swap(xs);
+  myPoolY.swap(ys);
+  myPoolTime.swap(times);
+  myPoolInvalid.assign(size, 0);
+  myPoolNumInvalid = 0;
+  myPoolHead = 0;
+
+  // the list has pointers into the old adapter, so get rid of those
+  myBuffer.clear();
+  myAdapterSpare.clear();
+  myAdapterListSize = 0;
+  myAdapterPoses.resize(size, ArPoseWithTime(0, 0, 0, ArTime::INIT_NONE));
+  myAdapterValid = false;
+
+  gridRebuild();
+}
+
+/**
+   Removes the readings marked in myPoolInvalid, sliding the newer
+   readings down over them so the order stays the same.
+**/
+void ArRangeBuffer::poolCompact(void)
+{
+  size_t i, from, to;
+  size_t kept = 0;
+
+  for (i = 0; i < myPoolCount; i++)
+  {
+    from = poolIndex(i);
+    if (myPoolInvalid[from])
+    {
+      myPoolInvalid[from] = 0;
+      continue;
+    }
+    to = poolIndex(kept);
+    if (to != from)
+    {
+      myPoolX[to] = myPoolX[from];
+      myPoolY[to] = myPoolY[from];
+      myPoolTime[to] = myPoolTime[from];
+    }
+    kept++;
+  }
+  myPoolCount = kept;
+  myPoolNumInvalid = 0;
+  myAdapterValid = false;
+  gridRebuild();
+}
+
+/**
+   Makes myBuffer have the pool's readings, newest first, reusing the
+   list nodes from before (the extras are kept in myAdapterSpare) so
+   that once the buffer has filled up this doesn't allocate.
+**/
+void ArRangeBuffer::adapterRebuild(void)
+{
+  std::list<ArPoseWithTime *>::iterator it;
+  size_t i;
+
+  while (myAdapterListSize > myPoolCount)
+  {
+    myAdapterSpare.splice(myAdapterSpare.begin(), myBuffer, 
+			  --myBuffer.end());
+    myAdapterListSize--;
+  }
+  while (myAdapterListSize < myPoolCount)
+  {
+    if (!myAdapterSpare.empty())
+      myBuffer.splice(myBuffer.end(), myAdapterSpare, 
+		      myAdapterSpare.begin());
+    else
+      myBuffer.push_back(NULL);
+    myAdapterListSize++;
+  }
+  
+  myAdapterValid = true;
+  for (i = 0, it = myBuffer.begin(); it != myBuffer.end(); i++, ++it)
+  {
+    (*it) = &myAdapterPoses[poolIndex(i)];
+    adapterUpdate(poolIndex(i));
+  }
+}
+
+void ArRangeBuffer::adapterUpdate(size_t index)
+{
+  if (!myAdapterValid)
+    return;
+  ArPoseWithTime *pose = &myAdapterPoses[index];
+  pose->setPose(myPoolX[index], myPoolY[index]);
+  pose->setTime(myPoolTime[index]);
+}
+
+void ArRangeBuffer::gridInsert(size_t index)
+{
+  if (myGridCellSize <= 0)
+    return;
+  int bucket = gridBucket((int)floor(myPoolX[index] / myGridCellSize),
+			  (int)floor(myPoolY[index] / myGridCellSize));
+  myGridBucketOf[index] = bucket;
+  myGridPrev[index] = -1;
+  myGridNext[index] = myGridBucketHead[bucket];
+  if (myGridBucketHead[bucket] >= 0)
+    myGridPrev[myGridBucketHead[bucket]] = index;
+  myGridBucketHead[bucket] = index;
+}
+
+void ArRangeBuffer::gridRemove(size_t index)
+{
+  if (myGridCellSize <= 0 || myGridBucketOf[index] < 0)
+    return;
+  if (myGridPrev[index] >= 0)
+    myGridNext[myGridPrev[index]] = myGridNext[index];
+  else
+    myGridBucketHead[myGridBucketOf[index]] = myGridNext[index];
+  if (myGridNext[index] >= 0)
+    myGridPrev[myGridNext[index]] = myGridPrev[index];
+  myGridBucketOf[index] = -1;
+}
+
+void ArRangeBuffer::gridRebuild(void)
+{
+  size_t numBuckets = 64;
+  size_t i;
+
+  if (myGridCellSize <= 0)
+    return;
+
+  // the bucket count has to be a power of two for gridBucket
+  while (numBuckets < myPoolX.size())
+    numBuckets *= 2;
+  myGridBucketHead.assign(numBuckets, -1);
+  myGridNext.assign(myPoolX.size(), -1);
+  myGridPrev.assign(myPoolX.size(), -1);
+  myGridBucketOf.assign(myPoolX.size(), -1);
+  for (i = 0; i < myPoolCount; i++)
+    gridInsert(poolIndex(i));
+}
+
+/**
+   Figures out the range of grid cells that cover a box, this returns
+   false if it'd be quicker to just look at all the readings instead.
+**/
+bool ArRangeBuffer::gridCells(double minX, double minY, 
+			      double maxX, double maxY,
+			      int *cellX1, int *cellY1, 
+			      int *cellX2, int *cellY2) const
+{
+  double numCells;
+  if (myGridCellSize <= 0 || myPoolCount == 0)
+    return false;
+  numCells = ((floor(maxX / myGridCellSize) - 
+	       floor(minX / myGridCellSize) + 1) * 
+	      (floor(maxY / myGridCellSize) - 
+	       floor(minY / myGridCellSize) + 1));
+  if (numCells > myPoolCount || numCells > myGridBucketHead.size())
+    return false;
+  *cellX1 = (int)floor(minX / myGridCellSize);
+  *cellY1 = (int)floor(minY / myGridCellSize);
+  *cellX2 = (int)floor(maxX / myGridCellSize);
+  *cellY2 = (int)floor(maxY / myGridCellSize);
+  return true;
+}
+
+void ArRangeBuffer::gridExpand(double x, double y, 
+			       double *minX, double *minY,
+			       double *maxX, double *maxY)
+{
+  if (x < *minX)
+    *minX = x;
+  if (x > *maxX)
+    *maxX = x;
+  if (y < *minY)
+    *minY = y;
+  if (y > *maxY)
+    *maxY = y;
+}
@@ -256,6 +256,39 @@ AREXPORT size_t ArRangeDevice::getCumulativeBufferSize(void) const
   return myCumulativeBuffer.getSize();
 }
 
+/**
+   Pooled storage keeps the readings in preallocated contiguous
+   arrays instead of a list of individually allocated readings, which
+   is much easier on the allocator for devices that add a lot of
+   readings (see ArRangeBuffer::setPooledStorage()).
+   @param current whether the current buffer should use pooled storage
+   @param cumulative whether the cumulative buffer should use pooled storage
+*/
+AREXPORT void ArRangeDevice::setPooledBufferStorage(bool current,
+						   bool cumulative)
+{
+  lockDevice();
+  myCurrentBuffer.setPooledStorage(current);
+  myCumulativeBuffer.setPooledStorage(cumulative);
+  unlockDevice();
+}
+
+/**
+   This keeps a grid index over the cumulative readings (which also
+   means pooled storage, see ArRangeBuffer::setGridIndex()), so that
+   the cumulative box and polar searches (and so
+   ArRobot::checkRangeDevicesCumulativeBox() and
+   ArRobot::checkRangeDevicesCumulativePolar()) only look at the
+   readings near the region instead of at every reading.
+   @param cellSize the size of the grid cells in mm, 0 to not use a grid
+*/
+AREXPORT void ArRangeDevice::setCumulativeBufferGridIndex(double cellSize)
+{
+  lockDevice();
+  myCumulativeBuffer.setGridIndex(cellSize);
+  unlockDevice();
+}
+
 AREXPORT void ArRangeDevice::addReading(double x, double y, bool *wasAdded)
 {
   myCurrentBuffer.addReadingConditional(x, y, 
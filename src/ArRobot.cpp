@@ -87,6 +87,7 @@ AREXPORT ArRobot::ArRobot(const char *name, bool obsolete,
   myStateReflectorCB(this, &ArRobot::stateReflector),
   myRobotLockerCB(this, &ArRobot::robotLocker),
   myRobotUnlockerCB(this, &ArRobot::robotUnlocker),
+  myStatePublisherCB(this, &ArRobot::statePublisher),
   myKeyHandlerExitCB(this, &ArRobot::keyHandlerExit),
   myGetCycleWarningTimeCB(this, &ArRobot::getCycleWarningTime),
   myGetNoTimeWarningThisCycleCB(this, &ArRobot::getNoTimeWarningThisCycle),
@@ -157,6 +158,7 @@ AREXPORT ArRobot::ArRobot(const char *name, bool obsolete,
   myTimeoutTime = 8000;
   myStabilizingTime = 0;
   myCounter = 1;
+  myStateMutex.setLogName("ArRobot::myStateMutex");
   myResolver = NULL;
   myNumSonar = 0;
 
@@ -210,6 +212,8 @@ AREXPORT ArRobot::~ArRobot()
   delete mySyncTaskRoot;
   ArUtil::deleteSetPairs(mySonars.begin(), mySonars.end());
   Aria::delRobot(this);
+  if (myAddedAriaExitCB)
+    Aria::remExitCallback(&myAriaExitCB);
 
   if (myKeyHandlerCB != NULL)
     delete myKeyHandlerCB;
@@ -362,6 +366,7 @@ AREXPORT void ArRobot::setUpSyncList(void)
   mySyncTaskRoot->addNewLeaf("Action Handler", 55, &myActionHandlerCB);
   mySyncTaskRoot->addNewLeaf("State Reflector", 45, &myStateReflectorCB);
   mySyncTaskRoot->addNewBranch("User Tasks", 25);
+  mySyncTaskRoot->addNewLeaf("State Publisher", 21, &myStatePublisherCB);
   mySyncTaskRoot->addNewLeaf("Robot Unlocker", 20, &myRobotUnlockerCB);
 }
 
@@ -1812,6 +1817,9 @@ AREXPORT void ArRobot::finishedConnection(void)
     (*it)->invoke();
   myLastPacketReceivedTime.setToNow();
   myLastOdometryReceivedTime.setToNow();
+  // so anyone using the state snapshot has the connected state before
+  // the first cycle is done
+  statePublisher();
 
   wakeAllConnWaitingThreads();
 }
@@ -3190,6 +3198,97 @@ AREXPORT void ArRobot::logAllTasks(void) const
     mySyncTaskRoot->log();
 }
 
+/**
+   When this is on each of the syncronous tasks (packet handler,
+   sensor interp tasks, action handler, state reflector, user tasks,
+   etc) keeps a histogram of how long it takes to run, and a count of
+   how many times it took longer than the cycle warning time, so you
+   can find which task is making the cycle run long.  This can be
+   turned on and off at any time, when it is off it costs next to
+   nothing.
+
+   @see getSyncTaskTiming
+   @see logSyncTaskTiming
+**/
+AREXPORT void ArRobot::setSyncTaskTimingEnabled(bool enabled)
+{
+  if (mySyncTaskRoot != NULL)
+    mySyncTaskRoot->setTimingEnabled(enabled);
+}
+
+AREXPORT bool ArRobot::getSyncTaskTimingEnabled(void) const
+{
+  if (mySyncTaskRoot != NULL)
+    return mySyncTaskRoot->getTimingEnabled();
+  return false;
+}
+
+AREXPORT void ArRobot::resetSyncTaskTiming(void)
+{
+  if (mySyncTaskRoot != NULL)
+    mySyncTaskRoot->resetTiming();
+}
+
+/**
+   @param name the name of the task (as given to addUserTask,
+   addSensorInterpTask, etc, or one of the robot's own tasks like
+   "Packet Handler" or "Action Handler"), or NULL to get the timing of
+   the whole set of syncronous tasks (ie the cycle)
+
+   @param timing the timing is copied into this
+
+   @param overrunCount if not NULL the number of times the task took
+   longer than the cycle warning time is put here
+
+   @return true if the task was found, false if not
+**/
+AREXPORT bool ArRobot::getSyncTaskTiming(const char *name, 
+					 ArTimingHistogram *timing,
+					 unsigned int *overrunCount) const
+{
+  ArSyncTask *proc;
+
+  if (mySyncTaskRoot == NULL)
+    return false;
+  if (name == NULL)
+    proc = mySyncTaskRoot;
+  else
+    proc = mySyncTaskRoot->find(name);
+  if (proc == NULL)
+    return false;
+
+  if (timing != NULL)
+    *timing = proc->getTiming();
+  if (overrunCount != NULL)
+    *overrunCount = proc->getOverrunCount();
+  return true;
+}
+
+/**
+   This is only counted while the sync task timing is on (see
+   setSyncTaskTimingEnabled).
+**/
+AREXPORT unsigned int ArRobot::getCycleOverrunCount(void) const
+{
+  if (mySyncTaskRoot != NULL)
+    return mySyncTaskRoot->getOverrunCount();
+  return 0;
+}
+
+/**
+   Logs the timing of each syncronous task (in the same tree as
+   logAllTasks).
+   @see ArLog
+**/
+AREXPORT void ArRobot::logSyncTaskTiming(void) const
+{
+  if (mySyncTaskRoot == NULL)
+    return;
+  if (!mySyncTaskRoot->getTimingEnabled())
+    ArLog::log(ArLog::Terse, "Sync task timing is not enabled");
+  mySyncTaskRoot->logTiming();
+}
+
 /**
    Finds a user task by its name, searching the entire space of tasks
    @return NULL if no user task of that name found, otherwise a pointer to 
@@ -4520,22 +4619,75 @@ AREXPORT long int ArRobot::getRightEncoder()
 
 /**
  * @internal
-   This just locks the robot, so that its locked for all the user tasks
+   This just locks the robot, so that its locked for all the user tasks,
+   and caches the time for this cycle so that the sensor readings
+   that are timestamped with ArTime::setToCachedNow() while it runs
+   don't each read the clock
 **/
 AREXPORT void ArRobot::robotLocker(void)
 {
   lock();
+  ArTime::refreshCachedNow();
 }
 
 /**
  * @internal
-   This just unlocks the robot
+   This just unlocks the robot (and clears the cached time for the cycle)
 **/
 AREXPORT void ArRobot::robotUnlocker(void)
 {
+  ArTime::clearCachedNow();
   unlock();
 }
 
+/**
+ * @internal
+   Fills in a new state snapshot and then publishes it, this runs with
+   the robot locked at the end of each cycle (after the user tasks, so
+   that things like localization moving the robot are in it), and when
+   the robot connects so there's a snapshot before the first cycle.
+**/
+AREXPORT void ArRobot::statePublisher(void)
+{
+  ArRobotState state;
+
+  state.myPose = myGlobalPose;
+  state.myEncoderPose = myEncoderPose;
+  state.myVel = myVel;
+  state.myRotVel = myRotVel;
+  state.myLatVel = myLatVel;
+  state.myBatteryVoltage = getBatteryVoltage();
+  state.myRealBatteryVoltage = getRealBatteryVoltage();
+  state.myHaveStateOfCharge = myHaveStateOfCharge;
+  state.myStateOfCharge = getStateOfCharge();
+  state.myTemperature = myTemperature;
+  state.myFlags = myFlags;
+  state.myFaultFlags = myFaultFlags;
+  state.myStallValue = myStallValue;
+  state.myIsConnected = myIsConnected;
+  state.myCounter = myCounter;
+  myStateMutex.lock();
+  myState = state;
+  myStateMutex.unlock();
+}
+
+/**
+   This doesn't lock the robot or wait for the robot's cycle, it copies
+   the state the robot published at the end of its last cycle (see
+   ArRobotState), only locking a mutex that is held just long enough
+   to copy the state in or out.  So the state can be up to a cycle
+   old; if you need the state as of right now lock the robot and call
+   its get functions.
+
+   @param state this is filled in with the state
+**/
+AREXPORT void ArRobot::getStateSnapshot(ArRobotState *state) const
+{
+  myStateMutex.lock();
+  *state = myState;
+  myStateMutex.unlock();
+}
+
 
 
 AREXPORT void ArRobot::packetHandler(void)
@@ -5867,9 +6019,9 @@ AREXPORT bool ArRobot::hasRangeDevice(ArRangeDevice *device) const
  *  Find the closest reading from any range device's set of current readings
  *  within a polar region or "slice" defined by the given angle range.
  *  This function iterates through each registered range device (see 
- *  addRangeDevice()), calls ArRangeDevice::lockDevice(), uses
+ *  addRangeDevice()), calls ArRangeDevice::lockDeviceForRead(), uses
  *  ArRangeDevice::currentReadingPolar() to find a reading, then calls
- *  ArRangeDevice::unlockDevice().
+ *  ArRangeDevice::unlockDeviceForRead().
  *
  *  @copydoc ArRangeDevice::currentReadingPolar()
  *  @param rangeDevice If not null, then a pointer to the ArRangeDevice 
@@ -5893,10 +6045,10 @@ AREXPORT double ArRobot::checkRangeDevicesCurrentPolar(
   for (it = myRangeDeviceList.begin(); it != myRangeDeviceList.end(); ++it)
   {
     device = (*it);
-    device->lockDevice();
+    device->lockDeviceForRead();
     if (!useLocationDependentDevices && device->isLocationDependent())
     {
-      device->unlockDevice();
+      device->unlockDeviceForRead();
       continue;
     }
     if (!foundOne || 
@@ -5917,7 +6069,7 @@ AREXPORT double ArRobot::checkRangeDevicesCurrentPolar(
       }
       foundOne = true;
     }
-    device->unlockDevice();
+    device->unlockDeviceForRead();
   }
   if (!foundOne)
     return -1;
@@ -5934,9 +6086,9 @@ AREXPORT double ArRobot::checkRangeDevicesCurrentPolar(
  *  Find the closest reading from any range device's set of cumulative readings
  *  within a polar region or "slice" defined by the given angle range.
  *  This function iterates through each registered range device (see 
- *  addRangeDevice()), calls ArRangeDevice::lockDevice(), uses
+ *  addRangeDevice()), calls ArRangeDevice::lockDeviceForRead(), uses
  *  ArRangeDevice::cumulativeReadingPolar() to find a reading, then calls
- *  ArRangeDevice::unlockDevice().
+ *  ArRangeDevice::unlockDeviceForRead().
  *
  *  @copydoc ArRangeDevice::cumulativeReadingPolar()
  *  @param rangeDevice If not null, then a pointer to the ArRangeDevice 
@@ -5958,10 +6110,10 @@ AREXPORT double ArRobot::checkRangeDevicesCumulativePolar(
   for (it = myRangeDeviceList.begin(); it != myRangeDeviceList.end(); ++it)
   {
     device = (*it);
-    device->lockDevice();
+    device->lockDeviceForRead();
     if (!useLocationDependentDevices && device->isLocationDependent())
     {
-      device->unlockDevice();
+      device->unlockDeviceForRead();
       continue;
     }
     if (!foundOne || 
@@ -5982,7 +6134,7 @@ AREXPORT double ArRobot::checkRangeDevicesCumulativePolar(
       }
       foundOne = true;
     }
-    device->unlockDevice();
+    device->unlockDeviceForRead();
   }
   if (!foundOne)
     return -1;
@@ -6030,10 +6182,10 @@ AREXPORT double ArRobot::checkRangeDevicesCurrentBox(
   for (it = myRangeDeviceList.begin(); it != myRangeDeviceList.end(); ++it)
   {
     device = (*it);
-    device->lockDevice();
+    device->lockDeviceForRead();
     if (!useLocationDependentDevices && device->isLocationDependent())
     {
-      device->unlockDevice();
+      device->unlockDeviceForRead();
       continue;
     }
     if (!foundOne || 
@@ -6052,7 +6204,7 @@ AREXPORT double ArRobot::checkRangeDevicesCurrentBox(
       }
       foundOne = true;
     }
-    device->unlockDevice();
+    device->unlockDeviceForRead();
   }
   if (!foundOne)
     return -1;
@@ -6100,10 +6252,10 @@ AREXPORT double ArRobot::checkRangeDevicesCumulativeBox(
   for (it = myRangeDeviceList.begin(); it != myRangeDeviceList.end(); ++it)
   {
     device = (*it);
-    device->lockDevice();
+    device->lockDeviceForRead();
     if (!useLocationDependentDevices && device->isLocationDependent())
     {
-      device->unlockDevice();
+      device->unlockDeviceForRead();
       continue;
     }
     if (!foundOne || 
@@ -6122,7 +6274,7 @@ AREXPORT double ArRobot::checkRangeDevicesCumulativeBox(
       }
       foundOne = true;
     }
-    device->unlockDevice();
+    device->unlockDeviceForRead();
   }
   if (!foundOne)
     return -1;
@@ -54,6 +54,8 @@ AREXPORT ArRobotPacketReceiver::ArRobotPacketReceiver(bool allocatePackets,
   mySync1 = sync1;
   mySync2 = sync2;
   myPacketReceivedCallback = NULL;
+  myAllocatedPacket = NULL;
+  myReadBuffer.setDeviceConnection(myDeviceConn);
 }
 
 /**
@@ -79,6 +81,8 @@ AREXPORT ArRobotPacketReceiver::ArRobotPacketReceiver(
   mySync1 = sync1;
   mySync2 = sync2;
   myPacketReceivedCallback = NULL;
+  myAllocatedPacket = NULL;
+  myReadBuffer.setDeviceConnection(myDeviceConn);
 }
 
 /**
@@ -107,17 +111,21 @@ AREXPORT ArRobotPacketReceiver::ArRobotPacketReceiver(
   mySync1 = sync1;
   mySync2 = sync2;
   myPacketReceivedCallback = NULL;
+  myAllocatedPacket = NULL;
+  myReadBuffer.setDeviceConnection(myDeviceConn);
 }
 
 AREXPORT ArRobotPacketReceiver::~ArRobotPacketReceiver() 
 {
-  
+  if (myAllocatedPacket != NULL)
+    delete myAllocatedPacket;
 }
 
 AREXPORT void ArRobotPacketReceiver::setDeviceConnection(
 	ArDeviceConnection *deviceConnection)
 {
   myDeviceConn = deviceConnection;
+  myReadBuffer.setDeviceConnection(myDeviceConn);
 }
 
 AREXPORT ArDeviceConnection *ArRobotPacketReceiver::getDeviceConnection(void)
@@ -138,32 +146,31 @@ AREXPORT ArRobotPacket *ArRobotPacketReceiver::receivePacket(
 	unsigned int msWait)
 {
   ArRobotPacket *packet;
-  unsigned char c;
   char buf[256];
-  int count = 0;
-  // state can be one of the STATE_ enums in the class
-  int state = STATE_SYNC1;
-  //unsigned int timeDone;
-  //unsigned int curTime;
+  int c;
+  int start;
+  int numRead;
   long timeToRunFor;
   ArTime timeDone;
   ArTime lastDataRead;
   ArTime packetReceived;
-  int numRead;
 
-  if (myAllocatePackets)
-    packet = new ArRobotPacket(mySync1, mySync2);
-  else
-    packet = &myPacket;
-
-  if (packet == NULL || myDeviceConn == NULL || 
+  if (myDeviceConn == NULL || 
       myDeviceConn->getStatus() != ArDeviceConnection::STATUS_OPEN)
   {
-    myDeviceConn->debugEndPacket(false, -10);
-    if (myAllocatePackets)
-      delete packet;
+    if (myDeviceConn != NULL)
+      myDeviceConn->debugEndPacket(false, -10);
     return NULL;
   }
+
+  if (myAllocatePackets)
+  {
+    if (myAllocatedPacket == NULL)
+      myAllocatedPacket = new ArRobotPacket(mySync1, mySync2);
+    packet = myAllocatedPacket;
+  }
+  else
+    packet = &myPacket;
   
   timeDone.setToNow();
   if (!timeDone.addMSec(msWait)) {
@@ -209,133 +216,59 @@ AREXPORT ArRobotPacket *ArRobotPacketReceiver::receivePacket(
 
 			}  // end tracking		
 
+      if (myAllocatePackets)
+	myAllocatedPacket = NULL;
       return packet;
     }
     else
     {
       myDeviceConn->debugEndPacket(false, -20);
-      if (myAllocatePackets)
-	delete packet;
       return NULL;
     }
   }      
   
 
-  do
-    {
-      timeToRunFor = timeDone.mSecTo();
-      if (timeToRunFor < 0)
-        timeToRunFor = 0;
-
-      if (state == STATE_SYNC1)
-	myDeviceConn->debugStartPacket();
-
-      if (myDeviceConn->read((char *)&c, 1, timeToRunFor) == 0) 
-        {
-	  myDeviceConn->debugBytesRead(0);
-          if (state == STATE_SYNC1)
-            {
-	      myDeviceConn->debugEndPacket(false, -30);
-              if (myAllocatePackets)
-                delete packet;
-              return NULL;
-            }
-          else
-            {
-              //ArUtil::sleep(1);
-              continue;
-            }
-        }
-
-      myDeviceConn->debugBytesRead(1);
-
-      switch (state) {
-      case STATE_SYNC1:
-
-
-        if (c == mySync1) // move on, resetting packet
-          {
-            state = STATE_SYNC2;
-            packet->empty();
-            packet->setLength(0);
-            packet->uByteToBuf(c);
-            packetReceived = myDeviceConn->getTimeRead(0);
-            packet->setTimeReceived(packetReceived);
-          }
-        else
-	{
-          //printf("Bad sync1 %d\n", c);
-	}
-        break;
-      case STATE_SYNC2:
- 
-       if (c == mySync2) // move on, adding this byte
-          {
-            state = STATE_ACQUIRE_DATA;
-            packet->uByteToBuf(c);
-          }
-        else // go back to beginning, packet hosed
-          {
-	    //printf("Bad sync2 %d\n", c);
-            state = STATE_SYNC1;
-          }
-        break;
-      case STATE_ACQUIRE_DATA:
+  myDeviceConn->debugStartPacket();
+  // if there's part of a packet left from before, it's been waiting
+  // since it was read
+  if (myReadBuffer.getNumBytes() > 0)
+    lastDataRead = myReadBuffer.getTimeRead(myReadBuffer.getNumBytes() - 1);
+  while (true)
+  {
+    // throw out anything before the start of a packet
+    if ((start = myReadBuffer.find(mySync1)) != 0)
+      myReadBuffer.consume(start < 0 ? myReadBuffer.getNumBytes() : start);
 
-        // the character c is the count of the packets remianing at this point
-        // so we'll just put it into the packet then get the rest of the data
-        packet->uByteToBuf(c);
-        // if c > 200 than there is a problem, spec says packet max size is 200
-        count = 0;
-	/** this case can't happen since c can't be over that so taking it out
-        if (c > 255) 
-          {
-            ArLog::log(ArLog::Normal, "ArRobotPacketReceiver::receivePacket: bad packet, more than 255 bytes");
-            state = STATE_SYNC1;
-            break;
-          }
+    // see if we have the header, if so see if we have the rest
+    if (myReadBuffer.getNumBytes() >= 2 && myReadBuffer.peek(1) != mySync2)
+    {
+      // go back to beginning, packet hosed
+      myReadBuffer.consume(1);
+      continue;
+    }
+    if (myReadBuffer.getNumBytes() >= 3 && 
+	myReadBuffer.getNumBytes() >= 3 + (c = myReadBuffer.peek(2)))
+    {
+      packet->empty();
+      packet->setLength(0);
+      packetReceived = myReadBuffer.getTimeRead(0);
+      packet->setTimeReceived(packetReceived);
+      myReadBuffer.copy(packet->getBuf(), 0, 3 + c);
+      packet->setLength(3 + c);
+      if (packet->verifyCheckSum()) 
+      {
+	myReadBuffer.consume(3 + c);
+	packet->resetRead();
+	/* put this in if you want to see the packets received
+	   printf("Input ");
+	   packet->printHex();
 	*/
-        // here we read until we get as much as we want, OR until
-        // we go 100 ms without data... its arbitrary but it doesn't happen often
-        // and it'll mean a bad packet anyways
-        lastDataRead.setToNow();
-        while (count < c)
-          {
-            numRead = myDeviceConn->read(buf + count, c - count, 1);
-            if (numRead > 0)
-	    {
-	      myDeviceConn->debugBytesRead(numRead);
-              lastDataRead.setToNow();
-	    }
-	    else
-	    {
-	      myDeviceConn->debugBytesRead(0);
-	    }
-            if (lastDataRead.mSecTo() < -100)
-              {
-		myDeviceConn->debugEndPacket(false, -40);
-                if (myAllocatePackets)
-                  delete packet;
-		//printf("Bad time taken reading\n");
-                return NULL;
-              }
-            count += numRead;
-          }
-        packet->dataToBuf(buf, c);
-        if (packet->verifyCheckSum()) 
-          {
 	
-            packet->resetRead();
-	    /* put this in if you want to see the packets received
-	       printf("Input ");
-               packet->printHex();
-	       */
-
-	    // you can also do this next line if you only care about type
-	    //printf("Input %x\n", packet->getID());
-	    myDeviceConn->debugEndPacket(true, packet->getID());
-	    if (myPacketReceivedCallback != NULL)
-	      myPacketReceivedCallback->invoke(packet);
+	// you can also do this next line if you only care about type
+	//printf("Input %x\n", packet->getID());
+	myDeviceConn->debugEndPacket(true, packet->getID());
+	if (myPacketReceivedCallback != NULL)
+	  myPacketReceivedCallback->invoke(packet);
 
 			// if tracking is on - log packet - also make sure
 			// buffer length is in range
@@ -358,32 +291,54 @@ AREXPORT ArRobotPacket *ArRobotPacketReceiver::receivePacket(
 
 			}  // end tracking		
 
-			return packet;
-          }
-        else 
-          {
-	    /* put this in if you want to see bad checksum packets 
-               printf("Bad Input ");
-               packet->printHex();
-	       */
-            ArLog::log(ArLog::Normal, 
-                       "ArRobotPacketReceiver::receivePacket: bad packet, bad checksum");
-            state = STATE_SYNC1;
-	    myDeviceConn->debugEndPacket(false, -50);
-            break;
-          }
-        break;
-      default:
-        break;
+	if (myAllocatePackets)
+	  myAllocatedPacket = NULL;
+	return packet;
       }
-    } while (timeDone.mSecTo() >= 0 || state != STATE_SYNC1);
-
-  myDeviceConn->debugEndPacket(false, -60);
-  //printf("finished the loop...\n");
-  if (myAllocatePackets)
-    delete packet;
-  return NULL;
+      else 
+      {
+	/* put this in if you want to see bad checksum packets 
+	   printf("Bad Input ");
+	   packet->printHex();
+	*/
+	ArLog::log(ArLog::Normal, 
+		   "ArRobotPacketReceiver::receivePacket: bad packet, bad checksum");
+	// only skip the sync byte, since a real packet might be inside
+	// what looked like this one
+	myReadBuffer.consume(1);
+	myDeviceConn->debugEndPacket(false, -50);
+	myDeviceConn->debugStartPacket();
+	continue;
+      }
+    }
 
+    // we need more data, if we're in the middle of a packet wait for
+    // the rest of it, unless we go 100 ms without data... its
+    // arbitrary but it doesn't happen often and it'll mean a bad
+    // packet anyways (which will get thrown out when the data after
+    // it comes in)
+    if (myReadBuffer.getNumBytes() > 0)
+    {
+      if ((numRead = myReadBuffer.fill(1)) > 0)
+	lastDataRead.setToNow();
+      else if (numRead < 0 || lastDataRead.mSecTo() < -100)
+      {
+	myDeviceConn->debugEndPacket(false, -40);
+	return NULL;
+      }
+      continue;
+    }
+    timeToRunFor = timeDone.mSecTo();
+    if (timeToRunFor < 0)
+      timeToRunFor = 0;
+    if ((numRead = myReadBuffer.fill(timeToRunFor)) <= 0)
+    {
+      myDeviceConn->debugBytesRead(0);
+      myDeviceConn->debugEndPacket(false, numRead < 0 ? -30 : -60);
+      return NULL;
+    }
+    lastDataRead.setToNow();
+  }
 }
 
 AREXPORT void ArRobotPacketReceiver::setPacketReceivedCallback(
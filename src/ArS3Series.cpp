@@ -1043,65 +1043,73 @@ void ArS3Series::sensorInterp(void) {
 
 		}
 
-		for (atDeg = start,
-				it = myRawReadings->begin(),
-				readingIndex = 0,
-				onReading = 0;
+		// if we're not interpolating all the readings are from the
+		// same spot so the whole scan is converted at once
+		if (!interpolateReadings)
+		{
+			myScanRanges.resize(eachNumberData);
+			for (readingIndex = 0; readingIndex < eachNumberData; readingIndex++)
+			{
+				dist = ((buf[(readingIndex * 2) + 1] & 0x8f) << 8)
+								| buf[readingIndex * 2];
+				myScanRanges[readingIndex] = dist * 10; // convert to mm
+			}
+			if (eachNumberData > 0)
+				laserConvertScan(&myScanRanges[0], NULL, eachNumberData, start,
+						increment, pose, encoderPose, transform, counter, time);
+		}
+		else
+		{
+			for (atDeg = start,
+					it = myRawReadings->begin(),
+					readingIndex = 0,
+					onReading = 0;
 
-				onReading < eachNumberData;
+					onReading < eachNumberData;
 
-				atDeg += increment,
-				it++,
-				readingIndex++,
-				onReading++)
-		{
+					atDeg += increment,
+					it++,
+					readingIndex++,
+					onReading++)
+			{
 
 
-			reading = (*it);
+				reading = (*it);
 
-			dist = ((buf[(readingIndex * 2) + 1] & 0x8f) << 8)
-							| buf[readingIndex * 2];
-			dist = dist * 10; // convert to mm
+				dist = ((buf[(readingIndex * 2) + 1] & 0x8f) << 8)
+								| buf[readingIndex * 2];
+				dist = dist * 10; // convert to mm
 
-			if (interpolateReadings)
-			{
-			  interpolateDelta.setX(
-				  interpolateDelta.getX() + incrX);
-			  interpolateDelta.setY(
-				  interpolateDelta.getY() + incrY);
-			  interpolateDelta.setTh(
-				  ArMath::addAngle(interpolateDelta.getTh(),
-						   incrTh));
-
-			  /*
-			  ArLog::log(ArLog::Normal, "%d %g %g %g",
-				     onReading, 
-				     interpolateDelta.getX(), 
-				     interpolateDelta.getY(), 
-				     interpolateDelta.getTh());
-			  */
-
-			  reading->resetSensorPosition(
-				  ArMath::roundInt(mySensorPose.getX() + 
-						   interpolateDelta.getX()),
-				  ArMath::roundInt(mySensorPose.getY() + 
-						   interpolateDelta.getY()),
-				  ArMath::addAngle(atDeg,
-						   interpolateDelta.getTh()));
-			}
-			else
-			{
-			  reading->resetSensorPosition(
-				  ArMath::roundInt(mySensorPose.getX()),
-				  ArMath::roundInt(mySensorPose.getY()), 
-				  atDeg);
-			}
-			reading->newData(dist, pose, encoderPose, transform, counter, time,
-					ignore, 0); // no reflector yet
+				interpolateDelta.setX(
+					interpolateDelta.getX() + incrX);
+				interpolateDelta.setY(
+					interpolateDelta.getY() + incrY);
+				interpolateDelta.setTh(
+					ArMath::addAngle(interpolateDelta.getTh(),
+							 incrTh));
+
+				/*
+				ArLog::log(ArLog::Normal, "%d %g %g %g",
+					   onReading, 
+					   interpolateDelta.getX(), 
+					   interpolateDelta.getY(), 
+					   interpolateDelta.getTh());
+				*/
 
-			//printf("dist = %d, pose = %d, encoderPose = %d, transform = %d, counter = %d, time = %d, igore = %d",
-			//		dist, pose, encoderPose, transform, counter,
-			//					 time, ignore);
+				reading->resetSensorPosition(
+					ArMath::roundInt(mySensorPose.getX() + 
+							 interpolateDelta.getX()),
+					ArMath::roundInt(mySensorPose.getY() + 
+							 interpolateDelta.getY()),
+					ArMath::addAngle(atDeg,
+							 interpolateDelta.getTh()));
+				reading->newData(dist, pose, encoderPose, transform, counter, time,
+						ignore, 0); // no reflector yet
+
+				//printf("dist = %d, pose = %d, encoderPose = %d, transform = %d, counter = %d, time = %d, igore = %d",
+				//		dist, pose, encoderPose, transform, counter,
+				//					 time, ignore);
+			}
 		}
 		/*
 		 ArLog::log(ArLog::Normal,
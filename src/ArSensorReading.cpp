@@ -27,6 +27,47 @@ Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
 #include "ariaOSDef.h"
 #include "ArSensorReading.h"
 #include "ariaUtil.h"
+/**
+   This is for when whoever has the reading has already found where
+   it is relative to the robot and in global coordinates (for
+   instance ArLaser does that for a whole scan at once), so it just
+   sets the values.
+
+   @param range the distance from the sensor to the sensor return (mm)
+   @param localX the x of the sensor return relative to the robot (mm)
+   @param localY the y of the sensor return relative to the robot (mm)
+   @param x the x of the sensor return in global coordinates (mm)
+   @param y the y of the sensor return in global coordinates (mm)
+   @param th the heading of the sensor return in global coordinates
+   (the heading of the transform that was used to find x and y)
+   @param robotPose the robot's pose when the reading was taken
+   @param encoderPose the robot's encoder pose when the reading was taken
+   @param counter the counter from the robot when the sensor reading was taken
+   @param timeTaken the time the reading was taken
+   @param ignoreThisReading if this reading should be ignored or not
+   @param extraInt extra laser device-specific value associated with this
+   reading (e.g. SICK LMS-200 reflectance)
+*/
+AREXPORT void ArSensorReading::newData(int range, double localX, 
+				       double localY, double x, double y,
+				       double th, const ArPose &robotPose,
+				       const ArPose &encoderPose,
+				       unsigned int counter,
+				       const ArTime &timeTaken,
+				       bool ignoreThisReading, int extraInt)
+{
+  myRange = range;
+  myCounterTaken = counter;
+  myReadingTaken = robotPose;
+  myEncoderPoseTaken = encoderPose;
+  myLocalReading.setPose(localX, localY);
+  myReading.setPose(x, y, th);
+  myTimeTaken = timeTaken;
+  myIgnoreThisReading = ignoreThisReading;
+  myExtraInt = extraInt;
+  myAdjusted = false;
+}
+
 
 /**
    @param xPos the x position of the sensor on the robot (mm)
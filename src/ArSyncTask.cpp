@@ -41,16 +41,20 @@ AREXPORT ArSyncTask::ArSyncTask(const char *name, ArFunctor *functor,
   myFunctor = functor;
   myParent = parent;
   myIsDeleting = false;
+  myOverrunCount = 0;
+  myTimingMutex.setLogName("ArSyncTask::myTimingMutex");
   setState(ArTaskState::INIT);
   if (myParent != NULL)
   {
     setWarningTimeCB(parent->getWarningTimeCB());
     setNoTimeWarningCB(parent->getNoTimeWarningCB());
+    myTimingEnabled = parent->getTimingEnabled();
   }
   else
   {
     setWarningTimeCB(NULL);
     setNoTimeWarningCB(NULL);
+    myTimingEnabled = false;
   }
 }
 
@@ -250,6 +254,10 @@ AREXPORT void ArSyncTask::run(void)
   ArTaskState::State state;
   ArTime runTime;
   int took;  
+  bool timing = myTimingEnabled;
+  unsigned long long startUSec = 0;
+  unsigned long long tookUSec;
+  unsigned int warningTime = 0;
 
   state = getState();
   switch (state) 
@@ -267,17 +275,22 @@ AREXPORT void ArSyncTask::run(void)
     break;
   }
   
+  if (timing)
+    startUSec = ArUtil::getTimeUSec();
   runTime.setToNow();
   if (myFunctor != NULL)
     myFunctor->invoke();
   
+  // this is used twice, so only get it once
+  if (myWarningTimeCB != NULL)
+    warningTime = myWarningTimeCB->invokeR();
+
   if (myNoTimeWarningCB != NULL && !myNoTimeWarningCB->invokeR() && 
-      myFunctor != NULL && myWarningTimeCB != NULL &&
-      myWarningTimeCB->invokeR() > 0 && 
-      (took = runTime.mSecSince()) > (signed int)myWarningTimeCB->invokeR())
+      myFunctor != NULL && warningTime > 0 && 
+      (took = runTime.mSecSince()) > (signed int)warningTime)
     ArLog::log(ArLog::Normal, 
 	       "Warning: Task '%s' took %d ms to run (longer than the %d warning time)",
-	       myName.c_str(), took, (signed int)myWarningTimeCB->invokeR());
+	       myName.c_str(), took, (signed int)warningTime);
   
   
   for (it = myMultiMap.rbegin(); it != myMultiMap.rend(); it++)
@@ -286,6 +299,94 @@ AREXPORT void ArSyncTask::run(void)
     myInvokingOtherFunctor->run();
   }
   myInvokingOtherFunctor = NULL;
+
+  if (timing)
+  {
+    tookUSec = ArUtil::getTimeUSec() - startUSec;
+    myTimingMutex.lock();
+    myTiming.add(tookUSec);
+    if (warningTime > 0 && tookUSec > (unsigned long long)warningTime * 1000)
+      myOverrunCount++;
+    myTimingMutex.unlock();
+  }
+}
+
+/**
+   When timing is on, each time this task (or its children) run, how
+   long it took is added to its timing histogram (see getTiming()).
+   This is set on the children too, and new children get the setting
+   of their parent.
+**/
+AREXPORT void ArSyncTask::setTimingEnabled(bool enabled)
+{
+  std::multimap<int, ArSyncTask *>::reverse_iterator it;
+  myTimingEnabled = enabled;
+  for (it = myMultiMap.rbegin(); it != myMultiMap.rend(); it++)
+    (*it).second->setTimingEnabled(enabled);
+}
+
+AREXPORT bool ArSyncTask::getTimingEnabled(void)
+{
+  return myTimingEnabled;
+}
+
+/**
+   This is a copy, so it can be looked at while the task keeps running.
+   For branches this is how long the whole branch took to run.
+**/
+AREXPORT ArTimingHistogram ArSyncTask::getTiming(void)
+{
+  ArTimingHistogram ret;
+  myTimingMutex.lock();
+  ret = myTiming;
+  myTimingMutex.unlock();
+  return ret;
+}
+
+/**
+   This counts the runs of the task that took longer than the
+   warning time (see setWarningTimeCB()), it is only counted while
+   timing is on.
+**/
+AREXPORT unsigned int ArSyncTask::getOverrunCount(void)
+{
+  unsigned int ret;
+  myTimingMutex.lock();
+  ret = myOverrunCount;
+  myTimingMutex.unlock();
+  return ret;
+}
+
+AREXPORT void ArSyncTask::resetTiming(void)
+{
+  std::multimap<int, ArSyncTask *>::reverse_iterator it;
+  myTimingMutex.lock();
+  myTiming.clear();
+  myOverrunCount = 0;
+  myTimingMutex.unlock();
+  for (it = myMultiMap.rbegin(); it != myMultiMap.rend(); it++)
+    (*it).second->resetTiming();
+}
+
+/**
+   Logs the timing of the node, then of its children (indented with
+   depth tabs, the same as log()).
+**/
+AREXPORT void ArSyncTask::logTiming(int depth)
+{
+  int i;
+  std::multimap<int, ArSyncTask *>::reverse_iterator it;
+  std::string str = "";
+  char buf[64];
+  
+  for (i = 0; i < depth; i++)
+    str += "\t";
+  str += myName.c_str();
+  sprintf(buf, " (%u overruns):", getOverrunCount());
+  str += buf;
+  getTiming().log(str.c_str(), ArLog::Terse);
+  for (it = myMultiMap.rbegin(); it != myMultiMap.rend(); it++)
+    (*it).second->logTiming(depth + 1);
 }
 
 /**
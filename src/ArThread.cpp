@@ -219,6 +219,25 @@ AREXPORT ArThread::ThreadType ArThread::getThisOSThread(void)
 #endif
 }
 
+/**
+   @return the name of the ArThread for the given os thread, or
+   "unknown" if there isn't one
+**/
+AREXPORT std::string ArThread::getOSThreadName(ThreadType thread)
+{
+  ArThread *found;
+  std::string name;
+
+  // the lock keeps the thread from going away while we copy its name
+  ourThreadsMutex.lock();
+  if ((found = findThreadInMap(thread)) != NULL)
+    name = found->getThreadName();
+  else
+    name = ourUnknownThreadName;
+  ourThreadsMutex.unlock();
+  return name;
+}
+
 
 // ourThreads is a vector on MINGW and a map on Linux and Windows (where native ThreadType just happens to be a scalar and usable as a key in a map)
 
@@ -53,6 +53,38 @@ AREXPORT void ArTransform::doTransform(std::list<ArPoseWithTime *> *poseList)
 
 }
 
+/**
+   This does the same thing as transforming each point as an ArPose,
+   but it works on plain arrays in one loop (that the compiler can
+   vectorize), which is much quicker for things like a whole laser
+   scan.  The dest arrays can be the same as the source arrays.
+
+   @param sourceX the x coordinates to transform
+   @param sourceY the y coordinates to transform
+   @param destX where to put the transformed x coordinates
+   @param destY where to put the transformed y coordinates
+   @param num the number of coordinates in each array
+**/
+AREXPORT void ArTransform::doTransform(const double *sourceX, 
+				       const double *sourceY,
+				       double *destX, double *destY, int num)
+{
+  const double x = myX;
+  const double y = myY;
+  const double c = myCos;
+  const double s = mySin;
+  double sx, sy;
+  int i;
+
+  for (i = 0; i < num; i++)
+  {
+    sx = sourceX[i];
+    sy = sourceY[i];
+    destX[i] = x + c * sx + s * sy;
+    destY[i] = y + c * sy - s * sx;
+  }
+}
+
 /**
    @param pose the coord system from which we transform to abs world coords
 */
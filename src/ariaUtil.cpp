@@ -195,6 +195,95 @@ AREXPORT unsigned int ArUtil::getTime(void)
 #endif
 }
 
+/**
+   Get the time in microseconds, counting from some arbitrary point.
+   This uses the same clocks as getTime() (and so also has the same
+   restrictions on comparing the values), except on Windows where the
+   performance counter is used.  This is meant for measuring short
+   durations, like how long the tasks in the robot's cycle take.
+**/
+AREXPORT unsigned long long ArUtil::getTimeUSec(void)
+{
+#if defined(_POSIX_TIMERS) && defined(_POSIX_MONOTONIC_CLOCK)
+  struct timespec tp;
+  if (clock_gettime(CLOCK_MONOTONIC, &tp) == 0)
+    return ((unsigned long long)tp.tv_sec * 1000000 + 
+	    (unsigned long long)tp.tv_nsec / 1000);
+#endif 
+#if !defined(WIN32)
+  struct timeval tv;
+  if (gettimeofday(&tv,NULL) == 0)
+    return (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec;
+  else
+    return 0;
+#elif defined(WIN32)
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  if (QueryPerformanceFrequency(&frequency) && frequency.QuadPart != 0 &&
+      QueryPerformanceCounter(&counter))
+    return (unsigned long long)(counter.QuadPart / frequency.QuadPart * 
+				1000000 + 
+				counter.QuadPart % frequency.QuadPart * 
+				1000000 / frequency.QuadPart);
+  return (unsigned long long)timeGetTime() * 1000;
+#endif
+}
+
+/**
+   This is a full memory barrier, like the ones that come with
+   atomicIncrement() and atomicDecrement().
+**/
+AREXPORT void ArUtil::memoryBarrier(void)
+{
+#ifndef WIN32
+  __sync_synchronize();
+#else
+  MemoryBarrier();
+#endif
+}
+
+/**
+   @return the value after it was incremented
+**/
+AREXPORT long ArUtil::atomicIncrement(volatile long *value)
+{
+#ifndef WIN32
+  return __sync_add_and_fetch(value, 1);
+#else
+  return InterlockedIncrement((volatile LONG *)value);
+#endif
+}
+
+/**
+   @return the value after it was decremented
+**/
+AREXPORT long ArUtil::atomicDecrement(volatile long *value)
+{
+#ifndef WIN32
+  return __sync_sub_and_fetch(value, 1);
+#else
+  return InterlockedDecrement((volatile LONG *)value);
+#endif
+}
+
+// the callback list invokes each thread is in the middle of
+#ifndef WIN32
+static __thread ArCallbackListInvoke *ourThreadInvokes = NULL;
+#else
+static __declspec(thread) ArCallbackListInvoke *ourThreadInvokes = NULL;
+#endif
+
+AREXPORT ArCallbackListInvoke *ArCallbackListInvoke::getThreadInvokes(void)
+{
+  return ourThreadInvokes;
+}
+
+AREXPORT void ArCallbackListInvoke::setThreadInvokes(
+	ArCallbackListInvoke *invokes)
+{
+  ourThreadInvokes = invokes;
+}
+
 /*
    Takes a string and splits it into a list of words. It appends the words
    to the outList. If there is nothing found, it will not touch the outList.
@@ -1083,8 +1172,139 @@ AREXPORT bool ArUtil::getStringFromRegistry(REGKEY root,
 bool ArTime::ourMonotonicClock = true;
 #endif 
 
+bool ArTime::ourVirtualClock = false;
+volatile long long ArTime::ourVirtualMSec = 0;
+
+// the virtual clock is 64 bits, which a 32 bit build can't read or
+// write in one go, so it only goes through these
+static inline long long virtualMSecRead(volatile long long *value)
+{
+#ifndef WIN32
+  return __sync_fetch_and_add(value, 0);
+#else
+  return InterlockedCompareExchange64((volatile LONGLONG *)value, 0, 0);
+#endif
+}
+
+static inline void virtualMSecWrite(volatile long long *value, 
+				    long long newValue)
+{
+#ifndef WIN32
+  long long oldValue = *value;
+  long long seen;
+  while ((seen = __sync_val_compare_and_swap(value, oldValue, 
+					     newValue)) != oldValue)
+    oldValue = seen;
+#else
+  InterlockedExchange64((volatile LONGLONG *)value, newValue);
+#endif
+}
+
+static inline void virtualMSecAdd(volatile long long *value, long long add)
+{
+#ifndef WIN32
+  __sync_fetch_and_add(value, add);
+#else
+  InterlockedExchangeAdd64((volatile LONGLONG *)value, add);
+#endif
+}
+
+// the time each thread cached with refreshCachedNow(), -1 if it has none
+#ifndef WIN32
+static __thread long long ourThreadCachedMSec = -1;
+#else
+static __declspec(thread) long long ourThreadCachedMSec = -1;
+#endif
+
+/**
+   When the virtual clock is being used setToNow() (and so everything
+   that finds out how long it has been since a time) gets the time of
+   the virtual clock, which only moves when it is told to.  This is
+   for replaying logs (see ArLogFileConnection::setFastReplay()) and
+   the like, so they can be run as fast as possible and still see
+   the same times every run.
+
+   The virtual clock starts where the system clock is when it is
+   turned on, times taken before it was turned on (or after it is
+   turned off) won't compare sensibly with the ones taken from it.
+**/
+AREXPORT void ArTime::setUseVirtualClock(bool useVirtualClock)
+{
+  if (useVirtualClock && !ourVirtualClock)
+  {
+    ArTime now;
+    setVirtualClock(now);
+  }
+  ourVirtualClock = useVirtualClock;
+}
+
+AREXPORT void ArTime::setVirtualClock(const ArTime &time)
+{
+  virtualMSecWrite(&ourVirtualMSec, time.mySec * 1000LL + time.myMSec);
+}
+
+/**
+   The virtual clock should only be moved by one thread (normally the
+   robot's), other threads can read it at any time.
+
+   @param ms how many milliseconds to move the clock, this cannot be
+   negative since that would break the loops that wait on times
+**/
+AREXPORT void ArTime::advanceVirtualClock(long long ms)
+{
+  if (ms > 0)
+    virtualMSecAdd(&ourVirtualMSec, ms);
+}
+
+/**
+   This reads the clock (with setToNow()) and keeps the time for the
+   calling thread, after which setToCachedNow() in that thread gets
+   that time until the next refreshCachedNow() or clearCachedNow().
+   Other threads aren't affected.
+**/
+AREXPORT void ArTime::refreshCachedNow(void)
+{
+  ArTime now;
+  ourThreadCachedMSec = now.mySec * 1000 + now.myMSec;
+}
+
+AREXPORT void ArTime::clearCachedNow(void)
+{
+  ourThreadCachedMSec = -1;
+}
+
+AREXPORT bool ArTime::hasCachedNow(void)
+{
+  return ourThreadCachedMSec >= 0;
+}
+
+/**
+   This is for timestamping data, not for timing durations, since the
+   time won't move until the thread refreshes its cache (see
+   refreshCachedNow()).  If the calling thread has no cached time this
+   is the same as setToNow().
+**/
+AREXPORT void ArTime::setToCachedNow(void)
+{
+  long long cached = ourThreadCachedMSec;
+  if (cached < 0)
+  {
+    setToNow();
+    return;
+  }
+  mySec = cached / 1000;
+  myMSec = cached % 1000;
+}
+
 AREXPORT void ArTime::setToNow(void)
 {
+  if (ourVirtualClock)
+  {
+    long long now = virtualMSecRead(&ourVirtualMSec);
+    mySec = now / 1000;
+    myMSec = now % 1000;
+    return;
+  }
 // if we have the best way of finding time use that
 #if defined(_POSIX_TIMERS) && defined(_POSIX_MONOTONIC_CLOCK)
   if (ourMonotonicClock)
@@ -1294,6 +1514,126 @@ AREXPORT const char *ArRootMeanSquareCalculator::getName(void)
   return myName.c_str();
 }
 
+AREXPORT ArTimingHistogram::ArTimingHistogram()
+{
+  clear();
+}
+
+AREXPORT ArTimingHistogram::~ArTimingHistogram()
+{
+
+}
+
+AREXPORT void ArTimingHistogram::clear(void)
+{
+  int i;
+  myCount = 0;
+  myMin = 0;
+  myMax = 0;
+  myTotal = 0;
+  for (i = 0; i < NUM_BUCKETS; i++)
+    myBuckets[i] = 0;
+}
+
+AREXPORT void ArTimingHistogram::add(unsigned long long usecs)
+{
+  if (myCount == 0 || usecs < myMin)
+    myMin = usecs;
+  if (myCount == 0 || usecs > myMax)
+    myMax = usecs;
+  myCount++;
+  myTotal += usecs;
+  myBuckets[getBucket(usecs)]++;
+}
+
+AREXPORT double ArTimingHistogram::getAverage(void) const
+{
+  if (myCount == 0)
+    return 0;
+  return (double)myTotal / (double)myCount;
+}
+
+/**
+   The estimate is the top of the histogram bucket the percentile
+   falls in (but no more than the max and no less than the min).
+   @param percentile the percentile to get, from 0 to 100 (so 50 for
+   the median, 99 for the 99th percentile)
+**/
+AREXPORT unsigned long long ArTimingHistogram::getPercentile(
+	double percentile) const
+{
+  unsigned long long target;
+  unsigned long long seen = 0;
+  unsigned long long ret;
+  int i;
+
+  if (myCount == 0)
+    return 0;
+  if (percentile <= 0)
+    return myMin;
+  if (percentile >= 100)
+    return myMax;
+  target = (unsigned long long)ceil(myCount * percentile / 100.0);
+  if (target < 1)
+    target = 1;
+  for (i = 0; i < NUM_BUCKETS; i++)
+  {
+    seen += myBuckets[i];
+    if (seen >= target)
+      break;
+  }
+  ret = getBucketTop(i);
+  if (ret > myMax)
+    ret = myMax;
+  if (ret < myMin)
+    ret = myMin;
+  return ret;
+}
+
+/**
+   @param prefix what to put at the start of the line (like the name
+   of what was timed)
+   @param level the ArLog::LogLevel to log at
+**/
+AREXPORT void ArTimingHistogram::log(const char *prefix, int level) const
+{
+  ArLog::log((ArLog::LogLevel)level, 
+	     "%s count %llu min %.3f avg %.3f p50 %.3f p99 %.3f max %.3f ms", 
+	     prefix, myCount, myMin / 1000.0, getAverage() / 1000.0, 
+	     getPercentile(50) / 1000.0, getPercentile(99) / 1000.0, 
+	     myMax / 1000.0);
+}
+
+AREXPORT int ArTimingHistogram::getBucket(unsigned long long usecs)
+{
+  int power = 0;
+  int bucket;
+  unsigned long long val;
+
+  if (usecs < NUM_EXACT_BUCKETS)
+    return (int)usecs;
+  // find the highest bit set, then use the next two bits to split
+  // that power of two into four buckets
+  for (val = usecs; val > 1; val >>= 1)
+    power++;
+  bucket = (NUM_EXACT_BUCKETS + (power - 4) * 4 + 
+	    (int)((usecs >> (power - 2)) & 3));
+  if (bucket >= NUM_BUCKETS)
+    bucket = NUM_BUCKETS - 1;
+  return bucket;
+}
+
+AREXPORT unsigned long long ArTimingHistogram::getBucketTop(int bucket)
+{
+  int power;
+  if (bucket < NUM_EXACT_BUCKETS)
+    return bucket;
+  power = (bucket - NUM_EXACT_BUCKETS) / 4 + 4;
+  return (((1ULL << power) + 
+	   ((unsigned long long)((bucket - NUM_EXACT_BUCKETS) % 4 + 1) << 
+	    (power - 2))) - 1);
+}
+
 #ifndef WIN32
 
 AREXPORT ArDaemonizer::ArDaemonizer(int *argc, char **argv, 
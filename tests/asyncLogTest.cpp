@@ -0,0 +1,186 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Logs numbered messages from several threads to a file with ArLog in
+  async mode, then reads the file back and checks that each message
+  that wasn't dropped is there once, in the order each thread logged
+  them.  Then turns async mode off while threads are logging and
+  checks that no messages are left behind.  Then times a bunch of log calls with the log going to a file
+  in the normal and the async modes.
+*/
+
+int errors = 0;
+int numThreads = 4;
+int numMessages = 20000;
+
+class LogThread : public ArASyncTask
+{
+public:
+  LogThread(int num) { myNum = num; }
+  virtual void *runThread(void *)
+  {
+    int i;
+    for (i = 0; i < numMessages; i++)
+      ArLog::log(ArLog::Normal, "thread %d message %d", myNum, i);
+    return NULL;
+  }
+protected:
+  int myNum;
+};
+
+long long timeLogging(int num)
+{
+  ArTime start;
+  int i;
+  for (i = 0; i < num; i++)
+    ArLog::log(ArLog::Normal, "timing message %d with some more text %g", 
+	       i, i * 1.5);
+  return start.mSecSinceLL();
+}
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  ArArgumentParser parser(&argc, argv);
+  parser.checkParameterArgumentInteger("-threads", &numThreads);
+  parser.checkParameterArgumentInteger("-messages", &numMessages);
+
+  const char *fileName = "asyncLogTest.log";
+  int i;
+  char line[20000];
+  int thread, message;
+  int numLines = 0;
+  std::vector<int> last(numThreads, -1);
+  std::vector<LogThread *> threads;
+
+  ArLog::init(ArLog::File, ArLog::Normal, fileName, false);
+  ArLog::setAsync(true, 1024, ArLog::DropNewUnlessTerse);
+
+  for (i = 0; i < numThreads; i++)
+  {
+    threads.push_back(new LogThread(i));
+    threads[i]->runAsync();
+  }
+  for (i = 0; i < numThreads; i++)
+    threads[i]->join();
+
+  // one long enough that it doesn't fit in a queue record
+  std::string longMessage(3000, 'x');
+  ArLog::log(ArLog::Terse, "long %s end", longMessage.c_str());
+
+  ArLog::flushAsync();
+  long dropped = (ArLog::getAsyncNumDropped(ArLog::Terse) + 
+		  ArLog::getAsyncNumDropped(ArLog::Normal));
+  ArLog::setAsync(false);
+  ArLog::close();
+
+  FILE *file = fopen(fileName, "r");
+  bool foundLong = false;
+  while (file != NULL && fgets(line, sizeof(line), file) != NULL)
+  {
+    if (sscanf(line, "thread %d message %d", &thread, &message) == 2)
+    {
+      numLines++;
+      if (thread < 0 || thread >= numThreads || message <= last[thread])
+      {
+	printf("Out of order: %s", line);
+	errors++;
+      }
+      else
+	last[thread] = message;
+    }
+    else if (strncmp(line, "long ", 5) == 0)
+    {
+      if (strlen(line) != 5 + longMessage.size() + 5 || 
+	  strncmp(&line[5], longMessage.c_str(), longMessage.size()) != 0)
+      {
+	printf("Long message was wrong\n");
+	errors++;
+      }
+      foundLong = true;
+    }
+  }
+  if (file != NULL)
+    fclose(file);
+  if (!foundLong)
+  {
+    printf("Long message was missing\n");
+    errors++;
+  }
+  if (numLines + dropped != numThreads * numMessages)
+  {
+    printf("%d lines + %ld dropped != %d logged\n", numLines, dropped,
+	   numThreads * numMessages);
+    errors++;
+  }
+  printf("%d messages logged, %d written, %ld dropped, %d errors\n", 
+	 numThreads * numMessages, numLines, dropped, errors);
+
+  // turning async off while threads log mustn't strand any messages
+  for (i = 0; i < numThreads; i++)
+    delete threads[i];
+  threads.clear();
+  ArLog::init(ArLog::File, ArLog::Normal, fileName, false);
+  ArLog::setAsync(true, 64, ArLog::Wait);
+  for (i = 0; i < numThreads; i++)
+  {
+    threads.push_back(new LogThread(i));
+    threads[i]->runAsync();
+  }
+  ArUtil::sleep(20);
+  ArLog::setAsync(false);
+  for (i = 0; i < numThreads; i++)
+    threads[i]->join();
+  ArLog::close();
+  numLines = 0;
+  file = fopen(fileName, "r");
+  while (file != NULL && fgets(line, sizeof(line), file) != NULL)
+    if (sscanf(line, "thread %d message %d", &thread, &message) == 2)
+      numLines++;
+  if (file != NULL)
+    fclose(file);
+  if (numLines != numThreads * numMessages)
+  {
+    printf("Turning async off: %d lines written of %d logged\n", numLines,
+	   numThreads * numMessages);
+    errors++;
+  }
+
+  ArLog::init(ArLog::File, ArLog::Normal, fileName, false);
+  long long syncTime = timeLogging(100000);
+  ArLog::setAsync(true, 1024, ArLog::Wait);
+  long long asyncTime = timeLogging(100000);
+  ArLog::setAsync(false);
+  ArLog::close();
+  printf("100000 log calls: %lld ms normal, %lld ms async\n", 
+	 syncTime, asyncTime);
+
+  unlink(fileName);
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
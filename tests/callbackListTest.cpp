@@ -0,0 +1,279 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Checks that ArCallbackList and ArCallbackList1 call their callbacks
+  in order, handle callbacks that add or remove callbacks while being
+  called, single shot lists and copies, and that adding a callback
+  doesn't wait for a slow invoke in another thread but removing one
+  does.  Then times
+  invoking a list a million times, alone and with another thread
+  adding and removing a callback, against a list that holds a mutex
+  while it invokes (the way ArCallbackList used to).
+*/
+
+int errors = 0;
+
+void check(bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("FAILED: %s\n", what);
+    errors++;
+  }
+}
+
+std::string calls;
+
+class Callbacks
+{
+public:
+  Callbacks(ArCallbackList *list) : 
+    myList(list),
+    myACB(this, &Callbacks::a),
+    myBCB(this, &Callbacks::b),
+    myRemoveSelfCB(this, &Callbacks::removeSelf),
+    myAddBCB(this, &Callbacks::addB),
+    mySlowCB(this, &Callbacks::slow),
+    myCountCB(this, &Callbacks::count),
+    myIntCB(this, &Callbacks::gotInt),
+    myCount(0), myInt(0), mySlowDone(false) {}
+  void a(void) { calls += "a"; }
+  void b(void) { calls += "b"; }
+  void removeSelf(void) 
+    { calls += "r"; myList->remCallback(&myRemoveSelfCB); }
+  void addB(void) 
+    { calls += "+"; myList->remCallback(&myAddBCB); myList->addCallback(&myBCB, 10); }
+  void slow(void) { ArUtil::sleep(200); mySlowDone = true; }
+  void count(void) { myCount++; }
+  void gotInt(int i) { myInt += i; }
+  ArCallbackList *myList;
+  ArFunctorC<Callbacks> myACB;
+  ArFunctorC<Callbacks> myBCB;
+  ArFunctorC<Callbacks> myRemoveSelfCB;
+  ArFunctorC<Callbacks> myAddBCB;
+  ArFunctorC<Callbacks> mySlowCB;
+  ArFunctorC<Callbacks> myCountCB;
+  ArFunctor1C<Callbacks, int> myIntCB;
+  volatile int myCount;
+  int myInt;
+  volatile bool mySlowDone;
+};
+
+/// Invokes a list once
+class InvokeThread : public ArASyncTask
+{
+public:
+  InvokeThread(ArCallbackList *list) : myList(list), myDone(false) {}
+  virtual void *runThread(void *) 
+    { myList->invoke(); myDone = true; return NULL; }
+  ArCallbackList *myList;
+  volatile bool myDone;
+};
+
+/// Adds and removes a callback from a list until told to stop
+class ChurnThread : public ArASyncTask
+{
+public:
+  ChurnThread(ArCallbackList *list, ArFunctor *functor) : 
+    myList(list), myFunctor(functor), myChanges(0) {}
+  virtual void *runThread(void *) 
+    {
+      while (getRunningWithLock())
+      {
+	myList->addCallback(myFunctor);
+	myList->remCallback(myFunctor);
+	myChanges++;
+	if (myChanges % 100 == 0)
+	  ArUtil::sleep(1);
+      }
+      return NULL;
+    }
+  ArCallbackList *myList;
+  ArFunctor *myFunctor;
+  volatile int myChanges;
+};
+
+void testList(void)
+{
+  ArCallbackList list("test");
+  list.setLogging(false);
+  Callbacks cb(&list);
+
+  list.addCallback(&cb.myBCB, 10);
+  list.addCallback(&cb.myACB, 90);
+  calls = "";
+  list.invoke();
+  check(calls == "ab", "called in position order");
+
+  // copies have the same callbacks
+  ArCallbackList copy(list);
+  calls = "";
+  copy.invoke();
+  check(calls == "ab", "copy has callbacks");
+  list.remCallback(&cb.myACB);
+  calls = "";
+  list.invoke();
+  check(calls == "b", "removed callback not called");
+  calls = "";
+  copy.invoke();
+  check(calls == "ab", "copy not changed by original");
+  copy = list;
+  calls = "";
+  copy.invoke();
+  check(calls == "b", "assigned list");
+
+  // callbacks can change the list they're called from, which takes
+  // effect next time
+  list.remCallback(&cb.myBCB);
+  list.addCallback(&cb.myRemoveSelfCB, 50);
+  list.addCallback(&cb.myAddBCB, 40);
+  calls = "";
+  list.invoke();
+  check(calls == "r+", "changes made while invoking not seen yet");
+  calls = "";
+  list.invoke();
+  check(calls == "b", "changes made while invoking seen next time");
+
+  // single shot lists clear out what they called
+  list.setSingleShot(true);
+  list.addCallback(&cb.myACB, 90);
+  list.addCallback(&cb.myAddBCB, 40);
+  calls = "";
+  list.invoke();
+  check(calls == "a+b", "single shot called");
+  calls = "";
+  list.invoke();
+  check(calls == "b", "single shot keeps callback added while invoking");
+  calls = "";
+  list.invoke();
+  check(calls == "", "single shot cleared");
+  list.setSingleShot(false);
+
+  // lists with an argument
+  ArCallbackList1<int> intList("int");
+  intList.setLogging(false);
+  intList.addCallback(&cb.myIntCB);
+  intList.invoke(3);
+  intList.invoke(4);
+  check(cb.myInt == 7, "ArCallbackList1 passes argument");
+
+  // a slow invoke doesn't hold up adding to the list, but removing
+  // waits for it so the removed callback can be deleted right away
+  list.addCallback(&cb.mySlowCB);
+  InvokeThread invoker(&list);
+  invoker.runAsync();
+  ArUtil::sleep(50);
+  ArTime addStarted;
+  list.addCallback(&cb.myACB);
+  check(addStarted.mSecSince() < 50, "add doesn't wait for invoke");
+  check(!invoker.myDone, "still invoking");
+  list.remCallback(&cb.mySlowCB);
+  check(cb.mySlowDone, "remove waits for invoke");
+  list.remCallback(&cb.myACB);
+  while (!invoker.myDone)
+    ArUtil::sleep(5);
+}
+
+/// The way ArCallbackList used to invoke, holding the mutex
+class LockedList
+{
+public:
+  void addCallback(ArFunctor *functor, int position = 50)
+    {
+      myMutex.lock();
+      myList.insert(std::pair<int, ArFunctor *>(-position, functor));
+      myMutex.unlock();
+    }
+  void invoke(void)
+    {
+      myMutex.lock();
+      std::multimap<int, ArFunctor *>::iterator it;
+      for (it = myList.begin(); it != myList.end(); it++)
+	if ((*it).second != NULL)
+	  (*it).second->invoke();
+      myMutex.unlock();
+    }
+protected:
+  ArMutex myMutex;
+  std::multimap<int, ArFunctor *> myList;
+};
+
+void benchmark(void)
+{
+  int num = 1000000;
+  int i;
+  ArCallbackList list("bench");
+  LockedList locked;
+  list.setLogging(false);
+  Callbacks cb(&list);
+  Callbacks churnCB(&list);
+  
+  for (i = 0; i < 5; i++)
+  {
+    list.addCallback(&cb.myCountCB, i * 10);
+    locked.addCallback(&cb.myCountCB, i * 10);
+  }
+
+  ArTime start;
+  for (i = 0; i < num; i++)
+    locked.invoke();
+  long long lockedTime = start.mSecSinceLL();
+
+  start.setToNow();
+  for (i = 0; i < num; i++)
+    list.invoke();
+  long long snapshotTime = start.mSecSinceLL();
+
+  printf("%d invokes of 5 callbacks: locked %lld ms, snapshot %lld ms\n",
+	 num, lockedTime, snapshotTime);
+
+  // and with another thread changing the list
+  ChurnThread churn(&list, &churnCB.myCountCB);
+  churn.runAsync();
+  start.setToNow();
+  for (i = 0; i < num; i++)
+    list.invoke();
+  long long churnTime = start.mSecSinceLL();
+  churn.stopRunning();
+  while (churn.getRunningWithLock())
+    ArUtil::sleep(1);
+  ArUtil::sleep(10);
+  printf("%d invokes while %d adds and removes: %lld ms\n",
+	 num, churn.myChanges, churnTime);
+  check(cb.myCount == num * 5 * 3, "every callback called");
+}
+
+int main(void)
+{
+  Aria::init();
+  testList();
+  benchmark();
+  printf("%d errors\n", errors);
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
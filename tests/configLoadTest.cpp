@@ -0,0 +1,195 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Builds a big ArConfig like one with lots of modules in it (many
+  sections, each with lots of parameters), writes it out, and times
+  adding the parameters, loading the file back in, and looking up
+  sections and parameters, checking that findSection and findParam
+  find the same things searching the lists would.
+*/
+
+int numSections = 400;
+int numParams = 40;
+int errors = 0;
+
+// what findSection used to do
+ArConfigSection *searchSections(ArConfig *config, const char *name)
+{
+  std::list<ArConfigSection *>::iterator it;
+  for (it = config->getSections()->begin(); 
+       it != config->getSections()->end(); 
+       it++)
+    if (ArUtil::strcasecmp((*it)->getName(), name) == 0)
+      return (*it);
+  return NULL;
+}
+
+// what findParam used to do (the last one with the name wins)
+ArConfigArg *searchParams(ArConfigSection *section, const char *name)
+{
+  ArConfigArg *found = NULL;
+  std::list<ArConfigArg>::iterator it;
+  for (it = section->getParams()->begin(); 
+       it != section->getParams()->end(); 
+       it++)
+    if ((*it).getType() != ArConfigArg::STRING_HOLDER &&
+	(*it).getType() != ArConfigArg::LIST_HOLDER &&
+	ArUtil::strcasecmp((*it).getName(), name) == 0)
+      found = &(*it);
+  return found;
+}
+
+void check(bool ok, const char *what)
+{
+  if (!ok)
+  {
+    if (errors < 10)
+      printf("FAILED: %s\n", what);
+    errors++;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  ArLog::init(ArLog::StdOut, ArLog::Terse);
+  ArArgumentParser parser(&argc, argv);
+  parser.checkParameterArgumentInteger("-sections", &numSections);
+  parser.checkParameterArgumentInteger("-params", &numParams);
+
+  int total = numSections * numParams;
+  std::vector<int> ints(total);
+  std::vector<double> doubles(total);
+  char name[256];
+  char sectionName[256];
+  int i, j, k;
+
+  ArConfig config;
+  ArTime started;
+  for (i = 0; i < numSections; i++)
+  {
+    sprintf(sectionName, "Module %d settings", i);
+    for (j = 0; j < numParams; j++)
+    {
+      k = i * numParams + j;
+      ints[k] = k;
+      doubles[k] = k / 2.0;
+      sprintf(name, "Param%dOf%d", j, i);
+      if (j % 2 == 0)
+	config.addParam(ArConfigArg(name, &ints[k], "an int"), sectionName);
+      else
+	config.addParam(ArConfigArg(name, &doubles[k], "a double"), 
+			sectionName);
+    }
+  }
+  printf("%d sections of %d params: added in %lld ms\n", numSections, 
+	 numParams, started.mSecSinceLL());
+
+  started.setToNow();
+  config.writeFile("configLoadTest.txt");
+  printf("wrote file in %lld ms\n", started.mSecSinceLL());
+
+  for (k = 0; k < total; k++)
+  {
+    ints[k] = -1;
+    doubles[k] = -1;
+  }
+  started.setToNow();
+  check(config.parseFile("configLoadTest.txt"), "parsing the file");
+  printf("parsed file in %lld ms\n", started.mSecSinceLL());
+  for (k = 0; k < total; k++)
+    check(ints[k] == -1 ? doubles[k] == k / 2.0 : ints[k] == k, 
+	  "value read back");
+
+  // look things up with different capitalization (and some that
+  // aren't there), comparing with searching the lists
+  ArConfigSection *section;
+  ArConfigArg *param;
+  int found = 0;
+  started.setToNow();
+  for (i = 0; i < 20000; i++)
+  {
+    k = ArMath::random() % (numSections + 10);
+    sprintf(sectionName, "MODULE %d Settings", k);
+    sprintf(name, "param%dof%d", (int)(ArMath::random() % numParams), k);
+    if ((section = config.findSection(sectionName)) != NULL &&
+	(param = section->findParam(name)) != NULL)
+      found++;
+  }
+  printf("20000 lookups in %lld ms (%d found)\n", started.mSecSinceLL(), 
+	 found);
+
+  found = 0;
+  started.setToNow();
+  for (i = 0; i < 20000; i++)
+  {
+    k = ArMath::random() % (numSections + 10);
+    sprintf(sectionName, "MODULE %d Settings", k);
+    sprintf(name, "param%dof%d", (int)(ArMath::random() % numParams), k);
+    if ((section = searchSections(&config, sectionName)) != NULL &&
+	(param = searchParams(section, name)) != NULL)
+      found++;
+  }
+  printf("20000 lookups searching the lists in %lld ms (%d found)\n", 
+	 started.mSecSinceLL(), found);
+
+  for (i = 0; i < numSections + 10; i++)
+  {
+    sprintf(sectionName, "module %d SETTINGS", i);
+    section = config.findSection(sectionName);
+    check(section == searchSections(&config, sectionName), "findSection");
+    if (section == NULL)
+      continue;
+    for (j = 0; j < numParams + 2; j++)
+    {
+      sprintf(name, "PARAM%dOF%d", j, i);
+      check(section->findParam(name) == searchParams(section, name), 
+	    "findParam");
+    }
+  }
+
+  // params removed from the list directly
+  section = config.findSection("Module 0 settings");
+  section->getParams()->pop_front();
+  section->paramsChanged();
+  check(section->findParam("Param0Of0") == NULL, "removed param");
+  check(section->findParam("Param1Of0") != NULL, "param after removed one");
+
+  // a copy of the config finds its own params
+  ArConfig copy(config);
+  section = copy.findSection("Module 1 settings");
+  check(section != NULL && section != config.findSection("Module 1 settings"),
+	"copied section");
+  check(section != NULL && section->findParam("Param1Of1") == 
+	searchParams(section, "Param1Of1"), "param in copied section");
+
+  unlink("configLoadTest.txt");
+  printf("%d errors\n", errors);
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -0,0 +1,285 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Runs the same readings through ArInterpolation and a copy of the old
+  list based lookup, checks that they give the same answers (including
+  the too old, prediction and not enough data cases), that getPoses
+  matches getPose, then times lookups against a full buffer.
+*/
+
+int errors = 0;
+
+/// The old list based lookup, newest reading first, without the logging
+class ListInterpolation
+{
+public:
+  ListInterpolation(size_t size) { mySize = size; }
+  void addReading(ArTime time, ArPose pose)
+    {
+      if (myTimes.size() >= mySize)
+      {
+	myTimes.pop_back();
+	myPoses.pop_back();
+      }
+      myTimes.push_front(time);
+      myPoses.push_front(pose);
+    }
+  void setNumberOfReadings(size_t size)
+    {
+      while (myTimes.size() > size)
+      {
+	myTimes.pop_back();
+	myPoses.pop_back();
+      }
+      mySize = size;
+    }
+  void reset(void) { myTimes.clear(); myPoses.clear(); }
+  int getPose(ArTime timeStamp, ArPose *position, ArPoseWithTime *mostRecent);
+protected:
+  std::list<ArTime> myTimes;
+  std::list<ArPose> myPoses;
+  size_t mySize;
+};
+
+int ListInterpolation::getPose(ArTime timeStamp, ArPose *position,
+			       ArPoseWithTime *mostRecent)
+{
+  std::list<ArTime>::iterator tit;
+  std::list<ArPose>::iterator pit;
+  ArPose thisPose, lastPose, retPose;
+  ArTime thisTime, lastTime;
+  long total, toStamp;
+  double percentage;
+
+  for (tit = myTimes.begin(), pit = myPoses.begin();
+       tit != myTimes.end(); ++tit, ++pit)
+  {
+    lastTime = thisTime;
+    lastPose = thisPose;
+    thisTime = (*tit);
+    thisPose = (*pit);
+    if (!timeStamp.isAfter(thisTime))
+      break;
+  }
+  mostRecent->setPose(thisPose);
+  mostRecent->setTime(thisTime);
+  if (tit == myTimes.end())
+    return -2;
+  if (tit == myTimes.begin() && !timeStamp.isAt((*tit)))
+  {
+    tit++;
+    pit++;
+    if (tit == myTimes.end())
+      return -3;
+    lastTime = (*tit);
+    lastPose = (*pit);
+    total = thisTime.mSecSince(lastTime);
+    if (total == 0)
+      total = 100;
+    toStamp = timeStamp.mSecSince(thisTime);
+    percentage = (double)toStamp/(double)total;
+    if (percentage * 100 > 50 || abs(toStamp) > 50)
+      return -1;
+    retPose.setX(thisPose.getX() + 
+		 (thisPose.getX() - lastPose.getX()) * percentage);
+    retPose.setY(thisPose.getY() + 
+		 (thisPose.getY() - lastPose.getY()) * percentage);
+    retPose.setTh(ArMath::addAngle(thisPose.getTh(),
+				   ArMath::subAngle(thisPose.getTh(),
+						    lastPose.getTh())
+				   * percentage));
+    *position = retPose;
+    return 0;
+  }
+  total = thisTime.mSecSince(lastTime);
+  toStamp = thisTime.mSecSince(timeStamp);
+  percentage = (double)toStamp/(double)total;
+  if (total == 0)
+    percentage = 0;
+  retPose.setX(thisPose.getX() + 
+	       (lastPose.getX() - thisPose.getX()) * percentage); 
+  retPose.setY(thisPose.getY() + 
+	       (lastPose.getY() - thisPose.getY()) * percentage); 
+  retPose.setTh(ArMath::addAngle(thisPose.getTh(),
+				 ArMath::subAngle(lastPose.getTh(), 
+						  thisPose.getTh())
+				 * percentage));
+  *position = retPose;
+  return 1;
+}
+
+void check(const char *what, double a, double b)
+{
+  if (fabs(a - b) > .0001)
+  {
+    printf("MISMATCH %s: list %g ring %g\n", what, a, b);
+    errors++;
+  }
+}
+
+void compare(ListInterpolation *list, ArInterpolation *ring, ArTime base, 
+	     int maxMS)
+{
+  ArTime times[50];
+  ArPose ringPoses[50];
+  int ringResults[50];
+  ArPose listPose, ringPose;
+  ArPoseWithTime listRecent, ringRecent;
+  int i, listRet, ringRet;
+
+  for (i = 0; i < 50; i++)
+  {
+    times[i] = base;
+    times[i].addMSec(ArMath::random() % (maxMS + 200) - 100);
+    listRet = list->getPose(times[i], &listPose, &listRecent);
+    ringRet = ring->getPose(times[i], &ringPose, &ringRecent);
+    check("result", listRet, ringRet);
+    if (listRet >= 0 && ringRet >= 0)
+    {
+      check("x", listPose.getX(), ringPose.getX());
+      check("y", listPose.getY(), ringPose.getY());
+      check("th", listPose.getTh(), ringPose.getTh());
+    }
+    check("recent x", listRecent.getX(), ringRecent.getX());
+    check("recent time", listRecent.getTime().mSecSince(base),
+	  ringRecent.getTime().mSecSince(base));
+  }
+  
+  ring->getPoses(times, ringPoses, ringResults, 50);
+  for (i = 0; i < 50; i++)
+  {
+    ringRet = ring->getPose(times[i], &ringPose);
+    check("batch result", ringRet, ringResults[i]);
+    if (ringRet >= 0)
+    {
+      check("batch x", ringPose.getX(), ringPoses[i].getX());
+      check("batch th", ringPose.getTh(), ringPoses[i].getTh());
+    }
+  }
+}
+
+void benchmark(ArInterpolation *ring, ListInterpolation *list, 
+	       ArTime base, int numReadings, int numLookups)
+{
+  ArTime start;
+  ArTime when;
+  ArPose pose;
+  ArPoseWithTime recent;
+  double total = 0;
+  int i;
+
+  for (i = 0; i < numLookups; i++)
+  {
+    when = base;
+    when.addMSec(ArMath::random() % (numReadings * 10));
+    list->getPose(when, &pose, &recent);
+    total += pose.getX();
+  }
+  long long listTime = start.mSecSinceLL();
+
+  start.setToNow();
+  for (i = 0; i < numLookups; i++)
+  {
+    when = base;
+    when.addMSec(ArMath::random() % (numReadings * 10));
+    ring->getPose(when, &pose);
+    total += pose.getX();
+  }
+  long long ringTime = start.mSecSinceLL();
+
+  printf("%d readings, %d lookups: list %lld ms, ring %lld ms (%g)\n",
+	 numReadings, numLookups, listTime, ringTime, total);
+}
+
+int main(void)
+{
+  Aria::init();
+  ArInterpolation ring(100);
+  ListInterpolation list(100);
+  ArTime base, when;
+  ArPose pose;
+  int i;
+
+  ring.setAllowedMSForPrediction(50);
+  ring.setAllowedPercentageForPrediction(50);
+  ring.setLogPrediction(false);
+
+  // empty and single reading cases
+  compare(&list, &ring, base, 100);
+  list.addReading(base, ArPose(10, 20, 30));
+  ring.addReading(base, ArPose(10, 20, 30));
+  compare(&list, &ring, base, 100);
+
+  // readings 10 ms apart, with some duplicate times in there
+  for (i = 1; i < 300; i++)
+  {
+    when = base;
+    when.addMSec(i * 10 - (i % 17 == 0 ? 10 : 0));
+    pose.setPose(i * 5 + ArMath::random() % 3, i * -2, (i * 7) % 360);
+    list.addReading(when, pose);
+    ring.addReading(when, pose);
+    if (i % 50 == 0)
+      compare(&list, &ring, base, i * 10);
+  }
+  compare(&list, &ring, base, 3000);
+
+  list.setNumberOfReadings(30);
+  ring.setNumberOfReadings(30);
+  compare(&list, &ring, base, 3000);
+
+  list.setNumberOfReadings(60);
+  ring.setNumberOfReadings(60);
+  for (i = 300; i < 320; i++)
+  {
+    when = base;
+    when.addMSec(i * 10);
+    list.addReading(when, ArPose(i, i, i));
+    ring.addReading(when, ArPose(i, i, i));
+  }
+  compare(&list, &ring, base, 3200);
+
+  list.reset();
+  ring.reset();
+  compare(&list, &ring, base, 3200);
+
+  printf("%d mismatches\n", errors);
+
+  ArInterpolation benchRing(5000);
+  ListInterpolation benchList(5000);
+  for (i = 0; i < 5000; i++)
+  {
+    when = base;
+    when.addMSec(i * 10);
+    benchRing.addReading(when, ArPose(i, -i, i % 360));
+    benchList.addReading(when, ArPose(i, -i, i % 360));
+  }
+  benchmark(&benchRing, &benchList, base, 5000, 20000);
+
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
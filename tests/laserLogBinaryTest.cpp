@@ -0,0 +1,271 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Writes the same scans and tags with a text ArLaserLogger and a
+  binary one, converts the binary log to text and checks it matches
+  the text log, checks the index of the binary log, then times
+  logging scans each way.
+*/
+
+class TestLaser : public ArLaser
+{
+public:
+  TestLaser() : ArLaser(1, "test", 20000) 
+    { myRawReadings = new std::list<ArSensorReading *>; }
+  virtual bool blockingConnect(void) { return true; }
+  virtual bool asyncConnect(void) { return true; }
+  virtual bool disconnect(void) { return true; }
+  virtual bool isConnected(void) { return true; }
+  virtual bool isTryingToConnect(void) { return false; }
+  virtual void *runThread(void *) { return NULL; }
+
+  void scan(const int *ranges, const char *ignore, int num, 
+	    double start, double increment, ArPose pose)
+  {
+    laserConvertScan(ranges, ignore, num, start, increment, pose, pose,
+		     ArTransform(pose), 0, ArTime());
+  }
+};
+
+class TestLogger : public ArLaserLogger
+{
+public:
+  TestLogger(ArRobot *robot, ArLaser *laser, const char *fileName, 
+	     std::list<ArLaser *> *extraLasers, bool binaryFile) :
+    ArLaserLogger(robot, laser, 300, 45, fileName, false, NULL, "", true,
+		  NULL, NULL, extraLasers, binaryFile) {}
+  void takeScan(ArLaser *laser) { internalTakeLaserReading(laser, 1); }
+  void task(void) { robotTask(); }
+};
+
+int errors = 0;
+
+// so both logs get the same scans
+void seed(void)
+{
+#ifdef WIN32
+  srand(1);
+#else
+  srand48(1);
+#endif
+}
+
+// the text logger puts out "%.0f" and the binary one rounds, so
+// numbers can differ a little (and -0 is 0)
+void compareFiles(const char *textName, const char *convertedName)
+{
+  FILE *textFile = ArUtil::fopen(textName, "r");
+  FILE *convertedFile = ArUtil::fopen(convertedName, "r");
+  char textWord[1024], convertedWord[1024];
+  char *textEnd, *convertedEnd;
+  int textRet, convertedRet;
+  int words = 0;
+
+  if (textFile == NULL || convertedFile == NULL)
+  {
+    printf("Could not open %s or %s\n", textName, convertedName);
+    errors++;
+    return;
+  }
+  while (true)
+  {
+    textRet = fscanf(textFile, "%1023s", textWord);
+    convertedRet = fscanf(convertedFile, "%1023s", convertedWord);
+    if (textRet != convertedRet)
+    {
+      printf("MISMATCH: files are different lengths after %d words\n", words);
+      errors++;
+      break;
+    }
+    if (textRet != 1)
+      break;
+    words++;
+    if (strcmp(textWord, convertedWord) == 0)
+      continue;
+    double textVal = strtod(textWord, &textEnd);
+    double convertedVal = strtod(convertedWord, &convertedEnd);
+    if (*textEnd != '\0' || *convertedEnd != '\0' || 
+	fabs(textVal - convertedVal) > 1.0001)
+    {
+      printf("MISMATCH at word %d: text '%s' converted '%s'\n", 
+	     words, textWord, convertedWord);
+      if (++errors > 10)
+	break;
+    }
+  }
+  printf("Compared %d words\n", words);
+  fclose(textFile);
+  fclose(convertedFile);
+}
+
+void checkIndex(const char *binaryName, int numScans)
+{
+  std::map<int, long> offsets;
+  std::map<int, long>::iterator it;
+  unsigned char buf[9];
+
+  if (!ArLaserLogger::readBinaryIndex(binaryName, &offsets))
+  {
+    printf("Could not read the index of %s\n", binaryName);
+    errors++;
+    return;
+  }
+  if ((int)offsets.size() != numScans)
+  {
+    printf("MISMATCH: %d scans in the index, wanted %d\n", 
+	   (int)offsets.size(), numScans);
+    errors++;
+  }
+  FILE *file = ArUtil::fopen(binaryName, "rb");
+  for (it = offsets.begin(); it != offsets.end(); it++)
+  {
+    // the length, the type, then the scan id
+    if (fseek(file, (*it).second, SEEK_SET) != 0 || 
+	fread(buf, 1, 9, file) != 9 || 
+	buf[4] != ArLaserLogger::BINARY_SCAN ||
+	(buf[5] | (buf[6] << 8) | (buf[7] << 16) | (buf[8] << 24)) != 
+	(*it).first)
+    {
+      printf("MISMATCH: scan %d is not at %ld\n", (*it).first, (*it).second);
+      errors++;
+    }
+  }
+  fclose(file);
+}
+
+void logScans(TestLogger *logger, TestLaser *laser, int numScans, 
+	      int num, bool slow)
+{
+  std::vector<int> ranges(num);
+  std::vector<char> ignore(num);
+  int i, scanNum;
+
+  for (scanNum = 0; scanNum < numScans; scanNum++)
+  {
+    for (i = 0; i < num; i++)
+    {
+      ranges[i] = ArMath::random() % 20000;
+      ignore[i] = (ranges[i] < 30);
+    }
+    laser->scan(&ranges[0], &ignore[0], num, -90, 180.0 / (num - 1),
+		ArPose(scanNum * 10.5, -scanNum * 3.25, scanNum * 1.37));
+    logger->takeScan(laser);
+    // don't let the writer fall behind when we're comparing
+    if (slow && scanNum % 50 == 0)
+      ArUtil::sleep(20);
+  }
+}
+
+int main(void)
+{
+  Aria::init();
+  ArLog::init(ArLog::StdOut, ArLog::Terse);
+  ArRobot robot;
+  TestLaser laser;
+  std::list<ArLaser *> noExtraLasers;
+  std::vector<int> ranges(541, 1000);
+  std::vector<char> ignore(541, 0);
+  int numScans = 250;
+  
+  laser.setSensorPosition(150, -20, 5);
+  // the logger wants a scan to get the laser's configuration from
+  laser.scan(&ranges[0], &ignore[0], 541, -90, 180.0 / 540, ArPose());
+
+  TestLogger *text = new TestLogger(&robot, &laser, "/tmp/laserLogTest.2d", 
+				    &noExtraLasers, false);
+  TestLogger *binary = new TestLogger(&robot, &laser, 
+				      "/tmp/laserLogTest.2db", 
+				      &noExtraLasers, true);
+  seed();
+  text->addTagToLog("cairn: GoalWithHeading \"\" ICON_GOALWITHHEADING \"goal1\"");
+  text->addInfoToLog("# some info");
+  text->task();
+  logScans(text, &laser, numScans, 541, true);
+  seed();
+  binary->addTagToLog("cairn: GoalWithHeading \"\" ICON_GOALWITHHEADING \"goal1\"");
+  binary->addInfoToLog("# some info");
+  binary->task();
+  logScans(binary, &laser, numScans, 541, true);
+  if (text->getNumDropped() != 0 || binary->getNumDropped() != 0)
+  {
+    printf("Dropped %ld text and %ld binary sets of scans\n", 
+	   text->getNumDropped(), binary->getNumDropped());
+    errors++;
+  }
+  delete text;
+  delete binary;
+
+  if (!ArLaserLogger::convertBinaryToText("/tmp/laserLogTest.2db",
+					  "/tmp/laserLogTest.converted.2d"))
+  {
+    printf("Could not convert the binary log\n");
+    errors++;
+  }
+  compareFiles("/tmp/laserLogTest.2d", "/tmp/laserLogTest.converted.2d");
+  checkIndex("/tmp/laserLogTest.2db", numScans);
+
+  // cut the end off and make sure the index can still be found
+  FILE *in = ArUtil::fopen("/tmp/laserLogTest.2db", "rb");
+  FILE *out = ArUtil::fopen("/tmp/laserLogTest.cut.2db", "wb");
+  char buf[4096];
+  size_t len;
+  while ((len = fread(buf, 1, sizeof(buf), in)) > 0)
+    fwrite(buf, 1, len, out);
+  long size = ftell(out);
+  fclose(in);
+  fclose(out);
+  truncate("/tmp/laserLogTest.cut.2db", size - 20);
+  checkIndex("/tmp/laserLogTest.cut.2db", numScans);
+
+  printf("%d mismatches\n", errors);
+
+  ArTime start;
+  text = new TestLogger(&robot, &laser, "/tmp/laserLogTest.2d", 
+			&noExtraLasers, false);
+  logScans(text, &laser, 2000, 1081, false);
+  long long textTime = start.mSecSinceLL();
+  printf("text   2000 scans %lld ms in the robot task, %ld dropped\n", 
+	 textTime, text->getNumDropped());
+  start.setToNow();
+  delete text;
+  printf("text   writer finished %lld ms later\n", start.mSecSinceLL());
+
+  start.setToNow();
+  binary = new TestLogger(&robot, &laser, "/tmp/laserLogTest.2db", 
+			  &noExtraLasers, true);
+  logScans(binary, &laser, 2000, 1081, false);
+  long long binaryTime = start.mSecSinceLL();
+  printf("binary 2000 scans %lld ms in the robot task, %ld dropped\n", 
+	 binaryTime, binary->getNumDropped());
+  start.setToNow();
+  delete binary;
+  printf("binary writer finished %lld ms later\n", start.mSecSinceLL());
+
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -0,0 +1,147 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Converts the same scans into raw readings one reading at a time (the
+  way the laser drivers used to) and with ArLaser::laserConvertScan,
+  checks that they give the same readings, then times each way.
+*/
+
+class TestLaser : public ArLaser
+{
+public:
+  TestLaser() : ArLaser(1, "test", 20000) 
+    { myRawReadings = new std::list<ArSensorReading *>; }
+  virtual bool blockingConnect(void) { return true; }
+  virtual bool asyncConnect(void) { return true; }
+  virtual bool disconnect(void) { return true; }
+  virtual bool isConnected(void) { return true; }
+  virtual bool isTryingToConnect(void) { return false; }
+  virtual void *runThread(void *) { return NULL; }
+
+  // the old way
+  void convertEach(const int *ranges, const char *ignore, int num, 
+		   double start, double increment, ArPose pose, 
+		   ArTransform transform)
+  {
+    std::list<ArSensorReading *>::iterator it;
+    double atDeg;
+    int i;
+    while (myRawReadings->size() < (size_t)num)
+      myRawReadings->push_back(new ArSensorReading);
+    for (atDeg = start, i = 0, it = myRawReadings->begin(); i < num; 
+	 atDeg += increment, i++, it++)
+    {
+      (*it)->resetSensorPosition(ArMath::roundInt(mySensorPose.getX()),
+				 ArMath::roundInt(mySensorPose.getY()),
+				 atDeg);
+      (*it)->newData(ranges[i], pose, pose, transform, 0, ArTime(), 
+		     ignore[i] != 0, 0);
+    }
+  }
+  void convertScan(const int *ranges, const char *ignore, int num, 
+		   double start, double increment, ArPose pose, 
+		   ArTransform transform)
+  {
+    laserConvertScan(ranges, ignore, num, start, increment, pose, pose,
+		     transform, 0, ArTime());
+  }
+  std::list<ArSensorReading *> *getRaw(void) { return myRawReadings; }
+};
+
+int main(void)
+{
+  Aria::init();
+  TestLaser each, scan;
+  int num = 1081;
+  double increment = .25;
+  std::vector<int> ranges(num);
+  std::vector<char> ignore(num);
+  std::list<ArSensorReading *>::iterator eIt, sIt;
+  int errors = 0;
+  int i, scanNum;
+  
+  each.setSensorPosition(150, -20, 5);
+  scan.setSensorPosition(150, -20, 5);
+  double start = 5 - (num - 1) * increment / 2;
+
+  for (scanNum = 0; scanNum < 20; scanNum++)
+  {
+    ArPose pose(scanNum * 100, -scanNum * 50, scanNum * 17);
+    ArTransform transform(pose);
+    for (i = 0; i < num; i++)
+    {
+      ranges[i] = ArMath::random() % 20000;
+      ignore[i] = (ranges[i] < 30);
+    }
+    // change the angles partway through to make sure the tables are redone
+    if (scanNum == 10)
+      start = 5 + (num - 1) * increment / 2;
+    if (scanNum >= 10)
+      increment = -.25;
+    each.convertEach(&ranges[0], &ignore[0], num, start, increment, pose, 
+		     transform);
+    scan.convertScan(&ranges[0], &ignore[0], num, start, increment, pose,
+		     transform);
+    for (eIt = each.getRaw()->begin(), sIt = scan.getRaw()->begin();
+	 eIt != each.getRaw()->end() && sIt != scan.getRaw()->end(); 
+	 eIt++, sIt++)
+    {
+      if (fabs((*eIt)->getX() - (*sIt)->getX()) > .01 ||
+	  fabs((*eIt)->getY() - (*sIt)->getY()) > .01 ||
+	  fabs((*eIt)->getLocalX() - (*sIt)->getLocalX()) > .01 ||
+	  fabs((*eIt)->getLocalY() - (*sIt)->getLocalY()) > .01 ||
+	  fabs((*eIt)->getSensorTh() - (*sIt)->getSensorTh()) > .0001 ||
+	  (*eIt)->getRange() != (*sIt)->getRange() ||
+	  (*eIt)->getIgnoreThisReading() != (*sIt)->getIgnoreThisReading())
+      {
+	printf("Mismatch: each %.2f %.2f scan %.2f %.2f\n", 
+	       (*eIt)->getX(), (*eIt)->getY(), (*sIt)->getX(), (*sIt)->getY());
+	errors++;
+      }
+    }
+  }
+  printf("%d mismatches\n", errors);
+
+  ArPose pose(1000, 2000, 30);
+  ArTransform transform(pose);
+  ArTime startTime;
+  for (i = 0; i < 2000; i++)
+    each.convertEach(&ranges[0], &ignore[0], num, start, increment, pose, 
+		     transform);
+  long long eachTime = startTime.mSecSinceLL();
+  startTime.setToNow();
+  for (i = 0; i < 2000; i++)
+    scan.convertScan(&ranges[0], &ignore[0], num, start, increment, pose, 
+		     transform);
+  long long scanTime = startTime.mSecSinceLL();
+  printf("2000 scans of %d readings: %lld ms one at a time, %lld ms as a scan\n",
+	 num, eachTime, scanTime);
+
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
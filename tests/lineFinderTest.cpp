@@ -0,0 +1,250 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Records scans of a simulated room (walls, a doorway, a pillar) from a
+  robot driving through it, then plays them back through ArLineFinder:
+  checks that getLineArray finds exactly the lines getLines does, that
+  the incremental mode still finds the long walls, and times each way.
+*/
+
+class TestLaser : public ArLaser
+{
+public:
+  TestLaser() : ArLaser(1, "test", 20000) 
+    { myRawReadings = new std::list<ArSensorReading *>; }
+  virtual bool blockingConnect(void) { return true; }
+  virtual bool asyncConnect(void) { return true; }
+  virtual bool disconnect(void) { return true; }
+  virtual bool isConnected(void) { return true; }
+  virtual bool isTryingToConnect(void) { return false; }
+  virtual void *runThread(void *) { return NULL; }
+
+  void scan(const int *ranges, int num, ArPose pose)
+  {
+    laserConvertScan(ranges, NULL, num, -90, .5, pose, pose,
+		     ArTransform(pose), 0, ArTime());
+  }
+};
+
+const int numReadings = 361;
+const int numScans = 300;
+
+std::vector<ArLineSegment> walls;
+std::vector<ArPose> poses;
+std::vector<int> ranges;
+
+int errors = 0;
+
+void addWall(double x1, double y1, double x2, double y2)
+{
+  walls.push_back(ArLineSegment(x1, y1, x2, y2));
+}
+
+// a room with a doorway on one side and a pillar in it
+void makeRoom(void)
+{
+  addWall(-1000, -1500, 9000, -1500);
+  addWall(9000, -1500, 9000, 2500);
+  addWall(9000, 2500, 4000, 2500);
+  addWall(3000, 2500, -1000, 2500);
+  addWall(-1000, 2500, -1000, -1500);
+  addWall(5000, 500, 5400, 500);
+  addWall(5400, 500, 5400, 900);
+  addWall(5400, 900, 5000, 900);
+  addWall(5000, 900, 5000, 500);
+}
+
+int range(ArPose pose, double th)
+{
+  double dx = ArMath::cos(pose.getTh() + th);
+  double dy = ArMath::sin(pose.getTh() + th);
+  double best = 30000;
+  double denom, t, u;
+  size_t i;
+  
+  for (i = 0; i < walls.size(); i++)
+  {
+    double wx = walls[i].getX2() - walls[i].getX1();
+    double wy = walls[i].getY2() - walls[i].getY1();
+    double ox = walls[i].getX1() - pose.getX();
+    double oy = walls[i].getY1() - pose.getY();
+    denom = dx * wy - dy * wx;
+    if (fabs(denom) < 1e-9)
+      continue;
+    t = (ox * wy - oy * wx) / denom;
+    u = (ox * dy - oy * dx) / denom;
+    if (t > 0 && u >= 0 && u <= 1 && t < best)
+      best = t;
+  }
+  // a little noise, like a real laser
+  return ArMath::roundInt(best + ArMath::random() % 11 - 5);
+}
+
+// drives along the room and turns a little, recording the scans
+void recordScans(void)
+{
+  ArPose pose(0, 0, 0);
+  int i, j;
+
+  for (i = 0; i < numScans; i++)
+  {
+    pose.setX(i * 20);
+    pose.setY(300 * ArMath::sin(i * 2));
+    pose.setTh(15 * ArMath::sin(i * 3));
+    poses.push_back(pose);
+    for (j = 0; j < numReadings; j++)
+      ranges.push_back(range(pose, -90 + j * .5));
+  }
+}
+
+void play(TestLaser *laser, int scan)
+{
+  laser->lockDevice();
+  laser->scan(&ranges[scan * numReadings], numReadings, poses[scan]);
+  laser->unlockDevice();
+}
+
+void check(const char *what, int scan, double a, double b)
+{
+  if (fabs(a - b) > .0001)
+  {
+    printf("MISMATCH scan %d %s: maps %g array %g\n", scan, what, a, b);
+    errors++;
+  }
+}
+
+void compare(int scan, std::map<int, ArLineFinderSegment *> *lines,
+	     const std::vector<ArLineFinderSegment> *array)
+{
+  std::map<int, ArLineFinderSegment *>::iterator it;
+  size_t i;
+
+  check("number of lines", scan, lines->size(), array->size());
+  for (it = lines->begin(), i = 0; it != lines->end() && i < array->size();
+       ++it, ++i)
+  {
+    check("x1", scan, (*it).second->getX1(), (*array)[i].getX1());
+    check("y1", scan, (*it).second->getY1(), (*array)[i].getY1());
+    check("x2", scan, (*it).second->getX2(), (*array)[i].getX2());
+    check("y2", scan, (*it).second->getY2(), (*array)[i].getY2());
+    check("start point", scan, (*it).second->getStartPoint(), 
+	  (*array)[i].getStartPoint());
+    check("end point", scan, (*it).second->getEndPoint(), 
+	  (*array)[i].getEndPoint());
+  }
+}
+
+// if a long line got found some other way too
+bool found(const ArLineFinderSegment &line, 
+	   const std::vector<ArLineFinderSegment> *array)
+{
+  size_t i;
+  for (i = 0; i < array->size(); i++)
+    if (fabs(ArMath::subAngle(line.getLineAngle(), 
+			      (*array)[i].getLineAngle())) < 5 &&
+	(*array)[i].getLine()->getPerpDist(line.getMidPoint()) < 50 &&
+	(*array)[i].getPerpDist(line.getMidPoint()) >= 0)
+      return true;
+  return false;
+}
+
+int main(void)
+{
+  Aria::init();
+  TestLaser laser;
+  ArLineFinder maps(&laser);
+  ArLineFinder array(&laser);
+  ArLineFinder incremental(&laser);
+  ArTime start;
+  int i;
+  size_t j;
+  int numLines = 0, numLong = 0, numMissed = 0;
+
+  incremental.setIncremental(true);
+
+  makeRoom();
+  recordScans();
+
+  for (i = 0; i < numScans; i++)
+  {
+    play(&laser, i);
+    compare(i, maps.getLines(), array.getLineArray());
+    const std::vector<ArLineFinderSegment> *lines = array.getLineArray();
+    const std::vector<ArLineFinderSegment> *incLines = 
+      incremental.getLineArray();
+    numLines += lines->size();
+    for (j = 0; j < lines->size(); j++)
+    {
+      if ((*lines)[j].getLength() < 1000)
+	continue;
+      numLong++;
+      if (!found((*lines)[j], incLines))
+	numMissed++;
+    }
+  }
+  printf("%d lines, %d mismatches\n", numLines, errors);
+  printf("incremental missed %d of %d lines over a meter\n", 
+	 numMissed, numLong);
+  if (numMissed * 20 > numLong)
+    errors++;
+
+  start.setToNow();
+  for (i = 0; i < numScans; i++)
+  {
+    play(&laser, i);
+    maps.getLines();
+  }
+  long long mapsTime = start.mSecSinceLL();
+
+  start.setToNow();
+  for (i = 0; i < numScans; i++)
+  {
+    play(&laser, i);
+    array.getLineArray();
+  }
+  long long arrayTime = start.mSecSinceLL();
+
+  start.setToNow();
+  for (i = 0; i < numScans; i++)
+  {
+    play(&laser, i);
+    incremental.getLineArray();
+  }
+  long long incrementalTime = start.mSecSinceLL();
+
+  start.setToNow();
+  for (i = 0; i < numScans; i++)
+    play(&laser, i);
+  long long playTime = start.mSecSinceLL();
+
+  printf("%d scans: getLines %lld ms, getLineArray %lld ms, incremental %lld ms (converting scans alone %lld ms)\n", 
+	 numScans, mapsTime, arrayTime, incrementalTime, playTime);
+
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
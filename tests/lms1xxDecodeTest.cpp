@@ -0,0 +1,305 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+#include "ArLMS1XX.h"
+
+/*
+  Makes the same LMDscandata scans as ASCII (CoLa-A) and binary
+  (CoLa-B) telegrams, sends them through the LMS1XX packet receiver
+  and scan processing, checks they give the same readings, then times
+  decoding the readings a word at a time and all at once, and
+  processing whole scans each way.
+*/
+
+int errors = 0;
+int numReadings = 541;
+
+/// Connection that gives out a string of data in 1000 byte pieces
+class FakeConnection : public ArDeviceConnection
+{
+public:
+  FakeConnection() { myPos = 0; }
+  void setData(const std::string &data) { myData = data; myPos = 0; }
+  virtual int read(const char *data, unsigned int size, 
+		   unsigned int msWait = 0)
+    {
+      if (size > 1000)
+	size = 1000;
+      if (size > myData.size() - myPos)
+	size = myData.size() - myPos;
+      memcpy((char *)data, myData.data() + myPos, size);
+      myPos += size;
+      return size;
+    }
+  virtual int write(const char *data, unsigned int size) { return size; }
+  virtual int getStatus(void) { return STATUS_OPEN; }
+  virtual bool openSimple(void) { return true; }
+  virtual const char *getOpenMessage(int messageNumber) { return ""; }
+  virtual ArTime getTimeRead(int index) { ArTime now; return now; }
+  virtual bool isTimeStamping(void) { return false; }
+protected:
+  std::string myData;
+  size_t myPos;
+};
+
+/// Lets the test hand scans right to the processing
+class TestLMS1XX : public ArLMS1XX
+{
+public:
+  TestLMS1XX() : ArLMS1XX(1, "lms1xx", ArLMS1XX::LMS1XX) {}
+  void process(ArLMS1XXPacket *packet)
+    {
+      myPacketsMutex.lock();
+      myPackets.push_back(packet);
+      myPacketsMutex.unlock();
+      sensorInterp();
+    }
+};
+
+/// Builds a telegram as ASCII or binary
+class Telegram
+{
+public:
+  Telegram(bool binary) { myBinary = binary; }
+  void str(const char *s) 
+    { 
+      if (!myBinary && !myData.empty())
+	myData += " ";
+      myData += s; 
+      if (myBinary)
+	myData += " ";
+    }
+  // a channel name, which is a fixed length in binary
+  void name(const char *s) 
+    { 
+      if (!myBinary)
+	myData += " ";
+      myData += s; 
+    }
+  void val(ArTypes::UByte4 v, int size)
+    {
+      char buf[32];
+      int i;
+      if (myBinary)
+      {
+	for (i = size - 1; i >= 0; i--)
+	  myData += (char)((v >> (i * 8)) & 0xff);
+      }
+      else
+      {
+	sprintf(buf, " %X", v);
+	myData += buf;
+      }
+    }
+  std::string frame(void)
+    {
+      std::string ret;
+      unsigned char checksum = 0;
+      size_t i;
+      if (!myBinary)
+	return "\002" + myData + "\003";
+      ret = "\002\002\002\002";
+      for (i = 0; i < 4; i++)
+	ret += (char)((myData.size() >> ((3 - i) * 8)) & 0xff);
+      for (i = 0; i < myData.size(); i++)
+	checksum ^= myData[i];
+      return ret + myData + (char)checksum;
+    }
+protected:
+  bool myBinary;
+  std::string myData;
+};
+
+std::string makeScan(bool binary, int scan)
+{
+  Telegram t(binary);
+  int i;
+  t.str("sSN");
+  t.str("LMDscandata");
+  t.val(1, 2); // version
+  t.val(1, 2); // device number
+  t.val(0x8a1234, 4); // serial number
+  t.val(0, 1); // device status
+  t.val(0, 1);
+  t.val(scan, 2); // telegram counter
+  t.val(scan, 2); // scan counter
+  t.val(0x1000 + scan, 4); // time since power up
+  t.val(0x1100 + scan, 4); // time of transmission
+  t.val(0, 1); // inputs
+  t.val(0, 1);
+  t.val(0, 1); // outputs
+  t.val(0, 1);
+  t.val(0, 2); // reserved
+  t.val(5000, 4); // scanning frequency
+  t.val(0x5dc, 4); // measurement frequency
+  t.val(0, 2); // encoders
+  t.val(1, 2); // 16 bit channels
+  t.name("DIST1");
+  t.val(0x3f800000, 4); // scale factor
+  t.val(0, 4); // scale offset
+  t.val(0xfff92230, 4); // start angle
+  t.val(5000, 2); // angular step
+  t.val(numReadings, 2);
+  for (i = 0; i < numReadings; i++)
+    t.val(100 + (i * 37 + scan * 11) % 8000, 2);
+  t.val(0, 2); // 8 bit channels
+  t.val(0, 2); // position
+  t.val(0, 2); // name
+  t.val(0, 2); // comment
+  t.val(0, 2); // time
+  t.val(0, 2); // events
+  return t.frame();
+}
+
+ArLMS1XXPacket *receive(ArLMS1XXPacketReceiver *receiver, 
+			FakeConnection *conn, const std::string &data)
+{
+  conn->setData(data);
+  return receiver->receivePacket(0);
+}
+
+void getRanges(TestLMS1XX *lms, std::vector<int> *ranges)
+{
+  const std::list<ArSensorReading *> *raw = lms->getRawReadings();
+  std::list<ArSensorReading *>::const_iterator it;
+  ranges->clear();
+  for (it = raw->begin(); it != raw->end(); it++)
+    ranges->push_back((*it)->getRange());
+}
+
+int main(void)
+{
+  Aria::init();
+  ArLog::init(ArLog::StdOut, ArLog::Terse);
+  FakeConnection conn;
+  ArLMS1XXPacketReceiver receiver;
+  TestLMS1XX asciiLMS;
+  TestLMS1XX binaryLMS;
+  ArLMS1XXPacket *ascii;
+  ArLMS1XXPacket *binary;
+  std::vector<int> asciiRanges;
+  std::vector<int> binaryRanges;
+  int scan, i;
+
+  receiver.setmyName("lms1xx");
+  receiver.setReadTimeout(0);
+  receiver.setDeviceConnection(&conn);
+
+  for (scan = 0; scan < 20; scan++)
+  {
+    ascii = receive(&receiver, &conn, makeScan(false, scan));
+    binary = receive(&receiver, &conn, makeScan(true, scan));
+    if (ascii == NULL || binary == NULL || ascii->isBinary() || 
+	!binary->isBinary())
+    {
+      printf("MISMATCH did not receive scan %d right\n", scan);
+      errors++;
+      continue;
+    }
+    if (strcmp(ascii->getCommandType(), binary->getCommandType()) != 0 ||
+	strcmp(ascii->getCommandName(), binary->getCommandName()) != 0)
+    {
+      printf("MISMATCH scan %d is %s %s and %s %s\n", scan, 
+	     ascii->getCommandType(), ascii->getCommandName(),
+	     binary->getCommandType(), binary->getCommandName());
+      errors++;
+    }
+    asciiLMS.process(ascii);
+    binaryLMS.process(binary);
+    getRanges(&asciiLMS, &asciiRanges);
+    getRanges(&binaryLMS, &binaryRanges);
+    if (asciiRanges.size() != (size_t)numReadings || 
+	asciiRanges != binaryRanges)
+    {
+      printf("MISMATCH scan %d readings (%d and %d of them)\n", scan, 
+	     (int)asciiRanges.size(), (int)binaryRanges.size());
+      errors++;
+      continue;
+    }
+    for (i = 0; i < numReadings; i++)
+      if (asciiRanges[i] != 100 + (i * 37 + scan * 11) % 8000)
+      {
+	printf("MISMATCH scan %d reading %d is %d\n", scan, i, 
+	       asciiRanges[i]);
+	errors++;
+	break;
+      }
+  }
+
+  // decoding the readings a word at a time and all at once
+  ArLMS1XXPacket *packet = receive(&receiver, &conn, makeScan(false, 1));
+  std::vector<ArTypes::UByte2> values(numReadings);
+  std::vector<ArTypes::UByte2> arrayValues(numReadings);
+  char buf[32];
+  int start;
+  int rep;
+  // skip to the readings (the 24 words after the command name)
+  for (i = 0; i < 24; i++)
+    packet->bufToStr(buf, sizeof(buf));
+  start = packet->getReadLength();
+
+  ArTime wordTime;
+  for (rep = 0; rep < 2000; rep++)
+  {
+    packet->setReadLength(start);
+    for (i = 0; i < numReadings; i++)
+      values[i] = packet->bufToUByte2();
+  }
+  long long wordMS = wordTime.mSecSinceLL();
+  ArTime arrayTime;
+  for (rep = 0; rep < 2000; rep++)
+  {
+    packet->setReadLength(start);
+    packet->bufToUByte2Array(&arrayValues[0], numReadings);
+  }
+  long long arrayMS = arrayTime.mSecSinceLL();
+  if (values != arrayValues || values[5] != 100 + 5 * 37 + 11)
+  {
+    printf("MISMATCH decoding a word at a time and all at once\n");
+    errors++;
+  }
+  delete packet;
+  printf("2000 scans of %d ASCII readings: a word at a time %lld ms, all at once %lld ms\n",
+	 numReadings, wordMS, arrayMS);
+
+  // processing whole scans
+  std::string asciiScan = makeScan(false, 2);
+  std::string binaryScan = makeScan(true, 2);
+  ArTime asciiTime;
+  for (rep = 0; rep < 2000; rep++)
+    asciiLMS.process(receive(&receiver, &conn, asciiScan));
+  long long asciiMS = asciiTime.mSecSinceLL();
+  ArTime binaryTime;
+  for (rep = 0; rep < 2000; rep++)
+    binaryLMS.process(receive(&receiver, &conn, binaryScan));
+  long long binaryMS = binaryTime.mSecSinceLL();
+  printf("2000 scans (%d bytes ASCII, %d bytes binary) received and processed: ASCII %lld ms, binary %lld ms\n",
+	 (int)asciiScan.size(), (int)binaryScan.size(), asciiMS, binaryMS);
+
+  printf("%d mismatches\n", errors);
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
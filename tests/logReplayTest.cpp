@@ -0,0 +1,174 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Writes a log of robot motor packets, then replays it twice through
+  ArLogFileConnection on the virtual clock (with an action driving),
+  checks both replays saw exactly the same things at the same times
+  (relative to the start of the replay) and that the clock is back on
+  the system's afterwards, and prints how long the replays took
+  compared to the log.
+*/
+
+int numPackets = 3000;
+
+void writeLog(const char *fileName)
+{
+  FILE *file = ArUtil::fopen(fileName, "w");
+  int i;
+  int x, th;
+  fprintf(file, "// Saphira log file\n");
+  for (i = 0; i < numPackets; i++)
+  {
+    x = (i * 20) & 0x7fff;
+    th = (i * 3) % 4096;
+    // header, length, id
+    fprintf(file, "250 251 25 50 ");
+    // x, y, th
+    fprintf(file, "%d %d %d %d %d %d ", x & 0xff, x >> 8, 
+	    (i * 7) & 0xff, ((i * 7) & 0x7fff) >> 8, th & 0xff, th >> 8);
+    // left and right vel, battery, stall, control, flags, compass
+    fprintf(file, "200 0 %d 0 120 0 0 0 0 1 0 0 ", 180 + i % 40);
+    // one sonar reading then the checksum
+    fprintf(file, "1 0 %d %d 0 0\n", (500 + i) & 0xff, (500 + i) >> 8);
+  }
+  fclose(file);
+}
+
+class Recorder
+{
+public:
+  Recorder(ArRobot *robot) : 
+    myRobot(robot), myTaskCB(this, &Recorder::task) 
+    { myRobot->addUserTask("recorder", 50, &myTaskCB); }
+  void task(void)
+    {
+      // losing the connection closes it, which puts the clock back on
+      // the system's, so times from then on can't be compared
+      if (!myRobot->isConnected())
+	return;
+      if (myRecords.empty())
+	myStart.setToNow();
+      char buf[1024];
+      sprintf(buf, "%u %lld %.17g %.17g %.17g %.17g %.17g %d %.17g", 
+	      myRobot->getCounter(), myStart.mSecSinceLL(), 
+	      myRobot->getX(), myRobot->getY(), myRobot->getTh(), 
+	      myRobot->getVel(), myRobot->getBatteryVoltage(),
+	      myRobot->getSonarRange(0), 
+	      myRobot->getLeftVel());
+      myRecords.push_back(buf);
+    }
+  std::vector<std::string> myRecords;
+protected:
+  ArRobot *myRobot;
+  ArTime myStart;
+  ArFunctorC<Recorder> myTaskCB;
+};
+
+void replay(const char *fileName, std::vector<std::string> *records)
+{
+  // the robot uses these as it goes away, so they have to outlast it
+  ArLogFileConnection con;
+  ArActionConstantVelocity constantVelocity("constant", 300);
+  ArRobot robot;
+  Recorder recorder(&robot);
+
+  con.setFastReplay(true);
+  if (con.open(fileName) != 0)
+  {
+    printf("Could not open %s\n", fileName);
+    return;
+  }
+  robot.setDeviceConnection(&con);
+  robot.addAction(&constantVelocity, 50);
+  if (!robot.blockingConnect())
+  {
+    printf("Could not connect to %s\n", fileName);
+    return;
+  }
+  robot.enableMotors();
+  robot.run(true, true);
+  *records = recorder.myRecords;
+}
+
+int main(void)
+{
+  Aria::init();
+  ArLog::init(ArLog::StdOut, ArLog::Terse);
+  std::vector<std::string> first, second;
+  int errors = 0;
+  size_t i;
+  
+  writeLog("/tmp/logReplayTest.log");
+
+  ArTime start;
+  replay("/tmp/logReplayTest.log", &first);
+  // closing the connection puts the clock back on the system's
+  if (ArTime::usingVirtualClock())
+  {
+    printf("Still on the virtual clock after the replay\n");
+    errors++;
+  }
+  if (start.mSecSinceLL() < 0)
+  {
+    printf("The clock went backwards during the replay\n");
+    errors++;
+  }
+  start.setToNow();
+  replay("/tmp/logReplayTest.log", &second);
+  long long wallTime = start.mSecSinceLL();
+
+  if (first.size() != second.size())
+  {
+    printf("MISMATCH: %d cycles the first time, %d the second\n",
+	   (int)first.size(), (int)second.size());
+    errors++;
+  }
+  for (i = 0; i < first.size() && i < second.size(); i++)
+  {
+    if (first[i] != second[i])
+    {
+      printf("MISMATCH at cycle %d:\n  %s\n  %s\n", (int)i, 
+	     first[i].c_str(), second[i].c_str());
+      if (++errors > 10)
+	break;
+    }
+  }
+  if (first.size() < (size_t)numPackets)
+  {
+    printf("Only %d cycles for %d packets\n", (int)first.size(), numPackets);
+    errors++;
+  }
+  if (!first.empty())
+    printf("last cycle: %s\n", first.back().c_str());
+  printf("%d mismatches\n", errors);
+  printf("%d packets (%d s of log) replayed in %lld ms\n", numPackets,
+	 numPackets / 10, wallTime);
+
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
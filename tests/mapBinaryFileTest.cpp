@@ -0,0 +1,154 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Writes a large map file, then reads it with and without the binary
+  companion file, checks that both give the same map, and times them.
+  Also checks that a binary file is not used once the map file changes.
+*/
+
+int errors = 0;
+
+void check(const char *what, bool ok)
+{
+  if (!ok)
+  {
+    printf("FAILED %s\n", what);
+    errors++;
+  }
+}
+
+void writeMapFile(const char *fileName, int numPoints, int numLines, int seed)
+{
+  FILE *file = ArUtil::fopen(fileName, "wb");
+  int i;
+
+  srand(seed);
+  fprintf(file, "2D-Map\n");
+  fprintf(file, "MinPos: -50000 -50000\n");
+  fprintf(file, "MaxPos: 50000 50000\n");
+  fprintf(file, "NumPoints: %d\n", numPoints);
+  fprintf(file, "PointsAreSorted: false\n");
+  fprintf(file, "Resolution: 20\n");
+  fprintf(file, "LineMinPos: -50000 -50000\n");
+  fprintf(file, "LineMaxPos: 50000 50000\n");
+  fprintf(file, "NumLines: %d\n", numLines);
+  fprintf(file, "LinesAreSorted: false\n");
+  fprintf(file, "Cairn: Goal 1000 2000 0.0 \"\" ICON \"goal1\"\n");
+  fprintf(file, "Cairn: ForbiddenLine 0 0 0.0 \"\" ICON \"\" 0 0 500 500\n");
+  fprintf(file, "LINES\n");
+  for (i = 0; i < numLines; i++)
+    fprintf(file, "%d %d %d %d\n", rand() % 100000 - 50000,
+	    rand() % 100000 - 50000, rand() % 100000 - 50000,
+	    rand() % 100000 - 50000);
+  fprintf(file, "DATA\n");
+  for (i = 0; i < numPoints; i++)
+    fprintf(file, "%d %d\n", rand() % 100000 - 50000,
+	    rand() % 100000 - 50000);
+  fclose(file);
+}
+
+void compare(ArMap *text, ArMap *binary)
+{
+  ArMapId textId, binaryId;
+  text->getMapId(&textId);
+  binary->getMapId(&binaryId);
+  check("map id", textId == binaryId);
+
+  check("num points", text->getNumPoints() == binary->getNumPoints());
+  check("num lines", text->getNumLines() == binary->getNumLines());
+  check("min pose", text->getMinPose().findDistanceTo(
+		binary->getMinPose()) < .1);
+  check("max pose", text->getMaxPose().findDistanceTo(
+		binary->getMaxPose()) < .1);
+  check("resolution", text->getResolution() == binary->getResolution());
+  check("map objects", text->getMapObjects()->size() ==
+	binary->getMapObjects()->size());
+  check("points", *text->getPoints() == *binary->getPoints());
+  check("lines", text->getLines()->size() == binary->getLines()->size());
+  for (size_t i = 0; i < text->getLines()->size() && 
+	 i < binary->getLines()->size(); i++)
+    if ((*text->getLines())[i] != (*binary->getLines())[i])
+    {
+      check("line", false);
+      break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  ArLog::init(ArLog::StdOut, ArLog::Terse);
+  const char *fileName = "mapBinaryFileTest.map";
+  int numPoints = 1000000;
+  if (argc > 1)
+    numPoints = atoi(argv[1]);
+
+  writeMapFile(fileName, numPoints, 5000, 1);
+  remove(ArMapSimple::getBinaryFileName(fileName).c_str());
+
+  ArTime start;
+  ArMap text("./", false);
+  check("read text", text.readFile(fileName));
+  printf("text read %ld ms\n", start.mSecSince());
+
+  // the first read with the binary file enabled has to write it
+  ArMap binary("./", false);
+  binary.setUseBinaryFile(true);
+  start.setToNow();
+  check("read text and write binary", binary.readFile(fileName));
+  printf("text read and binary write %ld ms\n", start.mSecSince());
+  compare(&text, &binary);
+
+  start.setToNow();
+  check("read binary", binary.readFile(fileName));
+  long binaryTime = start.mSecSince();
+  start.setToNow();
+  binary.getPoints();
+  printf("binary read %ld ms, first getPoints %ld ms\n", binaryTime,
+	 start.mSecSince());
+  compare(&text, &binary);
+
+  // a copy made before the points are loaded still gets them
+  check("read binary for copy", binary.readFile(fileName));
+  ArMap copy(binary);
+  check("copy points", *copy.getPoints() == *text.getPoints());
+
+  // change the map file, the old binary file must not be used for it
+  ArUtil::sleep(1100);
+  writeMapFile(fileName, numPoints, 5000, 2);
+  check("reread text", text.readFile(fileName));
+  check("read changed map", binary.readFile(fileName));
+  compare(&text, &binary);
+
+  remove(fileName);
+  remove(ArMapSimple::getBinaryFileName(fileName).c_str());
+
+  printf("%d errors\n", errors);
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -0,0 +1,205 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Puts random points and lines in an ArMap, checks that the radius,
+  box, closest point and ray casting queries of its grid index give the
+  same answers as looking through every point and line, that the
+  index is rebuilt after the map changes, then times both ways.
+*/
+
+int errors = 0;
+
+double randomCoord(void)
+{
+  return ArMath::random() % 100000 - 50000;
+}
+
+int bruteRadius(std::vector<ArPose> *points, ArPose center, double radius)
+{
+  int found = 0;
+  for (size_t i = 0; i < points->size(); i++)
+    if ((*points)[i].squaredFindDistanceTo(center) <= radius * radius)
+      found++;
+  return found;
+}
+
+int bruteBox(std::vector<ArPose> *points, double x1, double y1, 
+	     double x2, double y2)
+{
+  int found = 0;
+  for (size_t i = 0; i < points->size(); i++)
+    if ((*points)[i].getX() >= x1 && (*points)[i].getX() <= x2 &&
+	(*points)[i].getY() >= y1 && (*points)[i].getY() <= y2)
+      found++;
+  return found;
+}
+
+double bruteClosest(std::vector<ArPose> *points, ArPose center)
+{
+  double best = HUGE_VAL;
+  for (size_t i = 0; i < points->size(); i++)
+    best = ArUtil::findMin(best, (*points)[i].findDistanceTo(center));
+  return best;
+}
+
+double bruteRay(std::vector<ArLineSegment> *lines, ArPose start, double th,
+		double maxRange)
+{
+  ArLineSegment ray(start, ArPose(start.getX() + ArMath::cos(th) * maxRange,
+				  start.getY() + ArMath::sin(th) * maxRange));
+  ArPose hit;
+  double best = HUGE_VAL;
+  for (size_t i = 0; i < lines->size(); i++)
+    if (ray.intersects(&(*lines)[i], &hit))
+      best = ArUtil::findMin(best, hit.findDistanceTo(start));
+  return best;
+}
+
+void check(const char *what, double brute, double grid)
+{
+  if (fabs(brute - grid) > .01)
+  {
+    printf("MISMATCH %s: brute %g grid %g\n", what, brute, grid);
+    errors++;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  ArMap map(NULL, false);
+  std::vector<ArPose> points;
+  std::vector<ArLineSegment> lines;
+  std::vector<ArPose> found;
+  std::vector<ArLineSegment> foundLines;
+  ArMapGridIndex *index;
+  ArPose center, hit;
+  double dist, x, y;
+  int i;
+
+  for (i = 0; i < 200000; i++)
+    points.push_back(ArPose(randomCoord(), randomCoord()));
+  for (i = 0; i < 5000; i++)
+  {
+    x = randomCoord();
+    y = randomCoord();
+    lines.push_back(ArLineSegment(x, y, x + ArMath::random() % 4000 - 2000,
+				  y + ArMath::random() % 4000 - 2000));
+  }
+  map.lock();
+  map.setPoints(&points);
+  map.setLines(&lines);
+  map.mapChanged();
+
+  index = map.getGridIndex();
+  if (index->getNumPoints() != (int)points.size() || 
+      index->getNumLines() != (int)lines.size())
+  {
+    printf("Index has %d points and %d lines, should have %d and %d\n",
+	   index->getNumPoints(), index->getNumLines(), (int)points.size(), 
+	   (int)lines.size());
+    errors++;
+  }
+
+  for (i = 0; i < 200; i++)
+  {
+    center.setPose(randomCoord(), randomCoord());
+    found.clear();
+    check("radius", bruteRadius(&points, center, 3000),
+	  index->getPointsInRadius(center, 3000, &found));
+    found.clear();
+    check("box", 
+	  bruteBox(&points, center.getX(), center.getY(), 
+		   center.getX() + 4000, center.getY() + 2000),
+	  index->getPointsInBox(center.getX() + 4000, center.getY(), 
+				center.getX(), center.getY() + 2000, &found));
+    dist = -1;
+    index->getClosestPoint(center, 100000, &hit, &dist);
+    check("closest", bruteClosest(&points, center), dist);
+    dist = HUGE_VAL;
+    index->castRay(center, i * 7.3, 40000, &hit, &dist);
+    check("ray", bruteRay(&lines, center, i * 7.3, 40000), dist);
+    foundLines.clear();
+    index->getLinesInRadius(center, 2000, &foundLines);
+    for (size_t j = 0; j < foundLines.size(); j++)
+      if (foundLines[j].getDistToLine(center) > 2001)
+      {
+	printf("Line too far away\n");
+	errors++;
+      }
+  }
+
+  // a new map gets a new index
+  points.resize(1000);
+  map.setPoints(&points);
+  map.mapChanged();
+  if (map.getGridIndex()->getNumPoints() != 1000)
+  {
+    printf("Index wasn't rebuilt after the map changed\n");
+    errors++;
+  }
+  points = *map.getPoints();
+  printf("%d mismatches\n", errors);
+
+  // time them on a big map
+  for (i = 0; i < 200000; i++)
+    points.push_back(ArPose(randomCoord(), randomCoord()));
+  map.setPoints(&points);
+  map.mapChanged();
+  ArTime start;
+  index = map.getGridIndex();
+  long long buildTime = start.mSecSinceLL();
+  int total = 0;
+  start.setToNow();
+  for (i = 0; i < 1000; i++)
+    total += bruteRadius(&points, ArPose(i * 50 - 25000, 0), 2000);
+  long long bruteTime = start.mSecSinceLL();
+  start.setToNow();
+  for (i = 0; i < 1000; i++)
+  {
+    found.clear();
+    total -= index->getPointsInRadius(ArPose(i * 50 - 25000, 0), 2000, &found);
+  }
+  long long gridTime = start.mSecSinceLL();
+  start.setToNow();
+  for (i = 0; i < 1000; i++)
+    bruteRay(&lines, ArPose(0, 0), i * .36, 40000);
+  long long bruteRayTime = start.mSecSinceLL();
+  start.setToNow();
+  for (i = 0; i < 1000; i++)
+    index->castRay(ArPose(0, 0), i * .36, 40000, &hit);
+  long long gridRayTime = start.mSecSinceLL();
+  map.unlock();
+
+  printf("%d points: index built in %lld ms, 1000 radius queries %lld ms brute %lld ms grid (%d)\n",
+	 (int)points.size(), buildTime, bruteTime, gridTime, total);
+  printf("%d lines: 1000 ray casts %lld ms brute %lld ms grid\n",
+	 (int)lines.size(), bruteRayTime, gridRayTime);
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -0,0 +1,197 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Turns on mutex contention profiling, has a "holder" thread hold a
+  mutex for a couple of ms at a time while "waiter" threads lock it,
+  and checks that the snapshot shows the waits behind the holder, that
+  recursive locks count once and unnamed mutexes aren't counted.  Then
+  times locking and unlocking with profiling off and on, and lets the
+  periodic log go once.
+*/
+
+int errors = 0;
+ArMutex shared;
+volatile bool running = true;
+
+class HolderThread : public ArASyncTask
+{
+public:
+  virtual void *runThread(void *)
+  {
+    while (running)
+    {
+      shared.lock();
+      ArUtil::sleep(2);
+      shared.unlock();
+      ArUtil::sleep(1);
+    }
+    return NULL;
+  }
+};
+
+class WaiterThread : public ArASyncTask
+{
+public:
+  virtual void *runThread(void *)
+  {
+    int i;
+    for (i = 0; i < 200; i++)
+    {
+      shared.lock();
+      shared.unlock();
+      ArUtil::sleep(1);
+    }
+    return NULL;
+  }
+};
+
+bool find(std::list<ArMutexContention> *snapshot, const char *name,
+	  ArMutexContention *contention)
+{
+  std::list<ArMutexContention>::iterator it;
+  for (it = snapshot->begin(); it != snapshot->end(); it++)
+  {
+    if (strcmp((*it).getName(), name) == 0)
+    {
+      *contention = *it;
+      return true;
+    }
+  }
+  return false;
+}
+
+long long timeLocking(ArMutex *mutex, int num)
+{
+  ArTime start;
+  int i;
+  for (i = 0; i < num; i++)
+  {
+    mutex->lock();
+    mutex->unlock();
+  }
+  return start.mSecSinceLL();
+}
+
+int main(void)
+{
+  Aria::init();
+  HolderThread holder;
+  WaiterThread waiters[3];
+  ArMutex recursive;
+  ArMutex unnamed;
+  std::list<ArMutexContention> snapshot;
+  ArMutexContention contention;
+  int i;
+
+  shared.setLogName("shared");
+  recursive.setLogName("recursive");
+  ArMutex::setContentionProfiling(true);
+
+  holder.setThreadName("holder");
+  holder.runAsync();
+  for (i = 0; i < 3; i++)
+  {
+    waiters[i].setThreadName("waiter");
+    waiters[i].runAsync();
+  }
+
+  for (i = 0; i < 100; i++)
+  {
+    recursive.lock();
+    recursive.lock();
+    recursive.unlock();
+    recursive.unlock();
+    unnamed.lock();
+    unnamed.unlock();
+  }
+
+  for (i = 0; i < 3; i++)
+    waiters[i].join();
+  running = false;
+  holder.join();
+  ArMutex::setContentionProfiling(false);
+
+  ArMutexContention::getSnapshot(&snapshot);
+  if (!find(&snapshot, "shared", &contention))
+  {
+    printf("No statistics for shared\n");
+    errors++;
+  }
+  else
+  {
+    printf("shared: %llu locks, %llu waited, most waits behind '%s', longest held by '%s'\n",
+	   contention.getNumLocks(), contention.getNumContended(),
+	   contention.getMostBlockingThread(), contention.getLongestHolder());
+    if (contention.getNumLocks() < 600 || contention.getNumContended() == 0 ||
+	contention.getNumContended() != contention.getWaitTiming().getCount() ||
+	contention.getNumLocks() != contention.getHoldTiming().getCount())
+    {
+      printf("Wrong counts for shared\n");
+      errors++;
+    }
+    if (strcmp(contention.getMostBlockingThread(), "holder") != 0 ||
+	strcmp(contention.getLongestHolder(), "holder") != 0)
+    {
+      printf("Wrong threads for shared\n");
+      errors++;
+    }
+    if (contention.getHoldTiming().getMax() < 2000)
+    {
+      printf("Hold time too short for shared\n");
+      errors++;
+    }
+  }
+  if (!find(&snapshot, "recursive", &contention) || 
+      contention.getNumLocks() != 100 || contention.getNumContended() != 0)
+  {
+    printf("Wrong counts for recursive\n");
+    errors++;
+  }
+  if (find(&snapshot, "", &contention))
+  {
+    printf("The unnamed mutex was profiled\n");
+    errors++;
+  }
+  ArMutexContention::logSnapshot(ArLog::Normal, 5);
+
+  printf("%d errors\n", errors);
+
+  long long offTime = timeLocking(&recursive, 1000000);
+  ArMutex::setContentionProfiling(true);
+  long long onTime = timeLocking(&recursive, 1000000);
+  printf("1000000 lock/unlocks: %lld ms not profiling, %lld ms profiling\n",
+	 offTime, onTime);
+
+  ArMutexContention::clearAll();
+  ArMutexContention::setLogInterval(1);
+  ArUtil::sleep(1500);
+  ArMutexContention::setLogInterval(0);
+
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -0,0 +1,313 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+#include "ArLMS1XX.h"
+
+/*
+  Feeds streams of robot, LMS2xx and LMS1XX packets (with junk between
+  them, packets with bad checksums, LMS1XX packets too big to hold, and
+  packets split across reads at random spots) through the packet receivers from a fake connection,
+  checks the right packets come out, and prints how many reads it took
+  and how long it took.
+*/
+
+int errors = 0;
+
+/// Connection that gives out a string of data in randomly sized pieces
+class FakeConnection : public ArDeviceConnection
+{
+public:
+  FakeConnection() { myPos = 0; myAvailable = 0; myNumReads = 0; }
+  void setData(const std::string &data) 
+    { myData = data; myPos = 0; myAvailable = 0; myNumReads = 0; }
+  virtual int read(const char *data, unsigned int size, 
+		   unsigned int msWait = 0)
+    {
+      myNumReads++;
+      // the next piece comes in once the last one has all been read
+      if (myAvailable == 0 && myPos < myData.size())
+      {
+	myAvailable = 1 + lrand48() % 600;
+	if (myAvailable > myData.size() - myPos)
+	  myAvailable = myData.size() - myPos;
+      }
+      if (size > myAvailable)
+	size = myAvailable;
+      memcpy((char *)data, myData.data() + myPos, size);
+      myPos += size;
+      myAvailable -= size;
+      return size;
+    }
+  virtual int write(const char *data, unsigned int size) { return size; }
+  virtual int getStatus(void) { return STATUS_OPEN; }
+  virtual bool openSimple(void) { return true; }
+  virtual const char *getOpenMessage(int messageNumber) { return ""; }
+  virtual ArTime getTimeRead(int index) { ArTime now; return now; }
+  virtual bool isTimeStamping(void) { return false; }
+  bool done(void) { return myPos >= myData.size(); }
+  long getNumReads(void) { return myNumReads; }
+protected:
+  std::string myData;
+  size_t myPos;
+  size_t myAvailable;
+  long myNumReads;
+};
+
+void seed(void)
+{
+#ifdef WIN32
+  srand(1);
+#else
+  srand48(1);
+#endif
+}
+
+// junk between packets, without anything that starts a packet (since
+// then it could look like a packet)
+void addJunk(std::string *data)
+{
+  int i;
+  int num = lrand48() % 20;
+  for (i = 0; i < num; i++)
+    *data += (char)(0x10 + lrand48() % 0x60);
+}
+
+void report(const char *name, int numPackets, const std::string &data, 
+	    FakeConnection *conn, long long ms)
+{
+  printf("%-6s %d packets, %d bytes in %ld reads (a byte at a time would be at least %d), %lld ms\n", 
+	 name, numPackets, (int)data.size(), conn->getNumReads(), 
+	 (int)data.size(), ms);
+}
+
+void testRobot(int numPackets)
+{
+  FakeConnection conn;
+  ArRobotPacketReceiver receiver(&conn);
+  ArRobotPacket packet;
+  ArRobotPacket *got;
+  std::string data;
+  std::vector<std::string> expected;
+  int i, j, len;
+  unsigned int upTo = 0;
+
+  seed();
+  for (i = 0; i < numPackets; i++)
+  {
+    packet.empty();
+    packet.setID(0x90 + i % 16);
+    len = lrand48() % 150;
+    for (j = 0; j < len; j++)
+      packet.uByteToBuf((i + j) & 0xff);
+    packet.finalizePacket();
+    addJunk(&data);
+    // mess up the checksum on some
+    if (i % 50 == 7)
+    {
+      std::string bad(packet.getBuf(), packet.getLength());
+      bad[bad.size() - 1] ^= 0x55;
+      data += bad;
+    }
+    else
+    {
+      data.append(packet.getBuf(), packet.getLength());
+      expected.push_back(std::string(packet.getBuf(), packet.getLength()));
+    }
+  }
+  conn.setData(data);
+
+  ArTime start;
+  while (!conn.done() || upTo < expected.size())
+  {
+    if ((got = receiver.receivePacket(0)) == NULL)
+    {
+      if (conn.done())
+	break;
+      continue;
+    }
+    if (upTo >= expected.size() || 
+	std::string(got->getBuf(), got->getLength()) != expected[upTo])
+    {
+      printf("MISMATCH robot packet %u\n", upTo);
+      errors++;
+    }
+    upTo++;
+  }
+  long long ms = start.mSecSinceLL();
+  if (upTo != expected.size())
+  {
+    printf("MISMATCH robot got %u packets instead of %d\n", upTo, 
+	   (int)expected.size());
+    errors++;
+  }
+  report("robot", numPackets, data, &conn, ms);
+}
+
+void testLMS2xx(int numPackets)
+{
+  FakeConnection conn;
+  ArLMS2xxPacketReceiver receiver(&conn);
+  ArLMS2xxPacket packet;
+  ArLMS2xxPacket *got;
+  std::string data;
+  std::vector<std::string> expected;
+  int i, j, len;
+  unsigned int upTo = 0;
+
+  seed();
+  packet.setSendingAddress(0x80);
+  for (i = 0; i < numPackets; i++)
+  {
+    packet.empty();
+    packet.uByteToBuf(0xb0);
+    len = lrand48() % 800;
+    for (j = 0; j < len; j++)
+      packet.uByteToBuf((i * 3 + j) & 0xff);
+    packet.finalizePacket();
+    addJunk(&data);
+    if (i % 50 == 7)
+    {
+      std::string bad(packet.getBuf(), packet.getLength());
+      bad[bad.size() - 1] ^= 0x55;
+      data += bad;
+    }
+    else
+    {
+      data.append(packet.getBuf(), packet.getLength());
+      expected.push_back(std::string(packet.getBuf(), packet.getLength()));
+    }
+  }
+  conn.setData(data);
+
+  ArTime start;
+  while (!conn.done() || upTo < expected.size())
+  {
+    if ((got = receiver.receivePacket(0)) == NULL)
+    {
+      if (conn.done())
+	break;
+      continue;
+    }
+    if (upTo >= expected.size() || 
+	std::string(got->getBuf(), got->getLength()) != expected[upTo])
+    {
+      printf("MISMATCH lms2xx packet %u\n", upTo);
+      errors++;
+    }
+    upTo++;
+  }
+  long long ms = start.mSecSinceLL();
+  if (upTo != expected.size())
+  {
+    printf("MISMATCH lms2xx got %u packets instead of %d\n", upTo, 
+	   (int)expected.size());
+    errors++;
+  }
+  report("lms2xx", numPackets, data, &conn, ms);
+}
+
+void testLMS1XX(int numPackets)
+{
+  FakeConnection conn;
+  ArLMS1XXPacketReceiver receiver;
+  ArLMS1XXPacket *got;
+  std::string data;
+  std::string one;
+  std::vector<std::string> expected;
+  char buf[32];
+  int i, j, len;
+  unsigned int upTo = 0;
+
+  seed();
+  receiver.setmyName("lms1xx");
+  receiver.setReadTimeout(0);
+  receiver.setDeviceConnection(&conn);
+  for (i = 0; i < numPackets; i++)
+  {
+    one = "\002sRA LMDscandata";
+    len = lrand48() % 600;
+    for (j = 0; j < len; j++)
+    {
+      sprintf(buf, " %X", (i + j) & 0xfff);
+      one += buf;
+    }
+    one += "\003";
+    // junk (without the start or end chars) between some packets
+    if (i % 10 == 3)
+      data += "garbage";
+    // and a packet that never ends, which the next one should replace
+    if (i % 50 == 7)
+      data += "\002sRA LMDscandata 1 2 3";
+    // and one too big for a packet, which should be dropped
+    if (i % 100 == 42)
+      data += "\002sRA LMDscandata" + std::string(12000, 'A') + "\003";
+    data += one;
+    expected.push_back(one);
+  }
+  conn.setData(data);
+
+  ArTime start;
+  while (!conn.done() || upTo < expected.size())
+  {
+    if ((got = receiver.receivePacket(0)) == NULL)
+    {
+      if (conn.done())
+	break;
+      continue;
+    }
+    if (upTo >= expected.size() || 
+	std::string(got->getBuf(), got->getLength()) != expected[upTo])
+    {
+      printf("MISMATCH lms1xx packet %u\n", upTo);
+      errors++;
+    }
+    delete got;
+    upTo++;
+  }
+  long long ms = start.mSecSinceLL();
+  if (upTo != expected.size())
+  {
+    printf("MISMATCH lms1xx got %u packets instead of %d\n", upTo, 
+	   (int)expected.size());
+    errors++;
+  }
+  report("lms1xx", numPackets, data, &conn, ms);
+}
+
+int main(void)
+{
+  Aria::init();
+  // keep the bad checksum logging out of the way
+  ArLog::init(ArLog::StdOut, ArLog::Terse);
+
+  testRobot(20000);
+  testLMS2xx(5000);
+  testLMS1XX(2000);
+
+  printf("%d mismatches\n", errors);
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
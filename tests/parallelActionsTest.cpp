@@ -0,0 +1,202 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Makes a range device with a big cumulative buffer and a set of pure
+  actions that each check a different box in it (plus one action that
+  isn't pure), then times ArPriorityResolver::resolve() with the
+  actions fired one at a time and with parallel threads, for different
+  numbers of actions, and checks that both ways give the same result.
+  Then checks the robot's range device checks against a threaded range
+  device while its thread is adding readings, making sure the device
+  lock isn't left held.
+*/
+
+int errors = 0;
+
+class BoxAction : public ArAction
+{
+public:
+  BoxAction(int index) : ArAction("box"), myIndex(index) { setPure(true); }
+  virtual ArActionDesired *fire(ArActionDesired currentDesired)
+  {
+    double dist;
+    myDesired.reset();
+    dist = myRobot->checkRangeDevicesCumulativeBox(
+	    -500 + myIndex * 50, -400 - myIndex * 20, 
+	    1500 + myIndex * 100, 400 + myIndex * 20);
+    myDesired.setMaxVel(dist / 4);
+    myDesired.setDeltaHeading(myIndex * 7 % 30 - 15, .2 + myIndex % 5 / 10.0);
+    return &myDesired;
+  }
+  virtual ArActionDesired *getDesired(void) { return &myDesired; }
+protected:
+  int myIndex;
+  ArActionDesired myDesired;
+};
+
+class DriveAction : public ArAction
+{
+public:
+  DriveAction() : ArAction("drive") {}
+  virtual ArActionDesired *fire(ArActionDesired currentDesired)
+  {
+    myDesired.reset();
+    // not pure, this looks at what the higher priority actions want
+    myDesired.setVel(ArUtil::findMin(400.0, currentDesired.getMaxVel()));
+    return &myDesired;
+  }
+protected:
+  ArActionDesired myDesired;
+};
+
+class ThreadedDevice : public ArRangeDeviceThreaded
+{
+public:
+  ThreadedDevice() : 
+    ArRangeDeviceThreaded(100, 0, "threaded", 30000), myAdded(0) {}
+  virtual void *runThread(void *arg)
+  {
+    while (getRunningWithLock())
+    {
+      lockDevice();
+      myCurrentBuffer.addReading(ArMath::random() % 4000 - 2000,
+				 ArMath::random() % 4000 - 2000);
+      myAdded++;
+      unlockDevice();
+      ArUtil::sleep(1);
+    }
+    return NULL;
+  }
+  int getAdded(void) 
+  { int ret; lockDevice(); ret = myAdded; unlockDevice(); return ret; }
+protected:
+  int myAdded;
+};
+
+void compare(const char *what, double serial, double parallel)
+{
+  if (fabs(serial - parallel) > .00001)
+  {
+    printf("MISMATCH %s: serial %g parallel %g\n", what, serial, parallel);
+    errors++;
+  }
+}
+
+int main(void)
+{
+  Aria::init();
+  ArRobot robot;
+  ArRangeDevice device(10, 40000, "device", 30000);
+  ArPriorityResolver resolver;
+  std::vector<BoxAction *> boxes;
+  DriveAction drive;
+  ArResolver::ActionMap actions;
+  ArActionDesired serial, parallel;
+  int numActions, i, run;
+  long long serialTime, parallelTime;
+
+  robot.addRangeDevice(&device);
+  for (i = 0; i < 40000; i++)
+    device.getCumulativeRangeBuffer()->addReading(
+	    ArMath::random() % 20000 - 10000, ArMath::random() % 20000 - 10000);
+
+  drive.setRobot(&robot);
+  actions.insert(std::pair<int, ArAction *>(10, &drive));
+  for (numActions = 5; numActions <= 20; numActions += 5)
+  {
+    while ((int)boxes.size() < numActions)
+    {
+      boxes.push_back(new BoxAction(boxes.size()));
+      boxes.back()->setRobot(&robot);
+      // a few to each priority, so some get averaged together
+      actions.insert(std::pair<int, ArAction *>(100 - boxes.size() / 3, 
+						boxes.back()));
+    }
+
+    resolver.setParallelThreads(0);
+    ArTime start;
+    for (run = 0; run < 20; run++)
+      serial = *resolver.resolve(&actions, &robot);
+    serialTime = start.mSecSinceLL();
+
+    resolver.setParallelThreads(3);
+    start.setToNow();
+    for (run = 0; run < 20; run++)
+      parallel = *resolver.resolve(&actions, &robot);
+    parallelTime = start.mSecSinceLL();
+
+    compare("vel", serial.getVel(), parallel.getVel());
+    compare("vel strength", serial.getVelStrength(), 
+	    parallel.getVelStrength());
+    compare("max vel", serial.getMaxVel(), parallel.getMaxVel());
+    compare("delta heading", serial.getDeltaHeading(), 
+	    parallel.getDeltaHeading());
+    compare("delta heading strength", serial.getDeltaHeadingStrength(), 
+	    parallel.getDeltaHeadingStrength());
+    printf("%2d pure actions: serial %.2f ms/cycle, 3 threads %.2f ms/cycle (vel %.0f max vel %.0f heading %.1f)\n",
+	   numActions, serialTime / 20.0, parallelTime / 20.0, 
+	   parallel.getVel(), parallel.getMaxVel(), 
+	   parallel.getDeltaHeading());
+  }
+
+  // deactivating one between resolves must not mix up the results
+  boxes[3]->deactivate();
+  resolver.setParallelThreads(0);
+  serial = *resolver.resolve(&actions, &robot);
+  resolver.setParallelThreads(2);
+  parallel = *resolver.resolve(&actions, &robot);
+  compare("deactivated max vel", serial.getMaxVel(), parallel.getMaxVel());
+  compare("deactivated delta heading", serial.getDeltaHeading(), 
+	  parallel.getDeltaHeading());
+
+  resolver.setParallelThreads(0);
+
+  // the box checks against a device whose lock is its thread's mutex
+  ThreadedDevice threaded;
+  robot.remRangeDevice(&device);
+  robot.addRangeDevice(&threaded);
+  threaded.runAsync();
+  ArUtil::sleep(50);
+  for (run = 0; run < 2000; run++)
+    robot.checkRangeDevicesCurrentBox(-2000, -2000, 2000, 2000);
+  int added = threaded.getAdded();
+  ArUtil::sleep(100);
+  // if a check left the lock held the thread couldn't add any more
+  if (threaded.getAdded() == added)
+  {
+    printf("FAILED: threaded device stopped adding readings\n");
+    errors++;
+  }
+  threaded.stopRunning();
+  ArUtil::sleep(50);
+  robot.remRangeDevice(&threaded);
+
+  printf("%d errors\n", errors);
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
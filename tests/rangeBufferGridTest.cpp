@@ -0,0 +1,143 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+#include "Aria.h"
+
+/*
+  Compares closest reading searches on a pooled ArRangeBuffer with and
+  without a grid index, for cumulative buffers of 10k to 100k readings,
+  checking that both give the same answers and timing each.  The
+  searches are the kind the avoid and limiter actions do each cycle.
+*/
+
+int errors = 0;
+
+void fill(ArRangeBuffer *buffer, int numReadings, unsigned int seed)
+{
+  int i;
+  srand(seed);
+  for (i = 0; i < numReadings; i++)
+    buffer->addReading(rand() % 40000 - 20000, rand() % 40000 - 20000);
+}
+
+/// Does a bunch of searches, returns the total so they can be compared
+double search(ArRangeBuffer *buffer, int numSearches, unsigned int seed, 
+	      std::vector<double> *results)
+{
+  int i;
+  double total = 0;
+  double dist;
+  ArPose robot;
+  srand(seed);
+  for (i = 0; i < numSearches; i++)
+  {
+    robot.setPose(rand() % 30000 - 15000, rand() % 30000 - 15000, 
+		  rand() % 360 - 180);
+    // like ArActionLimiterForwards
+    dist = buffer->getClosestBox(0, -300, 1500, 300, robot, 5000);
+    results->push_back(dist);
+    total += dist;
+    // like ArActionAvoidFront
+    dist = buffer->getClosestPolar(-30, 30, robot, 3000);
+    results->push_back(dist);
+    total += dist;
+    // like ArActionDeceleratingLimiter's side checks
+    dist = buffer->getClosestBox(-300, 200, 300, 600, robot, 5000);
+    results->push_back(dist);
+    total += dist;
+  }
+  return total;
+}
+
+void run(int numReadings, double cellSize)
+{
+  ArRangeBuffer linear(numReadings);
+  ArRangeBuffer grid(numReadings);
+  std::vector<double> linearResults;
+  std::vector<double> gridResults;
+  ArTime start;
+  size_t i;
+  int numSearches = 500;
+  int mismatches = 0;
+
+  linear.setPooledStorage(true);
+  grid.setGridIndex(cellSize);
+
+  start.setToNow();
+  fill(&linear, numReadings, 42);
+  long long linearFill = start.mSecSinceLL();
+  start.setToNow();
+  fill(&grid, numReadings, 42);
+  long long gridFill = start.mSecSinceLL();
+
+  start.setToNow();
+  search(&linear, numSearches, 7, &linearResults);
+  long long linearSearch = start.mSecSinceLL();
+  start.setToNow();
+  search(&grid, numSearches, 7, &gridResults);
+  long long gridSearch = start.mSecSinceLL();
+
+  // move everything (like the robot's position getting corrected)
+  // and make sure things still line up
+  ArTransform trans(ArPose(250, -400, 15));
+  start.setToNow();
+  linear.applyTransform(trans);
+  long long linearTransform = start.mSecSinceLL();
+  start.setToNow();
+  grid.applyTransform(trans);
+  long long gridTransform = start.mSecSinceLL();
+  search(&linear, numSearches, 8, &linearResults);
+  search(&grid, numSearches, 8, &gridResults);
+
+  for (i = 0; i < linearResults.size() && i < gridResults.size(); i++)
+    if (fabs(linearResults[i] - gridResults[i]) > .001)
+      mismatches++;
+  if (mismatches > 0 || linearResults.size() != gridResults.size())
+  {
+    printf("MISMATCH %d of %d searches differ\n", mismatches, 
+	   (int)linearResults.size());
+    errors++;
+  }
+
+  printf("%6d readings: fill %4lld ms vs %4lld ms, %d searches %5lld ms vs %4lld ms, transform %3lld ms vs %3lld ms (linear vs grid %g mm)\n",
+	 numReadings, linearFill, gridFill, numSearches * 3, 
+	 linearSearch, gridSearch, linearTransform, gridTransform, cellSize);
+}
+
+int main(void)
+{
+  Aria::init();
+
+  run(10000, 500);
+  run(30000, 500);
+  run(100000, 500);
+  run(100000, 250);
+  run(100000, 1000);
+
+  printf("%d mismatches\n", errors);
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -0,0 +1,185 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Runs the same readings through a list ArRangeBuffer and a pooled
+  ArRangeBuffer, checks that they give the same answers, then times
+  adding readings and doing closest reading searches on each.
+*/
+
+int errors = 0;
+
+void check(const char *what, double a, double b)
+{
+  if (fabs(a - b) > .0001)
+  {
+    printf("MISMATCH %s: list %g pooled %g\n", what, a, b);
+    errors++;
+  }
+}
+
+void compare(ArRangeBuffer *list, ArRangeBuffer *pooled)
+{
+  ArPose robot(100, -200, 30);
+  ArPose listPos, pooledPos;
+  double listAngle = 0, pooledAngle = 0;
+  int i;
+
+  check("numReadings", list->getNumReadings(), pooled->getNumReadings());
+
+  std::vector<ArPoseWithTime> listVec = *list->getBufferAsVector();
+  std::vector<ArPoseWithTime> pooledVec = *pooled->getBufferAsVector();
+  check("vector size", listVec.size(), pooledVec.size());
+  for (i = 0; i < (int)listVec.size() && i < (int)pooledVec.size(); i++)
+  {
+    check("vector x", listVec[i].getX(), pooledVec[i].getX());
+    check("vector y", listVec[i].getY(), pooledVec[i].getY());
+  }
+
+  for (i = -180; i < 180; i += 45)
+  {
+    check("polar",
+	  list->getClosestPolar(i, i + 30, robot, 5000, &listAngle),
+	  pooled->getClosestPolar(i, i + 30, robot, 5000, &pooledAngle));
+    check("polar angle", listAngle, pooledAngle);
+  }
+  for (i = 0; i < 5; i++)
+  {
+    check("box",
+	  list->getClosestBox(-i * 500, -1000, i * 500 + 500, 1000, robot,
+			      5000, &listPos),
+	  pooled->getClosestBox(-i * 500, -1000, i * 500 + 500, 1000, robot,
+				5000, &pooledPos));
+    check("box x", listPos.getX(), pooledPos.getX());
+    check("box y", listPos.getY(), pooledPos.getY());
+  }
+}
+
+void invalidateSome(ArRangeBuffer *buffer)
+{
+  std::list<ArPoseWithTime *>::iterator it;
+  buffer->beginInvalidationSweep();
+  for (it = buffer->getBuffer()->begin(); it != buffer->getBuffer()->end();
+       ++it)
+    if ((*it)->getX() > 1500)
+      buffer->invalidateReading(it);
+  buffer->endInvalidationSweep();
+}
+
+void benchmark(ArRangeBuffer *buffer, const char *name, int numReadings)
+{
+  ArTime start;
+  ArPose robot(0, 0, 0);
+  int i;
+  double total = 0;
+
+  for (i = 0; i < numReadings; i++)
+    buffer->addReading(ArMath::random() % 8000 - 4000,
+		       ArMath::random() % 8000 - 4000);
+  long long addTime = start.mSecSinceLL();
+
+  start.setToNow();
+  for (i = 0; i < 100; i++)
+  {
+    total += buffer->getClosestPolar(-30, 30, robot, 5000);
+    total += buffer->getClosestBox(0, -300, 1000, 300, robot, 5000);
+  }
+  long long queryTime = start.mSecSinceLL();
+
+  start.setToNow();
+  for (i = 0; i < 100; i++)
+    invalidateSome(buffer);
+  long long sweepTime = start.mSecSinceLL();
+
+  printf("%-8s %d adds %lld ms, 200 queries %lld ms, 100 sweeps %lld ms (%g)\n",
+	 name, numReadings, addTime, queryTime, sweepTime, total);
+}
+
+int main(void)
+{
+  Aria::init();
+  ArRangeBuffer list(500);
+  ArRangeBuffer pooled(500);
+  int i;
+  double x, y;
+
+  pooled.setPooledStorage(true);
+
+  for (i = 0; i < 2000; i++)
+  {
+    x = ArMath::random() % 4000 - 2000;
+    y = ArMath::random() % 4000 - 2000;
+    list.addReading(x, y);
+    pooled.addReading(x, y);
+    if (i % 7 == 0)
+    {
+      list.addReadingConditional(y, x, 100 * 100);
+      pooled.addReadingConditional(y, x, 100 * 100);
+    }
+    if (i % 300 == 0)
+    {
+      invalidateSome(&list);
+      invalidateSome(&pooled);
+      compare(&list, &pooled);
+    }
+  }
+  compare(&list, &pooled);
+
+  list.beginRedoBuffer();
+  pooled.beginRedoBuffer();
+  for (i = 0; i < 100; i++)
+  {
+    list.redoReading(i * 10, -i * 10);
+    pooled.redoReading(i * 10, -i * 10);
+  }
+  list.endRedoBuffer();
+  pooled.endRedoBuffer();
+  compare(&list, &pooled);
+
+  list.setSize(50);
+  pooled.setSize(50);
+  compare(&list, &pooled);
+
+  list.applyTransform(ArTransform(ArPose(10, 20, 45)));
+  pooled.applyTransform(ArTransform(ArPose(10, 20, 45)));
+  compare(&list, &pooled);
+
+  // and switching back should leave the same readings
+  pooled.setPooledStorage(false);
+  compare(&list, &pooled);
+
+  printf("%d mismatches\n", errors);
+
+  ArRangeBuffer benchList(20000);
+  ArRangeBuffer benchPooled(20000);
+  benchPooled.setPooledStorage(true);
+  benchmark(&benchList, "list", 200000);
+  benchmark(&benchPooled, "pooled", 200000);
+
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -0,0 +1,153 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Runs an ArRobot (no connection needed) with a user task that moves
+  the robot to (counter, -counter) every cycle, and has reader threads
+  check that every ArRobot::getStateSnapshot() they get has a pose
+  that matches its counter and that the counters never go backwards.
+  Then times getting the pose and velocities with the snapshot, with
+  lockForRead() and with lock().
+*/
+
+ArRobot *robot;
+volatile bool running = true;
+int errors = 0;
+
+void task(void)
+{
+  robot->moveTo(ArPose(robot->getCounter(), -(double)robot->getCounter(), 0));
+}
+
+class ReaderThread : public ArASyncTask
+{
+public:
+  ReaderThread() : myReads(0), myErrors(0) {}
+  virtual void *runThread(void *)
+  {
+    ArRobotState state;
+    unsigned int lastCounter = 0;
+    while (running)
+    {
+      robot->getStateSnapshot(&state);
+      myReads++;
+      if (state.getCounter() < lastCounter)
+	myErrors++;
+      lastCounter = state.getCounter();
+      if (state.getCounter() > 1 &&
+	  (fabs(state.getPose().getX() - state.getCounter()) > .5 ||
+	   fabs(state.getPose().getY() + state.getCounter()) > .5))
+      {
+	if (myErrors++ < 5)
+	  printf("Inconsistent snapshot: counter %u pose %.0f %.0f\n", 
+		 state.getCounter(), state.getPose().getX(), 
+		 state.getPose().getY());
+      }
+    }
+    return NULL;
+  }
+  long myReads;
+  int myErrors;
+};
+
+double readState(int how)
+{
+  ArRobotState state;
+  if (how == 0)
+  {
+    robot->getStateSnapshot(&state);
+    return state.getPose().getX() + state.getVel() + state.getRotVel();
+  }
+  if (how == 1)
+    robot->lockForRead();
+  else
+    robot->lock();
+  double ret = robot->getX() + robot->getVel() + robot->getRotVel();
+  robot->unlock();
+  return ret;
+}
+
+int main(void)
+{
+  Aria::init();
+  ArGlobalFunctor taskCB(&task);
+  ReaderThread readers[4];
+  ArRobotState state;
+  unsigned int firstCounter;
+  long reads = 0;
+  int i, how;
+
+  robot = new ArRobot;
+  robot->getStateSnapshot(&state);
+  if (state.getCounter() != 0)
+  {
+    printf("Snapshot before the robot ran has counter %u\n", 
+	   state.getCounter());
+    errors++;
+  }
+  robot->setCycleTime(1);
+  robot->addUserTask("move", 50, &taskCB);
+  robot->runAsync(false);
+
+  for (i = 0; i < 4; i++)
+    readers[i].runAsync();
+  ArUtil::sleep(1000);
+  running = false;
+  for (i = 0; i < 4; i++)
+  {
+    readers[i].join();
+    reads += readers[i].myReads;
+    errors += readers[i].myErrors;
+  }
+  robot->getStateSnapshot(&state);
+  firstCounter = state.getCounter();
+  printf("%ld snapshots read over %u robot cycles\n", reads, firstCounter);
+  ArUtil::sleep(50);
+  robot->getStateSnapshot(&state);
+  if (state.getCounter() <= firstCounter)
+  {
+    printf("The snapshot isn't being updated\n");
+    errors++;
+  }
+  printf("%d errors\n", errors);
+
+  const char *names[3] = { "snapshot", "lockForRead", "lock" };
+  double total = 0;
+  for (how = 0; how < 3; how++)
+  {
+    ArTime start;
+    for (i = 0; i < 1000000; i++)
+      total += readState(how);
+    printf("1000000 reads with %-12s %lld ms\n", names[how], 
+	   start.mSecSinceLL());
+  }
+
+  robot->stopRunning();
+  robot->waitForRunExit();
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -0,0 +1,302 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Checks that ArRWMutex lets read locks overlap, keeps the write lock
+  exclusive, gives waiting writers priority and handles nested and
+  upgraded locks.  Then runs an ArRobot (no connection needed) with a
+  task that updates the pose and a range device every cycle the way
+  the robot's own thread does, while reader threads fetch the pose and
+  the readings as fast as they can, first with lock()/lockDevice() and
+  then with lockForRead()/lockDeviceForRead(), and prints how many
+  reads they got and how long the robot task waited for its lock.
+*/
+
+int errors = 0;
+
+void check(bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("FAILED: %s\n", what);
+    errors++;
+  }
+}
+
+/// Locks the mutex when asked and holds it until told to let go
+class LockThread : public ArASyncTask
+{
+public:
+  LockThread(ArRWMutex *mutex, bool forRead) : 
+    myMutex(mutex), myForRead(forRead), myGo(false), myLocked(false), 
+    myRelease(false) {}
+  virtual void *runThread(void *)
+  {
+    while (!myGo)
+      ArUtil::sleep(1);
+    if (myForRead)
+      myMutex->lockForRead();
+    else
+      myMutex->lock();
+    myLocked = true;
+    while (!myRelease)
+      ArUtil::sleep(1);
+    myMutex->unlock();
+    myLocked = false;
+    return NULL;
+  }
+  ArRWMutex *myMutex;
+  bool myForRead;
+  volatile bool myGo;
+  volatile bool myLocked;
+  volatile bool myRelease;
+};
+
+void testMutex(void)
+{
+  ArRWMutex mutex;
+  mutex.setLogName("testMutex");
+
+  // readers overlap, writers don't get in
+  LockThread reader(&mutex, true);
+  reader.runAsync();
+  reader.myGo = true;
+  while (!reader.myLocked)
+    ArUtil::sleep(1);
+  check(mutex.getNumReaders() == 1, "one reader");
+  check(mutex.tryLockForRead() == 0, "second reader gets in");
+  check(mutex.getNumReaders() == 2, "two readers");
+  mutex.unlock();
+  check(mutex.tryLock() == ArMutex::STATUS_ALREADY_LOCKED, 
+	"writer kept out by reader");
+
+  // a writer waits for the reader, and new readers wait for the writer
+  LockThread writer(&mutex, false);
+  writer.runAsync();
+  writer.myGo = true;
+  ArUtil::sleep(50);
+  check(!writer.myLocked, "writer waits for reader");
+  check(mutex.tryLockForRead() == ArMutex::STATUS_ALREADY_LOCKED, 
+	"new reader waits behind waiting writer");
+  reader.myRelease = true;
+  reader.join();
+  ArUtil::sleep(50);
+  check(writer.myLocked, "writer gets in after reader");
+  check(mutex.tryLockForRead() == ArMutex::STATUS_ALREADY_LOCKED, 
+	"reader kept out by writer");
+  check(mutex.tryLock() == ArMutex::STATUS_ALREADY_LOCKED, 
+	"writer kept out by writer");
+  writer.myRelease = true;
+  writer.join();
+
+  // nesting, reading while writing counts as writing
+  check(mutex.lock() == 0, "write lock");
+  check(mutex.lockForRead() == 0, "read inside write");
+  check(mutex.lock() == 0, "write inside read inside write");
+  check(mutex.getNumReaders() == 0, "no readers while nested in write");
+  mutex.unlock();
+  mutex.unlock();
+  LockThread nestedReader(&mutex, true);
+  nestedReader.runAsync();
+  nestedReader.myGo = true;
+  ArUtil::sleep(50);
+  check(!nestedReader.myLocked, "still write locked after inner unlocks");
+  mutex.unlock();
+  ArUtil::sleep(50);
+  check(nestedReader.myLocked, "unlocked after all unlocks");
+  nestedReader.myRelease = true;
+  nestedReader.join();
+
+  // upgrading from read to write when we're the only reader
+  check(mutex.lockForRead() == 0, "read lock");
+  check(mutex.lockForRead() == 0, "nested read lock");
+  check(mutex.lock() == 0, "upgrade to write");
+  LockThread upgradeReader(&mutex, true);
+  upgradeReader.runAsync();
+  upgradeReader.myGo = true;
+  ArUtil::sleep(50);
+  check(!upgradeReader.myLocked, "upgraded lock keeps readers out");
+  mutex.unlock();
+  ArUtil::sleep(50);
+  check(upgradeReader.myLocked, "back to reading after upgrade");
+  mutex.unlock();
+  mutex.unlock();
+  upgradeReader.myRelease = true;
+  upgradeReader.join();
+  check(mutex.getNumReaders() == 0, "no readers at the end");
+  check(mutex.tryLock() == 0, "free at the end");
+  mutex.unlock();
+}
+
+ArRobot *robot;
+ArRangeDevice *device;
+
+/// The work the robot thread does each cycle
+class RobotTask
+{
+public:
+  RobotTask() : myCB(this, &RobotTask::task) { reset(); }
+  void reset(void) { myCycles = 0; myWaitUSec = 0; myMaxWaitUSec = 0; }
+  void task(void)
+  {
+    unsigned long long start = ArUtil::getTimeUSec();
+    unsigned long long waited;
+    int i;
+
+    robot->lock();
+    waited = ArUtil::getTimeUSec() - start;
+    myCycles++;
+    myWaitUSec += waited;
+    if (waited > myMaxWaitUSec)
+      myMaxWaitUSec = waited;
+    robot->moveTo(ArPose(myCycles, -myCycles, myCycles % 360));
+    robot->unlock();
+
+    device->lockDevice();
+    device->getCurrentRangeBuffer()->beginRedoBuffer();
+    for (i = 0; i < 360; i++)
+      device->getCurrentRangeBuffer()->redoReading(
+	      cos(ArMath::degToRad(i)) * (1000 + myCycles % 100), 
+	      sin(ArMath::degToRad(i)) * (1000 + myCycles % 100));
+    device->getCurrentRangeBuffer()->endRedoBuffer();
+    device->unlockDevice();
+  }
+  ArFunctorC<RobotTask> myCB;
+  int myCycles;
+  unsigned long long myWaitUSec;
+  unsigned long long myMaxWaitUSec;
+};
+
+volatile bool readersRunning = false;
+volatile bool readForRead = false;
+
+/// Reads the pose and readings over and over, like a server handler would
+class ReaderThread : public ArASyncTask
+{
+public:
+  ReaderThread() : myReads(0), mySum(0) {}
+  virtual void *runThread(void *)
+  {
+    const std::list<ArPoseWithTime *> *readings;
+    std::list<ArPoseWithTime *>::const_iterator it;
+    ArPose pose;
+    bool forRead;
+
+    while (readersRunning)
+    {
+      // unlock the same way we locked even if the mode changes
+      forRead = readForRead;
+      if (forRead)
+	robot->lockForRead();
+      else
+	robot->lock();
+      pose = robot->getPose();
+      robot->unlock();
+      mySum += pose.getX();
+
+      if (forRead)
+	device->lockDeviceForRead();
+      else
+	device->lockDevice();
+      readings = device->getCurrentBuffer();
+      for (it = readings->begin(); it != readings->end(); it++)
+	mySum += (*it)->getX() * (*it)->getY();
+      if (forRead)
+	device->unlockDeviceForRead();
+      else
+	device->unlockDevice();
+      myReads++;
+    }
+    return NULL;
+  }
+  volatile long myReads;
+  double mySum;
+};
+
+void benchmark(int numReaders, bool forRead, RobotTask *task)
+{
+  std::vector<ReaderThread *> readers;
+  long reads = 0;
+  int i;
+
+  readForRead = forRead;
+  readersRunning = true;
+  for (i = 0; i < numReaders; i++)
+  {
+    readers.push_back(new ReaderThread);
+    readers.back()->runAsync();
+  }
+  robot->lock();
+  task->reset();
+  robot->unlock();
+  ArUtil::sleep(1000);
+  robot->lock();
+  int cycles = task->myCycles;
+  unsigned long long waitUSec = task->myWaitUSec;
+  unsigned long long maxWaitUSec = task->myMaxWaitUSec;
+  robot->unlock();
+  readersRunning = false;
+  for (i = 0; i < numReaders; i++)
+  {
+    readers[i]->join();
+    reads += readers[i]->myReads;
+    delete readers[i];
+  }
+  printf("%d readers %-13s %8ld reads/sec, robot task %d cycles waited avg %llu us max %llu us\n",
+	 numReaders, forRead ? "lockForRead" : "lock", reads, cycles,
+	 cycles > 0 ? waitUSec / cycles : 0, maxWaitUSec);
+}
+
+int main(void)
+{
+  Aria::init();
+  RobotTask task;
+  int numReaders;
+
+  testMutex();
+  printf("%d errors\n", errors);
+
+  robot = new ArRobot;
+  device = new ArRangeDevice(360, 0, "device", 5000);
+  device->getCurrentRangeBuffer()->setPooledStorage(true);
+  robot->addRangeDevice(device);
+  robot->setCycleTime(10);
+  robot->addUserTask("update", 50, &task.myCB);
+  robot->runAsync(false);
+
+  for (numReaders = 1; numReaders <= 8; numReaders *= 2)
+  {
+    benchmark(numReaders, false, &task);
+    benchmark(numReaders, true, &task);
+  }
+
+  robot->stopRunning();
+  robot->waitForRunExit();
+
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}
@@ -0,0 +1,114 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact
+Adept MobileRobots for information about a commercial version of ARIA at
+robots@mobilerobots.com or
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+#include "Aria.h"
+
+/*
+  Turns on the sync task timing in ArRobot, adds a couple of user
+  tasks that take a known amount of time, runs the cycle a bunch of
+  times (without a robot) and then logs the timing and checks that it
+  matches up.
+*/
+
+void quickTask(void)
+{
+  ArUtil::sleep(1);
+}
+
+int slowCount = 0;
+
+void slowTask(void)
+{
+  // take 30 ms usually, but every 10th time take 300 ms to cause an overrun
+  slowCount++;
+  if (slowCount % 10 == 0)
+    ArUtil::sleep(310);
+  else
+    ArUtil::sleep(40);
+}
+
+int main(void)
+{
+  Aria::init();
+  ArRobot robot;
+  ArGlobalFunctor quickCB(&quickTask);
+  ArGlobalFunctor slowCB(&slowTask);
+  ArTimingHistogram timing;
+  unsigned int overruns;
+  int i;
+  int ret = 0;
+
+  robot.addUserTask("quick", 50, &quickCB);
+  robot.addUserTask("slow", 40, &slowCB);
+  robot.setCycleWarningTime(250);
+
+  // these shouldn't count since timing is off
+  for (i = 0; i < 5; i++)
+    robot.loopOnce();
+  robot.getSyncTaskTiming("slow", &timing, &overruns);
+  if (timing.getCount() != 0)
+  {
+    printf("Timing was recorded while it was off\n");
+    ret = 1;
+  }
+
+  robot.setSyncTaskTimingEnabled(true);
+  slowCount = 0;
+  for (i = 0; i < 30; i++)
+    robot.loopOnce();
+
+  robot.logSyncTaskTiming();
+
+  robot.getSyncTaskTiming("slow", &timing, &overruns);
+  printf("slow: count %llu p50 %llu us max %llu us overruns %u\n",
+	 timing.getCount(), timing.getPercentile(50), timing.getMax(), 
+	 overruns);
+  if (timing.getCount() != 30 || overruns != 3 || 
+      timing.getPercentile(50) < 25000 || timing.getMax() < 250000)
+  {
+    printf("slow task timing is wrong\n");
+    ret = 1;
+  }
+  printf("cycle overruns %u\n", robot.getCycleOverrunCount());
+  if (robot.getCycleOverrunCount() != 3)
+  {
+    printf("cycle overrun count is wrong\n");
+    ret = 1;
+  }
+
+  robot.resetSyncTaskTiming();
+  robot.getSyncTaskTiming(NULL, &timing, &overruns);
+  if (timing.getCount() != 0 || overruns != 0)
+  {
+    printf("reset didn't work\n");
+    ret = 1;
+  }
+
+  if (ret == 0)
+    printf("Passed\n");
+  Aria::exit(ret);
+  return ret;
+}
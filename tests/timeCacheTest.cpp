@@ -0,0 +1,181 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004, 2005 ActivMedia Robotics LLC
+Copyright (C) 2006, 2007, 2008, 2009, 2010 MobileRobots Inc.
+Copyright (C) 2011, 2012, 2013 Adept Technology
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+If you wish to redistribute ARIA under different terms, contact 
+Adept MobileRobots for information about a commercial version of ARIA at 
+robots@mobilerobots.com or 
+Adept MobileRobots, 10 Columbia Drive, Amherst, NH 03031; +1-603-881-7960
+*/
+#include "Aria.h"
+
+/*
+  Checks ArTime's cached time (ArTime::refreshCachedNow and
+  setToCachedNow) stays put until it is refreshed, is only seen by the
+  thread that cached it, follows the virtual clock and that
+  ArRangeBuffer readings added with it share the one time.  Then times
+  a million ArTimes made each way (reading the clock, from the cached
+  time and without setting them).
+*/
+
+int errors = 0;
+
+void check(bool ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("FAILED: %s\n", what);
+    errors++;
+  }
+}
+
+/// Gets a cached time in another thread
+class OtherThread : public ArASyncTask
+{
+public:
+  OtherThread() : myHadCachedNow(true), myDone(false) {}
+  virtual void *runThread(void *)
+  {
+    myHadCachedNow = ArTime::hasCachedNow();
+    myTime.setToCachedNow();
+    myDone = true;
+    return NULL;
+  }
+  volatile bool myHadCachedNow;
+  volatile bool myDone;
+  ArTime myTime;
+};
+
+void testCache(void)
+{
+  ArTime none(ArTime::INIT_NONE);
+  check(none.getSecLL() == 0 && none.getMSecLL() == 0, 
+	"INIT_NONE leaves the time at 0");
+
+  // without a cached time it is just now
+  check(!ArTime::hasCachedNow(), "no cached time to start");
+  ArTime before;
+  ArTime cached(ArTime::INIT_CACHED_NOW);
+  check(before.mSecSinceLL(cached) >= 0 && before.mSecSinceLL(cached) < 5, 
+	"no cached time reads the clock");
+
+  // with one it stays put until refreshed
+  ArTime::refreshCachedNow();
+  check(ArTime::hasCachedNow(), "has cached time");
+  ArTime first(ArTime::INIT_CACHED_NOW);
+  ArUtil::sleep(30);
+  ArTime second;
+  second.setToCachedNow();
+  check(first.isAt(second), "cached time doesn't move");
+  ArPoseWithTime pose(1, 2, 3, ArTime::INIT_CACHED_NOW);
+  check(pose.getTime().isAt(first), "ArPoseWithTime gets cached time");
+  ArTime real;
+  check(first.mSecSinceLL(real) >= 15, "setToNow still reads the clock");
+
+  // other threads don't see it
+  OtherThread other;
+  other.runAsync();
+  while (!other.myDone)
+    ArUtil::sleep(1);
+  check(!other.myHadCachedNow, "other thread has no cached time");
+  check(first.mSecSinceLL(other.myTime) >= 15, 
+	"other thread reads the clock");
+
+  ArTime::refreshCachedNow();
+  ArTime third(ArTime::INIT_CACHED_NOW);
+  check(first.mSecSinceLL(third) >= 15, "refresh moves the cached time");
+
+  // range buffer readings share the cached time
+  ArRangeBuffer buffer(10);
+  buffer.setPooledStorage(true);
+  buffer.addReading(0, 0);
+  ArUtil::sleep(20);
+  buffer.addReading(1000, 1000);
+  std::vector<ArPoseWithTime> *readings = buffer.getBufferAsVector();
+  check(readings->size() == 2, "two readings");
+  if (readings->size() == 2)
+    check((*readings)[0].getTime().isAt(third) && 
+	  (*readings)[1].getTime().isAt(third), 
+	  "range buffer readings have cached time");
+
+  ArTime::clearCachedNow();
+  check(!ArTime::hasCachedNow(), "cleared");
+  ArTime fourth(ArTime::INIT_CACHED_NOW);
+  check(first.mSecSinceLL(fourth) >= 30, "cleared reads the clock");
+
+  // the cached time comes from the virtual clock when that's used
+  ArTime::setUseVirtualClock(true);
+  ArTime virtualStart;
+  ArTime::refreshCachedNow();
+  ArTime::advanceVirtualClock(1000);
+  ArTime virtualCached(ArTime::INIT_CACHED_NOW);
+  check(virtualCached.isAt(virtualStart), "cached from virtual clock");
+  ArTime::refreshCachedNow();
+  virtualCached.setToCachedNow();
+  check(virtualStart.mSecSinceLL(virtualCached) == 1000, 
+	"refreshed from virtual clock");
+  ArTime::clearCachedNow();
+  ArTime::setUseVirtualClock(false);
+}
+
+void benchmark(void)
+{
+  int i;
+  int num = 1000000;
+  unsigned long long total = 0;
+  ArTime start;
+
+  for (i = 0; i < num; i++)
+  {
+    ArTime t;
+    total += t.getMSecLL();
+  }
+  long long nowTime = start.mSecSinceLL();
+
+  ArTime::refreshCachedNow();
+  start.setToNow();
+  for (i = 0; i < num; i++)
+  {
+    ArTime t(ArTime::INIT_CACHED_NOW);
+    total += t.getMSecLL();
+  }
+  long long cachedTime = start.mSecSinceLL();
+  ArTime::clearCachedNow();
+
+  start.setToNow();
+  for (i = 0; i < num; i++)
+  {
+    ArTime t(ArTime::INIT_NONE);
+    total += t.getMSecLL();
+  }
+  long long noneTime = start.mSecSinceLL();
+
+  printf("%d ArTimes: now %lld ms, cached %lld ms, none %lld ms (%llu)\n",
+	 num, nowTime, cachedTime, noneTime, total);
+}
+
+int main(void)
+{
+  Aria::init();
+  testCache();
+  printf("%d errors\n", errors);
+  benchmark();
+  Aria::exit(errors == 0 ? 0 : 1);
+  return 0;
+}